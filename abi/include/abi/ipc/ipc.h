@@ -57,6 +57,16 @@ enum {
 	 * IPC_M_DATA_READ requests.
 	 */
 	DATA_XFER_LIMIT = 64 * 1024,
+
+	/**
+	 * Maximum buffer size allowed for IPC_M_DATA_WRITE and
+	 * IPC_M_DATA_READ requests whose buffers are page-aligned
+	 * and large enough to be transferred without an intermediate
+	 * kernel buffer. The data of such IPC_M_DATA_WRITE requests is
+	 * read from the source buffer when the request is answered, so
+	 * the buffer must not be modified until then.
+	 */
+	DATA_XFER_PINNED_LIMIT = 16 * 1024 * 1024,
 };
 
 /* Flags for calls */
@@ -112,7 +112,8 @@ enum {
 	/** Share a single page over IPC.
 	 *
 	 * - ARG1 - page-aligned offset from the beginning of the memory object
-	 * - ARG2 - page size
+	 * - ARG2 - page size ORed with the AS_AREA_READ, AS_AREA_WRITE and
+	 *          AS_AREA_EXEC flags of the faulting area
 	 * - ARG3 - user defined memory object ID
 	 * - ARG4 - user defined memory object ID
 	 * - ARG5 - user defined memory object ID
@@ -48,6 +48,7 @@ enum {
 	/** Maximum name sizes */
 	TASK_NAME_BUFLEN = 64,
 	EXC_NAME_BUFLEN  = 20,
+	SLAB_NAME_BUFLEN = 20,
 };
 
 /** Item value type
@@ -70,6 +71,12 @@ typedef struct {
 	uint16_t frequency_mhz;  /**< Frequency in MHz */
 	uint64_t idle_cycles;    /**< Number of idle cycles */
 	uint64_t busy_cycles;    /**< Number of busy cycles */
+	size_t nrdy;             /**< Number of ready threads */
+	uint64_t idle_pulls;     /**< Threads pulled in when going idle */
+	uint64_t lb_steals;      /**< Threads stolen by the load balancer */
+	uint64_t wakeup_migrations;  /**< Threads woken up away from last CPU */
+	uint64_t frame_cache_hits;    /**< Allocations served by the frame cache */
+	uint64_t frame_cache_misses;  /**< Frame cache refills */
 } stats_cpu_t;
 
 /** Physical memory statistics
@@ -104,6 +111,8 @@ typedef struct {
 	char name[TASK_NAME_BUFLEN];  /**< Task name (in kernel) */
 	size_t virtmem;               /**< Size of VAS (bytes) */
 	size_t resmem;                /**< Size of resident (used) memory (bytes) */
+	size_t large_pages;           /**< Number of mapped large pages */
+	size_t large_page_fallbacks;  /**< Large page faults served by small pages */
 	size_t threads;               /**< Number of threads */
 	uint64_t ucycles;             /**< Number of CPU cycles in user space */
 	uint64_t kcycles;             /**< Number of CPU cycles in kernel */
@@ -143,6 +152,24 @@ typedef struct {
 	uint64_t count;              /**< Number of handled exceptions */
 } stats_exc_t;
 
+/** Statistics about a single slab cache
+ *
+ */
+typedef struct {
+	char name[SLAB_NAME_BUFLEN];  /**< Cache name */
+	size_t size;                  /**< Object size (bytes) */
+	size_t slabs;                 /**< Number of allocated slabs */
+	size_t allocated;             /**< Number of allocated objects */
+	size_t cached;                /**< Number of objects in magazines */
+	size_t mag_size;              /**< Size of new magazines (0 if none) */
+	size_t magazines;             /**< Number of full magazines in depot */
+	uint64_t alloc_hits;          /**< Allocations served from magazines */
+	uint64_t alloc_misses;        /**< Allocations which went to slabs */
+	uint64_t free_hits;           /**< Frees stored into magazines */
+	uint64_t free_misses;         /**< Frees which went to slabs */
+	uint64_t depot_contention;    /**< Contended magazine depot locks */
+} stats_slab_t;
+
 /** Load fixed-point value */
 typedef uint32_t load_t;
 
@@ -44,6 +44,7 @@
 #define INTEL_CPUID_EXTENDED  0x80000000
 #define INTEL_SSE2            26
 #define INTEL_FXSAVE          24
+#define INTEL_HTT             28
 
 #ifndef __ASSEMBLER__
 
@@ -158,6 +158,18 @@ extern uintptr_t physmem_base;
 #define PTE_EXECUTABLE_ARCH(pte) \
 	get_pt_executable((pte_t *) (pte))
 
+/* Large pages are mapped directly by level 2 block descriptors. */
+#define LARGE_PAGE_WIDTH  PTL2_VA_SHIFT
+#define LARGE_PAGE_SIZE   (1 << LARGE_PAGE_WIDTH)
+
+#define PTL3_LARGE_ARCH(ptl2, i) \
+	(((pte_t *) (ptl2))[(i)].valid && \
+	    ((pte_t *) (ptl2))[(i)].type == PTE_L012_TYPE_BLOCK)
+#define GET_LARGE_FLAGS_ARCH(ptl2, i) \
+	get_pt_level3_flags((pte_t *) (ptl2), (size_t) (i))
+#define SET_LARGE_FLAGS_ARCH(ptl2, i, x) \
+	set_pt_level2_block_flags((pte_t *) (ptl2), (size_t) (i), (x))
+
 /* Level 3 access permissions. */
 
 /** Data access permission. User mode: no access, privileged mode: read/write.
@@ -209,8 +221,8 @@ extern uintptr_t physmem_base;
 #define PTE_L3_TYPE_PAGE  1
 
 /** HelenOS descriptor type. Table for level 0, 1, 2 page translation tables,
- * page for level 3 tables. Block descriptors are not used by HelenOS during
- * normal processing.
+ * page for level 3 tables. Block descriptors are used by HelenOS only for
+ * large pages in level 2 tables.
  */
 #define PTE_L0123_TYPE_HELENOS  1
 
@@ -244,8 +256,8 @@ extern uintptr_t physmem_base;
 /** Page Table Entry.
  *
  * HelenOS model:
- * * Level 0, 1, 2 translation tables hold next-level table descriptors. Block
- *   descriptors are not used during normal processing.
+ * * Level 0, 1, 2 translation tables hold next-level table descriptors. Level
+ *   2 tables may also hold 2MB block descriptors of large pages.
  * * Level 3 tables store 4kB page descriptors.
  */
 typedef struct {
@@ -377,6 +389,24 @@ _NO_TRACE static inline void set_pt_level3_flags(pte_t *pt, size_t i,
 	p->not_global = (flags & PAGE_GLOBAL) == 0;
 }
 
+/** Sets flags of level 2 block descriptor.
+ *
+ * Block descriptors share the attribute layout of level 3 page descriptors
+ * and differ only in the descriptor type.
+ *
+ * @param pt    Level 2 page table.
+ * @param i     Index of the entry to be changed.
+ * @param flags New flags.
+ */
+_NO_TRACE static inline void set_pt_level2_block_flags(pte_t *pt, size_t i,
+    int flags)
+{
+	pte_t *p = &pt[i];
+
+	set_pt_level3_flags(pt, i, flags);
+	p->type = PTE_L012_TYPE_BLOCK;
+}
+
 /** Sets the present flag of page table entry.
  *
  * @param pt Level 0, 1, 2, 3 page table.
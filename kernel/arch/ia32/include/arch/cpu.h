@@ -81,6 +81,9 @@ typedef struct {
 	tss_t *tss;
 
 	size_t iomapver_copy;  /** Copy of TASK's I/O Permission bitmap generation count. */
+
+	uint32_t l_apic_tick;     /** Local APIC timer count of one clock tick. */
+	uint32_t l_apic_oneshot;  /** Initial count of the one-shot local APIC timer. */
 } cpu_arch_t;
 
 #endif
@@ -143,6 +143,21 @@ void cpu_identify(void)
 		CPU->arch.family = (info.cpuid_eax >> 8) & 0x0fU;
 		CPU->arch.model = (info.cpuid_eax >> 4) & 0x0fU;
 		CPU->arch.stepping = (info.cpuid_eax >> 0) & 0x0fU;
+
+		/*
+		 * Derive the package from the initial APIC ID. All logical
+		 * processors of a package share the last level cache.
+		 */
+		unsigned int apic_id = (info.cpuid_ebx >> 24) & 0xffU;
+		unsigned int shift = 0;
+		if (info.cpuid_edx & (1 << INTEL_HTT)) {
+			unsigned int logical = (info.cpuid_ebx >> 16) & 0xffU;
+			while ((1U << shift) < logical)
+				shift++;
+		}
+
+		CPU->package = apic_id >> shift;
+		CPU->cache_domain = CPU->package;
 	}
 }
 
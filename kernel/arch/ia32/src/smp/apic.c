@@ -40,6 +40,8 @@
 #include <assert.h>
 #include <mm/page.h>
 #include <time/delay.h>
+#include <time/clock.h>
+#include <cpu.h>
 #include <interrupt.h>
 #include <arch/interrupt.h>
 #include <log.h>
@@ -427,6 +429,64 @@ int l_apic_send_init_ipi(uint8_t apicid)
 	return apic_poll_errors();
 }
 
+/** Switch the local APIC timer to one-shot mode.
+ *
+ * @param ticks Number of clock ticks until the interrupt.
+ *
+ * @return Number of clock ticks actually programmed.
+ *
+ */
+static uint64_t l_apic_timer_oneshot(uint64_t ticks)
+{
+	uint32_t tick = CPU->arch.l_apic_tick;
+
+	if (ticks > UINT32_MAX / tick)
+		ticks = UINT32_MAX / tick;
+
+	lvt_tm_t tm;
+
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_ONESHOT;
+	l_apic[LVT_Tm] = tm.value;
+
+	CPU->arch.l_apic_oneshot = (uint32_t) ticks * tick;
+	l_apic[ICRT] = CPU->arch.l_apic_oneshot;
+
+	return ticks;
+}
+
+/** Switch the local APIC timer back to periodic mode.
+ *
+ * @return Number of whole clock ticks spent in one-shot mode.
+ *
+ */
+static uint64_t l_apic_timer_periodic(void)
+{
+	uint32_t left = l_apic[CCRT];
+
+	lvt_tm_t tm;
+
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_PERIODIC;
+	l_apic[LVT_Tm] = tm.value;
+	l_apic[ICRT] = CPU->arch.l_apic_tick;
+
+	return (CPU->arch.l_apic_oneshot - left) / CPU->arch.l_apic_tick;
+}
+
+/** Wake up a processor in tickless idle. */
+static void l_apic_timer_wakeup(cpu_t *cpu)
+{
+	(void) l_apic_send_custom_ipi((uint8_t) cpu->arch.id,
+	    VECTOR_WAKEUP_IPI);
+}
+
+static clock_oneshot_ops_t l_apic_timer_ops = {
+	.oneshot = l_apic_timer_oneshot,
+	.periodic = l_apic_timer_periodic,
+	.wakeup = l_apic_timer_wakeup
+};
+
 /** Initialize Local APIC. */
 void l_apic_init(void)
 {
@@ -510,7 +570,9 @@ void l_apic_init(void)
 	delay(1000000 / HZ);
 	uint32_t t2 = l_apic[CCRT];
 
-	l_apic[ICRT] = t1 - t2;
+	CPU->arch.l_apic_tick = t1 - t2;
+	l_apic[ICRT] = CPU->arch.l_apic_tick;
+	clock_oneshot_register(&l_apic_timer_ops);
 
 	/* Program Logical Destination Register. */
 	assert(CPU->id < 8);
@@ -36,12 +36,22 @@
 
 #include <smp/ipi.h>
 #include <arch/smp/apic.h>
+#include <cpu.h>
+#include <cpu/cpu_mask.h>
 
 void ipi_broadcast_arch(int ipi)
 {
 	(void) l_apic_broadcast_custom_ipi((uint8_t) ipi);
 }
 
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	cpu_mask_for_each(*mask, i) {
+		(void) l_apic_send_custom_ipi((uint8_t) cpus[i].arch.id,
+		    (uint8_t) ipi);
+	}
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -36,6 +36,7 @@
 #include <arch/mach/msim/msim.h>
 #include <stdint.h>
 #include <smp/ipi.h>
+#include <cpu/cpu_mask.h>
 #include <interrupt.h>
 #include <arch/asm.h>
 #include <typedefs.h>
@@ -49,6 +50,17 @@ void ipi_broadcast_arch(int ipi)
 	pio_write_32(((ioport32_t *) MSIM_DORDER_ADDRESS), 0x7fffffff);
 }
 
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	uint32_t targets = 0;
+
+	cpu_mask_for_each(*mask, i) {
+		targets |= 1U << i;
+	}
+
+	pio_write_32(((ioport32_t *) MSIM_DORDER_ADDRESS), targets);
+}
+
 #endif
 
 static irq_ownership_t dorder_claim(irq_t *irq)
@@ -36,6 +36,7 @@
 #include <arch/barrier.h>
 #include <assert.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
 #include <arch.h>
 #include <arch/cpu.h>
 #include <arch/asm.h>
@@ -130,6 +131,17 @@ static void cross_call(int mid, void (*func)(void))
 	preemption_enable();
 }
 
+/** Map IPI number to the function to be invoked by the recipients. */
+static void (*ipi_func(int ipi))(void)
+{
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		return tlb_shootdown_ipi_recv;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+	}
+}
+
 /*
  * Deliver IPI to all processors except the current one.
  *
@@ -146,16 +158,7 @@ void ipi_broadcast_arch(int ipi)
 {
 	unsigned int i;
 
-	void (*func)(void);
-
-	switch (ipi) {
-	case IPI_TLB_SHOOTDOWN:
-		func = tlb_shootdown_ipi_recv;
-		break;
-	default:
-		panic("Unknown IPI (%d).\n", ipi);
-		break;
-	}
+	void (*func)(void) = ipi_func(ipi);
 
 	/*
 	 * As long as we don't support hot-plugging
@@ -172,5 +175,21 @@ void ipi_broadcast_arch(int ipi)
 	}
 }
 
+/** Deliver IPI to a set of processors.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param mask Processors to deliver the IPI to.
+ * @param ipi  IPI number.
+ */
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	void (*func)(void) = ipi_func(ipi);
+
+	cpu_mask_for_each(*mask, i) {
+		cross_call(cpus[i].arch.mid, func);
+	}
+}
+
 /** @}
  */
@@ -34,6 +34,7 @@
 
 #include <smp/ipi.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
 #include <config.h>
 #include <interrupt.h>
 #include <arch/asm.h>
@@ -87,6 +88,17 @@ uint64_t ipi_unicast_to(void (*func)(void), uint16_t cpu_id)
 	return ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], 1);
 }
 
+/** Map IPI number to the function to be invoked by the recipients. */
+static void (*ipi_func(int ipi))(void)
+{
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		return tlb_shootdown_ipi_recv;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+	}
+}
+
 /*
  * Deliver IPI to all processors except the current one.
  *
@@ -96,16 +108,7 @@ uint64_t ipi_unicast_to(void (*func)(void), uint16_t cpu_id)
  */
 void ipi_broadcast_arch(int ipi)
 {
-	void (*func)(void);
-
-	switch (ipi) {
-	case IPI_TLB_SHOOTDOWN:
-		func = tlb_shootdown_ipi_recv;
-		break;
-	default:
-		panic("Unknown IPI (%d).\n", ipi);
-		break;
-	}
+	void (*func)(void) = ipi_func(ipi);
 
 	unsigned int i;
 	unsigned idx = 0;
@@ -121,5 +124,25 @@ void ipi_broadcast_arch(int ipi)
 	ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], idx);
 }
 
+/** Deliver IPI to a set of processors.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param mask Processors to deliver the IPI to.
+ * @param ipi  IPI number.
+ */
+void ipi_multicast_arch(cpu_mask_t *mask, int ipi)
+{
+	void (*func)(void) = ipi_func(ipi);
+	unsigned idx = 0;
+
+	cpu_mask_for_each(*mask, i) {
+		ipi_cpu_list[CPU->arch.id][idx] = (uint16_t) cpus[i].id;
+		idx++;
+	}
+
+	ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], idx);
+}
+
 /** @}
  */
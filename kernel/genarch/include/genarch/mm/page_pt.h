@@ -139,6 +139,17 @@
 #define PTE_WRITABLE(p)    PTE_WRITABLE_ARCH((p))
 #define PTE_EXECUTABLE(p)  PTE_EXECUTABLE_ARCH((p))
 
+/*
+ * Macros for large pages mapped directly by PTL2 entries. Architectures that
+ * support them define LARGE_PAGE_SIZE.
+ *
+ */
+#ifdef LARGE_PAGE_SIZE
+#define PTL3_LARGE(ptl2, i)          PTL3_LARGE_ARCH(ptl2, i)
+#define GET_LARGE_FLAGS(ptl2, i)     GET_LARGE_FLAGS_ARCH(ptl2, i)
+#define SET_LARGE_FLAGS(ptl2, i, x)  SET_LARGE_FLAGS_ARCH(ptl2, i, x)
+#endif
+
 extern as_operations_t as_pt_operations;
 extern page_mapping_operations_t pt_mapping_operations;
 
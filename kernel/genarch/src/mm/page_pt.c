@@ -41,6 +41,7 @@
 #include <mm/frame.h>
 #include <mm/km.h>
 #include <mm/as.h>
+#include <mm/tlb.h>
 #include <arch/mm/page.h>
 #include <arch/mm/as.h>
 #include <barrier.h>
@@ -50,8 +51,14 @@
 #include <align.h>
 #include <macros.h>
 #include <bitops.h>
+#include <atomic.h>
 
 static void pt_mapping_insert(as_t *, uintptr_t, uintptr_t, unsigned int);
+#ifdef LARGE_PAGE_SIZE
+static bool pt_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+static void pt_mapping_split(as_t *, uintptr_t);
+#endif
 static void pt_mapping_remove(as_t *, uintptr_t);
 static bool pt_mapping_find(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_update(as_t *, uintptr_t, bool, pte_t *pte);
@@ -59,25 +66,25 @@ static void pt_mapping_make_global(uintptr_t, size_t);
 
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
+#ifdef LARGE_PAGE_SIZE
+	.mapping_insert_large = pt_mapping_insert_large,
+	.mapping_split = pt_mapping_split,
+#endif
 	.mapping_remove = pt_mapping_remove,
 	.mapping_find = pt_mapping_find,
 	.mapping_update = pt_mapping_update,
 	.mapping_make_global = pt_mapping_make_global
 };
 
-/** Map page to frame using hierarchical page tables.
+/** Get the PTL2 table for a page, allocating missing PTL1 and PTL2 tables.
  *
- * Map virtual address page to physical address frame
- * using flags.
+ * @param as   Address space to which page belongs.
+ * @param page Virtual address of the page.
  *
- * @param as    Address space to wich page belongs.
- * @param page  Virtual address of the page to be mapped.
- * @param frame Physical address of memory frame to which the mapping is done.
- * @param flags Flags to be used for mapping.
+ * @return Kernel address of the PTL2 table.
  *
  */
-void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
-    unsigned int flags)
+static pte_t *pt_ptl2_get(as_t *as, uintptr_t page)
 {
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 
@@ -117,7 +124,160 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL2_PRESENT(ptl1, PTL1_INDEX(page));
 	}
 
+	return (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+}
+
+#ifdef LARGE_PAGE_SIZE
+
+/** Test whether a PTL2 entry maps a large page.
+ *
+ * @param ptl2 PTL2 table.
+ * @param page Virtual address within the large page.
+ *
+ * @return True if the PTL2 entry for page maps a large page.
+ *
+ */
+static bool pt_large_mapped(pte_t *ptl2, uintptr_t page)
+{
+	return (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)) &&
+	    PTL3_LARGE(ptl2, PTL2_INDEX(page));
+}
+
+/** Replace a large page mapping by an equivalent PTL3 table.
+ *
+ * The small page mappings translate to the same frames with the same flags,
+ * so the caller may go on changing individual pages of the former large page.
+ *
+ * The function may sleep and performs its own TLB shootdown, so it must not
+ * be called within another TLB shootdown sequence.
+ *
+ * @param as   Address space to which page belongs.
+ * @param ptl2 PTL2 table with the large page mapping.
+ * @param page Virtual address within the large page.
+ *
+ */
+static void pt_large_split(as_t *as, pte_t *ptl2, uintptr_t page)
+{
+	uintptr_t base = ALIGN_DOWN(page, LARGE_PAGE_SIZE);
+	uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page));
+	unsigned int flags = GET_LARGE_FLAGS(ptl2, PTL2_INDEX(page));
+
+	assert(page_table_locked(as));
+
+	pte_t *newpt = (pte_t *)
+	    PA2KA(frame_alloc(PTL3_FRAMES, FRAME_LOWMEM, PTL3_SIZE - 1));
+	memsetb(newpt, PTL3_SIZE, 0);
+	for (size_t i = 0; i < PTL3_ENTRIES; i++) {
+		SET_FRAME_ADDRESS(newpt, i, frame + P2SZ(i));
+		SET_FRAME_FLAGS(newpt, i, flags);
+	}
+
+	/*
+	 * The large page entry must be gone from all TLBs before it is turned
+	 * into a table pointer. The other processors using the address space
+	 * wait until the shootdown is finalized and flush their TLBs then.
+	 */
+	ipl_t ipl = tlb_shootdown_as_start(as, base,
+	    LARGE_PAGE_SIZE / PAGE_SIZE);
+
+	memsetb(&ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+	tlb_invalidate_pages(as->asid, base, 1);
+
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), KA2PA(newpt));
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page),
+	    PAGE_NOT_PRESENT | PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE |
+	    PAGE_WRITE);
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, PTL2_INDEX(page));
+
+	tlb_shootdown_finalize(ipl);
+
+	atomic_dec(&as->large_pages);
+}
+
+/** Split a large page which spans across a page boundary.
+ *
+ * @param as   Address space to which page belongs.
+ * @param page Virtual address of the boundary.
+ *
+ */
+void pt_mapping_split(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	if (IS_ALIGNED(page, LARGE_PAGE_SIZE))
+		return;
+
+	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
 	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	if (pt_large_mapped(ptl2, page))
+		pt_large_split(as, ptl2, page);
+}
+
+/** Map a large page to a block of frames using a PTL2 entry.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the large page, aligned to LARGE_PAGE_SIZE.
+ * @param frame Physical address of the block of frames, aligned to
+ *              LARGE_PAGE_SIZE.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the large page was mapped, false if the PTL2 entry already
+ *         points to a PTL3 table or maps another large page.
+ *
+ */
+bool pt_mapping_insert_large(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	assert(IS_ALIGNED(frame, LARGE_PAGE_SIZE));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+	if (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT))
+		return false;
+
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), frame);
+	SET_LARGE_FLAGS(ptl2, PTL2_INDEX(page), flags | PAGE_NOT_PRESENT);
+	/*
+	 * Make the new mapping visible only after it is fully initialized.
+	 */
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, PTL2_INDEX(page));
+
+	atomic_inc(&as->large_pages);
+	return true;
+}
+
+#endif /* LARGE_PAGE_SIZE */
+
+/** Map page to frame using hierarchical page tables.
+ *
+ * Map virtual address page to physical address frame
+ * using flags.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the page to be mapped.
+ * @param frame Physical address of memory frame to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ *
+ */
+void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+#ifdef LARGE_PAGE_SIZE
+	if (pt_large_mapped(ptl2, page))
+		pt_large_split(as, ptl2, page);
+#endif
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
@@ -177,6 +337,26 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+	bool empty = true;
+	unsigned int i;
+
+#ifdef LARGE_PAGE_SIZE
+	if (PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		/*
+		 * Large pages are removed as a whole, page by page in
+		 * ascending order, within a single TLB shootdown sequence.
+		 * Keep the large page until its last page is removed so that
+		 * the caller can still find the frames of the other pages.
+		 */
+		if (PTL3_INDEX(page) != PTL3_ENTRIES - 1)
+			return;
+
+		memsetb(&ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+		atomic_dec(&as->large_pages);
+		goto check_ptl2;
+	}
+#endif
+
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
 	/*
@@ -195,9 +375,6 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	 */
 
 	/* Check PTL3 */
-	bool empty = true;
-
-	unsigned int i;
 	for (i = 0; i < PTL3_ENTRIES; i++) {
 		if (PTE_VALID(&ptl3[i])) {
 			empty = false;
@@ -234,6 +411,9 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 
 	/* Check PTL2, empty is still true */
 #if (PTL2_ENTRIES != 0)
+#ifdef LARGE_PAGE_SIZE
+check_ptl2:
+#endif
 	for (i = 0; i < PTL2_ENTRIES; i++) {
 		if (PTE_VALID(&ptl2[i])) {
 			empty = false;
@@ -291,8 +471,21 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 #endif /* PTL1_ENTRIES != 0 */
 }
 
-static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
+/** Find the PTE of a page in hierarchical page tables.
+ *
+ * @param as         Address space to which page belongs.
+ * @param page       Virtual page.
+ * @param nolock     True if the page tables need not be locked.
+ * @param[out] large Set to true if the returned entry is a PTL2 entry mapping
+ *                   a large page which contains page.
+ *
+ * @return Pointer to the PTE or NULL if page is not mapped.
+ */
+static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock,
+    bool *large)
 {
+	*large = false;
+
 	assert(nolock || page_table_locked(as));
 
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
@@ -316,6 +509,13 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+#ifdef LARGE_PAGE_SIZE
+	if (PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		*large = true;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+#endif
+
 #if (PTL2_ENTRIES != 0)
 	/*
 	 * Always read ptl3 only after we are sure it is present.
@@ -339,10 +539,30 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
  */
 bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
-	if (t)
-		*pte = *t;
-	return t != NULL;
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
+	if (!t)
+		return false;
+
+#ifdef LARGE_PAGE_SIZE
+	if (large) {
+		/*
+		 * Describe the small page within the large page so that the
+		 * callers need not know about large pages at all.
+		 */
+		uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(t, 0) +
+		    (ALIGN_DOWN(page, PAGE_SIZE) & (LARGE_PAGE_SIZE - 1));
+		unsigned int flags = GET_LARGE_FLAGS(t, 0);
+
+		memsetb(pte, sizeof(pte_t), 0);
+		SET_FRAME_ADDRESS(pte, 0, frame);
+		SET_FRAME_FLAGS(pte, 0, flags);
+		return true;
+	}
+#endif
+
+	*pte = *t;
+	return true;
 }
 
 /** Update mapping for virtual page in hierarchical page tables.
@@ -354,10 +574,20 @@ bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
  */
 void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
 	if (!t)
 		panic("Updating non-existent PTE");
 
+#ifdef LARGE_PAGE_SIZE
+	if (large) {
+		/* A single small page cannot be updated within a large page. */
+		assert(!nolock);
+		pt_large_split(as, t - PTL2_INDEX(page), page);
+		t = pt_mapping_find_internal(as, page, nolock, &large);
+	}
+#endif
+
 	assert(PTE_VALID(t) == PTE_VALID(pte));
 	assert(PTE_PRESENT(t) == PTE_PRESENT(pte));
 	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
@@ -36,6 +36,8 @@
 #define KERN_CPU_H_
 
 #include <mm/tlb.h>
+#include <mm/frame.h>
+#include <time/timeout_wheel.h>
 #include <synch/spinlock.h>
 #include <proc/scheduler.h>
 #include <arch/cpu.h>
@@ -61,8 +63,17 @@ typedef struct cpu {
 	runq_t rq[RQ_COUNT];
 	volatile size_t needs_relink;
 
+	/**
+	 * Scheduler statistics.
+	 */
+	atomic_t idle_pulls;        /**< Threads pulled in when going idle. */
+	atomic_t lb_steals;         /**< Threads stolen by kcpulb. */
+	atomic_t wakeup_migrations; /**< Threads woken up here, not on their last CPU. */
+
+	frame_cache_t frame_cache;
+
 	IRQ_SPINLOCK_DECLARE(timeoutlock);
-	list_t timeout_active_list;
+	timeout_wheel_t timeout_wheel;
 
 	/**
 	 * When system clock loses a tick, it is
@@ -73,6 +84,20 @@ typedef struct cpu {
 	 */
 	size_t missed_clock_ticks;
 
+	/**
+	 * Ticks slept through in tickless idle. Unlike missed
+	 * ticks, they are already reflected in the uptime.
+	 * CPU-local, accessed with interrupts disabled.
+	 */
+	size_t idle_clock_ticks;
+
+	/**
+	 * Whether the clock device of the processor is in one-shot
+	 * mode, armed for tickless_ticks ticks.
+	 */
+	atomic_bool tickless;
+	uint64_t tickless_ticks;
+
 	/**
 	 * Processor cycle accounting.
 	 */
@@ -86,6 +111,15 @@ typedef struct cpu {
 	 */
 	unsigned int id;
 
+	/**
+	 * Processor topology as detected by the architecture code.
+	 * Processors with the same cache_domain share the last level
+	 * cache, processors with the same node share local memory.
+	 */
+	unsigned int package;
+	unsigned int cache_domain;
+	unsigned int node;
+
 	bool active;
 	volatile bool tlb_active;
 
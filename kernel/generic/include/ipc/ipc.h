@@ -165,6 +165,14 @@ typedef struct call {
 
 	/** Buffer for IPC_M_DATA_WRITE and IPC_M_DATA_READ. */
 	uint8_t *buffer;
+
+	/**
+	 * Frames pinned instead of the buffer for page-aligned
+	 * IPC_M_DATA_WRITE and IPC_M_DATA_READ transfers.
+	 */
+	uintptr_t *frames;
+	/** Number of entries in frames. */
+	size_t frame_count;
 } call_t;
 
 extern slab_cache_t *phone_cache;
@@ -184,6 +192,9 @@ extern errno_t ipc_forward(call_t *, phone_t *, answerbox_t *, unsigned int);
 extern void ipc_answer(answerbox_t *, call_t *);
 extern void _ipc_answer_free_call(call_t *, bool);
 
+extern errno_t ipc_call_pin_buffer(call_t *, uspace_addr_t, size_t);
+extern errno_t ipc_call_copy_pinned(call_t *, uspace_addr_t, size_t);
+
 extern void ipc_phone_init(phone_t *, struct task *);
 extern bool ipc_phone_connect(phone_t *, answerbox_t *);
 extern errno_t ipc_phone_hangup(phone_t *);
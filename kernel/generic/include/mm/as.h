@@ -131,6 +131,33 @@ typedef struct as {
 
 	/** Architecture specific content. */
 	as_arch_t arch;
+
+	/** Number of large pages mapped in this address space. */
+	atomic_size_t large_pages;
+
+	/** Number of large page faults which had to fall back to small pages. */
+	atomic_size_t large_page_fallbacks;
+
+#ifdef CONFIG_SMP
+	/** Protects the TLB shootdown state below. */
+	IRQ_SPINLOCK_DECLARE(tlb_lock);
+
+	/**
+	 * Processors on which the address space is active. NULL for the
+	 * kernel address space, whose shootdowns go to all processors.
+	 */
+	struct cpu_mask *tlb_cpus;
+
+	/**
+	 * Processors which were not active during a TLB shootdown of the
+	 * address space and need to invalidate its ASID once they switch to
+	 * it again.
+	 */
+	struct cpu_mask *tlb_stale;
+
+	/** A TLB shootdown of the address space is in progress. */
+	atomic_bool tlb_shootdown;
+#endif
 } as_t;
 
 typedef struct {
@@ -338,6 +365,8 @@ extern void as_pagemap_remove(as_page_mapping_t *);
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
 extern size_t as_area_get_size(uintptr_t);
+extern errno_t as_pin_frames(uintptr_t, size_t, uintptr_t *);
+extern void as_unpin_frames(uintptr_t *, size_t);
 extern used_space_ival_t *used_space_first(used_space_t *);
 extern used_space_ival_t *used_space_next(used_space_ival_t *);
 extern used_space_ival_t *used_space_find_gteq(used_space_t *, uintptr_t);
@@ -38,6 +38,7 @@
 
 #include <typedefs.h>
 #include <trace.h>
+#include <atomic.h>
 #include <adt/bitmap.h>
 #include <adt/list.h>
 #include <synch/spinlock.h>
@@ -47,6 +48,17 @@
 /** Maximum number of zones in the system. */
 #define ZONES_MAX  32
 
+/** Number of block orders kept in the per-CPU frame caches. */
+#define FRAME_CACHE_ORDERS  4
+/** Capacity of a per-CPU frame cache of one order, in blocks. */
+#define FRAME_CACHE_SIZE    32
+/** Number of blocks moved between a frame cache and the zones at once. */
+#define FRAME_CACHE_BATCH   16
+
+/** Order of the blocks tracked by the buddy index of a zone. */
+#define FRAME_BUDDY_ORDER   4
+#define FRAME_BUDDY_FRAMES  (1 << FRAME_BUDDY_ORDER)
+
 typedef uint8_t frame_flags_t;
 
 #define FRAME_NONE        0x00
@@ -90,8 +102,8 @@ typedef uint8_t zone_flags_t;
 	    (((zf) & ~ZONE_EF_MASK) & (f)))
 
 typedef struct {
-	size_t refcount;  /**< Tracking of shared frames */
-	void *parent;     /**< If allocated by slab, this points there */
+	atomic_size_t refcount;  /**< Tracking of shared frames */
+	void *parent;            /**< If allocated by slab, this points there */
 } frame_t;
 
 typedef struct {
@@ -113,6 +125,12 @@ typedef struct {
 	/** Frame bitmap */
 	bitmap_t bitmap;
 
+	/**
+	 * Buddy index, one bit per FRAME_BUDDY_FRAMES aligned frames
+	 * of the zone, set if all of them are free.
+	 */
+	bitmap_t buddy;
+
 	/** Array of frame_t structures in this zone */
 	frame_t *frames;
 } zone_t;
@@ -129,6 +147,25 @@ typedef struct {
 
 extern zones_t zones;
 
+/** Per-CPU cache of free naturally aligned blocks of frames
+ *
+ * The cached frames are busy in their zones. Blocks are kept
+ * separately for low memory and high memory allocations.
+ *
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+	size_t count[2][FRAME_CACHE_ORDERS];
+	pfn_t blocks[2][FRAME_CACHE_ORDERS][FRAME_CACHE_SIZE];
+
+	/** Number of cached frames. */
+	size_t frames;
+	/** Allocations served from the cache. */
+	uint64_t hits;
+	/** Cacheable allocations which had to refill the cache. */
+	uint64_t misses;
+} frame_cache_t;
+
 extern void frame_init(void);
 extern bool frame_adjust_zone_bounds(bool, uintptr_t *, size_t *);
 extern uintptr_t frame_alloc_generic(size_t, frame_flags_t, uintptr_t,
@@ -139,6 +176,8 @@ extern void frame_free(uintptr_t, size_t);
 extern void frame_free_noreserve(uintptr_t, size_t);
 extern void frame_reference_add(pfn_t);
 extern size_t frame_total_free_get(void);
+extern void frame_cache_initialize(frame_cache_t *);
+extern size_t frame_cache_drain_all(void);
 
 extern size_t find_zone(pfn_t, size_t, size_t);
 extern size_t zone_create(pfn_t, size_t, pfn_t, zone_flags_t);
@@ -39,10 +39,20 @@
 #include <synch/spinlock.h>
 #include <atomic.h>
 #include <mm/frame.h>
+#include <abi/sysinfo.h>
 
-/** Initial Magazine size (TODO: dynamically growing magazines) */
+/** Initial Magazine size */
 #define SLAB_MAG_SIZE  4
 
+/** Number of magazine sizes, each twice the size of the previous one */
+#define SLAB_MAG_SIZES  5
+
+/** Maximum magazine size */
+#define SLAB_MAG_SIZE_MAX  (SLAB_MAG_SIZE << (SLAB_MAG_SIZES - 1))
+
+/** Number of depot lock contentions after which the magazines grow */
+#define SLAB_MAG_GROW_CONTENTION  16
+
 /** If object size is less, store control structure inside SLAB */
 #define SLAB_INSIDE_SIZE  (PAGE_SIZE >> 3)
 
@@ -75,6 +85,12 @@ typedef struct {
 	slab_magazine_t *current;
 	slab_magazine_t *last;
 	IRQ_SPINLOCK_DECLARE(lock);
+
+	/* Statistics, protected by lock */
+	uint64_t alloc_hits;    /**< Allocations served from magazines */
+	uint64_t alloc_misses;  /**< Allocations which went to slabs */
+	uint64_t free_hits;     /**< Frees stored into magazines */
+	uint64_t free_misses;   /**< Frees which went to slabs */
 } slab_mag_cache_t;
 
 typedef struct {
@@ -103,6 +119,13 @@ typedef struct {
 	atomic_t cached_objs;
 	/** How many magazines in magazines list */
 	atomic_t magazine_counter;
+	/** Number of times the magazine list lock was contended */
+	uint64_t depot_contention;
+	/** Value of depot_contention when mag_size last changed */
+	uint64_t depot_contention_mark;
+
+	/** Size of newly allocated magazines */
+	size_t mag_size;
 
 	/* Slabs */
 	list_t full_slabs;     /**< List of full slabs */
@@ -131,6 +154,11 @@ extern void slab_enable_cpucache(void);
 
 /* kconsole debug */
 extern void slab_print_list(void);
+extern void slab_print_magazines(void);
+
+/* sysinfo statistics */
+extern size_t slab_cache_count(void);
+extern size_t slab_get_stats(stats_slab_t *, size_t);
 
 #endif
 
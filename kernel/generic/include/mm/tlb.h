@@ -37,6 +37,8 @@
 
 #include <arch/mm/asid.h>
 #include <typedefs.h>
+#include <atomic.h>
+#include <errno.h>
 
 /**
  * Number of TLB shootdown messages that can be queued in processor tlb_messages
@@ -44,6 +46,12 @@
  */
 #define TLB_MESSAGE_QUEUE_LEN	10
 
+/**
+ * Shootdowns of more pages than this invalidate the whole address space
+ * instead, which is cheaper than invalidating the pages one by one.
+ */
+#define TLB_SHOOTDOWN_PAGES_MAX	32
+
 /** Type of TLB shootdown message. */
 typedef enum {
 	/** Invalid type. */
@@ -64,17 +72,38 @@ typedef struct {
 	size_t count;			/**< Number of pages to invalidate. */
 } tlb_shootdown_msg_t;
 
+struct as;
+
+/** Number of TLB shootdowns. */
+extern atomic_size_t tlb_shootdowns;
+/** Number of TLB shootdown IPIs sent to other processors. */
+extern atomic_size_t tlb_shootdown_ipis;
+/** Number of deferred TLB invalidations done when switching address spaces. */
+extern atomic_size_t tlb_lazy_invalidations;
+
 extern void tlb_init(void);
 
 #ifdef CONFIG_SMP
 extern ipl_t tlb_shootdown_start(tlb_invalidate_type_t, asid_t, uintptr_t,
     size_t);
+extern ipl_t tlb_shootdown_as_start(struct as *, uintptr_t, size_t);
 extern void tlb_shootdown_finalize(ipl_t);
 extern void tlb_shootdown_ipi_recv(void);
+
+extern errno_t tlb_as_create(struct as *);
+extern void tlb_as_destroy(struct as *);
+extern void tlb_as_install(struct as *);
+extern void tlb_as_deinstall(struct as *);
 #else
 #define tlb_shootdown_start(w, x, y, z)	interrupts_disable()
+#define tlb_shootdown_as_start(x, y, z)	interrupts_disable()
 #define tlb_shootdown_finalize(i)	(interrupts_restore(i));
 #define tlb_shootdown_ipi_recv()
+
+#define tlb_as_create(as)	EOK
+#define tlb_as_destroy(as)
+#define tlb_as_install(as)
+#define tlb_as_deinstall(as)
 #endif /* CONFIG_SMP */
 
 /* Export TLB interface that each architecture must implement. */
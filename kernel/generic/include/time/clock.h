@@ -36,9 +36,12 @@
 #define KERN_CLOCK_H_
 
 #include <typedefs.h>
+#include <atomic.h>
 
 #define HZ  100
 
+struct cpu;
+
 /** Uptime structure */
 typedef struct {
 	sysarg_t seconds1;
@@ -46,10 +49,39 @@ typedef struct {
 	sysarg_t seconds2;
 } uptime_t;
 
+/** One-shot operations of a per-CPU clock device
+ *
+ * A clock device which can stop its periodic tick lets idle
+ * processors sleep until their next timeout. All operations
+ * act on the device of the current CPU, except for wakeup().
+ *
+ */
+typedef struct {
+	/** Interrupt once after the given number of ticks instead of every tick.
+	 *
+	 * @return Number of ticks actually programmed, at least one.
+	 */
+	uint64_t (*oneshot)(uint64_t);
+	/** Resume the periodic tick.
+	 *
+	 * @return Number of whole ticks elapsed since oneshot().
+	 */
+	uint64_t (*periodic)(void);
+	/** Interrupt a processor sleeping in tickless idle. */
+	void (*wakeup)(struct cpu *);
+} clock_oneshot_ops_t;
+
 extern uptime_t *uptime;
 
+extern atomic_size_t clock_idle_wakeups;
+extern atomic_size_t clock_skipped_ticks;
+
 extern void clock(void);
 extern void clock_counter_init(void);
+extern void clock_oneshot_register(clock_oneshot_ops_t *);
+extern void clock_idle_enter(void);
+extern void clock_idle_exit(void);
+extern void clock_idle_kick(struct cpu *);
 
 #endif
 
@@ -44,9 +44,9 @@ typedef void (*timeout_handler_t)(void *arg);
 typedef struct {
 	IRQ_SPINLOCK_DECLARE(lock);
 
-	/** Link to the list of active timeouts on CURRENT->cpu */
+	/** Link to the timeout wheel of CURRENT->cpu */
 	link_t link;
-	/** Timeout will be activated in this amount of clock() ticks. */
+	/** Tick of the timeout wheel in which the timeout will be activated. */
 	uint64_t ticks;
 	/** Function that will be called on timeout activation. */
 	timeout_handler_t handler;
@@ -63,6 +63,8 @@ extern void timeout_initialize(timeout_t *);
 extern void timeout_reinitialize(timeout_t *);
 extern void timeout_register(timeout_t *, uint64_t, timeout_handler_t, void *);
 extern bool timeout_unregister(timeout_t *);
+extern void timeout_wheel_advance(void);
+extern uint64_t timeout_wheel_next(void);
 
 #endif
 
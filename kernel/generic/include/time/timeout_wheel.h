@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_time
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_TIMEOUT_WHEEL_H_
+#define KERN_TIMEOUT_WHEEL_H_
+
+#include <adt/list.h>
+#include <stdint.h>
+
+#define TIMEOUT_WHEEL_BITS    6
+#define TIMEOUT_WHEEL_SLOTS   (1 << TIMEOUT_WHEEL_BITS)
+#define TIMEOUT_WHEEL_MASK    (TIMEOUT_WHEEL_SLOTS - 1)
+#define TIMEOUT_WHEEL_LEVELS  5
+
+/** Hierarchical timing wheel of one processor
+ *
+ * Slot s of level l holds the timeouts which expire in a period of
+ * TIMEOUT_WHEEL_SLOTS^l ticks. Once the wheel reaches such a period, the
+ * slot is cascaded into the level below. Timeouts further away than the
+ * wheel reaches wait in the top level and are cascaded repeatedly.
+ *
+ */
+typedef struct {
+	/** Tick to be processed next. */
+	uint64_t tick;
+	/** Pending timeouts. */
+	list_t slots[TIMEOUT_WHEEL_LEVELS][TIMEOUT_WHEEL_SLOTS];
+	/** Expired timeouts whose handlers have not been run yet. */
+	list_t expired;
+} timeout_wheel_t;
+
+#endif
+
+/** @}
+ */
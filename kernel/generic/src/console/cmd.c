@@ -503,6 +503,14 @@ static cmd_info_t caches_info = {
 	.argc = 0
 };
 
+static int cmd_magazines(cmd_arg_t *argv);
+static cmd_info_t magazines_info = {
+	.name = "magazines",
+	.description = "Show per-CPU magazine statistics of slab caches.",
+	.func = cmd_magazines,
+	.argc = 0
+};
+
 static int cmd_sysinfo(cmd_arg_t *argv);
 static cmd_info_t sysinfo_info = {
 	.name = "sysinfo",
@@ -586,6 +594,7 @@ static cmd_info_t *basic_commands[] = {
 	&call0_info,
 	&mcall0_info,
 	&caches_info,
+	&magazines_info,
 	&call1_info,
 	&call2_info,
 	&call3_info,
@@ -1203,6 +1212,18 @@ int cmd_caches(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for listing magazine statistics of slab caches
+ *
+ * @param argv Ignored
+ *
+ * @return Always 1
+ */
+int cmd_magazines(cmd_arg_t *argv)
+{
+	slab_print_magazines();
+	return 1;
+}
+
 /** Command for dumping sysinfo
  *
  * @param argv Ignores
@@ -84,6 +84,7 @@ void cpu_init(void)
 			cpus[i].id = i;
 
 			irq_spinlock_initialize(&cpus[i].lock, "cpus[].lock");
+			frame_cache_initialize(&cpus[i].frame_cache);
 
 			for (unsigned int j = 0; j < RQ_COUNT; j++) {
 				irq_spinlock_initialize(&cpus[i].rq[j].lock, "cpus[].rq[].lock");
@@ -105,6 +106,17 @@ void cpu_init(void)
 	CPU->idle_cycles = 0;
 	CPU->busy_cycles = 0;
 
+	CPU->idle_clock_ticks = 0;
+	atomic_store(&CPU->tickless, false);
+
+	/*
+	 * Unless the architecture code knows better, assume that
+	 * every processor has its own cache and all share one node.
+	 */
+	CPU->package = CPU->id;
+	CPU->cache_domain = CPU->id;
+	CPU->node = 0;
+
 	cpu_identify();
 	cpu_arch_init();
 }
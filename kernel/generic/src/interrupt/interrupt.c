@@ -45,6 +45,7 @@
 #include <console/console.h>
 #include <console/cmd.h>
 #include <synch/mutex.h>
+#include <time/clock.h>
 #include <time/delay.h>
 #include <macros.h>
 #include <panic.h>
@@ -119,6 +120,9 @@ _NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 		CPU->last_cycle = now;
 		CPU->idle = false;
 		irq_spinlock_unlock(&CPU->lock, false);
+
+		atomic_inc(&clock_idle_wakeups);
+		clock_idle_exit();
 	}
 
 	uint64_t begin_cycle = get_cycle();
@@ -58,12 +58,26 @@
 #include <console/console.h>
 #include <proc/thread.h>
 #include <arch/interrupt.h>
+#include <mm/as.h>
+#include <mm/km.h>
+#include <mm/page.h>
+#include <syscall/copy.h>
+#include <config.h>
+#include <align.h>
+#include <macros.h>
 #include <ipc/irq.h>
 #include <cap/cap.h>
 #include <stdlib.h>
 
 static void ipc_forget_call(call_t *);
 
+/**
+ * Minimum size of a page-aligned data transfer for which the frames are
+ * pinned instead of buffering the data in the kernel. Smaller transfers
+ * are cheaper to copy twice.
+ */
+#define IPC_PIN_MIN_SIZE  (4 * PAGE_SIZE)
+
 /** Answerbox that new tasks are automatically connected to */
 answerbox_t *ipc_box_0 = NULL;
 
@@ -86,6 +100,8 @@ static void _ipc_call_init(call_t *call)
 	call->sender = NULL;
 	call->callerbox = NULL;
 	call->buffer = NULL;
+	call->frames = NULL;
+	call->frame_count = 0;
 }
 
 static void call_destroy(void *arg)
@@ -94,6 +110,10 @@ static void call_destroy(void *arg)
 
 	if (call->buffer)
 		free(call->buffer);
+	if (call->frames) {
+		as_unpin_frames(call->frames, call->frame_count);
+		free(call->frames);
+	}
 	if (call->caller_phone)
 		kobject_put(call->caller_phone->kobject);
 	slab_free(call_cache, call);
@@ -103,6 +123,92 @@ kobject_ops_t call_kobject_ops = {
 	.destroy = call_destroy
 };
 
+/** Pin the frames of a data transfer buffer in the current address space.
+ *
+ * Instead of copying the data into a kernel buffer, the frames backing
+ * the buffer are pinned and the data is copied directly from them to the
+ * final destination by ipc_call_copy_pinned(). The frames are unpinned
+ * when the call is destroyed.
+ *
+ * Unlike with the kernel buffer, modifications of the buffer made by the
+ * sender before the data is copied are visible to the recipient.
+ *
+ * @param call Call which transfers the data.
+ * @param src  Userspace address of the buffer.
+ * @param size Size of the buffer.
+ *
+ * @return EOK on success.
+ * @return ENOTSUP if the buffer is not suitable for pinning. The caller
+ *         should fall back to buffering the data in the kernel.
+ * @return ENOMEM if there is not enough memory.
+ *
+ */
+errno_t ipc_call_pin_buffer(call_t *call, uspace_addr_t src, size_t size)
+{
+	assert(!call->buffer);
+	assert(!call->frames);
+
+	if ((!IS_ALIGNED(src, PAGE_SIZE)) || (size < IPC_PIN_MIN_SIZE) ||
+	    (size > DATA_XFER_PINNED_LIMIT))
+		return ENOTSUP;
+
+	size_t count = SIZE2FRAMES(size);
+	uintptr_t *frames = malloc(count * sizeof(uintptr_t));
+	if (!frames)
+		return ENOMEM;
+
+	errno_t rc = as_pin_frames(src, count, frames);
+	if (rc != EOK) {
+		free(frames);
+		return rc;
+	}
+
+	call->frames = frames;
+	call->frame_count = count;
+	return EOK;
+}
+
+/** Copy data from pinned frames to the current address space.
+ *
+ * @param call Call with frames pinned by ipc_call_pin_buffer().
+ * @param dst  Userspace destination address.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code from copy_to_uspace().
+ *
+ */
+errno_t ipc_call_copy_pinned(call_t *call, uspace_addr_t dst, size_t size)
+{
+	assert(call->frames);
+	assert(size <= FRAMES2SIZE(call->frame_count));
+
+	for (size_t i = 0; size > 0; i++) {
+		uintptr_t frame = call->frames[i];
+		size_t chunk = min(size, (size_t) PAGE_SIZE);
+		uintptr_t page;
+
+		if (frame >= config.identity_size) {
+			page = km_map(frame, PAGE_SIZE, PAGE_SIZE,
+			    PAGE_READ | PAGE_CACHEABLE);
+		} else {
+			page = PA2KA(frame);
+		}
+
+		errno_t rc = copy_to_uspace(dst, (void *) page, chunk);
+
+		if (km_is_non_identity(page))
+			km_unmap(page, PAGE_SIZE);
+
+		if (rc != EOK)
+			return rc;
+
+		dst += chunk;
+		size -= chunk;
+	}
+
+	return EOK;
+}
+
 /** Allocate and initialize a call structure.
  *
  * The call is initialized, so that the reply will be directed to
@@ -44,11 +44,16 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 {
 	size_t size = ipc_get_arg2(&call->data);
 
-	if (size > DATA_XFER_LIMIT) {
+	/*
+	 * Transfers larger than DATA_XFER_LIMIT may still succeed if the
+	 * answering side provides a buffer which can be pinned. This is
+	 * decided in answer_preprocess().
+	 */
+	if (size > DATA_XFER_PINNED_LIMIT) {
 		int flags = ipc_get_arg3(&call->data);
 
 		if (flags & IPC_XF_RESTRICT)
-			ipc_set_arg2(&call->data, DATA_XFER_LIMIT);
+			ipc_set_arg2(&call->data, DATA_XFER_PINNED_LIMIT);
 		else
 			return ELIMIT;
 	}
@@ -59,6 +64,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
 	assert(!answer->buffer);
+	assert(!answer->frames);
 
 	if (!ipc_get_retval(&answer->data)) {
 		/* The recipient agreed to send data. */
@@ -74,13 +80,36 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			 */
 			ipc_set_arg1(&answer->data, dst);
 
+			/*
+			 * Try to pin the source frames so that the data can
+			 * be copied directly to the destination.
+			 */
+			errno_t rc = ipc_call_pin_buffer(answer, src, size);
+			if (rc == EOK)
+				return EOK;
+			if (rc != ENOTSUP) {
+				ipc_set_retval(&answer->data, rc);
+				return EOK;
+			}
+
+			if (size > DATA_XFER_LIMIT) {
+				int flags = ipc_get_arg3(olddata);
+
+				if (flags & IPC_XF_RESTRICT) {
+					size = DATA_XFER_LIMIT;
+					ipc_set_arg2(&answer->data, size);
+				} else {
+					ipc_set_retval(&answer->data, ELIMIT);
+					return EOK;
+				}
+			}
+
 			answer->buffer = malloc(size);
 			if (!answer->buffer) {
 				ipc_set_retval(&answer->data, ENOMEM);
 				return EOK;
 			}
-			errno_t rc = copy_from_uspace(answer->buffer,
-			    src, size);
+			rc = copy_from_uspace(answer->buffer, src, size);
 			if (rc) {
 				ipc_set_retval(&answer->data, rc);
 				/*
@@ -101,12 +130,15 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 
 static errno_t answer_process(call_t *answer)
 {
-	if (answer->buffer) {
+	if (answer->buffer || answer->frames) {
 		uspace_addr_t dst = ipc_get_arg1(&answer->data);
 		size_t size = ipc_get_arg2(&answer->data);
 		errno_t rc;
 
-		rc = copy_to_uspace(dst, answer->buffer, size);
+		if (answer->frames)
+			rc = ipc_call_copy_pinned(answer, dst, size);
+		else
+			rc = copy_to_uspace(dst, answer->buffer, size);
 		if (rc)
 			ipc_set_retval(&answer->data, rc);
 	}
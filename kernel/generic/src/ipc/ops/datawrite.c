@@ -45,6 +45,18 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 	uspace_addr_t src = ipc_get_arg1(&call->data);
 	size_t size = ipc_get_arg2(&call->data);
 
+	/*
+	 * Large page-aligned buffers are not copied into the kernel. Their
+	 * frames are pinned instead and the data is copied directly to the
+	 * recipient once it accepts it. The recipient therefore sees the
+	 * contents of the buffer at the time of the answer, not at the time
+	 * of the request. The sender must not modify the buffer until the
+	 * call is answered.
+	 */
+	errno_t rc = ipc_call_pin_buffer(call, src, size);
+	if (rc != ENOTSUP)
+		return rc;
+
 	if (size > DATA_XFER_LIMIT) {
 		int flags = ipc_get_arg3(&call->data);
 
@@ -58,7 +70,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 	call->buffer = (uint8_t *) malloc(size);
 	if (!call->buffer)
 		return ENOMEM;
-	errno_t rc = copy_from_uspace(call->buffer, src, size);
+	rc = copy_from_uspace(call->buffer, src, size);
 	if (rc != EOK) {
 		/*
 		 * call->buffer will be cleaned up in ipc_call_free() at the
@@ -72,7 +84,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
-	assert(answer->buffer);
+	assert(answer->buffer || answer->frames);
 
 	if (!ipc_get_retval(&answer->data)) {
 		/* The recipient agreed to receive data. */
@@ -81,8 +93,12 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		size_t max_size = ipc_get_arg2(olddata);
 
 		if (size <= max_size) {
-			errno_t rc = copy_to_uspace(dst,
-			    answer->buffer, size);
+			errno_t rc;
+
+			if (answer->frames)
+				rc = ipc_call_copy_pinned(answer, dst, size);
+			else
+				rc = copy_to_uspace(dst, answer->buffer, size);
 			if (rc)
 				ipc_set_retval(&answer->data, rc);
 		} else {
@@ -53,6 +53,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/tlb.h>
+#include <mm/reserve.h>
 #include <arch/mm/page.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
@@ -183,6 +184,13 @@ as_t *as_create(unsigned int flags)
 
 	refcount_init(&as->refcount);
 	as->cpu_refcount = 0;
+	atomic_store(&as->large_pages, 0);
+	atomic_store(&as->large_page_fallbacks, 0);
+
+	if (tlb_as_create(as) != EOK) {
+		slab_free(as_cache, as);
+		return NULL;
+	}
 
 #ifdef AS_PAGE_TABLE
 	as->genarch.page_table = page_table_create(flags);
@@ -269,6 +277,7 @@ retry:
 	page_table_destroy(NULL);
 #endif
 
+	tlb_as_destroy(as);
 	slab_free(as_cache, as);
 }
 
@@ -468,13 +477,14 @@ _NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
  * @param bound   Lowest address bound.
  * @param size    Requested size of the allocation.
  * @param guarded True if the allocation must be protected by guard pages.
+ * @param align   Required alignment of the area, a multiple of PAGE_SIZE.
  *
  * @return Address of the beginning of unmapped address space area.
  * @return -1 if no suitable address space area was found.
  *
  */
 _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
-    size_t size, bool guarded)
+    size_t size, bool guarded, size_t align)
 {
 	assert(mutex_locked(&as->lock));
 
@@ -505,7 +515,9 @@ _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 			addr += P2SZ(1);
 		}
 
-		if (check_area_conflicts(as, addr, pages, guarded, NULL))
+		addr = ALIGN_UP(addr, align);
+		if ((addr >= bound) &&
+		    (check_area_conflicts(as, addr, pages, guarded, NULL)))
 			return addr;
 	}
 
@@ -524,6 +536,8 @@ _NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 			addr += P2SZ(1);
 		}
 
+		addr = ALIGN_UP(addr, align);
+
 		bool avail =
 		    ((addr >= bound) && (addr >= area->base) &&
 		    (check_area_conflicts(as, addr, pages, guarded, area)));
@@ -761,7 +775,18 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 	mutex_lock(&as->lock);
 
 	if (*base == (uintptr_t) AS_AREA_ANY) {
-		*base = as_get_unmapped_area(as, bound, size, guarded);
+		size_t align = PAGE_SIZE;
+
+#ifdef LARGE_PAGE_SIZE
+		/*
+		 * Place areas which want large pages so that they can be
+		 * backed by them from their very beginning.
+		 */
+		if (flags & AS_AREA_LARGE_PAGES)
+			align = LARGE_PAGE_SIZE;
+#endif
+
+		*base = as_get_unmapped_area(as, bound, size, guarded, align);
 		if (*base == (uintptr_t) -1) {
 			mutex_unlock(&as->lock);
 			return NULL;
@@ -950,13 +975,18 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 
 		page_table_lock(as, false);
 
+		/*
+		 * A large page across the new end of the area is removed only
+		 * partly, so it must be split into small pages beforehand.
+		 */
+		page_mapping_split(as, start_free);
+
 		/*
 		 * Start TLB shootdown sequence.
 		 */
 
-		ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-		    as->asid, area->base + P2SZ(pages),
-		    area->pages - pages);
+		ipl_t ipl = tlb_shootdown_as_start(as,
+		    area->base + P2SZ(pages), area->pages - pages);
 
 		/*
 		 * Remove frames belonging to used space starting from
@@ -1104,8 +1134,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_as_start(as, area->base, area->pages);
 
 	/*
 	 * Visit only the pages mapped by used_space.
@@ -1404,8 +1433,7 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_as_start(as, area->base, area->pages);
 
 	/*
 	 * Remove used pages from page tables and remember their frame
@@ -1663,6 +1691,7 @@ retry:
 		 * is being removed from the CPU.
 		 */
 		as_deinstall_arch(old_as);
+		tlb_as_deinstall(old_as);
 	}
 
 	/*
@@ -1685,6 +1714,12 @@ retry:
 	 */
 	as_install_arch(new_as);
 
+	/*
+	 * Catch up with TLB shootdowns of the new address space which
+	 * happened while it was not active on this processor.
+	 */
+	tlb_as_install(new_as);
+
 	spinlock_unlock(&asidlock);
 
 	AS = new_as;
@@ -1843,6 +1878,113 @@ size_t as_area_get_size(uintptr_t base)
 	return size;
 }
 
+/** Pin frames backing anonymous memory of the current address space.
+ *
+ * Each page in the range is faulted in if it is not present yet and the
+ * frame backing it receives an extra reference. The frames therefore remain
+ * allocated even if the address space area is resized or destroyed before
+ * they are unpinned by as_unpin_frames(). Memory for the pinned frames is
+ * reserved on its own, so that it stays accounted for after the area gives
+ * back its reservation.
+ *
+ * Only anonymous address space areas which are readable and do not use late
+ * reservation can be pinned.
+ *
+ * @param base   Page-aligned virtual address of the first page.
+ * @param count  Number of pages to pin.
+ * @param frames Array of @a count entries which will receive the physical
+ *               addresses of the pinned frames.
+ *
+ * @return EOK on success.
+ * @return ENOMEM if the pinned frames cannot be reserved.
+ * @return ENOTSUP if some of the pages cannot be pinned.
+ *
+ */
+errno_t as_pin_frames(uintptr_t base, size_t count, uintptr_t *frames)
+{
+	assert(IS_ALIGNED(base, PAGE_SIZE));
+
+	if (!reserve_try_alloc(count))
+		return ENOMEM;
+
+	size_t i = 0;
+	while (i < count) {
+		uintptr_t page = base + P2SZ(i);
+
+		mutex_lock(&AS->lock);
+		as_area_t *area = find_area_and_lock(AS, page);
+		if (!area) {
+			mutex_unlock(&AS->lock);
+			goto error;
+		}
+
+		if ((area->backend != &anon_backend) ||
+		    (area->flags & AS_AREA_LATE_RESERVE) ||
+		    (area->attributes & AS_AREA_ATTR_PARTIAL) ||
+		    (!as_area_check_access(area, PF_ACCESS_READ))) {
+			mutex_unlock(&area->lock);
+			mutex_unlock(&AS->lock);
+			goto error;
+		}
+
+		page_table_lock(AS, false);
+
+		/* Pin all pages which fall into this area at once. */
+		uintptr_t end = area->base + P2SZ(area->pages);
+		while ((i < count) && (page < end)) {
+			pte_t pte;
+			bool found = page_mapping_find(AS, page, false, &pte);
+			if (!found || !PTE_PRESENT(&pte)) {
+				if (area->backend->page_fault(area, page,
+				    PF_ACCESS_READ) != AS_PF_OK) {
+					page_table_unlock(AS, false);
+					mutex_unlock(&area->lock);
+					mutex_unlock(&AS->lock);
+					goto error;
+				}
+
+				found = page_mapping_find(AS, page, false,
+				    &pte);
+				assert(found);
+				assert(PTE_PRESENT(&pte));
+			}
+
+			frames[i] = PTE_GET_FRAME(&pte);
+			frame_reference_add(ADDR2PFN(frames[i]));
+
+			i++;
+			page += PAGE_SIZE;
+		}
+
+		page_table_unlock(AS, false);
+		mutex_unlock(&area->lock);
+		mutex_unlock(&AS->lock);
+	}
+
+	return EOK;
+
+error:
+	as_unpin_frames(frames, i);
+	reserve_free(count - i);
+	return ENOTSUP;
+}
+
+/** Unpin frames pinned by as_pin_frames().
+ *
+ * The reservation taken by as_pin_frames() is given back.
+ *
+ * @param frames Array of physical addresses of the pinned frames.
+ * @param count  Number of entries in @a frames.
+ *
+ */
+void as_unpin_frames(uintptr_t *frames, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		frame_free_noreserve(frames[i], 1);
+
+	reserve_free(count);
+}
+
 /** Initialize used space map.
  *
  * @param used_space Used space map
@@ -52,6 +52,7 @@
 #include <align.h>
 #include <mem.h>
 #include <arch.h>
+#include <atomic.h>
 
 static bool anon_create(as_area_t *);
 static bool anon_resize(as_area_t *, size_t);
@@ -170,6 +171,71 @@ bool anon_is_shareable(as_area_t *area)
 	return !(area->flags & AS_AREA_LATE_RESERVE);
 }
 
+#ifdef LARGE_PAGE_SIZE
+
+/** Try to service a page fault by mapping a whole large page.
+ *
+ * A large page is used only if the area asked for large pages, the large page
+ * lies entirely within the area and none of its small pages is in use yet.
+ * If no suitable block of frames is available, the caller falls back to a
+ * small page.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area  Pointer to the private address space area.
+ * @param upage Faulting virtual page.
+ *
+ * @return True if the large page containing upage was mapped.
+ */
+static bool anon_page_fault_large(as_area_t *area, uintptr_t upage)
+{
+	uintptr_t base = ALIGN_DOWN(upage, LARGE_PAGE_SIZE);
+	size_t count = LARGE_PAGE_SIZE / PAGE_SIZE;
+
+	if (!(area->flags & AS_AREA_LARGE_PAGES))
+		return false;
+
+	if ((base < area->base) ||
+	    (base + LARGE_PAGE_SIZE > area->base + P2SZ(area->pages)))
+		return false;
+
+	used_space_ival_t *ival = used_space_find_gteq(&area->used_space, base);
+	if ((ival != NULL) && (ival->page < base + LARGE_PAGE_SIZE))
+		return false;
+
+	if (area->flags & AS_AREA_LATE_RESERVE) {
+		if (!reserve_try_alloc(count))
+			goto fallback;
+	}
+
+	uintptr_t frame = frame_alloc(count,
+	    FRAME_LOWMEM | FRAME_ATOMIC | FRAME_NO_RESERVE, LARGE_PAGE_SIZE - 1);
+	if (frame == 0)
+		goto unreserve;
+
+	memsetb((void *) PA2KA(frame), LARGE_PAGE_SIZE, 0);
+
+	if (!page_mapping_insert_large(AS, base, frame,
+	    as_area_get_flags(area))) {
+		frame_free_noreserve(frame, count);
+		goto unreserve;
+	}
+
+	if (!used_space_insert(&area->used_space, base, count))
+		panic("Cannot insert used space.");
+
+	return true;
+
+unreserve:
+	if (area->flags & AS_AREA_LATE_RESERVE)
+		reserve_free(count);
+fallback:
+	atomic_inc(&AS->large_page_fallbacks);
+	return false;
+}
+
+#endif /* LARGE_PAGE_SIZE */
+
 /** Service a page fault in the anonymous memory address space area.
  *
  * The address space area and page tables must be already locked.
@@ -236,6 +302,13 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 *   the different causes
 		 */
 
+#ifdef LARGE_PAGE_SIZE
+		if (anon_page_fault_large(area, upage)) {
+			mutex_unlock(&area->sh_info->lock);
+			return AS_PF_OK;
+		}
+#endif
+
 		if (area->flags & AS_AREA_LATE_RESERVE) {
 			/*
 			 * Reserve the memory for this page now.
@@ -120,7 +120,8 @@ int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	ipc_data_t data = { };
 	ipc_set_imethod(&data, IPC_M_PAGE_IN);
 	ipc_set_arg1(&data, upage - area->base);
-	ipc_set_arg2(&data, PAGE_SIZE);
+	ipc_set_arg2(&data, PAGE_SIZE |
+	    (area->flags & (AS_AREA_READ | AS_AREA_WRITE | AS_AREA_EXEC)));
 	ipc_set_arg3(&data, pager_info->id1);
 	ipc_set_arg4(&data, pager_info->id2);
 	ipc_set_arg5(&data, pager_info->id3);
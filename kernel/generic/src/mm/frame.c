@@ -39,6 +39,11 @@
  * This file contains the physical frame allocator and memory zone management.
  * The frame allocator is built on top of the two-level bitmap structure.
  *
+ * Each zone also keeps a buddy index of its free aligned blocks of
+ * FRAME_BUDDY_FRAMES frames, which larger contiguous allocations search
+ * first. Small naturally aligned blocks are allocated and freed through
+ * per-CPU frame caches, which only go to the zones in batches.
+ *
  */
 
 #include <typedefs.h>
@@ -61,6 +66,7 @@
 #include <config.h>
 #include <str.h>
 #include <proc/thread.h> /* THREAD */
+#include <cpu.h>
 
 zones_t zones;
 
@@ -80,7 +86,7 @@ static size_t mem_avail_gen = 0;  /**< Generation counter. */
  */
 _NO_TRACE static void frame_initialize(frame_t *frame)
 {
-	frame->refcount = 0;
+	atomic_store(&frame->refcount, 0);
 	frame->parent = NULL;
 }
 
@@ -147,6 +153,23 @@ _NO_TRACE static size_t zones_insert_zone(pfn_t base, size_t count,
 	return i;
 }
 
+/** Get number of frames in the per-CPU frame caches.
+ *
+ * The caches are not locked, so the result is only approximate.
+ *
+ */
+_NO_TRACE static size_t frame_cache_frames(void)
+{
+	size_t total = 0;
+
+	if (cpus != NULL) {
+		for (size_t i = 0; i < config.cpu_count; i++)
+			total += cpus[i].frame_cache.frames;
+	}
+
+	return total;
+}
+
 /** Get total available frames.
  *
  * Assume interrupts are disabled and zones lock is
@@ -163,7 +186,7 @@ _NO_TRACE static size_t frame_total_free_get_internal(void)
 	for (i = 0; i < zones.count; i++)
 		total += zones.info[i].free_count;
 
-	return total;
+	return total + frame_cache_frames();
 }
 
 _NO_TRACE size_t frame_total_free_get(void)
@@ -209,18 +232,137 @@ _NO_TRACE size_t find_zone(pfn_t frame, size_t count, size_t hint)
 	return (size_t) -1;
 }
 
+/** Check whether a block of the buddy index of a zone is free.
+ *
+ * @param zone  Zone.
+ * @param block Index of the block of FRAME_BUDDY_FRAMES frames.
+ *
+ * @return True if all frames of the block are free.
+ *
+ */
+_NO_TRACE static bool zone_buddy_free(zone_t *zone, size_t block)
+{
+	size_t first = block << FRAME_BUDDY_ORDER;
+
+	if (first + FRAME_BUDDY_FRAMES > zone->count)
+		return false;
+
+	for (size_t i = 0; i < FRAME_BUDDY_FRAMES; i++) {
+		if (bitmap_get(&zone->bitmap, first + i))
+			return false;
+	}
+
+	return true;
+}
+
+/** Update the buddy index of a zone after frames were freed.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first changed frame.
+ * @param count Number of changed frames.
+ *
+ */
+_NO_TRACE static void zone_buddy_update(zone_t *zone, size_t index,
+    size_t count)
+{
+	size_t first = index >> FRAME_BUDDY_ORDER;
+	size_t last = (index + count - 1) >> FRAME_BUDDY_ORDER;
+
+	for (size_t block = first; block <= last; block++)
+		bitmap_set(&zone->buddy, block, zone_buddy_free(zone, block));
+}
+
+/** Update the buddy index of a zone after frames were allocated.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first allocated frame.
+ * @param count Number of allocated frames.
+ *
+ */
+_NO_TRACE static void zone_buddy_clear(zone_t *zone, size_t index,
+    size_t count)
+{
+	size_t first = index >> FRAME_BUDDY_ORDER;
+	size_t last = (index + count - 1) >> FRAME_BUDDY_ORDER;
+
+	for (size_t block = first; block <= last; block++)
+		bitmap_set(&zone->buddy, block, 0);
+}
+
+/** Find free frames using the buddy index of a zone.
+ *
+ * Only ranges starting at a block boundary of the index are found.
+ * Like the bitmap search, prefer low-priority memory.
+ *
+ * @param zone       Zone to search.
+ * @param count      Number of frames to find.
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first frame.
+ * @param index      Place to store the index of the first frame.
+ *
+ * @return True if the frames were found.
+ *
+ */
+_NO_TRACE static bool zone_buddy_find(zone_t *zone, size_t count,
+    pfn_t constraint, size_t *index)
+{
+	size_t blocks = (count + FRAME_BUDDY_FRAMES - 1) >> FRAME_BUDDY_ORDER;
+	size_t elements = zone->buddy.elements;
+
+	if (blocks > elements)
+		return false;
+
+	size_t start = 0;
+	if ((FRAME_LOWPRIO > zone->base) &&
+	    (FRAME_LOWPRIO < zone->base + zone->count))
+		start = (FRAME_LOWPRIO - zone->base) >> FRAME_BUDDY_ORDER;
+
+	size_t run = 0;
+	for (size_t pos = 0; pos < elements; pos++) {
+		size_t block = (start + pos) % elements;
+
+		/* Ranges do not wrap around the end of the zone */
+		if (block == 0)
+			run = 0;
+
+		if (!bitmap_get(&zone->buddy, block)) {
+			run = 0;
+			continue;
+		}
+
+		if ((run == 0) && (((zone->base +
+		    (block << FRAME_BUDDY_ORDER)) & constraint) != 0))
+			continue;
+
+		run++;
+		if (run == blocks) {
+			*index = (block + 1 - blocks) << FRAME_BUDDY_ORDER;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /** @return True if zone can allocate specified number of frames */
 _NO_TRACE static bool zone_can_alloc(zone_t *zone, size_t count,
     pfn_t constraint)
 {
+	if (!(zone->flags & ZONE_AVAILABLE))
+		return false;
+
+	size_t index;
+	if ((count >= FRAME_BUDDY_FRAMES) &&
+	    (zone_buddy_find(zone, count, constraint, &index)))
+		return true;
+
 	/*
 	 * The function bitmap_allocate_range() does not modify
 	 * the bitmap if the last argument is NULL.
 	 */
 
-	return ((zone->flags & ZONE_AVAILABLE) &&
-	    bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, NULL));
+	return bitmap_allocate_range(&zone->bitmap, count, zone->base,
+	    FRAME_LOWPRIO, constraint, NULL);
 }
 
 /** Find a zone that can allocate specified number of frames
@@ -352,10 +494,11 @@ _NO_TRACE static frame_t *zone_get_frame(zone_t *zone, size_t index)
 	return &zone->frames[index];
 }
 
-/** Allocate frame in particular zone.
+/** Take free frames of a particular zone.
  *
  * Assume zone is locked and is available for allocation.
- * Panics if allocation is impossible.
+ * Panics if allocation is impossible. The reference counts
+ * of the frames are left at zero.
  *
  * @param zone       Zone to allocate from.
  * @param count      Number of frames to allocate
@@ -365,32 +508,83 @@ _NO_TRACE static frame_t *zone_get_frame(zone_t *zone, size_t index)
  * @return Frame index in zone.
  *
  */
-_NO_TRACE static size_t zone_frame_alloc(zone_t *zone, size_t count,
+_NO_TRACE static size_t zone_block_take(zone_t *zone, size_t count,
     pfn_t constraint)
 {
 	assert(zone->flags & ZONE_AVAILABLE);
 
 	/* Allocate frames from zone */
 	size_t index = (size_t) -1;
-	int avail = bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, &index);
 
-	(void) avail;
-	assert(avail);
+	if ((count >= FRAME_BUDDY_FRAMES) &&
+	    (zone_buddy_find(zone, count, constraint, &index))) {
+		bitmap_set_range(&zone->bitmap, index, count);
+	} else {
+		int avail = bitmap_allocate_range(&zone->bitmap, count,
+		    zone->base, FRAME_LOWPRIO, constraint, &index);
+
+		(void) avail;
+		assert(avail);
+	}
+
 	assert(index != (size_t) -1);
+	zone_buddy_clear(zone, index, count);
+
+	/* Update zone information. */
+	zone->free_count -= count;
+	zone->busy_count += count;
+
+	return index;
+}
+
+/** Return frames to a particular zone.
+ *
+ * Assume zone is locked and the frames are not referenced.
+ *
+ * @param zone  Zone of the frames.
+ * @param index Index of the first frame in zone.
+ * @param count Number of frames.
+ *
+ */
+_NO_TRACE static void zone_block_release(zone_t *zone, size_t index,
+    size_t count)
+{
+	assert(zone->flags & ZONE_AVAILABLE);
+
+	bitmap_clear_range(&zone->bitmap, index, count);
+	zone_buddy_update(zone, index, count);
+
+	/* Update zone information. */
+	zone->free_count += count;
+	zone->busy_count -= count;
+}
+
+/** Allocate frame in particular zone.
+ *
+ * Assume zone is locked and is available for allocation.
+ * Panics if allocation is impossible.
+ *
+ * @param zone       Zone to allocate from.
+ * @param count      Number of frames to allocate
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first allocated frame.
+ *
+ * @return Frame index in zone.
+ *
+ */
+_NO_TRACE static size_t zone_frame_alloc(zone_t *zone, size_t count,
+    pfn_t constraint)
+{
+	size_t index = zone_block_take(zone, count, constraint);
 
 	/* Update frame reference count */
 	for (size_t i = 0; i < count; i++) {
 		frame_t *frame = zone_get_frame(zone, index + i);
 
-		assert(frame->refcount == 0);
-		frame->refcount = 1;
+		assert(atomic_load(&frame->refcount) == 0);
+		atomic_store(&frame->refcount, 1);
 	}
 
-	/* Update zone information. */
-	zone->free_count -= count;
-	zone->busy_count += count;
-
 	return index;
 }
 
@@ -410,15 +604,10 @@ _NO_TRACE static size_t zone_frame_free(zone_t *zone, size_t index)
 
 	frame_t *frame = zone_get_frame(zone, index);
 
-	assert(frame->refcount > 0);
-
-	if (!--frame->refcount) {
-		bitmap_set(&zone->bitmap, index, 0);
-
-		/* Update zone information. */
-		zone->free_count++;
-		zone->busy_count--;
+	assert(atomic_load(&frame->refcount) > 0);
 
+	if (atomic_fetch_sub(&frame->refcount, 1) == 1) {
+		zone_block_release(zone, index, 1);
 		return 1;
 	}
 
@@ -431,11 +620,12 @@ _NO_TRACE static void zone_mark_unavailable(zone_t *zone, size_t index)
 	assert(zone->flags & ZONE_AVAILABLE);
 
 	frame_t *frame = zone_get_frame(zone, index);
-	if (frame->refcount > 0)
+	if (atomic_load(&frame->refcount) > 0)
 		return;
 
-	frame->refcount = 1;
+	atomic_store(&frame->refcount, 1);
 	bitmap_set_range(&zone->bitmap, index, 1);
+	zone_buddy_clear(zone, index, 1);
 
 	zone->free_count--;
 	reserve_force_alloc(1);
@@ -472,6 +662,10 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 	bitmap_initialize(&zones.info[z1].bitmap, zones.info[z1].count,
 	    confdata + (sizeof(frame_t) * zones.info[z1].count));
 	bitmap_clear_range(&zones.info[z1].bitmap, 0, zones.info[z1].count);
+	bitmap_initialize(&zones.info[z1].buddy,
+	    zones.info[z1].count >> FRAME_BUDDY_ORDER,
+	    confdata + (sizeof(frame_t) * zones.info[z1].count) +
+	    bitmap_size(zones.info[z1].count));
 
 	zones.info[z1].frames = (frame_t *) confdata;
 
@@ -491,6 +685,8 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 		zones.info[z1].frames[base_diff + i] =
 		    zones.info[z2].frames[i];
 	}
+
+	zone_buddy_update(&zones.info[z1], 0, zones.info[z1].count);
 }
 
 /** Return old configuration frames into the zone.
@@ -641,6 +837,15 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 		    (sizeof(frame_t) * count));
 		bitmap_clear_range(&zone->bitmap, 0, count);
 
+		/*
+		 * Initialize the buddy index (located after the frame
+		 * bitmap). All whole blocks are free.
+		 */
+
+		bitmap_initialize(&zone->buddy, count >> FRAME_BUDDY_ORDER,
+		    confdata + (sizeof(frame_t) * count) + bitmap_size(count));
+		bitmap_set_range(&zone->buddy, 0, count >> FRAME_BUDDY_ORDER);
+
 		/*
 		 * Initialize the array of frame_t structures.
 		 */
@@ -651,6 +856,7 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 			frame_initialize(&zone->frames[i]);
 	} else {
 		bitmap_initialize(&zone->bitmap, 0, NULL);
+		bitmap_initialize(&zone->buddy, 0, NULL);
 		zone->frames = NULL;
 	}
 }
@@ -664,7 +870,8 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
  */
 size_t zone_conf_size(size_t count)
 {
-	return (count * sizeof(frame_t) + bitmap_size(count));
+	return (count * sizeof(frame_t) + bitmap_size(count) +
+	    bitmap_size(count >> FRAME_BUDDY_ORDER));
 }
 
 /** Allocate external configuration frames from low memory. */
@@ -829,6 +1036,281 @@ static size_t try_find_zone(size_t count, bool lowmem,
 	    frame_constraint, hint);
 }
 
+/*
+ * Per-CPU frame cache functions
+ *
+ * Zones are only created and merged while the kernel boots on a single
+ * processor, before the caches are used. After that, the zone of a frame
+ * can be looked up without zones.lock.
+ */
+
+/** Initialize a per-CPU frame cache. */
+void frame_cache_initialize(frame_cache_t *cache)
+{
+	irq_spinlock_initialize(&cache->lock, "frame_cache.lock");
+
+	for (unsigned int type = 0; type < 2; type++) {
+		for (unsigned int order = 0; order < FRAME_CACHE_ORDERS; order++)
+			cache->count[type][order] = 0;
+	}
+
+	cache->frames = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+/** Get the cache order of a block of frames.
+ *
+ * @param count Number of frames.
+ *
+ * @return Order of the block, -1 if such blocks are not cached.
+ *
+ */
+_NO_TRACE static int frame_cache_order(size_t count)
+{
+	for (int order = 0; order < FRAME_CACHE_ORDERS; order++) {
+		if (count == ((size_t) 1 << order))
+			return order;
+	}
+
+	return -1;
+}
+
+/** Return blocks from a frame cache to their zones.
+ *
+ * Assume the cache and zones.lock are locked.
+ *
+ * @param cache Frame cache.
+ * @param type  Type of the blocks, 1 for high memory.
+ * @param order Order of the blocks.
+ * @param count Maximum number of blocks to return.
+ *
+ * @return Number of frames returned.
+ *
+ */
+_NO_TRACE static size_t frame_cache_release(frame_cache_t *cache,
+    unsigned int type, unsigned int order, size_t count)
+{
+	size_t frames = (size_t) 1 << order;
+	size_t released = 0;
+
+	while ((count-- > 0) && (cache->count[type][order] > 0)) {
+		pfn_t pfn = cache->blocks[type][order][--cache->count[type][order]];
+		size_t znum = find_zone(pfn, frames, 0);
+
+		assert(znum != (size_t) -1);
+
+		zone_block_release(&zones.info[znum],
+		    pfn - zones.info[znum].base, frames);
+		released += frames;
+	}
+
+	cache->frames -= released;
+	return released;
+}
+
+/** Return the contents of all per-CPU frame caches to the zones.
+ *
+ * @return Number of frames returned.
+ *
+ */
+size_t frame_cache_drain_all(void)
+{
+	size_t released = 0;
+
+	if (cpus == NULL)
+		return 0;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		irq_spinlock_lock(&cache->lock, true);
+		irq_spinlock_lock(&zones.lock, false);
+
+		for (unsigned int type = 0; type < 2; type++) {
+			for (unsigned int order = 0; order < FRAME_CACHE_ORDERS;
+			    order++) {
+				released += frame_cache_release(cache, type,
+				    order, FRAME_CACHE_SIZE);
+			}
+		}
+
+		irq_spinlock_unlock(&zones.lock, false);
+		irq_spinlock_unlock(&cache->lock, true);
+	}
+
+	return released;
+}
+
+/** Allocate a block of frames from the frame cache of the current CPU.
+ *
+ * An empty cache is refilled with a batch of blocks from the zones.
+ *
+ * @param count      Number of frames to allocate.
+ * @param lowmem     Whether the frames must be in low memory.
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first allocated frame.
+ * @param pzone      Preferred zone, updated on success.
+ *
+ * @return Frame number of the block or zero if the request
+ *         cannot be served from the cache.
+ *
+ */
+_NO_TRACE static pfn_t frame_cache_alloc(size_t count, bool lowmem,
+    pfn_t constraint, size_t *pzone)
+{
+	int order = frame_cache_order(count);
+	if (order < 0)
+		return 0;
+
+	/* Cached blocks are only aligned to their size. */
+	if ((constraint & ~((pfn_t) count - 1)) != 0)
+		return 0;
+
+	unsigned int type = lowmem ? 0 : 1;
+	size_t hint = pzone ? (*pzone) : 0;
+
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU == NULL) {
+		interrupts_restore(ipl);
+		return 0;
+	}
+
+	frame_cache_t *cache = &CPU->frame_cache;
+	irq_spinlock_lock(&cache->lock, false);
+
+	if (cache->count[type][order] == 0) {
+		cache->misses++;
+
+		irq_spinlock_lock(&zones.lock, false);
+
+		while (cache->count[type][order] < FRAME_CACHE_BATCH) {
+			size_t znum = try_find_zone(count, lowmem, count - 1,
+			    hint);
+			if (znum == (size_t) -1)
+				break;
+
+			pfn_t pfn = zones.info[znum].base +
+			    zone_block_take(&zones.info[znum], count, count - 1);
+			cache->blocks[type][order][cache->count[type][order]++] =
+			    pfn;
+			cache->frames += count;
+			hint = znum;
+		}
+
+		irq_spinlock_unlock(&zones.lock, false);
+	} else
+		cache->hits++;
+
+	pfn_t pfn = 0;
+	if (cache->count[type][order] > 0) {
+		pfn = cache->blocks[type][order][--cache->count[type][order]];
+		cache->frames -= count;
+	}
+
+	irq_spinlock_unlock(&cache->lock, false);
+	interrupts_restore(ipl);
+
+	if (pfn == 0)
+		return 0;
+
+	size_t znum = find_zone(pfn, count, hint);
+	assert(znum != (size_t) -1);
+
+	for (size_t i = 0; i < count; i++) {
+		frame_t *frame = zone_get_frame(&zones.info[znum],
+		    pfn - zones.info[znum].base + i);
+
+		assert(atomic_load(&frame->refcount) == 0);
+		atomic_store(&frame->refcount, 1);
+	}
+
+	if (pzone)
+		*pzone = znum;
+
+	return pfn;
+}
+
+/** Free a block of frames to the frame cache of the current CPU.
+ *
+ * A full cache first returns a batch of blocks to the zones. If only
+ * some frames of the block lose their last reference, they are freed
+ * to the zone directly.
+ *
+ * @param pfn   First frame of the block.
+ * @param count Number of frames of the block.
+ * @param freed Place to store the number of freed frames.
+ *
+ * @return False if the block cannot be freed through the cache.
+ *
+ */
+_NO_TRACE static bool frame_cache_free(pfn_t pfn, size_t count, size_t *freed)
+{
+	int order = frame_cache_order(count);
+	if ((order < 0) || ((pfn & (count - 1)) != 0))
+		return false;
+
+	ipl_t ipl = interrupts_disable();
+
+	size_t znum = find_zone(pfn, count, 0);
+	if ((CPU == NULL) || (znum == (size_t) -1)) {
+		interrupts_restore(ipl);
+		return false;
+	}
+
+	zone_t *zone = &zones.info[znum];
+	size_t index = pfn - zone->base;
+
+	/* Frames which lost their last reference */
+	unsigned int unused = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		frame_t *frame = zone_get_frame(zone, index + i);
+
+		assert(atomic_load(&frame->refcount) > 0);
+
+		if (atomic_fetch_sub(&frame->refcount, 1) == 1)
+			unused |= 1U << i;
+	}
+
+	*freed = 0;
+
+	if (unused == (1U << count) - 1) {
+		unsigned int type = (zone->flags & ZONE_HIGHMEM) ? 1 : 0;
+		frame_cache_t *cache = &CPU->frame_cache;
+
+		irq_spinlock_lock(&cache->lock, false);
+
+		if (cache->count[type][order] == FRAME_CACHE_SIZE) {
+			irq_spinlock_lock(&zones.lock, false);
+			(void) frame_cache_release(cache, type, order,
+			    FRAME_CACHE_BATCH);
+			irq_spinlock_unlock(&zones.lock, false);
+		}
+
+		cache->blocks[type][order][cache->count[type][order]++] = pfn;
+		cache->frames += count;
+
+		irq_spinlock_unlock(&cache->lock, false);
+		*freed = count;
+	} else if (unused != 0) {
+		irq_spinlock_lock(&zones.lock, false);
+
+		for (size_t i = 0; i < count; i++) {
+			if (unused & (1U << i)) {
+				zone_block_release(zone, index + i, 1);
+				(*freed)++;
+			}
+		}
+
+		irq_spinlock_unlock(&zones.lock, false);
+	}
+
+	interrupts_restore(ipl);
+	return true;
+}
+
 /** Allocate frames of physical memory.
  *
  * @param count      Number of continuous frames to allocate.
@@ -854,17 +1336,37 @@ uintptr_t frame_alloc_generic(size_t count, frame_flags_t flags,
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_force_alloc(count);
 
-loop:
-	irq_spinlock_lock(&zones.lock, true);
-
 	// TODO: Print diagnostic if neither is explicitly specified.
 	bool lowmem = (flags & FRAME_LOWMEM) || !(flags & FRAME_HIGHMEM);
 
+	/*
+	 * Small blocks come from the frame cache of this CPU.
+	 */
+	pfn_t cached = frame_cache_alloc(count, lowmem, frame_constraint, pzone);
+	if (cached != 0)
+		return PFN2ADDR(cached);
+
+loop:
+	irq_spinlock_lock(&zones.lock, true);
+
 	/*
 	 * First, find suitable frame zone.
 	 */
 	size_t znum = try_find_zone(count, lowmem, frame_constraint, hint);
 
+	/*
+	 * If no memory, take back the frames cached by the processors.
+	 */
+	if (znum == (size_t) -1) {
+		irq_spinlock_unlock(&zones.lock, true);
+		size_t drained = frame_cache_drain_all();
+		irq_spinlock_lock(&zones.lock, true);
+
+		if (drained > 0)
+			znum = try_find_zone(count, lowmem,
+			    frame_constraint, hint);
+	}
+
 	/*
 	 * If no memory, reclaim some slab memory,
 	 * if it does not help, reclaim all.
@@ -976,22 +1478,24 @@ void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 {
 	size_t freed = 0;
 
-	irq_spinlock_lock(&zones.lock, true);
+	if (!frame_cache_free(ADDR2PFN(start), count, &freed)) {
+		irq_spinlock_lock(&zones.lock, true);
 
-	for (size_t i = 0; i < count; i++) {
-		/*
-		 * First, find host frame zone for addr.
-		 */
-		pfn_t pfn = ADDR2PFN(start) + i;
-		size_t znum = find_zone(pfn, 1, 0);
+		for (size_t i = 0; i < count; i++) {
+			/*
+			 * First, find host frame zone for addr.
+			 */
+			pfn_t pfn = ADDR2PFN(start) + i;
+			size_t znum = find_zone(pfn, 1, 0);
 
-		assert(znum != (size_t) -1);
+			assert(znum != (size_t) -1);
 
-		freed += zone_frame_free(&zones.info[znum],
-		    pfn - zones.info[znum].base);
-	}
+			freed += zone_frame_free(&zones.info[znum],
+			    pfn - zones.info[znum].base);
+		}
 
-	irq_spinlock_unlock(&zones.lock, true);
+		irq_spinlock_unlock(&zones.lock, true);
+	}
 
 	/*
 	 * Signal that some memory has been freed.
@@ -1047,7 +1551,7 @@ _NO_TRACE void frame_reference_add(pfn_t pfn)
 
 	assert(znum != (size_t) -1);
 
-	zones.info[znum].frames[pfn - zones.info[znum].base].refcount++;
+	atomic_inc(&zones.info[znum].frames[pfn - zones.info[znum].base].refcount);
 
 	irq_spinlock_unlock(&zones.lock, true);
 }
@@ -1190,6 +1694,12 @@ void zones_stats(uint64_t *total, uint64_t *unavail, uint64_t *busy,
 			*unavail += (uint64_t) FRAMES2SIZE(zones.info[i].count);
 	}
 
+	/* Frames in the per-CPU caches are free, even if busy in zones. */
+	uint64_t cached = min((uint64_t) FRAMES2SIZE(frame_cache_frames()),
+	    *busy);
+	*busy -= cached;
+	*free += cached;
+
 	irq_spinlock_unlock(&zones.lock, true);
 }
 
@@ -1312,6 +1822,26 @@ void zones_print_list(void)
 	    false);
 	printf("Available high priority: %zu frames (%" PRIu64 " %s)\n",
 	    free_highprio, size, size_suffix);
+
+	if (cpus == NULL)
+		return;
+
+	printf("\n[cpu] [cached frames] [hits        ] [misses      ] [hit rate]\n");
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		irq_spinlock_lock(&cache->lock, true);
+		size_t frames = cache->frames;
+		uint64_t hits = cache->hits;
+		uint64_t misses = cache->misses;
+		irq_spinlock_unlock(&cache->lock, true);
+
+		uint64_t total = hits + misses;
+		printf("%-5zu %15zu %14" PRIu64 " %14" PRIu64 " %9" PRIu64 "%%\n",
+		    i, frames, hits, misses,
+		    (total > 0) ? (hits * 100 / total) : 0);
+	}
 }
 
 /** Prints zone details.
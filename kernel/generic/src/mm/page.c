@@ -109,6 +109,43 @@ _NO_TRACE void page_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 	memory_barrier();
 }
 
+/** Insert mapping of a large page to a block of frames.
+ *
+ * The large page is described by the same generic structures as the small
+ * pages it consists of, i.e. page_mapping_find() works on the individual
+ * small pages. page_mapping_remove() must be called on all its pages in
+ * ascending order within one TLB shootdown sequence. To remove only some of
+ * them, split the large page by page_mapping_split() first.
+ *
+ * @param as    Address space to which page belongs.
+ * @param page  Virtual address of the large page, aligned to LARGE_PAGE_SIZE.
+ * @param frame Physical address of the first frame of the block, aligned to
+ *              LARGE_PAGE_SIZE.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the large page was mapped, false if the architecture or
+ *         the current page tables do not allow it.
+ *
+ */
+_NO_TRACE bool page_mapping_insert_large(as_t *as, uintptr_t page,
+    uintptr_t frame, unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if (!page_mapping_operations->mapping_insert_large)
+		return false;
+
+	bool inserted = page_mapping_operations->mapping_insert_large(as, page,
+	    frame, flags);
+
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+
+	return inserted;
+}
+
 /** Remove mapping of page.
  *
  * Remove any mapping of page within address space as.
@@ -133,6 +170,29 @@ _NO_TRACE void page_mapping_remove(as_t *as, uintptr_t page)
 	memory_barrier();
 }
 
+/** Make sure no large page spans across a page boundary.
+ *
+ * A large page which contains page but does not start there is replaced by
+ * small pages mapping the same frames. Afterwards, the pages below and above
+ * the boundary can be removed independently. The function may sleep and
+ * performs its own TLB shootdown, so it must be called outside of any TLB
+ * shootdown sequence.
+ *
+ * @param as   Address space to which page belongs.
+ * @param page Virtual address of the boundary.
+ *
+ */
+_NO_TRACE void page_mapping_split(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if (page_mapping_operations->mapping_split)
+		page_mapping_operations->mapping_split(as,
+		    ALIGN_DOWN(page, PAGE_SIZE));
+}
+
 /** Find mapping for virtual page.
  *
  * @param as       Address space to which page belongs.
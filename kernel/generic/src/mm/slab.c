@@ -45,8 +45,6 @@
  *
  * Following features are not currently supported but would be easy to do:
  * @li cache coloring
- * @li dynamic magazine growing (different magazine sizes are already
- *     supported, but we would need to adjust allocation strategy)
  *
  * The slab allocator supports per-CPU caches ('magazines') to facilitate
  * good SMP scaling.
@@ -66,6 +64,14 @@
  * size boundary. LIFO order is enforced, which should avoid fragmentation
  * as much as possible.
  *
+ * Magazines start small and grow as in the Solaris allocator: every time
+ * the lock of the cpu-shared magazine list is found contended, the cache
+ * notes it and after SLAB_MAG_GROW_CONTENTION contentions the size of
+ * newly allocated magazines is doubled, up to SLAB_MAG_SIZE_MAX. Bigger
+ * magazines make the CPUs visit the shared list less often. Magazines
+ * of the old size stay in circulation until they are destroyed. Brutal
+ * reclaim shrinks the magazine size back to SLAB_MAG_SIZE.
+ *
  * Every cache contains list of full slabs and list of partially full slabs.
  * Empty slabs are immediately freed (thrashing will be avoided because
  * of magazines).
@@ -116,12 +122,21 @@
 #include <macros.h>
 #include <cpu.h>
 #include <stdlib.h>
+#include <str.h>
 
 IRQ_SPINLOCK_STATIC_INITIALIZE(slab_cache_lock);
 static LIST_INITIALIZE(slab_cache_list);
 
-/** Magazine cache */
-static slab_cache_t mag_cache;
+/** Magazine caches, one for each magazine size */
+static slab_cache_t mag_cache[SLAB_MAG_SIZES];
+
+static const char *mag_cache_names[SLAB_MAG_SIZES] = {
+	"slab_magazine_t",
+	"slab_magazine_8_t",
+	"slab_magazine_16_t",
+	"slab_magazine_32_t",
+	"slab_magazine_64_t"
+};
 
 /** Cache for cache descriptors */
 static slab_cache_t slab_cache_cache;
@@ -326,6 +341,55 @@ _NO_TRACE static void *slab_obj_create(slab_cache_t *cache, unsigned int flags)
  * CPU-Cache slab functions
  */
 
+/** Return magazine cache for magazines of given size
+ *
+ */
+_NO_TRACE static slab_cache_t *mag_cache_for(size_t size)
+{
+	size_t i = fnzb(size) - fnzb(SLAB_MAG_SIZE);
+
+	assert(i < SLAB_MAG_SIZES);
+	assert((SLAB_MAG_SIZE << i) == size);
+
+	return &mag_cache[i];
+}
+
+/** Lock magazine list of a cache
+ *
+ * Contention on the lock is accounted for and if it happens too often,
+ * the size of newly allocated magazines is increased.
+ *
+ * @return Interrupt priority level to be passed to unlock_mag_list().
+ *
+ */
+_NO_TRACE static ipl_t lock_mag_list(slab_cache_t *cache)
+{
+	ipl_t ipl = interrupts_disable();
+
+	if (irq_spinlock_trylock(&cache->maglock))
+		return ipl;
+
+	irq_spinlock_lock(&cache->maglock, false);
+
+	cache->depot_contention++;
+	if ((cache->depot_contention - cache->depot_contention_mark >=
+	    SLAB_MAG_GROW_CONTENTION) && (cache->mag_size < SLAB_MAG_SIZE_MAX)) {
+		cache->mag_size <<= 1;
+		cache->depot_contention_mark = cache->depot_contention;
+	}
+
+	return ipl;
+}
+
+/** Unlock magazine list of a cache
+ *
+ */
+_NO_TRACE static void unlock_mag_list(slab_cache_t *cache, ipl_t ipl)
+{
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
+}
+
 /** Find a full magazine in cache, take it from list and return it
  *
  * @param first If true, return first, else last mag.
@@ -337,7 +401,7 @@ _NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 	slab_magazine_t *mag = NULL;
 	link_t *cur;
 
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = lock_mag_list(cache);
 	if (!list_empty(&cache->magazines)) {
 		if (first)
 			cur = list_first(&cache->magazines);
@@ -348,7 +412,7 @@ _NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 		list_remove(&mag->link);
 		atomic_dec(&cache->magazine_counter);
 	}
-	irq_spinlock_unlock(&cache->maglock, true);
+	unlock_mag_list(cache, ipl);
 
 	return mag;
 }
@@ -359,12 +423,12 @@ _NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 _NO_TRACE static void put_mag_to_cache(slab_cache_t *cache,
     slab_magazine_t *mag)
 {
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = lock_mag_list(cache);
 
 	list_prepend(&mag->link, &cache->magazines);
 	atomic_inc(&cache->magazine_counter);
 
-	irq_spinlock_unlock(&cache->maglock, true);
+	unlock_mag_list(cache, ipl);
 }
 
 /** Free all objects in magazine and free memory associated with magazine
@@ -383,7 +447,7 @@ _NO_TRACE static size_t magazine_destroy(slab_cache_t *cache,
 		atomic_dec(&cache->cached_objs);
 	}
 
-	slab_free(&mag_cache, mag);
+	slab_free(mag_cache_for(mag->size), mag);
 
 	return frames;
 }
@@ -437,11 +501,13 @@ _NO_TRACE static void *magazine_obj_get(slab_cache_t *cache)
 
 	slab_magazine_t *mag = get_full_current_mag(cache);
 	if (!mag) {
+		cache->mag_cache[CPU->id].alloc_misses++;
 		irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 		return NULL;
 	}
 
 	void *obj = mag->objs[--mag->busy];
+	cache->mag_cache[CPU->id].alloc_hits++;
 	irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 
 	atomic_dec(&cache->cached_objs);
@@ -484,12 +550,13 @@ _NO_TRACE static slab_magazine_t *make_empty_current_mag(slab_cache_t *cache)
 	 * this would deadlock.
 	 *
 	 */
-	slab_magazine_t *newmag = slab_alloc(&mag_cache,
+	size_t size = cache->mag_size;
+	slab_magazine_t *newmag = slab_alloc(mag_cache_for(size),
 	    FRAME_ATOMIC | FRAME_NO_RECLAIM);
 	if (!newmag)
 		return NULL;
 
-	newmag->size = SLAB_MAG_SIZE;
+	newmag->size = size;
 	newmag->busy = 0;
 
 	/* Flush last to magazine list */
@@ -517,11 +584,13 @@ _NO_TRACE static int magazine_obj_put(slab_cache_t *cache, void *obj)
 
 	slab_magazine_t *mag = make_empty_current_mag(cache);
 	if (!mag) {
+		cache->mag_cache[CPU->id].free_misses++;
 		irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 		return -1;
 	}
 
 	mag->objs[mag->busy++] = obj;
+	cache->mag_cache[CPU->id].free_hits++;
 
 	irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 
@@ -602,6 +671,7 @@ _NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 	cache->constructor = constructor;
 	cache->destructor = destructor;
 	cache->flags = flags;
+	cache->mag_size = SLAB_MAG_SIZE;
 
 	list_initialize(&cache->full_slabs);
 	list_initialize(&cache->partial_slabs);
@@ -698,6 +768,12 @@ _NO_TRACE static size_t _slab_reclaim(slab_cache_t *cache, unsigned int flags)
 
 			irq_spinlock_unlock(&cache->mag_cache[i].lock, true);
 		}
+
+		/* Start over with small magazines */
+		ipl_t ipl = lock_mag_list(cache);
+		cache->mag_size = SLAB_MAG_SIZE;
+		cache->depot_contention_mark = cache->depot_contention;
+		unlock_mag_list(cache, ipl);
 	}
 
 	return frames;
@@ -870,13 +946,143 @@ void slab_print_list(void)
 	}
 }
 
+/** Gather statistics of a cache
+ *
+ * The slab_cache_lock must be held.
+ *
+ * @param cache Slab cache.
+ * @param stats Where to store the statistics.
+ *
+ */
+_NO_TRACE static void slab_cache_stats(slab_cache_t *cache,
+    stats_slab_t *stats)
+{
+	assert(irq_spinlock_locked(&slab_cache_lock));
+
+	memsetb(stats, sizeof(*stats), 0);
+
+	str_cpy(stats->name, SLAB_NAME_BUFLEN, cache->name);
+	stats->size = cache->size;
+	stats->slabs = atomic_load(&cache->allocated_slabs);
+	stats->allocated = atomic_load(&cache->allocated_objs);
+	stats->cached = atomic_load(&cache->cached_objs);
+	stats->magazines = atomic_load(&cache->magazine_counter);
+
+	if ((cache->flags & SLAB_CACHE_NOMAGAZINE) || (!cache->mag_cache))
+		return;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		irq_spinlock_lock(&cache->mag_cache[i].lock, false);
+
+		stats->alloc_hits += cache->mag_cache[i].alloc_hits;
+		stats->alloc_misses += cache->mag_cache[i].alloc_misses;
+		stats->free_hits += cache->mag_cache[i].free_hits;
+		stats->free_misses += cache->mag_cache[i].free_misses;
+
+		irq_spinlock_unlock(&cache->mag_cache[i].lock, false);
+	}
+
+	irq_spinlock_lock(&cache->maglock, false);
+	stats->mag_size = cache->mag_size;
+	stats->depot_contention = cache->depot_contention;
+	irq_spinlock_unlock(&cache->maglock, false);
+}
+
+/** Get number of slab caches
+ *
+ * @return Number of slab caches in the system.
+ *
+ */
+size_t slab_cache_count(void)
+{
+	irq_spinlock_lock(&slab_cache_lock, true);
+	size_t count = list_count(&slab_cache_list);
+	irq_spinlock_unlock(&slab_cache_lock, true);
+
+	return count;
+}
+
+/** Get statistics of slab caches
+ *
+ * @param stats Array to store the statistics to.
+ * @param count Number of entries in @a stats.
+ *
+ * @return Number of entries filled in, which might be less than
+ *         @a count if some caches were destroyed meanwhile.
+ *
+ */
+size_t slab_get_stats(stats_slab_t *stats, size_t count)
+{
+	size_t i = 0;
+
+	irq_spinlock_lock(&slab_cache_lock, true);
+
+	list_foreach(slab_cache_list, link, slab_cache_t, cache) {
+		if (i == count)
+			break;
+
+		slab_cache_stats(cache, &stats[i]);
+		i++;
+	}
+
+	irq_spinlock_unlock(&slab_cache_lock, true);
+
+	return i;
+}
+
+/* Print magazine statistics of caches which make use of magazines */
+void slab_print_magazines(void)
+{
+	printf("[cache name        ] [mag] [depot ] [alloc hit ] [alloc miss]"
+	    " [free hit  ] [free miss ] [contended]\n");
+
+	size_t skip = 0;
+	while (true) {
+		/*
+		 * Same as in slab_print_list(), we must not hold the
+		 * slab_cache_lock while printing.
+		 */
+		irq_spinlock_lock(&slab_cache_lock, true);
+
+		link_t *cur = list_first(&slab_cache_list);
+		size_t i = 0;
+		while (i < skip && cur != NULL) {
+			i++;
+			cur = list_next(cur, &slab_cache_list);
+		}
+
+		if (cur == NULL) {
+			irq_spinlock_unlock(&slab_cache_lock, true);
+			break;
+		}
+
+		skip++;
+
+		stats_slab_t stats;
+		slab_cache_stats(list_get_instance(cur, slab_cache_t, link),
+		    &stats);
+
+		irq_spinlock_unlock(&slab_cache_lock, true);
+
+		if (stats.mag_size == 0)
+			continue;
+
+		printf("%-20s %5zu %8zu %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+		    " %12" PRIu64 " %11" PRIu64 "\n", stats.name, stats.mag_size,
+		    stats.magazines, stats.alloc_hits, stats.alloc_misses,
+		    stats.free_hits, stats.free_misses, stats.depot_contention);
+	}
+}
+
 void slab_cache_init(void)
 {
-	/* Initialize magazine cache */
-	_slab_cache_create(&mag_cache, "slab_magazine_t",
-	    sizeof(slab_magazine_t) + SLAB_MAG_SIZE * sizeof(void *),
-	    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
-	    SLAB_CACHE_SLINSIDE);
+	/* Initialize magazine caches */
+	for (size_t i = 0; i < SLAB_MAG_SIZES; i++) {
+		_slab_cache_create(&mag_cache[i], mag_cache_names[i],
+		    sizeof(slab_magazine_t) + (SLAB_MAG_SIZE << i) *
+		    sizeof(void *), sizeof(uintptr_t), NULL, NULL,
+		    SLAB_CACHE_NOMAGAZINE | SLAB_CACHE_SLINSIDE);
+	}
 
 	/* Initialize slab_cache cache */
 	_slab_cache_create(&slab_cache_cache, "slab_cache_cache",
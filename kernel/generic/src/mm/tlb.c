@@ -35,8 +35,9 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm. Shootdowns of user address spaces only interrupt the CPUs on
+ * which the address space is active. The remaining CPUs invalidate the
+ * address space lazily when they switch to it again.
  */
 
 #include <mm/tlb.h>
@@ -51,6 +52,15 @@
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <macros.h>
+#include <stdlib.h>
+
+atomic_size_t tlb_shootdowns = 0;
+atomic_size_t tlb_shootdown_ipis = 0;
+atomic_size_t tlb_lazy_invalidations = 0;
 
 void tlb_init(void)
 {
@@ -67,6 +77,149 @@ void tlb_init(void)
  */
 IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
 
+/** Address space of the shootdown in progress, if any. Protected by tlblock. */
+static as_t *tlb_shootdown_as = NULL;
+
+/** Try to fold a shootdown request into a queued message.
+ *
+ * @return True if the queued message now covers the request as well.
+ *
+ */
+static bool tlb_message_merge(tlb_shootdown_msg_t *msg,
+    tlb_invalidate_type_t type, asid_t asid, uintptr_t page, size_t count)
+{
+	if (msg->type == TLB_INVL_ALL)
+		return true;
+
+	if (msg->asid != asid)
+		return false;
+
+	if (msg->type == TLB_INVL_ASID)
+		return true;
+
+	if (type == TLB_INVL_ASID) {
+		msg->type = TLB_INVL_ASID;
+		msg->page = 0;
+		msg->count = 0;
+		return true;
+	}
+
+	/* Both are page ranges, merge them if they touch. */
+	uintptr_t end = page + P2SZ(count);
+	uintptr_t msg_end = msg->page + P2SZ(msg->count);
+	if ((page > msg_end) || (msg->page > end))
+		return false;
+
+	msg->page = min(msg->page, page);
+	msg->count = (max(msg_end, end) - msg->page) >> PAGE_WIDTH;
+	if (msg->count > TLB_SHOOTDOWN_PAGES_MAX) {
+		msg->type = TLB_INVL_ASID;
+		msg->page = 0;
+		msg->count = 0;
+	}
+
+	return true;
+}
+
+/** Queue TLB shootdown message for a processor.
+ *
+ * @param cpu   Target processor.
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ */
+static void tlb_message_queue(cpu_t *cpu, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
+{
+	irq_spinlock_lock(&cpu->lock, false);
+	if ((cpu->tlb_messages_count > 0) &&
+	    (tlb_message_merge(
+	    &cpu->tlb_messages[cpu->tlb_messages_count - 1], type, asid,
+	    page, count))) {
+		/*
+		 * The last queued message covers this one now.
+		 */
+	} else if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The message queue is full.
+		 * Erase the queue and store one TLB_INVL_ALL message.
+		 */
+		cpu->tlb_messages_count = 1;
+		cpu->tlb_messages[0].type = TLB_INVL_ALL;
+		cpu->tlb_messages[0].asid = ASID_INVALID;
+		cpu->tlb_messages[0].page = 0;
+		cpu->tlb_messages[0].count = 0;
+	} else {
+		/*
+		 * Enqueue the message.
+		 */
+		size_t idx = cpu->tlb_messages_count++;
+		cpu->tlb_messages[idx].type = type;
+		cpu->tlb_messages[idx].asid = asid;
+		cpu->tlb_messages[idx].page = page;
+		cpu->tlb_messages[idx].count = count;
+	}
+	irq_spinlock_unlock(&cpu->lock, false);
+}
+
+/** Deliver TLB shootdown message to a set of processors.
+ *
+ * Interrupts must be disabled and tlblock held.
+ *
+ * @param targets Processors to deliver the message to, or NULL for
+ *                all other processors.
+ * @param type    Type describing scope of shootdown.
+ * @param asid    Address space, if required by type.
+ * @param page    Virtual page address, if required by type.
+ * @param count   Number of pages, if required by type.
+ *
+ */
+static void tlb_shootdown_send(cpu_mask_t *targets, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
+{
+	atomic_inc(&tlb_shootdowns);
+
+	if ((type == TLB_INVL_PAGES) && (count > TLB_SHOOTDOWN_PAGES_MAX)) {
+		type = TLB_INVL_ASID;
+		page = 0;
+		count = 0;
+	}
+
+	size_t i;
+	size_t sent = 0;
+	for (i = 0; i < config.cpu_count; i++) {
+		if (i == CPU->id)
+			continue;
+
+		if ((targets) && (!cpu_mask_is_set(targets, i)))
+			continue;
+
+		tlb_message_queue(&cpus[i], type, asid, page, count);
+		sent++;
+	}
+
+	if (sent == 0)
+		return;
+
+	(void) atomic_fetch_add(&tlb_shootdown_ipis, sent);
+
+	if (targets)
+		ipi_multicast(targets, VECTOR_TLB_SHOOTDOWN_IPI);
+	else
+		tlb_shootdown_ipi_send();
+
+busy_wait:
+	for (i = 0; i < config.cpu_count; i++) {
+		if ((targets) && (!cpu_mask_is_set(targets, i)))
+			continue;
+
+		if (cpus[i].tlb_active)
+			goto busy_wait;
+	}
+}
+
 /** Send TLB shootdown message.
  *
  * This function attempts to deliver TLB shootdown message
@@ -87,44 +240,56 @@ ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
 
+	tlb_shootdown_send(NULL, type, asid, page, count);
+
+	return ipl;
+}
+
+/** Send TLB shootdown message for pages of an address space.
+ *
+ * Only the processors on which the address space is active are
+ * interrupted. The other ones are marked to invalidate the address
+ * space once they switch to it (see tlb_as_install()).
+ *
+ * @param as    Address space.
+ * @param page  Virtual page address.
+ * @param count Number of pages.
+ *
+ * @return The interrupt priority level as it existed prior to this call.
+ *
+ */
+ipl_t tlb_shootdown_as_start(as_t *as, uintptr_t page, size_t count)
+{
+	if (as->tlb_cpus == NULL)
+		return tlb_shootdown_start(TLB_INVL_PAGES, as->asid, page, count);
+
+	ipl_t ipl = interrupts_disable();
+	CPU->tlb_active = false;
+	irq_spinlock_lock(&tlblock, false);
+
+	DEFINE_CPU_MASK(targets);
+	cpu_mask_none(targets);
+
+	irq_spinlock_lock(&as->tlb_lock, false);
+
 	size_t i;
 	for (i = 0; i < config.cpu_count; i++) {
 		if (i == CPU->id)
 			continue;
 
-		cpu_t *cpu = &cpus[i];
-
-		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
-			/*
-			 * Enqueue the message.
-			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
-		}
-		irq_spinlock_unlock(&cpu->lock, false);
+		if (cpu_mask_is_set(as->tlb_cpus, i))
+			cpu_mask_set(targets, i);
+		else
+			cpu_mask_set(as->tlb_stale, i);
 	}
 
-	tlb_shootdown_ipi_send();
+	/* Processors switching to the address space now wait for us. */
+	atomic_store(&as->tlb_shootdown, true);
+	tlb_shootdown_as = as;
 
-busy_wait:
-	for (i = 0; i < config.cpu_count; i++) {
-		if (cpus[i].tlb_active)
-			goto busy_wait;
-	}
+	irq_spinlock_unlock(&as->tlb_lock, false);
+
+	tlb_shootdown_send(targets, TLB_INVL_PAGES, as->asid, page, count);
 
 	return ipl;
 }
@@ -136,11 +301,125 @@ busy_wait:
  */
 void tlb_shootdown_finalize(ipl_t ipl)
 {
+	if (tlb_shootdown_as) {
+		atomic_store(&tlb_shootdown_as->tlb_shootdown, false);
+		tlb_shootdown_as = NULL;
+	}
+
 	irq_spinlock_unlock(&tlblock, false);
 	CPU->tlb_active = true;
 	interrupts_restore(ipl);
 }
 
+/** Initialize TLB shootdown state of a new address space.
+ *
+ * The kernel address space is created before the number of processors is
+ * known and it is not tracked.
+ *
+ * @param as Address space with its ASID already initialized.
+ *
+ * @return EOK on success or ENOMEM.
+ *
+ */
+errno_t tlb_as_create(as_t *as)
+{
+	irq_spinlock_initialize(&as->tlb_lock, "as.tlb_lock");
+	atomic_init(&as->tlb_shootdown, false);
+
+	if (as->asid == ASID_KERNEL) {
+		as->tlb_cpus = NULL;
+		as->tlb_stale = NULL;
+		return EOK;
+	}
+
+	as->tlb_cpus = malloc(cpu_mask_size());
+	as->tlb_stale = malloc(cpu_mask_size());
+	if ((!as->tlb_cpus) || (!as->tlb_stale)) {
+		free(as->tlb_cpus);
+		free(as->tlb_stale);
+		as->tlb_cpus = NULL;
+		as->tlb_stale = NULL;
+		return ENOMEM;
+	}
+
+	/* ASIDs are purged from all TLBs when allocated. */
+	cpu_mask_none(as->tlb_cpus);
+	cpu_mask_none(as->tlb_stale);
+
+	return EOK;
+}
+
+/** Release TLB shootdown state of an address space.
+ *
+ * @param as Address space.
+ *
+ */
+void tlb_as_destroy(as_t *as)
+{
+	free(as->tlb_cpus);
+	free(as->tlb_stale);
+}
+
+/** Note that the current processor switches to an address space.
+ *
+ * Called from as_switch() with interrupts disabled.
+ *
+ * @param as Address space.
+ *
+ */
+void tlb_as_install(as_t *as)
+{
+	if (as->tlb_cpus == NULL)
+		return;
+
+	irq_spinlock_lock(&as->tlb_lock, false);
+
+	cpu_mask_set(as->tlb_cpus, CPU->id);
+	bool stale = cpu_mask_is_set(as->tlb_stale, CPU->id);
+	if (stale)
+		cpu_mask_reset(as->tlb_stale, CPU->id);
+
+	/*
+	 * A shootdown in progress was started before we joined, so its sender
+	 * does not wait for us.
+	 */
+	bool busy = atomic_load(&as->tlb_shootdown);
+
+	irq_spinlock_unlock(&as->tlb_lock, false);
+
+	/*
+	 * The mappings may be changing under the sender's hands, so wait for
+	 * it to finish and only then get rid of whatever we may have cached.
+	 */
+	if (busy) {
+		while (atomic_load(&as->tlb_shootdown))
+			;
+		stale = true;
+	}
+
+	if (stale) {
+		tlb_invalidate_asid(as->asid);
+		atomic_inc(&tlb_lazy_invalidations);
+	}
+}
+
+/** Note that the current processor switches away from an address space.
+ *
+ * Called from as_switch() with interrupts disabled.
+ *
+ * @param as Address space.
+ *
+ */
+void tlb_as_deinstall(as_t *as)
+{
+	if (as->tlb_cpus == NULL)
+		return;
+
+	irq_spinlock_lock(&as->tlb_lock, false);
+	cpu_mask_reset(as->tlb_cpus, CPU->id);
+	irq_spinlock_unlock(&as->tlb_lock, false);
+}
+
 void tlb_shootdown_ipi_send(void)
 {
 	ipi_broadcast(VECTOR_TLB_SHOOTDOWN_IPI);
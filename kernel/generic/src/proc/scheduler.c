@@ -46,6 +46,7 @@
 #include <mm/frame.h>
 #include <mm/page.h>
 #include <mm/as.h>
+#include <time/clock.h>
 #include <time/timeout.h>
 #include <time/delay.h>
 #include <arch/asm.h>
@@ -172,6 +173,161 @@ void scheduler_init(void)
 {
 }
 
+#ifdef CONFIG_SMP
+/** Time after which a thread no longer has its working set cached */
+#define CACHE_HOT_US  2500
+
+/** Topological distance between two CPUs
+ *
+ * @param a First CPU.
+ * @param b Second CPU.
+ *
+ * @return 0 if the CPUs share the last level cache, 1 if they share
+ *         the NUMA node, 2 otherwise.
+ *
+ */
+static unsigned int cpu_distance(cpu_t *a, cpu_t *b)
+{
+	if (a->cache_domain == b->cache_domain)
+		return 0;
+
+	if (a->node == b->node)
+		return 1;
+
+	return 2;
+}
+
+/** Check whether a thread is likely to be cache hot
+ *
+ * @param cpu    CPU on which the thread ran last.
+ * @param thread Locked thread.
+ *
+ * @return True if the thread ran on @a cpu recently enough for its
+ *         working set to still be in the cache.
+ *
+ */
+static bool thread_cache_hot(cpu_t *cpu, thread_t *thread)
+{
+	assert(irq_spinlock_locked(&thread->lock));
+
+	uint64_t now = cpu->last_cycle;
+	if (thread->last_cycle >= now)
+		return true;
+
+	return (now - thread->last_cycle <
+	    (uint64_t) cpu->frequency_mhz * CACHE_HOT_US);
+}
+
+/** Steal a thread from a run queue of another CPU
+ *
+ * The run queue is searched from the back. CPU-wired threads, threads
+ * already stolen, threads for which migration was temporarily disabled
+ * and threads whose FPU context is still in the CPU are never stolen.
+ * The stolen thread is removed from the run queue and it is up to the
+ * caller to ready it.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param cpu    CPU to steal from.
+ * @param rq     Index of the run queue to steal from.
+ * @param hot_ok Whether cache hot threads can be stolen as well.
+ *
+ * @return Stolen thread or NULL if there is no thread to steal.
+ *
+ */
+static thread_t *steal_thread(cpu_t *cpu, int rq, bool hot_ok)
+{
+	assert(interrupts_disabled());
+
+	irq_spinlock_lock(&(cpu->rq[rq].lock), false);
+
+	link_t *link = list_last(&cpu->rq[rq].rq);
+	while (link != NULL) {
+		thread_t *thread = list_get_instance(link, thread_t, rq_link);
+
+		irq_spinlock_lock(&thread->lock, false);
+
+		if ((!thread->wired) && (!thread->stolen) &&
+		    (!thread->nomigrate) && (!thread->fpu_context_engaged) &&
+		    ((hot_ok) || (!thread_cache_hot(cpu, thread)))) {
+			/*
+			 * Remove thread from ready queue.
+			 */
+			atomic_dec(&cpu->nrdy);
+			atomic_dec(&nrdy);
+
+			cpu->rq[rq].n--;
+			list_remove(&thread->rq_link);
+			irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+
+			thread->stolen = true;
+			thread->state = Entering;
+			irq_spinlock_unlock(&thread->lock, false);
+
+			return thread;
+		}
+
+		irq_spinlock_unlock(&thread->lock, false);
+		link = list_prev(link, &cpu->rq[rq].rq);
+	}
+
+	irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+	return NULL;
+}
+
+/** Pull a thread to a CPU which is about to go idle
+ *
+ * The busiest CPU sharing the cache with the current CPU is searched
+ * first, then the busiest CPU in the same node and finally the busiest
+ * CPU anywhere. Only threads which are no longer cache hot are pulled
+ * from CPUs which do not share the cache with the current CPU, since
+ * for them the migration cost outweighs the wait in the run queue.
+ *
+ * Interrupts must be disabled.
+ *
+ * @return True if a thread was readied on the current CPU.
+ *
+ */
+static bool idle_pull(void)
+{
+	assert(interrupts_disabled());
+
+	for (unsigned int distance = 0; distance <= 2; distance++) {
+		cpu_t *busiest = NULL;
+		size_t busiest_rdy = 0;
+
+		for (size_t acpu = 0; acpu < config.cpu_active; acpu++) {
+			cpu_t *cpu = &cpus[acpu];
+
+			if ((cpu == CPU) || (cpu_distance(CPU, cpu) != distance))
+				continue;
+
+			size_t rdy = atomic_load(&cpu->nrdy);
+			if (rdy > busiest_rdy) {
+				busiest = cpu;
+				busiest_rdy = rdy;
+			}
+		}
+
+		if (busiest == NULL)
+			continue;
+
+		/* Search least priority queues first */
+		for (int rq = RQ_COUNT - 1; rq >= 0; rq--) {
+			thread_t *thread = steal_thread(busiest, rq,
+			    distance == 0);
+			if (thread != NULL) {
+				thread_ready(thread);
+				atomic_inc(&CPU->idle_pulls);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+#endif /* CONFIG_SMP */
+
 /** Get thread to be scheduled
  *
  * Get the optimal thread to be scheduled
@@ -188,6 +344,15 @@ static thread_t *find_best_thread(void)
 loop:
 
 	if (atomic_load(&CPU->nrdy) == 0) {
+#ifdef CONFIG_SMP
+		/*
+		 * Rather than waiting for kcpulb, try to find some work
+		 * on other CPUs right away.
+		 */
+		if (idle_pull())
+			goto loop;
+#endif /* CONFIG_SMP */
+
 		/*
 		 * For there was nothing to run, the CPU goes to sleep
 		 * until a hardware interrupt or an IPI comes.
@@ -196,6 +361,7 @@ loop:
 		irq_spinlock_lock(&CPU->lock, false);
 		CPU->idle = true;
 		irq_spinlock_unlock(&CPU->lock, false);
+		clock_idle_enter();
 		interrupts_enable();
 
 		/*
@@ -205,6 +371,7 @@ loop:
 		 */
 		cpu_sleep();
 		interrupts_disable();
+		clock_idle_exit();
 		goto loop;
 	}
 
@@ -600,61 +767,19 @@ not_satisfied:
 			if (atomic_load(&cpu->nrdy) <= average)
 				continue;
 
-			irq_spinlock_lock(&(cpu->rq[rq].lock), true);
-			if (cpu->rq[rq].n == 0) {
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
-				continue;
-			}
-
-			thread_t *thread = NULL;
-
-			/* Search rq from the back */
-			link_t *link = list_last(&cpu->rq[rq].rq);
-
-			while (link != NULL) {
-				thread = (thread_t *) list_get_instance(link,
-				    thread_t, rq_link);
-
-				/*
-				 * Do not steal CPU-wired threads, threads
-				 * already stolen, threads for which migration
-				 * was temporarily disabled or threads whose
-				 * FPU context is still in the CPU.
-				 */
-				irq_spinlock_lock(&thread->lock, false);
-
-				if ((!thread->wired) && (!thread->stolen) &&
-				    (!thread->nomigrate) &&
-				    (!thread->fpu_context_engaged)) {
-					/*
-					 * Remove thread from ready queue.
-					 */
-					irq_spinlock_unlock(&thread->lock,
-					    false);
-
-					atomic_dec(&cpu->nrdy);
-					atomic_dec(&nrdy);
-
-					cpu->rq[rq].n--;
-					list_remove(&thread->rq_link);
-
-					break;
-				}
-
-				irq_spinlock_unlock(&thread->lock, false);
-
-				link = list_prev(link, &cpu->rq[rq].rq);
-				thread = NULL;
-			}
+			/*
+			 * Leave cache hot threads alone unless the CPUs
+			 * share the cache.
+			 */
+			ipl_t ipl = interrupts_disable();
+			thread_t *thread = steal_thread(cpu, rq,
+			    cpu_distance(CPU, cpu) == 0);
 
 			if (thread) {
 				/*
 				 * Ready thread on local CPU
 				 */
 
-				irq_spinlock_pass(&(cpu->rq[rq].lock),
-				    &thread->lock);
-
 #ifdef KCPULB_VERBOSE
 				log(LF_OTHER, LVL_DEBUG,
 				    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
@@ -663,11 +788,9 @@ not_satisfied:
 				    atomic_load(&nrdy) / config.cpu_active);
 #endif
 
-				thread->stolen = true;
-				thread->state = Entering;
-
-				irq_spinlock_unlock(&thread->lock, true);
 				thread_ready(thread);
+				interrupts_restore(ipl);
+				atomic_inc(&CPU->lb_steals);
 
 				if (--count == 0)
 					goto satisfied;
@@ -680,9 +803,9 @@ not_satisfied:
 				acpu_bias++;
 
 				continue;
-			} else
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+			}
 
+			interrupts_restore(ipl);
 		}
 	}
 
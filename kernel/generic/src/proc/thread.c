@@ -302,6 +302,19 @@ void thread_ready(thread_t *thread)
 		/* Prefer the CPU on which the thread ran last */
 		assert(thread->cpu != NULL);
 		cpu = thread->cpu;
+
+#ifdef CONFIG_SMP
+		/*
+		 * Unless that CPU is backed up and the waking CPU shares
+		 * its cache. The waking CPU gets to the thread sooner and
+		 * the thread does not lose its cached working set.
+		 */
+		if ((cpu != CPU) && (cpu->cache_domain == CPU->cache_domain) &&
+		    (atomic_load(&cpu->nrdy) > atomic_load(&CPU->nrdy) + 1)) {
+			cpu = CPU;
+			atomic_inc(&cpu->wakeup_migrations);
+		}
+#endif /* CONFIG_SMP */
 	} else {
 		cpu = CPU;
 	}
@@ -321,6 +334,8 @@ void thread_ready(thread_t *thread)
 
 	atomic_inc(&nrdy);
 	atomic_inc(&cpu->nrdy);
+
+	clock_idle_kick(cpu);
 }
 
 /** Create new thread
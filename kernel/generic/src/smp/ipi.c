@@ -39,6 +39,7 @@
 
 #include <smp/ipi.h>
 #include <config.h>
+#include <cpu/cpu_mask.h>
 
 /** Broadcast IPI message
  *
@@ -59,6 +60,19 @@ void ipi_broadcast(int ipi)
 		ipi_broadcast_arch(ipi);
 }
 
+/** Send IPI message to a set of CPUs
+ *
+ * @param mask CPUs to deliver the message to. Must not include
+ *             the current CPU.
+ * @param ipi  Message to send.
+ *
+ */
+void ipi_multicast(cpu_mask_t *mask, int ipi)
+{
+	if ((config.cpu_count > 1) && (!cpu_mask_is_none(mask)))
+		ipi_multicast_arch(mask, ipi);
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -43,6 +43,8 @@
 #include <synch/mutex.h>
 #include <time/clock.h>
 #include <mm/frame.h>
+#include <mm/slab.h>
+#include <mm/tlb.h>
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <interrupt.h>
@@ -125,13 +127,72 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 		stats_cpus[i].frequency_mhz = cpus[i].frequency_mhz;
 		stats_cpus[i].busy_cycles = cpus[i].busy_cycles;
 		stats_cpus[i].idle_cycles = cpus[i].idle_cycles;
+		stats_cpus[i].nrdy = atomic_load(&cpus[i].nrdy);
+		stats_cpus[i].idle_pulls = atomic_load(&cpus[i].idle_pulls);
+		stats_cpus[i].lb_steals = atomic_load(&cpus[i].lb_steals);
+		stats_cpus[i].wakeup_migrations =
+		    atomic_load(&cpus[i].wakeup_migrations);
 
 		irq_spinlock_unlock(&cpus[i].lock, true);
+
+		irq_spinlock_lock(&cpus[i].frame_cache.lock, true);
+		stats_cpus[i].frame_cache_hits = cpus[i].frame_cache.hits;
+		stats_cpus[i].frame_cache_misses = cpus[i].frame_cache.misses;
+		irq_spinlock_unlock(&cpus[i].frame_cache.lock, true);
 	}
 
 	return ((void *) stats_cpus);
 }
 
+/** Get the value of a statistical counter
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Counter of type atomic_size_t.
+ *
+ * @return Current value of the counter.
+ */
+static sysarg_t get_stats_counter(struct sysinfo_item *item, void *data)
+{
+	return atomic_load((atomic_size_t *) data);
+}
+
+/** Get slab cache statistics
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_slab_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_slabs(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	/*
+	 * The number of caches is obtained first and the statistics are
+	 * gathered only after the allocation, as allocating memory while
+	 * holding the slab cache list lock could deadlock.
+	 */
+	size_t count = slab_cache_count();
+
+	*size = sizeof(stats_slab_t) * count;
+	if ((dry_run) || (count == 0))
+		return NULL;
+
+	stats_slab_t *stats_slabs = (stats_slab_t *) malloc(*size);
+	if (stats_slabs == NULL) {
+		*size = 0;
+		return NULL;
+	}
+
+	count = slab_get_stats(stats_slabs, count);
+	*size = sizeof(stats_slab_t) * count;
+
+	return ((void *) stats_slabs);
+}
+
 /** Get the size of a virtual address space
  *
  * @param as Address space.
@@ -223,6 +284,9 @@ static void produce_stats_task(task_t *task, stats_task_t *stats_task)
 	str_cpy(stats_task->name, TASK_NAME_BUFLEN, task->name);
 	stats_task->virtmem = get_task_virtmem(task->as);
 	stats_task->resmem = get_task_resmem(task->as);
+	stats_task->large_pages = atomic_load(&task->as->large_pages);
+	stats_task->large_page_fallbacks =
+	    atomic_load(&task->as->large_page_fallbacks);
 	stats_task->threads = atomic_load(&task->refcount);
 	task_get_accounting(task, &(stats_task->ucycles),
 	    &(stats_task->kcycles));
@@ -878,6 +942,17 @@ void stats_init(void)
 	sysinfo_set_item_gen_data("system.threads", NULL, get_stats_threads, NULL);
 	sysinfo_set_item_gen_data("system.ipccs", NULL, get_stats_ipccs, NULL);
 	sysinfo_set_item_gen_data("system.exceptions", NULL, get_stats_exceptions, NULL);
+	sysinfo_set_item_gen_data("system.slabs", NULL, get_stats_slabs, NULL);
+	sysinfo_set_item_gen_val("system.tlb.shootdowns", NULL,
+	    get_stats_counter, &tlb_shootdowns);
+	sysinfo_set_item_gen_val("system.tlb.shootdown_ipis", NULL,
+	    get_stats_counter, &tlb_shootdown_ipis);
+	sysinfo_set_item_gen_val("system.tlb.lazy_invalidations", NULL,
+	    get_stats_counter, &tlb_lazy_invalidations);
+	sysinfo_set_item_gen_val("system.clock.idle_wakeups", NULL,
+	    get_stats_counter, &clock_idle_wakeups);
+	sysinfo_set_item_gen_val("system.clock.skipped_ticks", NULL,
+	    get_stats_counter, &clock_skipped_ticks);
 	sysinfo_set_subtree_fn("system.tasks", NULL, get_stats_task, NULL);
 	sysinfo_set_subtree_fn("system.threads", NULL, get_stats_thread, NULL);
 	sysinfo_set_subtree_fn("system.exceptions", NULL, get_stats_exception, NULL);
@@ -71,6 +71,18 @@ static parea_t clock_parea;
  */
 static sysarg_t secfrag = 0;
 
+/** One-shot operations of the clock device, NULL if it has none */
+static clock_oneshot_ops_t *clock_oneshot_ops = NULL;
+
+/** Number of wakeups of idle processors */
+atomic_size_t clock_idle_wakeups = 0;
+
+/** Number of ticks skipped by processors in tickless idle */
+atomic_size_t clock_skipped_ticks = 0;
+
+/** Number of processors currently in tickless idle */
+static atomic_size_t tickless_cpus = 0;
+
 /** Initialize realtime clock counter
  *
  * The applications (and sometimes kernel) need to access accurate
@@ -110,20 +122,24 @@ void clock_counter_init(void)
  * Update it only on first processor
  * TODO: Do we really need so many write barriers?
  *
+ * @param ticks Number of ticks to advance the counters by.
+ *
  */
-static void clock_update_counters(void)
+static void clock_update_counters(size_t ticks)
 {
 	if (CPU->id == 0) {
-		secfrag += 1000000 / HZ;
-		if (secfrag >= 1000000) {
-			secfrag -= 1000000;
-			uptime->seconds1++;
+		uint64_t usecs = secfrag + (uint64_t) ticks * (1000000 / HZ);
+		if (usecs >= 1000000) {
+			secfrag = usecs % 1000000;
+			uptime->seconds1 += usecs / 1000000;
 			write_barrier();
 			uptime->useconds = secfrag;
 			write_barrier();
 			uptime->seconds2 = uptime->seconds1;
-		} else
-			uptime->useconds += 1000000 / HZ;
+		} else {
+			secfrag = usecs;
+			uptime->useconds = secfrag;
+		}
 	}
 }
 
@@ -136,6 +152,128 @@ static void cpu_update_accounting(void)
 	irq_spinlock_unlock(&CPU->lock, false);
 }
 
+/** Register one-shot operations of the clock device
+ *
+ * Once registered, idle processors stop their periodic tick.
+ * Called on each processor which initializes its clock device.
+ *
+ * @param ops One-shot operations.
+ *
+ */
+void clock_oneshot_register(clock_oneshot_ops_t *ops)
+{
+	clock_oneshot_ops = ops;
+}
+
+/** Stop the periodic tick of an idle processor
+ *
+ * Arm the clock device for the next pending timeout instead, if
+ * it is further than a tick away. Called by the scheduler right
+ * before the processor goes to sleep, with interrupts disabled.
+ *
+ * The processor keeping the uptime keeps ticking while there
+ * are other processors which could read it. Processors also keep
+ * ticking while threads are ready on other processors, so that
+ * they retry stealing them on each tick.
+ *
+ */
+void clock_idle_enter(void)
+{
+	if (clock_oneshot_ops == NULL)
+		return;
+
+	if ((CPU->id == 0) && (config.cpu_active > 1))
+		return;
+
+	irq_spinlock_lock(&CPU->timeoutlock, false);
+	uint64_t ticks = timeout_wheel_next();
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
+
+	/* The wheel lags behind by the ticks not processed yet. */
+	size_t pending = CPU->missed_clock_ticks + CPU->idle_clock_ticks;
+	if (ticks <= pending + 1)
+		return;
+
+	if (ticks != UINT64_MAX)
+		ticks -= pending;
+
+	/*
+	 * Pairs with clock_idle_kick(): either the thread made ready
+	 * by another processor is seen here or the kick sees us
+	 * tickless.
+	 */
+	atomic_store(&CPU->tickless, true);
+	atomic_inc(&tickless_cpus);
+	if (atomic_load(&nrdy) != 0) {
+		atomic_dec(&tickless_cpus);
+		atomic_store(&CPU->tickless, false);
+		return;
+	}
+
+	CPU->tickless_ticks = clock_oneshot_ops->oneshot(ticks);
+}
+
+/** Resume the periodic tick after tickless idle
+ *
+ * Account the ticks slept through to the uptime and let the next
+ * clock() catch up with the timeouts. Called with interrupts
+ * disabled on any interrupt which wakes up an idle processor.
+ *
+ */
+void clock_idle_exit(void)
+{
+	if (!atomic_load(&CPU->tickless))
+		return;
+
+	uint64_t elapsed = clock_oneshot_ops->periodic();
+	atomic_store(&CPU->tickless, false);
+	atomic_dec(&tickless_cpus);
+
+	/*
+	 * If the device has gone off, its interrupt is either being
+	 * handled or pending and its clock() accounts for the last tick.
+	 */
+	if (elapsed >= CPU->tickless_ticks)
+		elapsed = CPU->tickless_ticks - 1;
+
+	clock_update_counters(elapsed);
+	CPU->idle_clock_ticks += elapsed;
+	atomic_fetch_add(&clock_skipped_ticks, elapsed);
+}
+
+/** Wake up a processor sleeping in tickless idle
+ *
+ * Called after a thread is made ready on a processor, so that the
+ * processor does not oversleep it until its next timeout. If the
+ * processor is not asleep, another processor sleeping in tickless
+ * idle is woken up to steal the thread instead.
+ *
+ * @param cpu Processor the thread was made ready on.
+ *
+ */
+void clock_idle_kick(cpu_t *cpu)
+{
+	if (atomic_load(&cpu->tickless)) {
+		if (cpu != CPU)
+			clock_oneshot_ops->wakeup(cpu);
+		return;
+	}
+
+#ifdef CONFIG_SMP
+	if (atomic_load(&tickless_cpus) == 0)
+		return;
+
+	for (size_t i = 0; i < config.cpu_active; i++) {
+		cpu_t *idle = &cpus[i];
+
+		if ((idle != CPU) && (atomic_load(&idle->tickless))) {
+			clock_oneshot_ops->wakeup(idle);
+			return;
+		}
+	}
+#endif /* CONFIG_SMP */
+}
+
 /** Clock routine
  *
  * Clock routine executed from clock interrupt handler
@@ -145,51 +283,59 @@ static void cpu_update_accounting(void)
  */
 void clock(void)
 {
+	/* The device might still be in one-shot mode if it woke us up */
+	clock_idle_exit();
+
 	size_t missed_clock_ticks = CPU->missed_clock_ticks;
+	size_t idle_clock_ticks = CPU->idle_clock_ticks;
 
-	/* Account CPU usage */
+	/* Update counters and account CPU usage */
+	clock_update_counters(1 + missed_clock_ticks);
 	cpu_update_accounting();
 
 	/*
-	 * To avoid lock ordering problems,
-	 * run all expired timeouts as you visit them.
+	 * Advance the timeout wheel by all the ticks, collecting
+	 * the expired timeouts.
 	 *
 	 */
 	size_t i;
-	for (i = 0; i <= missed_clock_ticks; i++) {
-		/* Update counters and accounting */
-		clock_update_counters();
-		cpu_update_accounting();
-
+	for (i = 0; i <= missed_clock_ticks + idle_clock_ticks; i++) {
 		irq_spinlock_lock(&CPU->timeoutlock, false);
+		timeout_wheel_advance();
+		irq_spinlock_unlock(&CPU->timeoutlock, false);
+	}
 
-		link_t *cur;
-		while ((cur = list_first(&CPU->timeout_active_list)) != NULL) {
-			timeout_t *timeout = list_get_instance(cur, timeout_t,
-			    link);
+	/*
+	 * To avoid lock ordering problems, run the expired timeouts
+	 * without holding any lock. They stay in the list of expired
+	 * timeouts until their turn comes, so they can still be
+	 * unregistered until then.
+	 *
+	 */
+	irq_spinlock_lock(&CPU->timeoutlock, false);
 
-			irq_spinlock_lock(&timeout->lock, false);
-			if (timeout->ticks-- != 0) {
-				irq_spinlock_unlock(&timeout->lock, false);
-				break;
-			}
+	link_t *cur;
+	while ((cur = list_first(&CPU->timeout_wheel.expired)) != NULL) {
+		timeout_t *timeout = list_get_instance(cur, timeout_t, link);
 
-			list_remove(cur);
-			timeout_handler_t handler = timeout->handler;
-			void *arg = timeout->arg;
-			timeout_reinitialize(timeout);
+		irq_spinlock_lock(&timeout->lock, false);
 
-			irq_spinlock_unlock(&timeout->lock, false);
-			irq_spinlock_unlock(&CPU->timeoutlock, false);
+		list_remove(cur);
+		timeout_handler_t handler = timeout->handler;
+		void *arg = timeout->arg;
+		timeout_reinitialize(timeout);
 
-			handler(arg);
+		irq_spinlock_unlock(&timeout->lock, false);
+		irq_spinlock_unlock(&CPU->timeoutlock, false);
 
-			irq_spinlock_lock(&CPU->timeoutlock, false);
-		}
+		handler(arg);
 
-		irq_spinlock_unlock(&CPU->timeoutlock, false);
+		irq_spinlock_lock(&CPU->timeoutlock, false);
 	}
+
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
 	CPU->missed_clock_ticks = 0;
+	CPU->idle_clock_ticks = 0;
 
 	/*
 	 * Do CPU usage accounting and find out whether to preempt THREAD.
@@ -52,8 +52,16 @@
  */
 void timeout_init(void)
 {
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+
 	irq_spinlock_initialize(&CPU->timeoutlock, "cpu.timeoutlock");
-	list_initialize(&CPU->timeout_active_list);
+
+	wheel->tick = 0;
+	for (unsigned int level = 0; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		for (unsigned int slot = 0; slot < TIMEOUT_WHEEL_SLOTS; slot++)
+			list_initialize(&wheel->slots[level][slot]);
+	}
+	list_initialize(&wheel->expired);
 }
 
 /** Reinitialize timeout
@@ -85,6 +93,140 @@ void timeout_initialize(timeout_t *timeout)
 	timeout_reinitialize(timeout);
 }
 
+/** Insert timeout into a timeout wheel
+ *
+ * The wheel's CPU timeoutlock must be held.
+ *
+ * @param wheel   Timeout wheel.
+ * @param timeout Timeout with timeout->ticks not before wheel->tick.
+ *
+ */
+static void timeout_wheel_insert(timeout_wheel_t *wheel, timeout_t *timeout)
+{
+	uint64_t expires = timeout->ticks;
+	uint64_t delta = expires - wheel->tick;
+
+	unsigned int level = 0;
+	while ((level < TIMEOUT_WHEEL_LEVELS - 1) &&
+	    (delta >> (TIMEOUT_WHEEL_BITS * (level + 1))) != 0)
+		level++;
+
+	/* Park timeouts beyond the reach of the wheel in its last period. */
+	if ((delta >> (TIMEOUT_WHEEL_BITS * TIMEOUT_WHEEL_LEVELS)) != 0) {
+		expires = wheel->tick +
+		    ((uint64_t) 1 << (TIMEOUT_WHEEL_BITS * TIMEOUT_WHEEL_LEVELS)) - 1;
+	}
+
+	size_t slot = (expires >> (TIMEOUT_WHEEL_BITS * level)) &
+	    TIMEOUT_WHEEL_MASK;
+	list_append(&timeout->link, &wheel->slots[level][slot]);
+}
+
+/** Redistribute timeouts of a slot among the lower levels
+ *
+ * @param wheel Timeout wheel.
+ * @param level Level of the slot, at least one.
+ *
+ * @return Index of the cascaded slot.
+ *
+ */
+static size_t timeout_wheel_cascade(timeout_wheel_t *wheel, unsigned int level)
+{
+	size_t slot = (wheel->tick >> (TIMEOUT_WHEEL_BITS * level)) &
+	    TIMEOUT_WHEEL_MASK;
+
+	list_t pending;
+	list_initialize(&pending);
+	list_concat(&pending, &wheel->slots[level][slot]);
+
+	link_t *cur;
+	while ((cur = list_first(&pending)) != NULL) {
+		list_remove(cur);
+		timeout_wheel_insert(wheel,
+		    list_get_instance(cur, timeout_t, link));
+	}
+
+	return slot;
+}
+
+/** Advance the timeout wheel of the current CPU by one tick
+ *
+ * Timeouts which expire in the tick are moved to the list of
+ * expired timeouts of the wheel, where clock() picks them up.
+ * CPU->timeoutlock must be held.
+ *
+ */
+void timeout_wheel_advance(void)
+{
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+	size_t slot = wheel->tick & TIMEOUT_WHEEL_MASK;
+
+	/*
+	 * At the start of a period of a level, bring the timeouts
+	 * expiring in it one level down.
+	 */
+	if (slot == 0) {
+		for (unsigned int level = 1; level < TIMEOUT_WHEEL_LEVELS;
+		    level++) {
+			if (timeout_wheel_cascade(wheel, level) != 0)
+				break;
+		}
+	}
+
+	list_concat(&wheel->expired, &wheel->slots[0][slot]);
+	wheel->tick++;
+}
+
+/** Find out when the current CPU needs its next clock tick
+ *
+ * Timeouts in the lowest level of the wheel expire exactly in the tick
+ * of their slot. For the higher levels, the tick at which their slot
+ * is cascaded is taken instead. CPU->timeoutlock must be held.
+ *
+ * @return Number of clock() calls until the first one which has work
+ *         to do (one is the next tick), zero if there are expired
+ *         timeouts to be run, UINT64_MAX if there are no timeouts.
+ *
+ */
+uint64_t timeout_wheel_next(void)
+{
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+
+	if (!list_empty(&wheel->expired))
+		return 0;
+
+	uint64_t next = UINT64_MAX;
+
+	for (unsigned int level = 0; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		unsigned int shift = TIMEOUT_WHEEL_BITS * level;
+
+		/* The first tick at which this level visits a slot. */
+		uint64_t first = wheel->tick;
+		if (level > 0)
+			first = ((wheel->tick + ((uint64_t) 1 << shift) - 1) >>
+			    shift) << shift;
+
+		if (first - wheel->tick >= next)
+			break;
+
+		size_t first_slot = (first >> shift) & TIMEOUT_WHEEL_MASK;
+
+		for (size_t i = 0; i < TIMEOUT_WHEEL_SLOTS; i++) {
+			size_t slot = (first_slot + i) & TIMEOUT_WHEEL_MASK;
+			if (list_empty(&wheel->slots[level][slot]))
+				continue;
+
+			uint64_t delta = first - wheel->tick +
+			    ((uint64_t) i << shift);
+			if (delta < next)
+				next = delta;
+			break;
+		}
+	}
+
+	return (next == UINT64_MAX) ? next : next + 1;
+}
+
 /** Register timeout
  *
  * Insert timeout handler f (with argument arg)
@@ -107,52 +249,12 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 		panic("Unexpected: timeout->cpu != 0.");
 
 	timeout->cpu = CPU;
-	timeout->ticks = us2ticks(time);
+	timeout->ticks = CPU->timeout_wheel.tick + us2ticks(time);
 
 	timeout->handler = handler;
 	timeout->arg = arg;
 
-	/*
-	 * Insert timeout into the active timeouts list according to timeout->ticks.
-	 */
-	uint64_t sum = 0;
-	timeout_t *target = NULL;
-	link_t *cur, *prev;
-	prev = NULL;
-	for (cur = list_first(&CPU->timeout_active_list);
-	    cur != NULL; cur = list_next(cur, &CPU->timeout_active_list)) {
-		target = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&target->lock, false);
-
-		if (timeout->ticks < sum + target->ticks) {
-			irq_spinlock_unlock(&target->lock, false);
-			break;
-		}
-
-		sum += target->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-		prev = cur;
-	}
-
-	if (prev == NULL)
-		list_prepend(&timeout->link, &CPU->timeout_active_list);
-	else
-		list_insert_after(&timeout->link, prev);
-
-	/*
-	 * Adjust timeout->ticks according to ticks
-	 * accumulated in target's predecessors.
-	 */
-	timeout->ticks -= sum;
-
-	/*
-	 * Decrease ticks of timeout's immediate succesor by timeout->ticks.
-	 */
-	if (cur != NULL) {
-		irq_spinlock_lock(&target->lock, false);
-		target->ticks -= timeout->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
+	timeout_wheel_insert(&CPU->timeout_wheel, timeout);
 
 	irq_spinlock_unlock(&timeout->lock, false);
 	irq_spinlock_unlock(&CPU->timeoutlock, true);
@@ -186,18 +288,9 @@ grab_locks:
 
 	/*
 	 * Now we know for sure that timeout hasn't been activated yet
-	 * and is lurking in timeout->cpu->timeout_active_list.
+	 * and is lurking in the timeout wheel of timeout->cpu.
 	 */
 
-	link_t *cur = list_next(&timeout->link,
-	    &timeout->cpu->timeout_active_list);
-	if (cur != NULL) {
-		timeout_t *tmp = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&tmp->lock, false);
-		tmp->ticks += timeout->ticks;
-		irq_spinlock_unlock(&tmp->lock, false);
-	}
-
 	list_remove(&timeout->link);
 	irq_spinlock_unlock(&timeout->cpu->timeoutlock, false);
 
@@ -50,26 +50,31 @@
 
 #define HEADER_TABLE     "Filesystem           Size           Used      Available Used%% Mounted on"
 #define HEADER_TABLE_BLK "Filesystem  Blk. Size     Total        Used   Available Used%% Mounted on"
+#define HEADER_TABLE_CACHE "Filesystem       Hits     Misses Read-ahead    RA hits     Writes    Written Cached Target Mounted on"
 
 #define PERCENTAGE(x, tot) (tot ? (100ULL * (x) / (tot)) : 0)
 
 static bool display_blocks;
+static bool display_cache;
 
 static errno_t size_to_human_readable(uint64_t, size_t, char **);
 static void print_header(void);
 static errno_t print_statfs(vfs_statfs_t *, char *, char *);
+static void print_cache_stats(vfs_cache_stats_t *, char *, char *);
 static void print_usage(void);
 
 int main(int argc, char *argv[])
 {
 	int optres, errflg = 0;
 	vfs_statfs_t st;
+	vfs_cache_stats_t cst;
 	errno_t rc;
 
 	display_blocks = false;
+	display_cache = false;
 
 	/* Parse command-line options */
-	while ((optres = getopt(argc, argv, "ubh")) != -1) {
+	while ((optres = getopt(argc, argv, "ubch")) != -1) {
 		switch (optres) {
 		case 'h':
 			print_usage();
@@ -79,6 +84,10 @@ int main(int argc, char *argv[])
 			display_blocks = true;
 			break;
 
+		case 'c':
+			display_cache = true;
+			break;
+
 		case '?':
 			fprintf(stderr, "Unrecognized option: -%c\n", optopt);
 			errflg++;
@@ -107,6 +116,15 @@ int main(int argc, char *argv[])
 
 	print_header();
 	list_foreach(mtab_list, link, mtab_ent_t, mtab_ent) {
+		if (display_cache) {
+			/* File systems without a block cache are skipped */
+			if (vfs_cache_stats_path(mtab_ent->mp, &cst) == EOK) {
+				print_cache_stats(&cst, mtab_ent->fs_name,
+				    mtab_ent->mp);
+			}
+			continue;
+		}
+
 		if (vfs_statfs_path(mtab_ent->mp, &st) == 0) {
 			rc = print_statfs(&st, mtab_ent->fs_name, mtab_ent->mp);
 			if (rc != EOK)
@@ -132,7 +150,9 @@ static errno_t size_to_human_readable(uint64_t nblocks, size_t block_size, char
 
 static void print_header(void)
 {
-	if (!display_blocks)
+	if (display_cache)
+		printf(HEADER_TABLE_CACHE);
+	else if (!display_blocks)
 		printf(HEADER_TABLE);
 	else
 		printf(HEADER_TABLE_BLK);
@@ -189,12 +209,23 @@ error:
 	return ENOMEM;
 }
 
+static void print_cache_stats(vfs_cache_stats_t *st, char *name,
+    char *mountpoint)
+{
+	/* Hits / Misses / Read-ahead / RA hits / Writes / Written / Cached / Target / Mounted on */
+	printf("%10s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+	    " %10" PRIu64 " %10" PRIu64 " %6" PRIu64 " %6" PRIu64 " %s\n",
+	    name, st->hits, st->misses, st->ra_blocks, st->ra_hits, st->writes,
+	    st->written, st->cached, st->target, mountpoint);
+}
+
 static void print_usage(void)
 {
 	printf("Syntax: %s [<options>] \n", NAME);
 	printf("Options:\n");
 	printf("  -h Print help\n");
 	printf("  -b Print exact block sizes and numbers\n");
+	printf("  -c Print block cache statistics\n");
 }
 
 /** @}
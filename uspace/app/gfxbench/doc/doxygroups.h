@@ -0,0 +1,4 @@
+/** @addtogroup gfxbench gfxbench
+ * @brief Memory GC rendering benchmark
+ * @ingroup apps
+ */
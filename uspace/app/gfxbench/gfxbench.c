@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup gfxbench
+ * @{
+ */
+/** @file Memory GC rendering benchmark
+ *
+ * Measures the throughput of the software renderer (memory GC) for
+ * rectangle fills and for each kind of bitmap blit. This is the code
+ * path the display server uses to compose windows.
+ */
+
+#include <errno.h>
+#include <gfx/bitmap.h>
+#include <gfx/color.h>
+#include <gfx/context.h>
+#include <gfx/render.h>
+#include <io/pixel.h>
+#include <io/pixelmap.h>
+#include <memgfx/memgc.h>
+#include <perf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+
+#define NAME "gfxbench"
+
+/** Canvas width */
+#define CANVAS_W 1024
+/** Canvas height */
+#define CANVAS_H 768
+/** Number of operations between reading the clock */
+#define BATCH 16
+
+/** Benchmark kind */
+typedef enum {
+	/** Fill rectangle */
+	gb_fill,
+	/** Render opaque bitmap */
+	gb_copy,
+	/** Render bitmap with color key */
+	gb_key,
+	/** Render bitmap with color key and colorization */
+	gb_colorize
+} gfxbench_kind_t;
+
+/** Benchmark description */
+typedef struct {
+	const char *name;
+	gfxbench_kind_t kind;
+	gfx_bitmap_flags_t flags;
+} gfxbench_t;
+
+static gfxbench_t benchmarks[] = {
+	{ "fill", gb_fill, 0 },
+	{ "copy", gb_copy, 0 },
+	{ "key", gb_key, bmpf_color_key },
+	{ "colorize", gb_colorize, bmpf_color_key | bmpf_colorize }
+};
+
+/** Key color used in test bitmaps */
+#define KEY_COLOR PIXEL(0, 255, 0, 255)
+
+static void gfxbench_invalidate(void *arg, gfx_rect_t *rect)
+{
+	(void) arg;
+	(void) rect;
+}
+
+static void gfxbench_update(void *arg)
+{
+	(void) arg;
+}
+
+/** Create bitmap covering the whole canvas.
+ *
+ * About a quarter of the pixels is set to the key color.
+ *
+ * @param gc Graphic context
+ * @param flags Bitmap flags
+ * @param rbitmap Place to store pointer to new bitmap
+ * @return EOK on success or an error code
+ */
+static errno_t gfxbench_bitmap_create(gfx_context_t *gc,
+    gfx_bitmap_flags_t flags, gfx_bitmap_t **rbitmap)
+{
+	gfx_bitmap_params_t params;
+	gfx_bitmap_alloc_t alloc;
+	gfx_bitmap_t *bitmap;
+	pixelmap_t pixelmap;
+	sysarg_t x, y;
+	errno_t rc;
+
+	gfx_bitmap_params_init(&params);
+	params.rect.p0.x = 0;
+	params.rect.p0.y = 0;
+	params.rect.p1.x = CANVAS_W;
+	params.rect.p1.y = CANVAS_H;
+	params.flags = flags;
+	params.key_color = KEY_COLOR;
+
+	rc = gfx_bitmap_create(gc, &params, NULL, &bitmap);
+	if (rc != EOK)
+		return rc;
+
+	rc = gfx_bitmap_get_alloc(bitmap, &alloc);
+	if (rc != EOK) {
+		gfx_bitmap_destroy(bitmap);
+		return rc;
+	}
+
+	pixelmap.width = CANVAS_W;
+	pixelmap.height = CANVAS_H;
+	pixelmap.data = alloc.pixels;
+
+	for (y = 0; y < CANVAS_H; y++) {
+		for (x = 0; x < CANVAS_W; x++) {
+			pixelmap_put_pixel(&pixelmap, x, y,
+			    (x + y) % 4 == 0 ? KEY_COLOR :
+			    PIXEL(0, x & 0xff, y & 0xff, 0x80));
+		}
+	}
+
+	*rbitmap = bitmap;
+	return EOK;
+}
+
+/** Run one benchmark.
+ *
+ * @param gc Graphic context
+ * @param bench Benchmark
+ * @param duration Minimum duration in nanoseconds
+ * @return EOK on success or an error code
+ */
+static errno_t gfxbench_run(gfx_context_t *gc, gfxbench_t *bench,
+    nsec_t duration)
+{
+	gfx_bitmap_t *bitmap = NULL;
+	gfx_rect_t rect;
+	stopwatch_t sw;
+	uint64_t npixels;
+	uint64_t rate;
+	nsec_t nsec;
+	unsigned i;
+	errno_t rc;
+
+	rect.p0.x = 0;
+	rect.p0.y = 0;
+	rect.p1.x = CANVAS_W;
+	rect.p1.y = CANVAS_H;
+
+	if (bench->kind != gb_fill) {
+		rc = gfxbench_bitmap_create(gc, bench->flags, &bitmap);
+		if (rc != EOK)
+			return rc;
+	}
+
+	npixels = 0;
+	stopwatch_init(&sw);
+	stopwatch_start(&sw);
+
+	do {
+		for (i = 0; i < BATCH; i++) {
+			if (bench->kind == gb_fill)
+				rc = gfx_fill_rect(gc, &rect);
+			else
+				rc = gfx_bitmap_render(bitmap, NULL, NULL);
+			if (rc != EOK)
+				goto out;
+		}
+
+		npixels += BATCH * CANVAS_W * CANVAS_H;
+		stopwatch_stop(&sw);
+		nsec = stopwatch_get_nanos(&sw);
+	} while (nsec < duration);
+
+	/* Thousandths of Mpixel/s */
+	rate = npixels * 1000000 / (uint64_t) NSEC2USEC(nsec);
+	printf("%-10s %6" PRIu64 ".%03" PRIu64 " Mpixel/s\n", bench->name,
+	    rate / 1000, rate % 1000);
+out:
+	if (bitmap != NULL)
+		gfx_bitmap_destroy(bitmap);
+	return rc;
+}
+
+static void print_syntax(void)
+{
+	printf("Syntax: %s [-t <seconds>] [<benchmark>...]\n", NAME);
+	printf("Benchmarks: fill, copy, key, colorize (default: all)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	gfx_bitmap_alloc_t alloc;
+	gfx_rect_t rect;
+	gfx_color_t *color = NULL;
+	mem_gc_t *mgc = NULL;
+	gfx_context_t *gc;
+	nsec_t duration;
+	size_t nbench;
+	size_t j;
+	bool any;
+	int i;
+	errno_t rc;
+
+	duration = SEC2NSEC(2);
+	nbench = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+	i = 1;
+	while (i < argc && argv[i][0] == '-') {
+		if (str_cmp(argv[i], "-t") == 0) {
+			++i;
+			if (i >= argc) {
+				printf("Argument missing.\n");
+				print_syntax();
+				return 1;
+			}
+
+			duration = SEC2NSEC(strtoul(argv[i++], NULL, 10));
+			if (duration == 0) {
+				printf("Invalid duration.\n");
+				return 1;
+			}
+		} else {
+			printf("Invalid option '%s'.\n", argv[i]);
+			print_syntax();
+			return 1;
+		}
+	}
+
+	for (j = i; j < (size_t) argc; j++) {
+		any = false;
+		for (size_t k = 0; k < nbench; k++) {
+			if (str_cmp(argv[j], benchmarks[k].name) == 0)
+				any = true;
+		}
+
+		if (!any) {
+			printf("Unknown benchmark '%s'.\n", argv[j]);
+			print_syntax();
+			return 1;
+		}
+	}
+
+	rect.p0.x = 0;
+	rect.p0.y = 0;
+	rect.p1.x = CANVAS_W;
+	rect.p1.y = CANVAS_H;
+
+	alloc.pitch = CANVAS_W * sizeof(uint32_t);
+	alloc.off0 = 0;
+	alloc.pixels = calloc(1, alloc.pitch * CANVAS_H);
+	if (alloc.pixels == NULL) {
+		printf("Out of memory.\n");
+		return 1;
+	}
+
+	rc = mem_gc_create(&rect, &alloc, gfxbench_invalidate,
+	    gfxbench_update, NULL, &mgc);
+	if (rc != EOK) {
+		printf("Error creating memory GC: %s\n", str_error(rc));
+		goto error;
+	}
+
+	gc = mem_gc_get_ctx(mgc);
+
+	rc = gfx_color_new_rgb_i16(0xffff, 0x8000, 0, &color);
+	if (rc != EOK) {
+		printf("Error creating color: %s\n", str_error(rc));
+		goto error;
+	}
+
+	rc = gfx_set_color(gc, color);
+	if (rc != EOK) {
+		printf("Error setting color: %s\n", str_error(rc));
+		goto error;
+	}
+
+	printf("Canvas %dx%d\n", CANVAS_W, CANVAS_H);
+
+	for (j = 0; j < nbench; j++) {
+		any = (i >= argc);
+		for (int k = i; k < argc; k++) {
+			if (str_cmp(argv[k], benchmarks[j].name) == 0)
+				any = true;
+		}
+
+		if (!any)
+			continue;
+
+		rc = gfxbench_run(gc, &benchmarks[j], duration);
+		if (rc != EOK) {
+			printf("Benchmark '%s' failed: %s\n",
+			    benchmarks[j].name, str_error(rc));
+			goto error;
+		}
+	}
+
+	gfx_color_delete(color);
+	mem_gc_delete(mgc);
+	free(alloc.pixels);
+	return 0;
+error:
+	if (color != NULL)
+		gfx_color_delete(color);
+	if (mgc != NULL)
+		mem_gc_delete(mgc);
+	free(alloc.pixels);
+	return 1;
+}
+
+/** @}
+ */
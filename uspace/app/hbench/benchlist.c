@@ -38,11 +38,16 @@
 #include "hbench.h"
 
 benchmark_t *benchmarks[] = {
+	&benchmark_amap,
 	&benchmark_dir_read,
 	&benchmark_fibril_mutex,
 	&benchmark_file_read,
+	&benchmark_file_read_parallel,
+	&benchmark_file_write,
+	&benchmark_lookup,
 	&benchmark_malloc1,
 	&benchmark_malloc2,
+	&benchmark_malloc3,
 	&benchmark_ns_ping,
 	&benchmark_ping_pong
 };
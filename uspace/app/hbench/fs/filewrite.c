@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <str_error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../hbench.h"
+
+#define BUFFER_SIZE 4096
+
+/** Execute file writing benchmark.
+ *
+ * Sequentially writes size blocks into a new file and removes it afterwards.
+ * The result depends mostly on how well the file system keeps the file
+ * contiguous and on how the block cache writes the blocks back, so the
+ * file should be placed on a volume with a real on-disk file system (e.g.
+ * an ext4 image attached through file_bd).
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *path = bench_env_param_get(env, "filename",
+	    "/tmp/hbench_file_write");
+
+	char *buf = malloc(BUFFER_SIZE);
+	if (buf == NULL) {
+		return bench_run_fail(run, "failed to allocate %dB buffer", BUFFER_SIZE);
+	}
+	memset(buf, 0x5a, BUFFER_SIZE);
+
+	bool ret = true;
+
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		bench_run_fail(run, "failed to open %s for writing: %s",
+		    path, str_error(errno));
+		ret = false;
+		goto leave_free_buf;
+	}
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		if (fwrite(buf, 1, BUFFER_SIZE, file) != BUFFER_SIZE) {
+			bench_run_fail(run, "failed to write to %s: %s",
+			    path, str_error(errno));
+			ret = false;
+			goto leave_close;
+		}
+	}
+
+	if (fflush(file) != 0) {
+		bench_run_fail(run, "failed to flush %s: %s",
+		    path, str_error(errno));
+		ret = false;
+		goto leave_close;
+	}
+	bench_run_stop(run);
+
+leave_close:
+	fclose(file);
+	remove(path);
+
+leave_free_buf:
+	free(buf);
+
+	return ret;
+}
+
+benchmark_t benchmark_file_write = {
+	.name = "file_write",
+	.desc = "Sequentially write a new file of size 4KiB blocks (use 'filename' param to place it on the volume under test).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <str_error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+#define BUFFER_SIZE 4096
+#define MAX_READERS 64
+
+typedef struct {
+	const char *path;
+	/** Number of whole-file reads still to be claimed by the readers. */
+	uint64_t remaining;
+	/** Number of readers that have not finished yet. */
+	unsigned running;
+	/** First error encountered by any of the readers. */
+	errno_t rc;
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+} shared_t;
+
+/** Read the whole file through a private file descriptor.
+ *
+ * @param fd Open file descriptor.
+ * @param buf Buffer of BUFFER_SIZE bytes.
+ *
+ * @return EOK on success or an error code.
+ */
+static errno_t read_file(int fd, char *buf)
+{
+	aoff64_t pos = 0;
+	size_t nread;
+	errno_t rc;
+
+	do {
+		rc = vfs_read(fd, &pos, buf, BUFFER_SIZE, &nread);
+		if (rc != EOK)
+			return rc;
+	} while (nread > 0);
+
+	return EOK;
+}
+
+static errno_t reader(void *arg)
+{
+	shared_t *shared = arg;
+	char *buf = NULL;
+	int fd = -1;
+	errno_t rc;
+
+	buf = malloc(BUFFER_SIZE);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = vfs_lookup_open(shared->path, WALK_REGULAR, MODE_READ, &fd);
+	if (rc != EOK)
+		goto out;
+
+	while (true) {
+		fibril_mutex_lock(&shared->lock);
+		bool more = shared->remaining > 0 && shared->rc == EOK;
+		if (more)
+			shared->remaining--;
+		fibril_mutex_unlock(&shared->lock);
+
+		if (!more)
+			break;
+
+		rc = read_file(fd, buf);
+		if (rc != EOK)
+			break;
+	}
+
+out:
+	if (fd >= 0)
+		vfs_put(fd);
+	free(buf);
+
+	fibril_mutex_lock(&shared->lock);
+	if (rc != EOK && shared->rc == EOK)
+		shared->rc = rc;
+	shared->running--;
+	fibril_condvar_broadcast(&shared->done_cv);
+	fibril_mutex_unlock(&shared->lock);
+
+	return rc;
+}
+
+/** Execute parallel file reading benchmark.
+ *
+ * Several fibrils read the same file, each through its own file descriptor,
+ * so that the file system server receives concurrent read requests for one
+ * node. The total amount of work does not depend on the number of readers,
+ * the size iterations (each reading the whole file) are shared among them.
+ * Comparing runs with a different 'readers' param shows how well the reads
+ * overlap.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	shared_t shared;
+	unsigned readers;
+
+	shared.path = bench_env_param_get(env, "filename",
+	    "/data/web/helenos.png");
+	readers = strtoul(bench_env_param_get(env, "readers", "4"), NULL, 10);
+	if (readers == 0 || readers > MAX_READERS) {
+		return bench_run_fail(run, "number of readers must be "
+		    "between 1 and %d", MAX_READERS);
+	}
+
+	shared.remaining = size;
+	shared.running = 0;
+	shared.rc = EOK;
+	fibril_mutex_initialize(&shared.lock);
+	fibril_condvar_initialize(&shared.done_cv);
+
+	bench_run_start(run);
+
+	for (unsigned i = 0; i < readers; i++) {
+		fid_t fid = fibril_create(reader, &shared);
+		if (fid == 0) {
+			fibril_mutex_lock(&shared.lock);
+			shared.rc = ENOMEM;
+			fibril_mutex_unlock(&shared.lock);
+			break;
+		}
+
+		fibril_mutex_lock(&shared.lock);
+		shared.running++;
+		fibril_mutex_unlock(&shared.lock);
+
+		fibril_detach(fid);
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&shared.lock);
+	while (shared.running > 0)
+		fibril_condvar_wait(&shared.done_cv, &shared.lock);
+	fibril_mutex_unlock(&shared.lock);
+
+	bench_run_stop(run);
+
+	if (shared.rc != EOK) {
+		return bench_run_fail(run, "failed to read %s: %s",
+		    shared.path, str_error(shared.rc));
+	}
+
+	return true;
+}
+
+benchmark_t benchmark_file_read_parallel = {
+	.name = "file_read_parallel",
+	.desc = "Read one file from several fibrils at once (use 'filename' and 'readers' params to alter the defaults).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
@@ -131,11 +131,16 @@ extern benchmark_t *benchmarks[];
 extern size_t benchmark_count;
 
 /* Put your benchmark descriptors here (and also to benchlist.c). */
+extern benchmark_t benchmark_amap;
 extern benchmark_t benchmark_dir_read;
 extern benchmark_t benchmark_fibril_mutex;
 extern benchmark_t benchmark_file_read;
+extern benchmark_t benchmark_file_read_parallel;
+extern benchmark_t benchmark_file_write;
+extern benchmark_t benchmark_lookup;
 extern benchmark_t benchmark_malloc1;
 extern benchmark_t benchmark_malloc2;
+extern benchmark_t benchmark_malloc3;
 extern benchmark_t benchmark_ns_ping;
 extern benchmark_t benchmark_ping_pong;
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../hbench.h"
+
+/*
+ * Several fibrils running on multiple threads allocate and free small
+ * blocks of various sizes concurrently. Each fibril keeps a small working
+ * set of blocks so that both the allocation and the deallocation paths
+ * are exercised.
+ */
+
+#define WORKING_SET  64
+
+typedef struct {
+	uint64_t niter;
+	bool failed;
+	fibril_semaphore_t *done;
+} worker_t;
+
+static errno_t worker(void *arg)
+{
+	worker_t *w = arg;
+	void *blocks[WORKING_SET] = { NULL };
+
+	for (uint64_t i = 0; i < w->niter; i++) {
+		size_t idx = i % WORKING_SET;
+
+		free(blocks[idx]);
+		blocks[idx] = malloc(8 + (i * 24) % 248);
+		if (blocks[idx] == NULL) {
+			w->failed = true;
+			break;
+		}
+	}
+
+	for (size_t idx = 0; idx < WORKING_SET; idx++)
+		free(blocks[idx]);
+
+	fibril_semaphore_up(w->done);
+	return EOK;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	int threads = atoi(bench_env_param_get(env, "threads", "4"));
+	if (threads <= 0)
+		return bench_run_fail(run, "invalid number of threads %d", threads);
+
+	fibril_request_runners(threads);
+
+	worker_t *workers = calloc(threads, sizeof(worker_t));
+	if (workers == NULL) {
+		return bench_run_fail(run, "failed to allocate %d workers",
+		    threads);
+	}
+
+	fibril_semaphore_t done;
+	fibril_semaphore_initialize(&done, 0);
+
+	bench_run_start(run);
+
+	int started = 0;
+	for (int i = 0; i < threads; i++) {
+		workers[i].niter = niter / threads;
+		workers[i].done = &done;
+
+		fid_t fid = fibril_create(worker, &workers[i]);
+		if (fid == 0)
+			break;
+
+		fibril_add_ready(fid);
+		started++;
+	}
+
+	for (int i = 0; i < started; i++)
+		fibril_semaphore_down(&done);
+
+	bench_run_stop(run);
+
+	bool failed = (started < threads);
+	for (int i = 0; i < started; i++)
+		failed = failed || workers[i].failed;
+
+	free(workers);
+
+	if (failed)
+		return bench_run_fail(run, "failed to allocate a block");
+
+	return true;
+}
+
+benchmark_t benchmark_malloc3 = {
+	.name = "malloc3",
+	.desc = "User-space memory allocator benchmark, allocate and free small blocks in several threads (use 'threads' param to alter the default)",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <nettl/amap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * The association map is populated with a large number of connections
+ * (fully specified endpoint pairs) plus a listener on the local address
+ * and a listener on all addresses. Lookups then mimic incoming segments:
+ * most of them belong to an existing connection, the rest fall back
+ * to one of the listeners.
+ */
+
+/** Local port of all connections and of the laddr listener */
+#define AMAP_LPORT  80
+/** Port of the unspec listener */
+#define AMAP_UNSPEC_LPORT  22
+
+static amap_t *map;
+static inet_ep2_t *conns;
+static size_t nconns;
+static inet_ep2_t laddr_ep;
+static inet_ep2_t unspec_ep;
+
+/** Fill in endpoint pair of i-th connection. */
+static void conn_epp(size_t i, inet_ep2_t *epp)
+{
+	inet_ep2_init(epp);
+	inet_addr(&epp->remote.addr, 10, (i >> 16) & 0xff, (i >> 8) & 0xff,
+	    i & 0xff);
+	epp->remote.port = 1024 + (i % 50000);
+	inet_addr(&epp->local.addr, 192, 168, 0, 1);
+	epp->local.port = AMAP_LPORT;
+}
+
+static bool teardown(bench_env_t *env, bench_run_t *run)
+{
+	if (map == NULL)
+		return true;
+
+	for (size_t i = 0; i < nconns; i++)
+		amap_remove(map, &conns[i]);
+	if (laddr_ep.local.port != inet_port_any)
+		amap_remove(map, &laddr_ep);
+	if (unspec_ep.local.port != inet_port_any)
+		amap_remove(map, &unspec_ep);
+
+	amap_destroy(map);
+	free(conns);
+	map = NULL;
+	conns = NULL;
+	nconns = 0;
+	return true;
+}
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	inet_ep2_t epp;
+	errno_t rc;
+
+	int count = atoi(bench_env_param_get(env, "assocs", "100000"));
+	if (count <= 0 || count > 0xffffff)
+		return bench_run_fail(run, "invalid number of associations %d",
+		    count);
+
+	rc = amap_create(&map);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed to create association map: %s",
+		    str_error(rc));
+	}
+
+	conns = calloc(count, sizeof(inet_ep2_t));
+	if (conns == NULL) {
+		teardown(env, run);
+		return bench_run_fail(run, "failed to allocate %d endpoint pairs",
+		    count);
+	}
+
+	inet_ep2_init(&laddr_ep);
+	inet_ep2_init(&unspec_ep);
+
+	for (int i = 0; i < count; i++) {
+		conn_epp(i, &epp);
+		rc = amap_insert(map, &epp, &conns[i], af_allow_system,
+		    &conns[i]);
+		if (rc != EOK) {
+			teardown(env, run);
+			return bench_run_fail(run, "failed to insert "
+			    "association %d: %s", i, str_error(rc));
+		}
+
+		nconns++;
+	}
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 192, 168, 0, 1);
+	epp.local.port = AMAP_LPORT;
+	rc = amap_insert(map, &epp, &laddr_ep, af_allow_system, &laddr_ep);
+	if (rc != EOK) {
+		teardown(env, run);
+		return bench_run_fail(run, "failed to insert listener: %s",
+		    str_error(rc));
+	}
+
+	inet_ep2_init(&epp);
+	epp.local.port = AMAP_UNSPEC_LPORT;
+	rc = amap_insert(map, &epp, &unspec_ep, af_allow_system, &unspec_ep);
+	if (rc != EOK) {
+		teardown(env, run);
+		return bench_run_fail(run, "failed to insert listener: %s",
+		    str_error(rc));
+	}
+
+	return true;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	inet_ep2_t epp;
+	void *arg;
+	void *expected;
+	uint32_t seed = 1;
+	size_t idx;
+	errno_t rc;
+
+	bench_run_start(run);
+
+	for (uint64_t i = 0; i < niter; i++) {
+		seed = seed * 1103515245 + 12345;
+		idx = (seed >> 8) % nconns;
+
+		switch (i % 8) {
+		case 0:
+			/* New connection to the address listener */
+			conn_epp(idx, &epp);
+			epp.remote.port = 1;
+			expected = &laddr_ep;
+			break;
+		case 1:
+			/* New connection to the catch-all listener */
+			conn_epp(idx, &epp);
+			epp.local.port = AMAP_UNSPEC_LPORT;
+			expected = &unspec_ep;
+			break;
+		default:
+			/* Segment of an existing connection */
+			epp = conns[idx];
+			expected = &conns[idx];
+			break;
+		}
+
+		rc = amap_find_match(map, &epp, &arg);
+		if (rc != EOK || arg != expected) {
+			bench_run_stop(run);
+			return bench_run_fail(run, "lookup %" PRIu64 " did not "
+			    "find the expected association", i);
+		}
+	}
+
+	bench_run_stop(run);
+
+	return true;
+}
+
+benchmark_t benchmark_amap = {
+	.name = "amap",
+	.desc = "Look up endpoint pairs in an association map holding many connections (use 'assocs' param to alter the default)",
+	.entry = &runner,
+	.setup = &setup,
+	.teardown = &teardown
+};
+
+/** @}
+ */
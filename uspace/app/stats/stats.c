@@ -74,8 +74,8 @@ static void list_tasks(void)
 		return;
 	}
 
-	printf("[taskid] [thrds] [resident] [virtual] [ucycles]"
-	    " [kcycles] [name\n");
+	printf("[taskid] [thrds] [resident] [virtual] [large] [lfails]"
+	    " [ucycles] [kcycles] [name\n");
 
 	for (size_t i = 0; i < count; i++) {
 		uint64_t resmem;
@@ -93,9 +93,11 @@ static void list_tasks(void)
 		order_suffix(stats_tasks[i].kcycles, &kcycles, &ksuffix);
 
 		printf("%-8" PRIu64 " %7zu %7" PRIu64 "%s %6" PRIu64 "%s"
-		    " %8" PRIu64 "%c %8" PRIu64 "%c %s\n",
+		    " %7zu %8zu %8" PRIu64 "%c %8" PRIu64 "%c %s\n",
 		    stats_tasks[i].task_id, stats_tasks[i].threads,
 		    resmem, resmem_suffix, virtmem, virtmem_suffix,
+		    stats_tasks[i].large_pages,
+		    stats_tasks[i].large_page_fallbacks,
 		    ucycles, usuffix, kcycles, ksuffix, stats_tasks[i].name);
 	}
 
@@ -172,7 +174,8 @@ static void list_cpus(void)
 		return;
 	}
 
-	printf("[id] [MHz     ] [busy cycles] [idle cycles]\n");
+	printf("[id] [MHz     ] [busy cycles] [idle cycles] [ready] "
+	    "[pulls  ] [steals ] [wakeups] [frame cache hits]\n");
 
 	for (size_t i = 0; i < count; i++) {
 		printf("%-4u ", cpus[i].id);
@@ -183,9 +186,17 @@ static void list_cpus(void)
 			order_suffix(cpus[i].busy_cycles, &bcycles, &bsuffix);
 			order_suffix(cpus[i].idle_cycles, &icycles, &isuffix);
 
-			printf("%10" PRIu16 " %12" PRIu64 "%c %12" PRIu64 "%c\n",
+			uint64_t fcache = cpus[i].frame_cache_hits +
+			    cpus[i].frame_cache_misses;
+
+			printf("%10" PRIu16 " %12" PRIu64 "%c %12" PRIu64 "%c "
+			    "%7zu %9" PRIu64 " %9" PRIu64 " %9" PRIu64
+			    " %17" PRIu64 "%%\n",
 			    cpus[i].frequency_mhz, bcycles, bsuffix,
-			    icycles, isuffix);
+			    icycles, isuffix, cpus[i].nrdy, cpus[i].idle_pulls,
+			    cpus[i].lb_steals, cpus[i].wakeup_migrations,
+			    (fcache > 0) ?
+			    (cpus[i].frame_cache_hits * 100 / fcache) : 0);
 		} else
 			printf("inactive\n");
 	}
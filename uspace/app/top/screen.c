@@ -260,6 +260,13 @@ static inline void print_cpu_info(data_t *data)
 			print_percent(data->cpus_perc[i].idle, 2);
 			fputs(", busy: ", stdout);
 			print_percent(data->cpus_perc[i].busy, 2);
+			screen_newline();
+
+			printf("      ready: %zu, idle pulls: %" PRIu64
+			    ", balancer steals: %" PRIu64 ", wakeup migrations: %"
+			    PRIu64, data->cpus[i].nrdy, data->cpus[i].idle_pulls,
+			    data->cpus[i].lb_steals,
+			    data->cpus[i].wakeup_migrations);
 		} else
 			printf("cpu%u inactive", data->cpus[i].id);
 
@@ -320,6 +327,9 @@ static inline void print_help(void)
 	printf("      a .. toggle display of all/hot exceptions");
 	screen_newline();
 
+	printf(" b .. slab allocator statistics");
+	screen_newline();
+
 	printf(" h .. toggle this help screen");
 	screen_newline();
 
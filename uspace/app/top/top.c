@@ -57,6 +57,7 @@ typedef enum {
 	OP_TASKS,
 	OP_IPC,
 	OP_EXCS,
+	OP_SLABS,
 } op_mode_t;
 
 static const column_t task_columns[] = {
@@ -124,6 +125,33 @@ enum {
 	EXCEPTION_NUM_COLUMNS,
 };
 
+static const column_t slab_columns[] = {
+	{ "size",    'z',  8 },
+	{ "allocd",  'o',  9 },
+	{ "cached",  'c',  9 },
+	{ "mag",     'm',  5 },
+	{ "allocs",  'a',  9 },
+	{ "%amiss",  'A',  8 },
+	{ "frees",   'f',  9 },
+	{ "%fmiss",  'F',  8 },
+	{ "contend", 'C',  9 },
+	{ "name",    'd',  0 },
+};
+
+enum {
+	SLAB_COL_SIZE = 0,
+	SLAB_COL_ALLOCATED,
+	SLAB_COL_CACHED,
+	SLAB_COL_MAG_SIZE,
+	SLAB_COL_ALLOCS,
+	SLAB_COL_PERCENT_ALLOC_MISSES,
+	SLAB_COL_FREES,
+	SLAB_COL_PERCENT_FREE_MISSES,
+	SLAB_COL_CONTENTION,
+	SLAB_COL_NAME,
+	SLAB_NUM_COLUMNS,
+};
+
 screen_mode_t screen_mode = SCREEN_TABLE;
 static op_mode_t op_mode = OP_TASKS;
 static size_t sort_column = TASK_COL_PERCENT_USER;
@@ -141,6 +169,9 @@ static const char *read_data(data_t *target)
 	target->threads = NULL;
 	target->exceptions = NULL;
 	target->exceptions_perc = NULL;
+	target->slabs = NULL;
+	target->slabs_diff = NULL;
+	target->slabs_perc = NULL;
 	target->physmem = NULL;
 	target->ucycles_diff = NULL;
 	target->kcycles_diff = NULL;
@@ -209,6 +240,21 @@ static const char *read_data(data_t *target)
 	if (target->exceptions_perc == NULL)
 		return "Not enough memory for exception utilization";
 
+	/* Get slab caches */
+	target->slabs = stats_get_slabs(&(target->slabs_count));
+	if (target->slabs == NULL)
+		return "Cannot get slab caches";
+
+	target->slabs_diff =
+	    (diff_slab_t *) calloc(target->slabs_count, sizeof(diff_slab_t));
+	if (target->slabs_diff == NULL)
+		return "Not enough memory for slab cache differences";
+
+	target->slabs_perc =
+	    (perc_slab_t *) calloc(target->slabs_count, sizeof(perc_slab_t));
+	if (target->slabs_perc == NULL)
+		return "Not enough memory for slab cache miss ratios";
+
 	/* Get physical memory */
 	target->physmem = stats_get_physmem();
 	if (target->physmem == NULL)
@@ -358,6 +404,47 @@ static void compute_percentages(data_t *old_data, data_t *new_data)
 		FRACTION_TO_FLOAT(new_data->exceptions_perc[i].count,
 		    new_data->ecount_diff[i] * 100, ecount_total);
 	}
+
+	/* For each slab cache compute the traffic and miss ratios */
+
+	for (i = 0; i < new_data->slabs_count; i++) {
+		stats_slab_t *new_slab = &new_data->slabs[i];
+		diff_slab_t *diff = &new_data->slabs_diff[i];
+
+		/* Match slab cache with the previous instance */
+
+		bool found = false;
+		size_t j;
+		for (j = 0; j < old_data->slabs_count; j++) {
+			if (str_cmp(new_slab->name, old_data->slabs[j].name) == 0) {
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			/* This is a new slab cache, ignore it */
+			memset(diff, 0, sizeof(*diff));
+		} else {
+			stats_slab_t *old_slab = &old_data->slabs[j];
+
+			diff->alloc_misses =
+			    new_slab->alloc_misses - old_slab->alloc_misses;
+			diff->allocs = new_slab->alloc_hits -
+			    old_slab->alloc_hits + diff->alloc_misses;
+			diff->free_misses =
+			    new_slab->free_misses - old_slab->free_misses;
+			diff->frees = new_slab->free_hits -
+			    old_slab->free_hits + diff->free_misses;
+			diff->contention =
+			    new_slab->depot_contention - old_slab->depot_contention;
+		}
+
+		FRACTION_TO_FLOAT(new_data->slabs_perc[i].alloc_misses,
+		    diff->alloc_misses * 100, diff->allocs);
+		FRACTION_TO_FLOAT(new_data->slabs_perc[i].free_misses,
+		    diff->free_misses * 100, diff->frees);
+	}
 }
 
 static int cmp_data(void *a, void *b, void *arg)
@@ -514,6 +601,48 @@ static const char *fill_exception_table(data_t *data)
 	return NULL;
 }
 
+static const char *fill_slab_table(data_t *data)
+{
+	data->table.name = "Slab caches";
+	data->table.num_columns = SLAB_NUM_COLUMNS;
+	data->table.columns = slab_columns;
+	data->table.num_fields = data->slabs_count * SLAB_NUM_COLUMNS;
+	data->table.fields = calloc(data->table.num_fields, sizeof(field_t));
+	if (data->table.fields == NULL)
+		return "Not enough memory for table fields";
+
+	field_t *field = data->table.fields;
+	for (size_t i = 0; i < data->slabs_count; i++) {
+		stats_slab_t *slab = &data->slabs[i];
+		diff_slab_t *diff = &data->slabs_diff[i];
+		perc_slab_t *perc = &data->slabs_perc[i];
+
+		field[SLAB_COL_SIZE].type = FIELD_UINT_SUFFIX_BIN;
+		field[SLAB_COL_SIZE].uint = slab->size;
+		field[SLAB_COL_ALLOCATED].type = FIELD_UINT_SUFFIX_DEC;
+		field[SLAB_COL_ALLOCATED].uint = slab->allocated;
+		field[SLAB_COL_CACHED].type = FIELD_UINT_SUFFIX_DEC;
+		field[SLAB_COL_CACHED].uint = slab->cached;
+		field[SLAB_COL_MAG_SIZE].type = FIELD_UINT;
+		field[SLAB_COL_MAG_SIZE].uint = slab->mag_size;
+		field[SLAB_COL_ALLOCS].type = FIELD_UINT_SUFFIX_DEC;
+		field[SLAB_COL_ALLOCS].uint = diff->allocs;
+		field[SLAB_COL_PERCENT_ALLOC_MISSES].type = FIELD_PERCENT;
+		field[SLAB_COL_PERCENT_ALLOC_MISSES].fixed = perc->alloc_misses;
+		field[SLAB_COL_FREES].type = FIELD_UINT_SUFFIX_DEC;
+		field[SLAB_COL_FREES].uint = diff->frees;
+		field[SLAB_COL_PERCENT_FREE_MISSES].type = FIELD_PERCENT;
+		field[SLAB_COL_PERCENT_FREE_MISSES].fixed = perc->free_misses;
+		field[SLAB_COL_CONTENTION].type = FIELD_UINT_SUFFIX_DEC;
+		field[SLAB_COL_CONTENTION].uint = diff->contention;
+		field[SLAB_COL_NAME].type = FIELD_STRING;
+		field[SLAB_COL_NAME].string = slab->name;
+		field += SLAB_NUM_COLUMNS;
+	}
+
+	return NULL;
+}
+
 static const char *fill_table(data_t *data)
 {
 	if (data->table.fields != NULL) {
@@ -528,6 +657,8 @@ static const char *fill_table(data_t *data)
 		return fill_ipc_table(data);
 	case OP_EXCS:
 		return fill_exception_table(data);
+	case OP_SLABS:
+		return fill_slab_table(data);
 	}
 	return NULL;
 }
@@ -558,6 +689,15 @@ static void free_data(data_t *target)
 	if (target->exceptions_perc != NULL)
 		free(target->exceptions_perc);
 
+	if (target->slabs != NULL)
+		free(target->slabs);
+
+	if (target->slabs_diff != NULL)
+		free(target->slabs_diff);
+
+	if (target->slabs_perc != NULL)
+		free(target->slabs_perc);
+
 	if (target->physmem != NULL)
 		free(target->physmem);
 
@@ -644,6 +784,9 @@ int main(int argc, char *argv[])
 		case 'e':
 			op_mode = OP_EXCS;
 			break;
+		case 'b':
+			op_mode = OP_SLABS;
+			break;
 		case 's':
 			screen_mode = SCREEN_SORT;
 			break;
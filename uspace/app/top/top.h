@@ -79,6 +79,19 @@ typedef struct {
 	fixed_float count;
 } perc_exc_t;
 
+typedef struct {
+	uint64_t allocs;
+	uint64_t alloc_misses;
+	uint64_t frees;
+	uint64_t free_misses;
+	uint64_t contention;
+} diff_slab_t;
+
+typedef struct {
+	fixed_float alloc_misses;
+	fixed_float free_misses;
+} perc_slab_t;
+
 typedef enum {
 	FIELD_EMPTY,
 	FIELD_UINT,
@@ -139,6 +152,11 @@ typedef struct {
 	stats_exc_t *exceptions;
 	perc_exc_t *exceptions_perc;
 
+	size_t slabs_count;
+	stats_slab_t *slabs;
+	diff_slab_t *slabs_diff;
+	perc_slab_t *slabs_perc;
+
 	stats_physmem_t *physmem;
 
 	uint64_t *ucycles_diff;
@@ -32,6 +32,7 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <macros.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -44,22 +45,19 @@
 
 #define NAME	"virtio-blk"
 
-#define VIRTIO_BLK_NUM_QUEUES	1
-
-#define RQ_QUEUE	0
-
 /*
  * VIRTIO_BLK requests need at least two descriptors so that device-read-only
- * buffers are separated from device-writable buffers. For convenience, we
- * always use three descriptors for the request header, buffer and footer.
- * We therefore organize the virtque so that first RQ_BUFFERS descriptors are
- * used for request headers, the following RQ_BUFFERS descriptors are used
- * for in/out buffers and the last RQ_BUFFERS descriptors are used for request
- * footers.
+ * buffers are separated from device-writable buffers. Each request consists
+ * of the request header, one descriptor for every physically contiguous part
+ * of the caller's buffer and the request footer.
+ *
+ * If the device supports indirect descriptors, the request descriptors are
+ * kept in a per-slot table and the virtqueue holds a single descriptor per
+ * request, so the ring can accommodate RQ_SLOTS requests. Otherwise, the
+ * virtqueue is divided into runs of ring_descs descriptors, one run for each
+ * request slot.
  */
-#define REQ_HEADER_DESC(descno)	(0 * RQ_BUFFERS + (descno))
-#define REQ_BUFFER_DESC(descno)	(1 * RQ_BUFFERS + (descno))
-#define REQ_FOOTER_DESC(descno)	(2 * RQ_BUFFERS + (descno))
+#define REQ_RING_DESC(vblk, slot)	((slot) * (vblk)->ring_descs)
 
 static errno_t virtio_blk_dev_add(ddf_dev_t *dev);
 
@@ -80,11 +78,27 @@ static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
 	uint16_t descno;
 	uint32_t len;
 
-	while (virtio_virtq_consume_used(vdev, RQ_QUEUE, &descno, &len)) {
-		assert(descno < RQ_BUFFERS);
-		fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
-		fibril_condvar_signal(&virtio_blk->completion_cv[descno]);
-		fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
+	/*
+	 * All request queues share the interrupt. Interrupts from a queue are
+	 * suppressed while it is being drained so that requests completed in
+	 * the meantime are collected by this pass.
+	 */
+	for (unsigned i = 0; i < virtio_blk->num_queues; i++) {
+		virtio_blk_queue_t *q = &virtio_blk->queues[i];
+
+		do {
+			virtio_virtq_disable_interrupts(vdev, q->num);
+
+			fibril_mutex_lock(&q->lock);
+			while (virtio_virtq_consume_used(vdev, q->num, &descno,
+			    &len)) {
+				uint16_t slot = descno / virtio_blk->ring_descs;
+				assert(slot < q->slots);
+				q->done[slot] = true;
+				fibril_condvar_signal(&q->done_cv[slot]);
+			}
+			fibril_mutex_unlock(&q->lock);
+		} while (virtio_virtq_enable_interrupts(vdev, q->num));
 	}
 }
 
@@ -157,131 +171,236 @@ static errno_t virtio_blk_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
-    aoff64_t ba, void *buf)
+/** Set the i-th descriptor of a request */
+static void virtio_blk_desc_set(virtio_blk_t *virtio_blk, virtio_blk_queue_t *q,
+    uint16_t slot, unsigned i, uintptr_t addr, uint32_t len, uint16_t flags)
 {
-	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
-
-	/*
-	 * Allocate a descriptor.
-	 *
-	 * The allocated descno will determine the header descriptor
-	 * (REQ_HEADER_DESC), the buffer descriptor (REQ_BUFFER_DESC) and the
-	 * footer (REQ_FOOTER_DESC) descriptor.
-	 */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	uint16_t descno = virtio_alloc_desc(vdev, RQ_QUEUE,
-	    &virtio_blk->rq_free_head);
-	while (descno == (uint16_t) -1U) {
-		fibril_condvar_wait(&virtio_blk->free_cv,
-		    &virtio_blk->free_lock);
-		descno = virtio_alloc_desc(vdev, RQ_QUEUE,
-		    &virtio_blk->rq_free_head);
+	if (virtio_blk->indirect) {
+		virtq_desc_t *d = &((virtq_desc_t *) q->rq_table[slot])[i];
+		pio_write_le64(&d->addr, addr);
+		pio_write_le32(&d->len, len);
+		pio_write_le16(&d->flags, flags);
+		pio_write_le16(&d->next, i + 1);
+	} else {
+		uint16_t descno = REQ_RING_DESC(virtio_blk, slot) + i;
+		virtio_virtq_desc_set(&virtio_blk->virtio_dev, q->num, descno,
+		    addr, len, flags, descno + 1);
 	}
-	fibril_mutex_unlock(&virtio_blk->free_lock);
+}
+
+/** Get the physical address of a byte of the caller's buffer
+ *
+ * The device transfers data directly to and from the caller's buffer. Its
+ * page is touched first so that a page of a fresh buffer gets a frame.
+ * Anonymous memory is never moved while it is mapped so the address stays
+ * valid until the buffer is freed after the request is complete.
+ */
+static errno_t virtio_blk_buf_phys(void *virt, uintptr_t *phys)
+{
+	(void) *(volatile uint8_t *) virt;
+	return as_get_physical_mapping(virt, phys);
+}
 
-	assert(descno < RQ_BUFFERS);
+/** Prepare a request in a slot and offer it to the device
+ *
+ * The device is not notified, see virtio_virtq_kick().
+ *
+ * @param size  Number of bytes to transfer, at most rq_max_blocks blocks.
+ */
+static errno_t virtio_blk_rq_submit(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t slot, bool read, aoff64_t ba, void *buf,
+    size_t size)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+	uint16_t wflag = read ? VIRTQ_DESC_F_WRITE : 0;
 
 	/* Setup the request header */
 	virtio_blk_req_header_t *req_header =
-	    (virtio_blk_req_header_t *) virtio_blk->rq_header[descno];
+	    (virtio_blk_req_header_t *) q->rq_header[slot];
 	memset(req_header, 0, sizeof(virtio_blk_req_header_t));
 	pio_write_le32(&req_header->type,
 	    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT);
 	pio_write_le64(&req_header->sector, ba);
 
-	/* Copy write data to the request. */
-	if (!read)
-		memcpy(virtio_blk->rq_buf[descno], buf, VIRTIO_BLK_BLOCK_SIZE);
+	unsigned i = 0;
+	virtio_blk_desc_set(virtio_blk, q, slot, i++, q->rq_header_p[slot],
+	    sizeof(virtio_blk_req_header_t), VIRTQ_DESC_F_NEXT);
 
-	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	/* Describe the caller's buffer by physically contiguous segments */
+	size_t off = 0;
+	while (off < size) {
+		uintptr_t phys;
+		errno_t rc = virtio_blk_buf_phys(buf + off, &phys);
+		if (rc != EOK)
+			return rc;
 
-	/*
-	 * Set the descriptors, chain them in the virtqueue and notify the
-	 * device.
-	 */
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_HEADER_DESC(descno),
-	    virtio_blk->rq_header_p[descno], sizeof(virtio_blk_req_header_t),
-	    VIRTQ_DESC_F_NEXT, REQ_BUFFER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_BUFFER_DESC(descno),
-	    virtio_blk->rq_buf_p[descno], VIRTIO_BLK_BLOCK_SIZE,
-	    VIRTQ_DESC_F_NEXT | (read ? VIRTQ_DESC_F_WRITE : 0),
-	    REQ_FOOTER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_FOOTER_DESC(descno),
-	    virtio_blk->rq_footer_p[descno], sizeof(virtio_blk_req_footer_t),
-	    VIRTQ_DESC_F_WRITE, 0);
-	virtio_virtq_produce_available(vdev, RQ_QUEUE, descno);
+		size_t len = min(size - off,
+		    PAGE_SIZE - ((uintptr_t) (buf + off) & (PAGE_SIZE - 1)));
+		while (off + len < size) {
+			uintptr_t next;
+			rc = virtio_blk_buf_phys(buf + off + len, &next);
+			if (rc != EOK)
+				return rc;
+			if (next != phys + len)
+				break;
+			len += min(size - off - len, PAGE_SIZE);
+		}
 
-	/*
-	 * Wait for the completion of the request.
-	 */
-	fibril_condvar_wait(&virtio_blk->completion_cv[descno],
-	    &virtio_blk->completion_lock[descno]);
-	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
+		assert(i <= virtio_blk->seg_max);
+		virtio_blk_desc_set(virtio_blk, q, slot, i++, phys, len,
+		    VIRTQ_DESC_F_NEXT | wflag);
+		off += len;
+	}
+
+	virtio_blk_desc_set(virtio_blk, q, slot, i++, q->rq_footer_p[slot],
+	    sizeof(virtio_blk_req_footer_t), VIRTQ_DESC_F_WRITE);
+
+	uint16_t head = REQ_RING_DESC(virtio_blk, slot);
+	if (virtio_blk->indirect) {
+		virtio_virtq_desc_set(vdev, q->num, head, q->rq_table_p[slot],
+		    i * sizeof(virtq_desc_t), VIRTQ_DESC_F_INDIRECT, 0);
+	}
+
+	virtio_virtq_push_available(vdev, q->num, head);
+	return EOK;
+}
+
+/** Wait for the completion of a request and return its status */
+static errno_t virtio_blk_rq_wait(virtio_blk_queue_t *q, uint16_t slot)
+{
+	fibril_mutex_lock(&q->lock);
+	while (!q->done[slot])
+		fibril_condvar_wait(&q->done_cv[slot], &q->lock);
+	q->done[slot] = false;
+	fibril_mutex_unlock(&q->lock);
 
-	errno_t rc;
 	virtio_blk_req_footer_t *footer =
-	    (virtio_blk_req_footer_t *) virtio_blk->rq_footer[descno];
+	    (virtio_blk_req_footer_t *) q->rq_footer[slot];
 	switch (footer->status) {
 	case VIRTIO_BLK_S_OK:
-		rc = EOK;
-		break;
+		return EOK;
 	case VIRTIO_BLK_S_IOERR:
-		rc = EIO;
-		break;
+		return EIO;
 	case VIRTIO_BLK_S_UNSUPP:
-		rc = ENOTSUP;
-		break;
+		return ENOTSUP;
 	default:
 		ddf_msg(LVL_DEBUG, "device returned unknown status=%d\n",
 		    (int) footer->status);
-		rc = EIO;
-		break;
+		return EIO;
 	}
-
-	/* Copy read data from the request */
-	if (rc == EOK && read)
-		memcpy(buf, virtio_blk->rq_buf[descno], VIRTIO_BLK_BLOCK_SIZE);
-
-	/* Free the descriptor and buffer */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
-	fibril_condvar_signal(&virtio_blk->free_cv);
-	fibril_mutex_unlock(&virtio_blk->free_lock);
-
-	return rc;
 }
 
-static errno_t virtio_blk_bd_rw_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
-    void *buf, size_t size, bool read)
+/** Transfer several ranges of blocks
+ *
+ * The ranges are split into requests of at most rq_max_blocks blocks. As many
+ * of them as there are free slots in the request queue are put in flight at
+ * once.
+ */
+static errno_t virtio_blk_rw_vec(virtio_blk_t *virtio_blk, bd_vec_t *vec,
+    size_t nvec, bool read)
 {
-	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
-	aoff64_t i;
-	errno_t rc;
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+	uint16_t slots[RQ_SLOTS];
+	size_t needed = 0;
+	errno_t rc = EOK;
+
+	for (size_t v = 0; v < nvec; v++) {
+		if (vec[v].size != vec[v].cnt * VIRTIO_BLK_BLOCK_SIZE)
+			return EINVAL;
+		needed += (vec[v].cnt + virtio_blk->rq_max_blocks - 1) /
+		    virtio_blk->rq_max_blocks;
+	}
 
-	if (size != cnt * VIRTIO_BLK_BLOCK_SIZE)
-		return EINVAL;
+	/* Spread the clients' requests over the request queues */
+	virtio_blk_queue_t *q = &virtio_blk->queues[
+	    atomic_fetch_add(&virtio_blk->next_queue, 1) %
+	    virtio_blk->num_queues];
+
+	/* Position of the next request */
+	size_t v = 0;
+	size_t done = 0;
+
+	while (needed > 0 && rc == EOK) {
+		/*
+		 * Take as many free slots as the transfer needs, waiting only
+		 * if there is none at all.
+		 */
+		unsigned n = 0;
+		fibril_mutex_lock(&q->lock);
+		while (q->free_count == 0)
+			fibril_condvar_wait(&q->free_cv, &q->lock);
+		while (q->free_count > 0 && n < needed)
+			slots[n++] = q->free[--q->free_count];
+		fibril_mutex_unlock(&q->lock);
+
+		/* Put the whole batch in flight and notify the device once */
+		unsigned submitted = 0;
+		while (submitted < n) {
+			while (done == vec[v].cnt) {
+				v++;
+				done = 0;
+			}
+
+			size_t blocks = min(vec[v].cnt - done,
+			    virtio_blk->rq_max_blocks);
+			rc = virtio_blk_rq_submit(virtio_blk, q,
+			    slots[submitted], read, vec[v].ba + done,
+			    vec[v].buf + done * VIRTIO_BLK_BLOCK_SIZE,
+			    blocks * VIRTIO_BLK_BLOCK_SIZE);
+			if (rc != EOK)
+				break;
+			submitted++;
+			done += blocks;
+		}
+		virtio_virtq_kick(vdev, q->num);
+		needed -= submitted;
 
-	for (i = 0; i < cnt; i++) {
-		rc = virtio_blk_rw_block(virtio_blk, read, ba + i,
-		    buf + i * VIRTIO_BLK_BLOCK_SIZE);
-		if (rc != EOK)
-			return rc;
+		for (unsigned i = 0; i < submitted; i++) {
+			errno_t rc1 = virtio_blk_rq_wait(q, slots[i]);
+			if (rc == EOK)
+				rc = rc1;
+		}
+
+		/* Free the slots */
+		fibril_mutex_lock(&q->lock);
+		for (unsigned i = 0; i < n; i++)
+			q->free[q->free_count++] = slots[i];
+		fibril_condvar_broadcast(&q->free_cv);
+		fibril_mutex_unlock(&q->lock);
 	}
 
-	return EOK;
+	return rc;
 }
 
 static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     void *buf, size_t size)
 {
-	return virtio_blk_bd_rw_blocks(bd, ba, cnt, buf, size, true);
+	bd_vec_t vec = { .ba = ba, .cnt = cnt, .buf = buf, .size = size };
+	return virtio_blk_rw_vec((virtio_blk_t *) bd->srvs->sarg, &vec, 1,
+	    true);
 }
 
 static errno_t virtio_blk_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
-	return virtio_blk_bd_rw_blocks(bd, ba, cnt, (void *) buf, size, false);
+	bd_vec_t vec = { .ba = ba, .cnt = cnt, .buf = (void *) buf,
+	    .size = size };
+	return virtio_blk_rw_vec((virtio_blk_t *) bd->srvs->sarg, &vec, 1,
+	    false);
+}
+
+static errno_t virtio_blk_bd_read_blocks_v(bd_srv_t *bd, bd_vec_t *vec,
+    size_t nvec)
+{
+	return virtio_blk_rw_vec((virtio_blk_t *) bd->srvs->sarg, vec, nvec,
+	    true);
+}
+
+static errno_t virtio_blk_bd_write_blocks_v(bd_srv_t *bd, bd_vec_t *vec,
+    size_t nvec)
+{
+	return virtio_blk_rw_vec((virtio_blk_t *) bd->srvs->sarg, vec, nvec,
+	    false);
 }
 
 static errno_t virtio_blk_bd_get_block_size(bd_srv_t *bd, size_t *size)
@@ -305,8 +424,78 @@ bd_ops_t virtio_blk_bd_ops = {
 	.write_blocks = virtio_blk_bd_write_blocks,
 	.get_block_size = virtio_blk_bd_get_block_size,
 	.get_num_blocks = virtio_blk_bd_get_num_blocks,
+	.read_blocks_v = virtio_blk_bd_read_blocks_v,
+	.write_blocks_v = virtio_blk_bd_write_blocks_v,
 };
 
+/** Configure a virtqueue as a request queue and setup its request slots */
+static errno_t virtio_blk_queue_init(virtio_blk_t *virtio_blk,
+    virtio_blk_queue_t *q, uint16_t num)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+
+	q->num = num;
+	fibril_mutex_initialize(&q->lock);
+	fibril_condvar_initialize(&q->free_cv);
+	for (unsigned i = 0; i < RQ_SLOTS; i++)
+		fibril_condvar_initialize(&q->done_cv[i]);
+
+	/* Make the ring as deep as the device allows */
+	q->slots = min(RQ_SLOTS,
+	    virtio_virtq_max_size(vdev, num) / virtio_blk->ring_descs);
+	if (q->slots == 0) {
+		ddf_msg(LVL_ERROR, "Virtq %u: not enough descriptors", num);
+		return ENOMEM;
+	}
+
+	errno_t rc = virtio_virtq_setup(vdev, num,
+	    q->slots * virtio_blk->ring_descs);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * Setup DMA buffers
+	 */
+	rc = virtio_setup_dma_bufs(q->slots, sizeof(virtio_blk_req_header_t),
+	    true, q->rq_header, q->rq_header_p);
+	if (rc != EOK)
+		return rc;
+	rc = virtio_setup_dma_bufs(q->slots, sizeof(virtio_blk_req_footer_t),
+	    false, q->rq_footer, q->rq_footer_p);
+	if (rc != EOK)
+		return rc;
+	if (virtio_blk->indirect) {
+		rc = virtio_setup_dma_bufs(q->slots,
+		    (virtio_blk->seg_max + 2) * sizeof(virtq_desc_t), true,
+		    q->rq_table, q->rq_table_p);
+		if (rc != EOK)
+			return rc;
+	}
+
+	for (unsigned i = 0; i < q->slots; i++)
+		q->free[i] = q->slots - i - 1;
+	q->free_count = q->slots;
+
+	return EOK;
+}
+
+static void virtio_blk_queues_fini(virtio_blk_t *virtio_blk)
+{
+	if (!virtio_blk->queues)
+		return;
+
+	for (unsigned i = 0; i < virtio_blk->num_queues; i++) {
+		virtio_blk_queue_t *q = &virtio_blk->queues[i];
+
+		virtio_teardown_dma_bufs(q->rq_header);
+		virtio_teardown_dma_bufs(q->rq_footer);
+		virtio_teardown_dma_bufs(q->rq_table);
+	}
+
+	free(virtio_blk->queues);
+	virtio_blk->queues = NULL;
+}
+
 static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 {
 	virtio_blk_t *virtio_blk = ddf_dev_data_alloc(dev,
@@ -314,14 +503,6 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	if (!virtio_blk)
 		return ENOMEM;
 
-	fibril_mutex_initialize(&virtio_blk->free_lock);
-	fibril_condvar_initialize(&virtio_blk->free_cv);
-
-	for (unsigned i = 0; i < RQ_BUFFERS; i++) {
-		fibril_mutex_initialize(&virtio_blk->completion_lock[i]);
-		fibril_condvar_initialize(&virtio_blk->completion_cv[i]);
-	}
-
 	bd_srvs_init(&virtio_blk->bds);
 	virtio_blk->bds.ops = &virtio_blk_bd_ops;
 	virtio_blk->bds.sarg = virtio_blk;
@@ -332,6 +513,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 
 	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 	virtio_pci_common_cfg_t *cfg = virtio_blk->virtio_dev.common_cfg;
+	virtio_blk_cfg_t *blkcfg = virtio_blk->virtio_dev.device_cfg;
 
 	/*
 	 * Register IRQ
@@ -341,17 +523,41 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 
 	/* Reset the device and negotiate the feature bits */
-	rc = virtio_device_setup_start(vdev, 0);
+	rc = virtio_device_setup_start(vdev, 0, VIRTIO_BLK_F_SEG_MAX |
+	    VIRTIO_BLK_F_MQ | VIRTIO_F_RING_INDIRECT_DESC |
+	    VIRTIO_F_RING_EVENT_IDX);
 	if (rc != EOK)
 		goto fail;
 
 	/* Perform device-specific setup */
 
 	/*
-	 * Discover and configure the virtqueue
+	 * Determine the request layout. A transfer of (seg_max - 1) pages
+	 * spans at most seg_max pages of the caller's buffer.
+	 */
+	virtio_blk->seg_max = RQ_SEGMENTS;
+	if (vdev->features & VIRTIO_BLK_F_SEG_MAX) {
+		virtio_blk->seg_max = min(virtio_blk->seg_max,
+		    pio_read_le32(&blkcfg->seg_max));
+	}
+	if (virtio_blk->seg_max < 2) {
+		ddf_msg(LVL_ERROR, "Unsupported number of segments: %u",
+		    virtio_blk->seg_max);
+		rc = ENOTSUP;
+		goto fail;
+	}
+	virtio_blk->rq_max_blocks = (virtio_blk->seg_max - 1) * PAGE_SIZE /
+	    VIRTIO_BLK_BLOCK_SIZE;
+
+	virtio_blk->indirect = vdev->features & VIRTIO_F_RING_INDIRECT_DESC;
+	virtio_blk->ring_descs = virtio_blk->indirect ? 1 :
+	    virtio_blk->seg_max + 2;
+
+	/*
+	 * Discover and configure the virtqueues
 	 */
 	uint16_t num_queues = pio_read_le16(&cfg->num_queues);
-	if (num_queues != VIRTIO_BLK_NUM_QUEUES) {
+	if (num_queues < 1) {
 		ddf_msg(LVL_NOTE, "Unsupported number of virtqueues: %u",
 		    num_queues);
 		rc = ELIMIT;
@@ -364,35 +570,28 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
-	/* For each in/out request we need 3 descriptors */
-	rc = virtio_virtq_setup(vdev, RQ_QUEUE, 3 * RQ_BUFFERS);
-	if (rc != EOK)
-		goto fail;
+	unsigned rq_queues = 1;
+	if (vdev->features & VIRTIO_BLK_F_MQ)
+		rq_queues = max(1, pio_read_le16(&blkcfg->num_queues));
+	rq_queues = min(rq_queues, min(num_queues, VIRTIO_BLK_MAX_QUEUES));
 
-	/*
-	 * Setup DMA buffers
-	 */
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, sizeof(virtio_blk_req_header_t),
-	    true, virtio_blk->rq_header, virtio_blk->rq_header_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, VIRTIO_BLK_BLOCK_SIZE,
-	    true, virtio_blk->rq_buf, virtio_blk->rq_buf_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, sizeof(virtio_blk_req_footer_t),
-	    false, virtio_blk->rq_footer, virtio_blk->rq_footer_p);
-	if (rc != EOK)
+	virtio_blk->queues = calloc(sizeof(virtio_blk_queue_t), rq_queues);
+	if (!virtio_blk->queues) {
+		rc = ENOMEM;
 		goto fail;
+	}
+	virtio_blk->num_queues = rq_queues;
 
-	/*
-	 * Put all request descriptors on a free list. Because of the
-	 * correspondence between the request, buffer and footer descriptors,
-	 * we only need to manage allocations for one set: the request header
-	 * descriptors.
-	 */
-	virtio_create_desc_free_list(vdev, RQ_QUEUE, RQ_BUFFERS,
-	    &virtio_blk->rq_free_head);
+	for (unsigned i = 0; i < rq_queues; i++) {
+		rc = virtio_blk_queue_init(virtio_blk, &virtio_blk->queues[i],
+		    i);
+		if (rc != EOK)
+			goto fail;
+	}
+
+	ddf_msg(LVL_NOTE, "%u request queue(s), %u requests each, %s "
+	    "descriptors", rq_queues, virtio_blk->queues[0].slots,
+	    virtio_blk->indirect ? "indirect" : "direct");
 
 	/*
 	 * Enable IRQ
@@ -412,9 +611,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	return EOK;
 
 fail:
-	virtio_teardown_dma_bufs(virtio_blk->rq_header);
-	virtio_teardown_dma_bufs(virtio_blk->rq_buf);
-	virtio_teardown_dma_bufs(virtio_blk->rq_footer);
+	virtio_blk_queues_fini(virtio_blk);
 
 	virtio_device_setup_fail(vdev);
 	virtio_pci_dev_cleanup(vdev);
@@ -425,9 +622,7 @@ static void virtio_blk_uninitialize(ddf_dev_t *dev)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) ddf_dev_data_get(dev);
 
-	virtio_teardown_dma_bufs(virtio_blk->rq_header);
-	virtio_teardown_dma_bufs(virtio_blk->rq_buf);
-	virtio_teardown_dma_bufs(virtio_blk->rq_footer);
+	virtio_blk_queues_fini(virtio_blk);
 
 	virtio_device_setup_fail(&virtio_blk->virtio_dev);
 	virtio_pci_dev_cleanup(&virtio_blk->virtio_dev);
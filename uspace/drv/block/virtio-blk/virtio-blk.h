@@ -34,6 +34,8 @@
 #include <abi/cap.h>
 
 #include <fibril_synch.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 
 #define VIRTIO_BLK_BLOCK_SIZE	512
 
@@ -46,10 +48,24 @@
 #define VIRTIO_BLK_S_IOERR	1
 #define VIRTIO_BLK_S_UNSUPP	2
 
-#define RQ_BUFFERS	32
+/** Maximum number of request queues used by the driver */
+#define VIRTIO_BLK_MAX_QUEUES	8
 
+/** Maximum number of requests in flight in one request queue */
+#define RQ_SLOTS	128
+
+/** Maximum number of data segments of one request */
+#define RQ_SEGMENTS	17
+
+/** Maximum number of descriptors of one request */
+#define RQ_DESCS	(RQ_SEGMENTS + 2)
+
+/** Maximum number of data segments in a request is in seg_max. */
+#define VIRTIO_BLK_F_SEG_MAX	(1U << 2)
 /** Device is read-only. */
 #define VIRTIO_BLK_F_RO		(1U << 5)
+/** Device supports multiple request queues, their number is in num_queues. */
+#define VIRTIO_BLK_F_MQ		(1U << 12)
 
 typedef struct {
 	uint32_t type;
@@ -63,32 +79,75 @@ typedef struct {
 
 typedef struct {
 	uint64_t capacity;
+	uint32_t size_max;
+	uint32_t seg_max;
+	struct {
+		uint16_t cylinders;
+		uint8_t heads;
+		uint8_t sectors;
+	} geometry;
+	uint32_t blk_size;
+	struct {
+		uint8_t physical_block_exp;
+		uint8_t alignment_offset;
+		uint16_t min_io_size;
+		uint32_t opt_io_size;
+	} topology;
+	uint8_t writeback;
+	uint8_t unused0;
+	uint16_t num_queues;
 } virtio_blk_cfg_t;
 
+/** Request queue */
 typedef struct {
-	virtio_dev_t virtio_dev;
+	/** Index of the underlying virtqueue */
+	uint16_t num;
+	/** Number of request slots, at most RQ_SLOTS */
+	uint16_t slots;
+
+	void *rq_header[RQ_SLOTS];
+	uintptr_t rq_header_p[RQ_SLOTS];
+
+	void *rq_footer[RQ_SLOTS];
+	uintptr_t rq_footer_p[RQ_SLOTS];
+
+	/** Indirect descriptor tables, used with VIRTIO_F_RING_INDIRECT_DESC */
+	void *rq_table[RQ_SLOTS];
+	uintptr_t rq_table_p[RQ_SLOTS];
 
-	void *rq_header[RQ_BUFFERS];
-	uintptr_t rq_header_p[RQ_BUFFERS];
+	/** Protects the free slots and completion flags */
+	fibril_mutex_t lock;
 
-	void *rq_buf[RQ_BUFFERS];
-	uintptr_t rq_buf_p[RQ_BUFFERS];
+	fibril_condvar_t free_cv;
+	uint16_t free[RQ_SLOTS];
+	uint16_t free_count;
+
+	bool done[RQ_SLOTS];
+	fibril_condvar_t done_cv[RQ_SLOTS];
+} virtio_blk_queue_t;
 
-	void *rq_footer[RQ_BUFFERS];
-	uintptr_t rq_footer_p[RQ_BUFFERS];
+typedef struct {
+	virtio_dev_t virtio_dev;
 
-	uint16_t rq_free_head;
+	/** Request queues */
+	virtio_blk_queue_t *queues;
+	unsigned num_queues;
+	/** Request queue for the next request */
+	atomic_uint next_queue;
+
+	/** Requests use indirect descriptor tables */
+	bool indirect;
+	/** Maximum number of data segments of one request */
+	unsigned seg_max;
+	/** Virtqueue descriptors taken by one request */
+	unsigned ring_descs;
+	/** Maximum number of blocks transferred by one request */
+	size_t rq_max_blocks;
 
 	int irq;
 	cap_irq_handle_t irq_handle;
 
 	bd_srvs_t bds;
-
-	fibril_mutex_t free_lock;
-	fibril_condvar_t free_cv;
-
-	fibril_mutex_t completion_lock[RQ_BUFFERS];
-	fibril_condvar_t completion_cv[RQ_BUFFERS];
 } virtio_blk_t;
 
 #endif
@@ -197,7 +197,7 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ, 0);
 	if (rc != EOK)
 		goto fail;
 
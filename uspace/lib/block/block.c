@@ -54,10 +54,32 @@
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
+#include <stats.h>
 #include "block.h"
 
 #define MAX_WRITE_RETRIES 10
 
+/** Initial and maximum read-ahead window in blocks. */
+#define CACHE_READAHEAD_MIN	2
+#define CACHE_READAHEAD_MAX	8
+
+/** Maximum number of dirty blocks written back in one flusher pass. */
+#define CACHE_FLUSH_BATCH	32
+/** Maximum number of adjacent blocks written back in one request. */
+#define CACHE_FLUSH_RUN_MAX	16
+/** Number of dirty blocks put back that wakes up the flusher early. */
+#define CACHE_FLUSH_THRESHOLD	8
+/** Time a dirty block may stay in the write-back cache (microseconds). */
+#define CACHE_FLUSH_INTERVAL	1000000
+
+/** Minimum and maximum target size of the cache in blocks. */
+#define CACHE_LO_WATERMARK	10
+#define CACHE_MAX_BLOCKS	65536
+/** The cache targets 1 / CACHE_MEM_SHARE of the free physical memory. */
+#define CACHE_MEM_SHARE		64
+/** Number of misses after which the target size is recomputed. */
+#define CACHE_RESIZE_PERIOD	256
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
@@ -69,11 +91,43 @@ typedef struct {
 	unsigned blocks_cluster;  /**< Physical blocks per block_t */
 	unsigned block_count;     /**< Total number of blocks. */
 	unsigned blocks_cached;   /**< Number of cached blocks. */
+	unsigned lo_watermark;    /**< Target number of cached blocks. */
+	unsigned hi_watermark;    /**< Number of blocks above which to shrink. */
+	unsigned resize_misses;   /**< Misses since the last resize. */
 	hash_table_t block_hash;
-	list_t free_list;
+	/*
+	 * Unused blocks are kept on two LRU lists as in the 2Q algorithm.
+	 * Blocks start on probation and become hot when they are requested
+	 * again after they have been evicted from probation or when they are
+	 * requested as metadata. A sequential scan thus only displaces other
+	 * blocks on probation.
+	 */
+	list_t free_probation;    /**< Unused blocks on probation. */
+	list_t free_hot;          /**< Unused hot blocks. */
+	unsigned blocks_probation; /**< Number of cached blocks on probation. */
+	/** Addresses of blocks recently evicted from probation. */
+	hash_table_t ghost_hash;
+	list_t ghost_list;
+	unsigned ghosts;
 	enum cache_mode mode;
+	aoff64_t ra_next;         /**< Block following the last read-ahead. */
+	aoff64_t last_miss;       /**< Block that missed the cache last. */
+	unsigned ra_window;       /**< Current read-ahead window in blocks. */
+	/** Signalled when the flusher has work to do and when it exits. */
+	fibril_condvar_t flush_cv;
+	unsigned dirty_put;       /**< Dirty blocks put since the last flush. */
+	bool flusher_stop;        /**< The flusher fibril is asked to exit. */
+	bool flusher_running;     /**< The flusher fibril exists. */
+	vfs_cache_stats_t stats;
 } cache_t;
 
+/** Address of a block recently evicted from probation. */
+typedef struct {
+	ht_link_t hash_link;
+	link_t link;
+	aoff64_t lba;
+} ghost_t;
+
 typedef struct {
 	link_t link;
 	service_id_t service_id;
@@ -86,9 +140,27 @@ typedef struct {
 	cache_t *cache;
 } devcon_t;
 
+/** Wait state shared by the write-back runs of a batch. */
+typedef struct {
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+	unsigned pending;         /**< Number of runs in flight. */
+} flush_wait_t;
+
+/** Run of adjacent dirty blocks written back with a single request. */
+typedef struct {
+	flush_wait_t *wait;
+	block_t **blocks;         /**< Blocks sorted by ascending address. */
+	size_t cnt;               /**< Number of blocks in the run. */
+	errno_t rc;               /**< Result of the write. */
+} flush_run_t;
+
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
+static errno_t read_blocks_v(devcon_t *, bd_vec_t *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
+static errno_t write_blocks_v(devcon_t *, bd_vec_t *, size_t);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
+static errno_t cache_flusher(void *);
 
 static devcon_t *devcon_search(service_id_t service_id)
 {
@@ -267,6 +339,114 @@ static hash_table_ops_t cache_ops = {
 	.remove_callback = NULL
 };
 
+static size_t ghost_hash(const ht_link_t *item)
+{
+	ghost_t *g = hash_table_get_inst(item, ghost_t, hash_link);
+	return g->lba;
+}
+
+static bool ghost_key_equal(const void *key, const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	ghost_t *g = hash_table_get_inst(item, ghost_t, hash_link);
+	return g->lba == *lba;
+}
+
+static hash_table_ops_t ghost_ops = {
+	.hash = ghost_hash,
+	.key_hash = cache_key_hash,
+	.key_equal = ghost_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Remove the oldest ghost entry.
+ *
+ * Must be called with the cache lock held.
+ */
+static void ghost_drop_oldest(cache_t *cache)
+{
+	ghost_t *g = list_get_instance(list_first(&cache->ghost_list),
+	    ghost_t, link);
+
+	list_remove(&g->link);
+	hash_table_remove_item(&cache->ghost_hash, &g->hash_link);
+	cache->ghosts--;
+	free(g);
+}
+
+/** Remember a block evicted from probation.
+ *
+ * Must be called with the cache lock held. The ghost list remembers as many
+ * addresses as half the target size of the cache.
+ */
+static void ghost_add(cache_t *cache, aoff64_t lba)
+{
+	unsigned max = cache->lo_watermark / 2;
+
+	while (cache->ghosts > 0 && cache->ghosts >= max)
+		ghost_drop_oldest(cache);
+	if (max == 0)
+		return;
+
+	ghost_t *g = malloc(sizeof(ghost_t));
+	if (g == NULL)
+		return;
+
+	link_initialize(&g->link);
+	g->lba = lba;
+	list_append(&g->link, &cache->ghost_list);
+	hash_table_insert(&cache->ghost_hash, &g->hash_link);
+	cache->ghosts++;
+}
+
+/** Forget a block evicted from probation.
+ *
+ * Must be called with the cache lock held.
+ *
+ * @return	True if the block was evicted from probation recently.
+ */
+static bool ghost_remove(cache_t *cache, aoff64_t lba)
+{
+	ht_link_t *hlink = hash_table_find(&cache->ghost_hash, &lba);
+	if (hlink == NULL)
+		return false;
+
+	ghost_t *g = hash_table_get_inst(hlink, ghost_t, hash_link);
+	list_remove(&g->link);
+	hash_table_remove_item(&cache->ghost_hash, &g->hash_link);
+	cache->ghosts--;
+	free(g);
+	return true;
+}
+
+/** Recompute the target size of the cache from the free physical memory.
+ *
+ * Must be called without the cache lock held.
+ *
+ * @param cache		Block cache.
+ */
+static void cache_resize(cache_t *cache)
+{
+	uint64_t target = CACHE_LO_WATERMARK;
+
+	stats_physmem_t *physmem = stats_get_physmem();
+	if (physmem != NULL) {
+		target = physmem->free / CACHE_MEM_SHARE / cache->lblock_size;
+		free(physmem);
+	}
+
+	/* A non-zero block count given to block_cache_init() is a limit */
+	if (cache->block_count != 0)
+		target = min(target, cache->block_count);
+	target = max(min(target, CACHE_MAX_BLOCKS), CACHE_LO_WATERMARK);
+
+	fibril_mutex_lock(&cache->lock);
+	cache->lo_watermark = target;
+	cache->hi_watermark = 2 * target;
+	fibril_mutex_unlock(&cache->lock);
+}
+
 errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
     enum cache_mode mode)
 {
@@ -281,11 +461,26 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 		return ENOMEM;
 
 	fibril_mutex_initialize(&cache->lock);
-	list_initialize(&cache->free_list);
 	cache->lblock_size = size;
 	cache->block_count = blocks;
 	cache->blocks_cached = 0;
+	cache->lo_watermark = CACHE_LO_WATERMARK;
+	cache->hi_watermark = 2 * CACHE_LO_WATERMARK;
+	cache->resize_misses = 0;
+	list_initialize(&cache->free_probation);
+	list_initialize(&cache->free_hot);
+	cache->blocks_probation = 0;
+	list_initialize(&cache->ghost_list);
+	cache->ghosts = 0;
 	cache->mode = mode;
+	cache->ra_next = 0;
+	cache->last_miss = 0;
+	cache->ra_window = 0;
+	fibril_condvar_initialize(&cache->flush_cv);
+	cache->dirty_put = 0;
+	cache->flusher_stop = false;
+	cache->flusher_running = false;
+	memset(&cache->stats, 0, sizeof(cache->stats));
 
 	/* Allow 1:1 or small-to-large block size translation */
 	if (cache->lblock_size % devcon->pblock_size != 0) {
@@ -300,7 +495,34 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 		return ENOMEM;
 	}
 
+	if (!hash_table_create(&cache->ghost_hash, 0, 0, &ghost_ops)) {
+		hash_table_destroy(&cache->block_hash);
+		free(cache);
+		return ENOMEM;
+	}
+
+	cache_resize(cache);
+
 	devcon->cache = cache;
+
+	if (mode == CACHE_MODE_WB) {
+		/*
+		 * Dirty blocks are written back in the background so that
+		 * block_get() rarely has to write a block before recycling it.
+		 */
+		fid_t fid = fibril_create(cache_flusher, devcon);
+		if (fid == 0) {
+			devcon->cache = NULL;
+			hash_table_destroy(&cache->ghost_hash);
+			hash_table_destroy(&cache->block_hash);
+			free(cache);
+			return ENOMEM;
+		}
+
+		cache->flusher_running = true;
+		fibril_add_ready(fid);
+	}
+
 	return EOK;
 }
 
@@ -316,14 +538,24 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	fibril_mutex_lock(&cache->lock);
+	cache->flusher_stop = true;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	while (cache->flusher_running)
+		fibril_condvar_wait(&cache->flush_cv, &cache->lock);
+	fibril_mutex_unlock(&cache->lock);
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
-	 * free list, i.e. the block reference count should be zero. Do not
+	 * free lists, i.e. the block reference count should be zero. Do not
 	 * bother with the cache and block locks because we are single-threaded.
 	 */
-	while (!list_empty(&cache->free_list)) {
-		block_t *b = list_get_instance(list_first(&cache->free_list),
-		    block_t, free_link);
+	while (!list_empty(&cache->free_probation) ||
+	    !list_empty(&cache->free_hot)) {
+		list_t *list = list_empty(&cache->free_hot) ?
+		    &cache->free_probation : &cache->free_hot;
+		block_t *b = list_get_instance(list_first(list), block_t,
+		    free_link);
 
 		list_remove(&b->free_link);
 		if (b->dirty) {
@@ -339,6 +571,10 @@ errno_t block_cache_fini(service_id_t service_id)
 		free(b);
 	}
 
+	while (cache->ghosts > 0)
+		ghost_drop_oldest(cache);
+
+	hash_table_destroy(&cache->ghost_hash);
 	hash_table_destroy(&cache->block_hash);
 	devcon->cache = NULL;
 	free(cache);
@@ -346,17 +582,77 @@ errno_t block_cache_fini(service_id_t service_id)
 	return EOK;
 }
 
-#define CACHE_LO_WATERMARK	10
-#define CACHE_HI_WATERMARK	20
+/** Get block cache statistics.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param stats		Place to store the statistics.
+ *
+ * @return		EOK on success, ENOENT if the device is not open,
+ *			ENOTSUP if it has no cache.
+ */
+errno_t block_cache_stats(service_id_t service_id, vfs_cache_stats_t *stats)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return ENOTSUP;
+	cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	*stats = cache->stats;
+	stats->cached = cache->blocks_cached;
+	stats->target = cache->lo_watermark;
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
 static bool cache_can_grow(cache_t *cache)
 {
-	if (cache->blocks_cached < CACHE_LO_WATERMARK)
+	if (cache->blocks_cached < cache->lo_watermark)
 		return true;
-	if (!list_empty(&cache->free_list))
+	if (!list_empty(&cache->free_probation) ||
+	    !list_empty(&cache->free_hot))
 		return false;
 	return true;
 }
 
+/** Choose the free list to recycle a block from.
+ *
+ * Must be called with the cache lock held. Blocks on probation are recycled
+ * first as long as they take up more than a quarter of the cache.
+ *
+ * @param cache		Block cache.
+ *
+ * @return		Free list or NULL if there are no unused blocks.
+ */
+static list_t *cache_victim_list(cache_t *cache)
+{
+	if (!list_empty(&cache->free_probation) &&
+	    (cache->blocks_probation > cache->lo_watermark / 4 ||
+	    list_empty(&cache->free_hot)))
+		return &cache->free_probation;
+	if (!list_empty(&cache->free_hot))
+		return &cache->free_hot;
+	return NULL;
+}
+
+/** Account for a block leaving the cache.
+ *
+ * Must be called with the cache lock held after the block has been removed
+ * from the hash table.
+ */
+static void cache_evicted(cache_t *cache, block_t *b)
+{
+	if (!b->hot) {
+		cache->blocks_probation--;
+		ghost_add(cache, b->lba);
+	}
+}
+
 static void block_initialize(block_t *b)
 {
 	fibril_mutex_initialize(&b->lock);
@@ -364,10 +660,562 @@ static void block_initialize(block_t *b)
 	b->write_failures = 0;
 	b->dirty = false;
 	b->toxic = false;
+	b->readahead = false;
 	fibril_rwlock_initialize(&b->contents_lock);
 	link_initialize(&b->free_link);
 }
 
+/** Get a block for read-ahead.
+ *
+ * Must be called with the cache lock held.
+ *
+ * @param cache		Block cache.
+ *
+ * @return		Unused block or NULL if no block can be had cheaply.
+ */
+static block_t *cache_readahead_block(cache_t *cache)
+{
+	block_t *b;
+
+	if (cache->blocks_cached < cache->lo_watermark) {
+		b = malloc(sizeof(block_t));
+		if (b != NULL) {
+			b->data = malloc(cache->lblock_size);
+			if (b->data != NULL) {
+				cache->blocks_cached++;
+				return b;
+			}
+			free(b);
+		}
+	}
+
+	/*
+	 * Recycle the least recently used block, but only if it does not
+	 * need to be written back first. Read-ahead is not worth extra I/O.
+	 */
+	list_t *list = cache_victim_list(cache);
+	if (list == NULL)
+		return NULL;
+
+	b = list_get_instance(list_first(list), block_t, free_link);
+	if (!fibril_mutex_trylock(&b->lock))
+		return NULL;
+	if (b->dirty) {
+		fibril_mutex_unlock(&b->lock);
+		return NULL;
+	}
+	fibril_mutex_unlock(&b->lock);
+
+	list_remove(&b->free_link);
+	hash_table_remove_item(&cache->block_hash, &b->hash_link);
+	cache_evicted(cache, b);
+	return b;
+}
+
+/** Prepare read-ahead after a cache miss.
+ *
+ * Must be called with the cache lock held. If @a ba continues a sequential
+ * stream of misses, the blocks following it are instantiated, locked and
+ * inserted into the cache so that they can be read from the device together
+ * with @a ba. The read-ahead window doubles with every sequential miss up to
+ * CACHE_READAHEAD_MAX blocks.
+ *
+ * @param devcon	Device connection.
+ * @param ba		Logical address of the block which missed the cache.
+ * @param ra_blocks	Array of CACHE_READAHEAD_MAX pointers for storing the
+ *			blocks to read ahead.
+ *
+ * @return		Number of blocks to read ahead.
+ */
+static unsigned cache_readahead_prepare(devcon_t *devcon, aoff64_t ba,
+    block_t **ra_blocks)
+{
+	cache_t *cache = devcon->cache;
+	bool sequential;
+	unsigned cnt;
+
+	sequential = (ba == cache->ra_next) || (ba == cache->last_miss + 1);
+	cache->last_miss = ba;
+	if (!sequential)
+		return 0;
+
+	if (cache->ra_window == 0)
+		cache->ra_window = CACHE_READAHEAD_MIN;
+	else
+		cache->ra_window = min(2 * cache->ra_window, CACHE_READAHEAD_MAX);
+
+	for (cnt = 0; cnt < cache->ra_window; cnt++) {
+		aoff64_t lba = ba + 1 + cnt;
+
+		/* Do not read past the end of the device */
+		if (ba_ltop(devcon, lba) + cache->blocks_cluster >=
+		    devcon->pblocks)
+			break;
+
+		/* Stop at the first block which is already cached */
+		if (hash_table_find(&cache->block_hash, &lba) != NULL)
+			break;
+
+		block_t *b = cache_readahead_block(cache);
+		if (b == NULL)
+			break;
+
+		block_initialize(b);
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = lba;
+		b->pba = ba_ltop(devcon, lba);
+		b->readahead = true;
+		b->hot = false;
+		cache->blocks_probation++;
+		hash_table_insert(&cache->block_hash, &b->hash_link);
+		fibril_mutex_lock(&b->lock);
+		ra_blocks[cnt] = b;
+	}
+
+	cache->ra_next = ba + 1 + cnt;
+	cache->stats.ra_blocks += cnt;
+	return cnt;
+}
+
+/** Read a block together with the blocks following it.
+ *
+ * All blocks must be locked by the caller. The cache lock must not be held.
+ * Blocks read ahead which cannot be read are marked toxic.
+ *
+ * @param devcon	Device connection.
+ * @param b		Block which missed the cache.
+ * @param ra_blocks	Blocks following @a b.
+ * @param cnt		Number of blocks in @a ra_blocks.
+ *
+ * @return		EOK if @a b was read successfully or an error code.
+ */
+static errno_t cache_read_cluster(devcon_t *devcon, block_t *b,
+    block_t **ra_blocks, unsigned cnt)
+{
+	cache_t *cache = devcon->cache;
+	bd_vec_t vec[CACHE_READAHEAD_MAX + 1];
+	unsigned i;
+	errno_t rc;
+
+	if (cnt == 0) {
+		return read_blocks(devcon, b->pba, cache->blocks_cluster,
+		    b->data, cache->lblock_size);
+	}
+
+	/*
+	 * The blocks are adjacent on the device so the server reads them as
+	 * a single range, directly into the blocks' buffers.
+	 */
+	vec[0].ba = b->pba;
+	vec[0].cnt = cache->blocks_cluster;
+	vec[0].buf = b->data;
+	vec[0].size = cache->lblock_size;
+	for (i = 0; i < cnt; i++) {
+		vec[i + 1].ba = ra_blocks[i]->pba;
+		vec[i + 1].cnt = cache->blocks_cluster;
+		vec[i + 1].buf = ra_blocks[i]->data;
+		vec[i + 1].size = cache->lblock_size;
+	}
+
+	rc = read_blocks_v(devcon, vec, cnt + 1);
+	if (rc == EOK)
+		return EOK;
+
+	/*
+	 * Fall back to reading the blocks one by one so that only the blocks
+	 * which really cannot be read end up toxic.
+	 */
+	for (i = 0; i < cnt; i++) {
+		rc = read_blocks(devcon, ra_blocks[i]->pba,
+		    cache->blocks_cluster, ra_blocks[i]->data,
+		    cache->lblock_size);
+		if (rc != EOK)
+			ra_blocks[i]->toxic = true;
+	}
+
+	return read_blocks(devcon, b->pba, cache->blocks_cluster, b->data,
+	    cache->lblock_size);
+}
+
+static int block_lba_cmp(const void *a, const void *b)
+{
+	const block_t *ba = *(const block_t **) a;
+	const block_t *bb = *(const block_t **) b;
+
+	if (ba->lba < bb->lba)
+		return -1;
+	return ba->lba > bb->lba;
+}
+
+/** Determine whether the flusher may write a block back.
+ *
+ * The block lock must be held. The flusher may only write blocks to which it
+ * holds the only reference. Nobody can obtain another reference while the
+ * block lock is held, so the contents cannot change during the write.
+ */
+static bool block_flushable(block_t *b)
+{
+	return b->refcnt == 1 && b->dirty && !b->toxic;
+}
+
+/** Completion callback of a write-back run. */
+static void cache_write_run_done(void *arg, errno_t rc)
+{
+	flush_run_t *run = (flush_run_t *) arg;
+
+	fibril_mutex_lock(&run->wait->lock);
+	run->rc = rc;
+	run->wait->pending--;
+	fibril_condvar_broadcast(&run->wait->cv);
+	fibril_mutex_unlock(&run->wait->lock);
+}
+
+/** Start writing back a run of adjacent blocks with a single request.
+ *
+ * All blocks must be locked by the caller. The data is written directly from
+ * the blocks' buffers, the blocks must not change until the run completes.
+ *
+ * @param devcon	Device connection.
+ * @param run		Run to write back.
+ */
+static void cache_write_run_start(devcon_t *devcon, flush_run_t *run)
+{
+	cache_t *cache = devcon->cache;
+	bd_vec_t vec[CACHE_FLUSH_RUN_MAX];
+	size_t i;
+
+	for (i = 0; i < run->cnt; i++) {
+		vec[i].ba = run->blocks[i]->pba;
+		vec[i].cnt = cache->blocks_cluster;
+		vec[i].buf = run->blocks[i]->data;
+		vec[i].size = cache->lblock_size;
+	}
+
+	fibril_mutex_lock(&run->wait->lock);
+	run->wait->pending++;
+	fibril_mutex_unlock(&run->wait->lock);
+
+	errno_t rc = bd_write_blocks_async(devcon->bd, vec, run->cnt,
+	    cache_write_run_done, run);
+	if (rc != EOK)
+		cache_write_run_done(run, rc);
+}
+
+/** Take references to dirty blocks on the free list.
+ *
+ * Must be called with the cache lock held. The blocks are removed from the
+ * free list so that they cannot be recycled while they are written back.
+ *
+ * @param cache		Block cache.
+ * @param batch		Array of CACHE_FLUSH_BATCH pointers for storing the
+ *			blocks.
+ *
+ * @return		Number of blocks stored in @a batch.
+ */
+static size_t cache_flush_collect(cache_t *cache, block_t **batch)
+{
+	size_t n = 0;
+	size_t i;
+
+	list_t *lists[] = { &cache->free_probation, &cache->free_hot };
+
+	for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+		list_foreach(*lists[i], free_link, block_t, b) {
+			if (n == CACHE_FLUSH_BATCH)
+				break;
+
+			/* A locked block is being written back by block_get(). */
+			if (!fibril_mutex_trylock(&b->lock))
+				continue;
+			if (b->dirty && !b->toxic) {
+				b->refcnt++;
+				batch[n++] = b;
+			}
+			fibril_mutex_unlock(&b->lock);
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		list_remove(&batch[i]->free_link);
+
+	return n;
+}
+
+/** Write back a batch of dirty blocks in ascending order.
+ *
+ * Adjacent blocks are written with a single request and all requests of the
+ * batch are in flight at the same time. The references taken by
+ * cache_flush_collect() are dropped afterwards.
+ *
+ * @param devcon	Device connection.
+ * @param batch		Blocks to write back.
+ * @param n		Number of blocks in @a batch.
+ *
+ * @return		EOK on success or the error of the first failed write.
+ */
+static errno_t cache_flush_batch(devcon_t *devcon, block_t **batch, size_t n)
+{
+	cache_t *cache = devcon->cache;
+	flush_run_t runs[CACHE_FLUSH_BATCH];
+	flush_wait_t wait;
+	errno_t rc = EOK;
+	size_t nruns = 0;
+	unsigned writes = 0;
+	unsigned written = 0;
+	size_t i, j;
+
+	fibril_mutex_initialize(&wait.lock);
+	fibril_condvar_initialize(&wait.cv);
+	wait.pending = 0;
+
+	qsort(batch, n, sizeof(block_t *), block_lba_cmp);
+
+	i = 0;
+	while (i < n) {
+		/*
+		 * Do not wait for block locks while holding the locks of the
+		 * runs in flight. Blocks skipped now are written back by the
+		 * next pass.
+		 */
+		if (nruns == 0)
+			fibril_mutex_lock(&batch[i]->lock);
+		else if (!fibril_mutex_trylock(&batch[i]->lock)) {
+			i++;
+			continue;
+		}
+		if (!block_flushable(batch[i])) {
+			fibril_mutex_unlock(&batch[i]->lock);
+			i++;
+			continue;
+		}
+
+		flush_run_t *run = &runs[nruns++];
+		run->wait = &wait;
+		run->blocks = &batch[i++];
+		run->cnt = 1;
+
+		/* Extend the run with the adjacent blocks. */
+		while (i < n && run->cnt < CACHE_FLUSH_RUN_MAX &&
+		    batch[i]->lba == run->blocks[run->cnt - 1]->lba + 1) {
+			if (!fibril_mutex_trylock(&batch[i]->lock))
+				break;
+			if (!block_flushable(batch[i])) {
+				fibril_mutex_unlock(&batch[i]->lock);
+				break;
+			}
+			run->cnt++;
+			i++;
+		}
+
+		cache_write_run_start(devcon, run);
+	}
+
+	fibril_mutex_lock(&wait.lock);
+	while (wait.pending > 0)
+		fibril_condvar_wait(&wait.cv, &wait.lock);
+	fibril_mutex_unlock(&wait.lock);
+
+	for (i = 0; i < nruns; i++) {
+		flush_run_t *run = &runs[i];
+
+		if (run->rc == EOK) {
+			writes++;
+			written += run->cnt;
+		} else {
+			printf("Error %s writing %zu blocks starting at block %"
+			    PRIuOFF64 " to device handle %" PRIun "\n",
+			    str_error_name(run->rc), run->cnt,
+			    run->blocks[0]->pba, devcon->service_id);
+			if (rc == EOK)
+				rc = run->rc;
+		}
+
+		for (j = 0; j < run->cnt; j++) {
+			if (run->rc == EOK) {
+				run->blocks[j]->dirty = false;
+				run->blocks[j]->write_failures = 0;
+			} else {
+				run->blocks[j]->write_failures++;
+			}
+			fibril_mutex_unlock(&run->blocks[j]->lock);
+		}
+	}
+
+	fibril_mutex_lock(&cache->lock);
+	cache->stats.writes += writes;
+	cache->stats.written += written;
+	fibril_mutex_unlock(&cache->lock);
+
+	for (i = 0; i < n; i++)
+		(void) block_put(batch[i]);
+
+	return rc;
+}
+
+/** Write-back cache flusher fibril.
+ *
+ * Dirty blocks are written back once CACHE_FLUSH_THRESHOLD of them have been
+ * put back or CACHE_FLUSH_INTERVAL after the first of them was put back.
+ *
+ * @param arg	Device connection.
+ *
+ * @return	EOK.
+ */
+static errno_t cache_flusher(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+	block_t *batch[CACHE_FLUSH_BATCH];
+	bool more = false;
+	size_t n;
+
+	fibril_mutex_lock(&cache->lock);
+	while (!cache->flusher_stop) {
+		if (!more && cache->dirty_put == 0) {
+			fibril_condvar_wait(&cache->flush_cv, &cache->lock);
+			continue;
+		}
+
+		if (!more && cache->dirty_put < CACHE_FLUSH_THRESHOLD) {
+			(void) fibril_condvar_wait_timeout(&cache->flush_cv,
+			    &cache->lock, CACHE_FLUSH_INTERVAL);
+			if (cache->flusher_stop)
+				break;
+		}
+
+		cache->dirty_put = 0;
+		n = cache_flush_collect(cache, batch);
+		more = (n == CACHE_FLUSH_BATCH);
+		if (n == 0)
+			continue;
+
+		fibril_mutex_unlock(&cache->lock);
+		(void) cache_flush_batch(devcon, batch, n);
+		fibril_mutex_lock(&cache->lock);
+	}
+
+	cache->flusher_running = false;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	fibril_mutex_unlock(&cache->lock);
+	return EOK;
+}
+
+/** Check whether a cached block is dirty.
+ *
+ * Must be called with the cache lock held. Waits for a write back of the
+ * block which is in progress.
+ */
+static bool cache_block_dirty(block_t *b)
+{
+	fibril_mutex_lock(&b->lock);
+	bool dirty = b->dirty;
+	fibril_mutex_unlock(&b->lock);
+
+	return dirty;
+}
+
+static bool cache_dirty_check(ht_link_t *item, void *arg)
+{
+	bool *dirty = (bool *) arg;
+
+	*dirty = cache_block_dirty(hash_table_get_inst(item, block_t,
+	    hash_link));
+	return !*dirty;
+}
+
+/** Write back all dirty blocks that are not in use.
+ *
+ * Blocks to which somebody holds a reference are skipped, they are written
+ * back once the last reference is dropped. This lets the file system order
+ * the write back of the blocks it still holds after the rest.
+ *
+ * @param service_id	Service ID of the block device.
+ *
+ * @return		EOK if all blocks of the device are clean, ENOENT if
+ *			the device is not open, EBUSY if some dirty blocks
+ *			were skipped or an error of a failed write.
+ */
+errno_t block_cache_flush(service_id_t service_id)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	block_t *batch[CACHE_FLUSH_BATCH];
+	cache_t *cache;
+	unsigned rounds;
+	errno_t rc = EOK;
+	bool dirty = false;
+	size_t n;
+
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return EOK;
+	cache = devcon->cache;
+
+	/*
+	 * Blocks that fail to be written stay dirty and would be collected
+	 * again, so bound the number of rounds by the size of the cache.
+	 */
+	fibril_mutex_lock(&cache->lock);
+	rounds = cache->blocks_cached / CACHE_FLUSH_BATCH + 1;
+	fibril_mutex_unlock(&cache->lock);
+
+	do {
+		fibril_mutex_lock(&cache->lock);
+		n = cache_flush_collect(cache, batch);
+		fibril_mutex_unlock(&cache->lock);
+
+		if (n > 0) {
+			errno_t brc = cache_flush_batch(devcon, batch, n);
+			if (rc == EOK)
+				rc = brc;
+		}
+	} while (n == CACHE_FLUSH_BATCH && --rounds > 0);
+
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * Blocks in use, blocks written back by somebody else and blocks left
+	 * over by the last round are still dirty.
+	 */
+	fibril_mutex_lock(&cache->lock);
+	hash_table_apply(&cache->block_hash, cache_dirty_check, &dirty);
+	fibril_mutex_unlock(&cache->lock);
+
+	return dirty ? EBUSY : EOK;
+}
+
+/** Check whether a block has reached the device.
+ *
+ * A write back of the block in progress is waited for.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Block address (logical).
+ *
+ * @return		True if the block is not cached or if its cached
+ *			copy is not dirty.
+ */
+bool block_cache_clean(service_id_t service_id, aoff64_t ba)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	bool dirty = false;
+
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
+	if (hlink != NULL)
+		dirty = cache_block_dirty(hash_table_get_inst(hlink, block_t,
+		    hash_link));
+	fibril_mutex_unlock(&cache->lock);
+
+	return !dirty;
+}
+
 /** Instantiate a block in memory and get a reference to it.
  *
  * @param block			Pointer to where the function will store the
@@ -385,6 +1233,11 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 	devcon_t *devcon;
 	cache_t *cache;
 	block_t *b;
+	block_t *ra_blocks[CACHE_READAHEAD_MAX];
+	unsigned ra = 0;
+	unsigned written = 0;
+	bool resize = false;
+	list_t *list;
 	link_t *link;
 	aoff64_t p_ba;
 	errno_t rc;
@@ -412,6 +1265,10 @@ retry:
 	b = NULL;
 
 	fibril_mutex_lock(&cache->lock);
+	cache->stats.writes += written;
+	cache->stats.written += written;
+	written = 0;
+
 	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
 	if (hlink) {
 	found:
@@ -424,6 +1281,15 @@ retry:
 			list_remove(&b->free_link);
 		if (b->toxic)
 			rc = EIO;
+		if (b->readahead) {
+			b->readahead = false;
+			cache->stats.ra_hits++;
+		}
+		if ((flags & BLOCK_FLAGS_META) && !b->hot) {
+			b->hot = true;
+			cache->blocks_probation--;
+		}
+		cache->stats.hits++;
 		fibril_mutex_unlock(&b->lock);
 		fibril_mutex_unlock(&cache->lock);
 	} else {
@@ -448,15 +1314,16 @@ retry:
 			cache->blocks_cached++;
 		} else {
 			/*
-			 * Try to recycle a block from the free list.
+			 * Try to recycle a block from the free lists.
 			 */
 		recycle:
-			if (list_empty(&cache->free_list)) {
+			list = cache_victim_list(cache);
+			if (list == NULL) {
 				fibril_mutex_unlock(&cache->lock);
 				rc = ENOMEM;
 				goto out;
 			}
-			link = list_first(&cache->free_list);
+			link = list_first(list);
 			b = list_get_instance(link, block_t, free_link);
 
 			fibril_mutex_lock(&b->lock);
@@ -471,7 +1338,7 @@ retry:
 				 * block_get() draining the free list.
 				 */
 				list_remove(&b->free_link);
-				list_append(&b->free_link, &cache->free_list);
+				list_append(&b->free_link, list);
 				fibril_mutex_unlock(&cache->lock);
 				rc = write_blocks(devcon, b->pba,
 				    cache->blocks_cluster, b->data, b->size);
@@ -492,8 +1359,10 @@ retry:
 						    "SEVERE DATA LOSS POSSIBLE\n",
 						    b->lba, devcon->service_id);
 					}
-				} else
+				} else {
 					b->write_failures = 0;
+					written++;
+				}
 
 				b->dirty = false;
 				if (!fibril_mutex_trylock(&cache->lock)) {
@@ -504,6 +1373,9 @@ retry:
 					fibril_mutex_unlock(&b->lock);
 					goto retry;
 				}
+				cache->stats.writes += written;
+				cache->stats.written += written;
+				written = 0;
 				hlink = hash_table_find(&cache->block_hash, &ba);
 				if (hlink) {
 					/*
@@ -528,6 +1400,7 @@ retry:
 			 */
 			list_remove(&b->free_link);
 			hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			cache_evicted(cache, b);
 		}
 
 		block_initialize(b);
@@ -535,6 +1408,14 @@ retry:
 		b->size = cache->lblock_size;
 		b->lba = ba;
 		b->pba = ba_ltop(devcon, b->lba);
+
+		/*
+		 * Metadata and blocks requested again shortly after they have
+		 * been evicted from probation go straight to the hot list.
+		 */
+		b->hot = (flags & BLOCK_FLAGS_META) || ghost_remove(cache, ba);
+		if (!b->hot)
+			cache->blocks_probation++;
 		hash_table_insert(&cache->block_hash, &b->hash_link);
 
 		/*
@@ -543,21 +1424,41 @@ retry:
 		 * the block.
 		 */
 		fibril_mutex_lock(&b->lock);
+		if (!(flags & BLOCK_FLAGS_NOREAD)) {
+			cache->stats.misses++;
+			ra = cache_readahead_prepare(devcon, ba, ra_blocks);
+		}
+		if (++cache->resize_misses >= CACHE_RESIZE_PERIOD) {
+			cache->resize_misses = 0;
+			resize = true;
+		}
 		fibril_mutex_unlock(&cache->lock);
 
 		if (!(flags & BLOCK_FLAGS_NOREAD)) {
 			/*
 			 * The block contains old or no data. We need to read
-			 * the new contents from the device.
+			 * the new contents from the device, possibly together
+			 * with the blocks read ahead.
 			 */
-			rc = read_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, cache->lblock_size);
+			rc = cache_read_cluster(devcon, b, ra_blocks, ra);
 			if (rc != EOK)
 				b->toxic = true;
 		} else
 			rc = EOK;
 
 		fibril_mutex_unlock(&b->lock);
+
+		/*
+		 * The blocks read ahead stay in the cache until they are used
+		 * or recycled.
+		 */
+		for (unsigned i = 0; i < ra; i++) {
+			fibril_mutex_unlock(&ra_blocks[i]->lock);
+			(void) block_put(ra_blocks[i]);
+		}
+
+		if (resize)
+			cache_resize(cache);
 	}
 out:
 	if ((rc != EOK) && b) {
@@ -582,7 +1483,9 @@ errno_t block_put(block_t *block)
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
 	unsigned blocks_cached;
+	unsigned hi_watermark;
 	enum cache_mode mode;
+	bool written = false;
 	errno_t rc = EOK;
 
 	assert(devcon);
@@ -594,6 +1497,7 @@ errno_t block_put(block_t *block)
 retry:
 	fibril_mutex_lock(&cache->lock);
 	blocks_cached = cache->blocks_cached;
+	hi_watermark = cache->hi_watermark;
 	mode = cache->mode;
 	fibril_mutex_unlock(&cache->lock);
 
@@ -608,16 +1512,23 @@ retry:
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (blocks_cached > hi_watermark || mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
-		if (rc == EOK)
+		if (rc == EOK) {
 			block->write_failures = 0;
+			written = true;
+		}
 		block->dirty = false;
 	}
 	fibril_mutex_unlock(&block->lock);
 
 	fibril_mutex_lock(&cache->lock);
+	if (written) {
+		cache->stats.writes++;
+		cache->stats.written++;
+		written = false;
+	}
 	fibril_mutex_lock(&block->lock);
 	if (!--block->refcnt) {
 		/*
@@ -625,7 +1536,7 @@ retry:
 		 * block or put it on the free list. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
+		if ((cache->blocks_cached > cache->hi_watermark) ||
 		    (rc != EOK)) {
 			/*
 			 * Currently there are too many cached blocks or there
@@ -655,6 +1566,7 @@ retry:
 			 * Take the block out of the cache and free it.
 			 */
 			hash_table_remove_item(&cache->block_hash, &block->hash_link);
+			cache_evicted(cache, block);
 			fibril_mutex_unlock(&block->lock);
 			free(block->data);
 			free(block);
@@ -675,7 +1587,20 @@ retry:
 			fibril_mutex_unlock(&cache->lock);
 			goto retry;
 		}
-		list_append(&block->free_link, &cache->free_list);
+		if (block->hot)
+			list_append(&block->free_link, &cache->free_hot);
+		else
+			list_append(&block->free_link, &cache->free_probation);
+		if (block->dirty) {
+			/*
+			 * Wake up the flusher when the first dirty block
+			 * shows up and when enough of them accumulate.
+			 */
+			cache->dirty_put++;
+			if (cache->dirty_put == 1 ||
+			    cache->dirty_put == CACHE_FLUSH_THRESHOLD)
+				fibril_condvar_signal(&cache->flush_cv);
+		}
 	}
 	fibril_mutex_unlock(&block->lock);
 	fibril_mutex_unlock(&cache->lock);
@@ -787,6 +1712,48 @@ errno_t block_write_direct(service_id_t service_id, aoff64_t ba, size_t cnt,
 	return write_blocks(devcon, ba, cnt, (void *)data, devcon->pblock_size * cnt);
 }
 
+/** Read several ranges of blocks directly from device (bypass cache).
+ *
+ * Ranges adjacent on the device are read as a single range.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param vec		Ranges of physical blocks and buffers for the data.
+ * @param nvec		Number of ranges, at most BD_VEC_MAX.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_direct_v(service_id_t service_id, bd_vec_t *vec,
+    size_t nvec)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return read_blocks_v(devcon, vec, nvec);
+}
+
+/** Write several ranges of blocks directly to device (bypass cache).
+ *
+ * Ranges adjacent on the device are written as a single range.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param vec		Ranges of physical blocks and the data to write.
+ * @param nvec		Number of ranges, at most BD_VEC_MAX.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_write_direct_v(service_id_t service_id, bd_vec_t *vec,
+    size_t nvec)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return write_blocks_v(devcon, vec, nvec);
+}
+
 /** Synchronize blocks to persistent storage.
  *
  * @param service_id	Service ID of the block device.
@@ -934,6 +1901,31 @@ static errno_t read_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *buf,
 	return rc;
 }
 
+/** Read several ranges of blocks from block device.
+ *
+ * @param devcon	Device connection.
+ * @param vec		Ranges of physical blocks and buffers for the data.
+ * @param nvec		Number of ranges.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t read_blocks_v(devcon_t *devcon, bd_vec_t *vec, size_t nvec)
+{
+	assert(devcon);
+
+	errno_t rc = bd_read_blocks_v(devcon->bd, vec, nvec);
+	if (rc != EOK) {
+		printf("Error %s reading %zu ranges starting at block %" PRIuOFF64
+		    " from device handle %" PRIun "\n", str_error_name(rc), nvec,
+		    vec[0].ba, devcon->service_id);
+#ifndef NDEBUG
+		stacktrace_print();
+#endif
+	}
+
+	return rc;
+}
+
 /** Write block to block device.
  *
  * @param devcon	Device connection.
@@ -960,6 +1952,31 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 	return rc;
 }
 
+/** Write several ranges of blocks to block device.
+ *
+ * @param devcon	Device connection.
+ * @param vec		Ranges of physical blocks and the data to write.
+ * @param nvec		Number of ranges.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t write_blocks_v(devcon_t *devcon, bd_vec_t *vec, size_t nvec)
+{
+	assert(devcon);
+
+	errno_t rc = bd_write_blocks_v(devcon->bd, vec, nvec);
+	if (rc != EOK) {
+		printf("Error %s writing %zu ranges starting at block %" PRIuOFF64
+		    " to device handle %" PRIun "\n", str_error_name(rc), nvec,
+		    vec[0].ba, devcon->service_id);
+#ifndef NDEBUG
+		stacktrace_print();
+#endif
+	}
+
+	return rc;
+}
+
 /** Convert logical block address to physical block address. */
 static aoff64_t ba_ltop(devcon_t *devcon, aoff64_t lba)
 {
@@ -44,6 +44,8 @@
 #include <adt/hash_table.h>
 #include <adt/list.h>
 #include <loc.h>
+#include <types/bd.h>
+#include <vfs/vfs.h>
 
 /*
  * Flags that can be used with block_get().
@@ -61,6 +63,13 @@
  */
 #define BLOCK_FLAGS_NOREAD	1
 
+/**
+ * The block holds file system metadata which is likely to be needed again
+ * soon, e.g. a part of an allocation table. The cache keeps such blocks
+ * in preference to data blocks.
+ */
+#define BLOCK_FLAGS_META	2
+
 typedef struct block {
 	/** Mutex protecting the reference count. */
 	fibril_mutex_t lock;
@@ -70,6 +79,10 @@ typedef struct block {
 	bool dirty;
 	/** If true, the blcok does not contain valid data. */
 	bool toxic;
+	/** If true, the block was read ahead and has not been used yet. */
+	bool readahead;
+	/** If true, the block is hot, otherwise it is on probation. */
+	bool hot;
 	/** Readers / Writer lock protecting the contents of the block. */
 	fibril_rwlock_t contents_lock;
 	/** Service ID of service providing the block device. */
@@ -106,6 +119,9 @@ extern void *block_bb_get(service_id_t);
 
 extern errno_t block_cache_init(service_id_t, size_t, unsigned, enum cache_mode);
 extern errno_t block_cache_fini(service_id_t);
+extern errno_t block_cache_flush(service_id_t);
+extern bool block_cache_clean(service_id_t, aoff64_t);
+extern errno_t block_cache_stats(service_id_t, vfs_cache_stats_t *);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
@@ -119,6 +135,8 @@ extern errno_t block_read_toc(service_id_t, uint8_t, void *, size_t);
 extern errno_t block_read_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
+extern errno_t block_read_direct_v(service_id_t, bd_vec_t *, size_t);
+extern errno_t block_write_direct_v(service_id_t, bd_vec_t *, size_t);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
 
 #endif
@@ -1329,6 +1329,10 @@ errno_t async_data_read_start(async_exch_t *exch, void *dst, size_t size)
 }
 
 /** Wrapper for IPC_M_DATA_WRITE calls using the async framework.
+ *
+ * Large page-aligned source buffers are read by the kernel only when the
+ * recipient accepts the data. The source buffer must therefore not be
+ * modified by other fibrils or threads until the function returns.
  *
  * @param exch Exchange for sending the message.
  * @param src  Address of the beginning of the source buffer.
@@ -46,6 +46,7 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <adt/gcdlcm.h>
+#include <tls.h>
 
 #include "private/malloc.h"
 #include "private/fibril.h"
@@ -95,6 +96,26 @@
  */
 #define NET_SIZE(size)  ((size) - STRUCT_OVERHEAD)
 
+/** Largest net block size cached in the per-fibril caches. */
+#define CACHE_MAX_SIZE  (MALLOC_CACHE_CLASSES * BASE_ALIGN)
+
+/** Size class of a heap block with the given net size.
+ *
+ * The block can serve any request up to the size of its class.
+ *
+ */
+#define CACHE_BLOCK_CLASS(size)  (((size) / BASE_ALIGN) - 1)
+
+/** Size class which serves a request of the given size. */
+#define CACHE_REQUEST_CLASS(size) \
+	(CACHE_BLOCK_CLASS(ALIGN_UP(max((size), 1), BASE_ALIGN)))
+
+/** Net size of the blocks of the given size class. */
+#define CACHE_CLASS_SIZE(cls)  (((cls) + 1) * BASE_ALIGN)
+
+/** Number of bytes a fibril may keep cached in one size class. */
+#define CACHE_BIN_BYTES  1024
+
 /** Overhead of each area. */
 #define AREA_OVERHEAD(size) \
 	(ALIGN_UP(GROSS_SIZE(size) + sizeof(heap_area_t), BASE_ALIGN))
@@ -167,6 +188,9 @@ typedef struct {
 	/* Indication of a free block */
 	bool free;
 
+	/* Indication of a block kept in a fibril cache */
+	bool cached;
+
 	/** Heap area this block belongs to */
 	heap_area_t *area;
 
@@ -237,6 +261,7 @@ static void block_init(void *addr, size_t size, bool free, heap_area_t *area)
 
 	head->size = size;
 	head->free = free;
+	head->cached = false;
 	head->area = area;
 	head->magic = HEAP_BLOCK_HEAD_MAGIC;
 
@@ -297,7 +322,8 @@ static bool area_create(size_t size)
 	/* Align the heap area size on page boundary */
 	size_t asize = ALIGN_UP(size, PAGE_SIZE);
 	void *astart = as_area_create(AS_AREA_ANY, asize,
-	    AS_AREA_WRITE | AS_AREA_READ | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	    AS_AREA_WRITE | AS_AREA_READ | AS_AREA_CACHEABLE |
+	    AS_AREA_LARGE_PAGES, AS_AREA_UNPAGED);
 	if (astart == AS_MAP_FAILED)
 		return false;
 
@@ -772,6 +798,263 @@ static void *malloc_internal(const size_t size, const size_t align)
 	return heap_grow_and_alloc(gross_size, falign);
 }
 
+/** Free a memory block
+ *
+ * Should be called only inside the critical section.
+ *
+ * @param addr The address of the block.
+ *
+ */
+static void free_internal(void *const addr)
+{
+	/* Calculate the position of the header. */
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	block_check(head);
+	malloc_assert(!head->free);
+	malloc_assert(!head->cached);
+
+	heap_area_t *area = head->area;
+
+	area_check(area);
+	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
+	malloc_assert((void *) head < area->end);
+
+	/* Mark the block itself as free. */
+	head->free = true;
+
+	/* Look at the next block. If it is free, merge the two. */
+	heap_block_head_t *next_head =
+	    (heap_block_head_t *) (((void *) head) + head->size);
+
+	if ((void *) next_head < area->end) {
+		block_check(next_head);
+		if (next_head->free)
+			block_init(head, head->size + next_head->size, true, area);
+	}
+
+	/* Look at the previous block. If it is free, merge the two. */
+	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
+		heap_block_foot_t *prev_foot =
+		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
+
+		heap_block_head_t *prev_head =
+		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
+
+		block_check(prev_head);
+
+		if (prev_head->free)
+			block_init(prev_head, prev_head->size + head->size, true,
+			    area);
+	}
+
+	heap_shrink(area);
+}
+
+/** Get the heap block cache of the current fibril.
+ *
+ * @return Cache of the current fibril or NULL if there is none
+ *         (e.g. during thread creation or fibril teardown).
+ *
+ */
+static inline malloc_cache_t *cache_get(void)
+{
+	if (!__tcb_is_set())
+		return NULL;
+
+	fibril_t *fibril = __tcb_get()->fibril_data;
+	if (fibril == NULL)
+		return NULL;
+
+	return &fibril->malloc_cache;
+}
+
+/** Maximum number of blocks kept in a bin of the given size class. */
+static inline size_t cache_bin_limit(size_t cls)
+{
+	size_t limit = CACHE_BIN_BYTES / CACHE_CLASS_SIZE(cls);
+
+	return min(max(limit, 4), 32);
+}
+
+/** Return blocks from a cache bin to the heap
+ *
+ * All blocks are returned within a single critical section.
+ *
+ * @param bin   Cache bin.
+ * @param count Number of blocks to return.
+ *
+ */
+static void cache_bin_drain(malloc_bin_t *bin, size_t count)
+{
+	heap_lock();
+
+	while ((count > 0) && (bin->head != NULL)) {
+		void *addr = bin->head;
+		bin->head = *((void **) addr);
+		bin->count--;
+		count--;
+
+		heap_block_head_t *head =
+		    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+		head->cached = false;
+
+		free_internal(addr);
+	}
+
+	heap_unlock();
+}
+
+/** Refill a cache bin from the heap
+ *
+ * A single heap block large enough for a batch of blocks of the given
+ * size class is allocated and split into individual blocks. One of the
+ * blocks is returned to the caller, the others are put into the bin.
+ *
+ * @param bin Cache bin.
+ * @param cls Size class of the bin.
+ *
+ * @return Address of an allocated block of the size class or NULL
+ *         on not enough memory.
+ *
+ */
+static void *cache_bin_refill(malloc_bin_t *bin, size_t cls)
+{
+	size_t batch = cache_bin_limit(cls) / 2;
+	size_t gross_size = GROSS_SIZE(CACHE_CLASS_SIZE(cls));
+
+	heap_lock();
+
+	void *addr = malloc_internal(NET_SIZE(batch * gross_size), BASE_ALIGN);
+	if (addr == NULL) {
+		heap_unlock();
+		return NULL;
+	}
+
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+	heap_area_t *area = head->area;
+	size_t size = head->size;
+
+	/*
+	 * Split the block. The last block also receives
+	 * any excess and is returned to the caller.
+	 */
+	for (size_t i = 0; i < batch - 1; i++) {
+		block_init(head, gross_size, false, area);
+		head->cached = true;
+
+		void *block = ((void *) head) + sizeof(heap_block_head_t);
+		*((void **) block) = bin->head;
+		bin->head = block;
+		bin->count++;
+
+		head = ((void *) head) + gross_size;
+		size -= gross_size;
+	}
+
+	block_init(head, size, false, area);
+
+	heap_unlock();
+
+	return ((void *) head) + sizeof(heap_block_head_t);
+}
+
+/** Allocate a memory block from the cache of the current fibril
+ *
+ * @param size Number of bytes to allocate.
+ * @param hit  Set to true if the request was handled by the cache,
+ *             false if the caller should allocate from the heap.
+ *
+ * @return Allocated memory or NULL.
+ *
+ */
+static inline void *cache_malloc(const size_t size, bool *hit)
+{
+	malloc_cache_t *cache = cache_get();
+	if ((cache == NULL) || (size > CACHE_MAX_SIZE)) {
+		*hit = false;
+		return NULL;
+	}
+
+	*hit = true;
+
+	size_t cls = CACHE_REQUEST_CLASS(size);
+	malloc_bin_t *bin = &cache->bins[cls];
+
+	void *addr = bin->head;
+	if (addr == NULL)
+		return cache_bin_refill(bin, cls);
+
+	bin->head = *((void **) addr);
+	bin->count--;
+
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+	malloc_assert(head->cached);
+	head->cached = false;
+
+	return addr;
+}
+
+/** Free a memory block into the cache of the current fibril
+ *
+ * @param addr The address of the block.
+ *
+ * @return True if the block was cached, false if the caller should
+ *         return it to the heap.
+ *
+ */
+static inline bool cache_free(void *const addr)
+{
+	malloc_cache_t *cache = cache_get();
+	if (cache == NULL)
+		return false;
+
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	block_check(head);
+	malloc_assert(!head->free);
+	malloc_assert(!head->cached);
+
+	size_t net_size = NET_SIZE(head->size);
+	if ((net_size < BASE_ALIGN) || (net_size > CACHE_MAX_SIZE))
+		return false;
+
+	size_t cls = CACHE_BLOCK_CLASS(net_size);
+	malloc_bin_t *bin = &cache->bins[cls];
+	size_t limit = cache_bin_limit(cls);
+
+	if (bin->count >= limit)
+		cache_bin_drain(bin, limit / 2);
+
+	/* Catch double free of the block while it is cached. */
+	head->cached = true;
+
+	*((void **) addr) = bin->head;
+	bin->head = addr;
+	bin->count++;
+
+	return true;
+}
+
+/** Return all blocks from a fibril cache to the heap
+ *
+ * @param cache Fibril cache.
+ *
+ */
+void __malloc_cache_flush(malloc_cache_t *cache)
+{
+	for (size_t cls = 0; cls < MALLOC_CACHE_CLASSES; cls++) {
+		malloc_bin_t *bin = &cache->bins[cls];
+
+		if (bin->count > 0)
+			cache_bin_drain(bin, bin->count);
+	}
+}
+
 /** Allocate memory by number of elements
  *
  * @param nmemb Number of members to allocate.
@@ -801,8 +1084,13 @@ void *calloc(const size_t nmemb, const size_t size)
  */
 void *malloc(const size_t size)
 {
+	bool hit;
+	void *block = cache_malloc(size, &hit);
+	if (hit)
+		return block;
+
 	heap_lock();
-	void *block = malloc_internal(size, BASE_ALIGN);
+	block = malloc_internal(size, BASE_ALIGN);
 	heap_unlock();
 
 	return block;
@@ -857,6 +1145,7 @@ void *realloc(void *const addr, const size_t size)
 
 	block_check(head);
 	malloc_assert(!head->free);
+	malloc_assert(!head->cached);
 
 	heap_area_t *area = head->area;
 
@@ -958,51 +1247,11 @@ void free(void *const addr)
 	if (addr == NULL)
 		return;
 
-	heap_lock();
-
-	/* Calculate the position of the header. */
-	heap_block_head_t *head =
-	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
-
-	block_check(head);
-	malloc_assert(!head->free);
-
-	heap_area_t *area = head->area;
-
-	area_check(area);
-	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
-	malloc_assert((void *) head < area->end);
-
-	/* Mark the block itself as free. */
-	head->free = true;
-
-	/* Look at the next block. If it is free, merge the two. */
-	heap_block_head_t *next_head =
-	    (heap_block_head_t *) (((void *) head) + head->size);
-
-	if ((void *) next_head < area->end) {
-		block_check(next_head);
-		if (next_head->free)
-			block_init(head, head->size + next_head->size, true, area);
-	}
-
-	/* Look at the previous block. If it is free, merge the two. */
-	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
-		heap_block_foot_t *prev_foot =
-		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
-
-		heap_block_head_t *prev_head =
-		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
-
-		block_check(prev_head);
-
-		if (prev_head->free)
-			block_init(prev_head, prev_head->size + head->size, true,
-			    area);
-	}
-
-	heap_shrink(area);
+	if (cache_free(addr))
+		return;
 
+	heap_lock();
+	free_internal(addr);
 	heap_unlock();
 }
 
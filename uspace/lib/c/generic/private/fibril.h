@@ -37,6 +37,7 @@
 #include <ipc/common.h>
 
 #include "./futex.h"
+#include "./malloc.h"
 
 typedef struct {
 	fibril_t *fibril;
@@ -44,6 +45,8 @@ typedef struct {
 
 #define FIBRIL_EVENT_INIT ((fibril_event_t) {0})
 
+typedef struct runner runner_t;
+
 struct fibril {
 	// XXX: The first two fields must not move (for taskdump).
 	link_t all_link;
@@ -62,6 +65,15 @@ struct fibril {
 
 	fibril_t *thread_ctx;
 
+	/*
+	 * Runner whose ready queue the fibril is put in when it becomes
+	 * ready. For the helper fibril, this is the runner of its thread.
+	 */
+	runner_t *runner;
+
+	/* Cache of small heap blocks owned by this fibril. */
+	malloc_cache_t malloc_cache;
+
 	bool is_running : 1;
 	bool is_writer : 1;
 	/* In some places, we use fibril structs that can't be freed. */
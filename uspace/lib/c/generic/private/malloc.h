@@ -35,8 +35,34 @@
 #ifndef _LIBC_PRIVATE_MALLOC_H_
 #define _LIBC_PRIVATE_MALLOC_H_
 
+#include <stddef.h>
+
+/** Number of size classes cached by each fibril. */
+#define MALLOC_CACHE_CLASSES  16
+
+/** Bin of cached heap blocks of one size class. */
+typedef struct {
+	/** Singly-linked list of cached blocks (linked through the payload) */
+	void *head;
+
+	/** Number of blocks in the bin */
+	size_t count;
+} malloc_bin_t;
+
+/** Per-fibril cache of small heap blocks.
+ *
+ * The blocks in the cache are allocated from the point of view of the
+ * shared heap. Since a fibril never runs on more than one thread at a time,
+ * the cache can be manipulated without any locking.
+ *
+ */
+typedef struct {
+	malloc_bin_t bins[MALLOC_CACHE_CLASSES];
+} malloc_cache_t;
+
 extern void __malloc_init(void);
 extern void __malloc_fini(void);
+extern void __malloc_cache_flush(malloc_cache_t *);
 
 #endif
 
@@ -47,6 +47,7 @@
 #include <str.h>
 #include <ipc/ipc.h>
 #include <libarch/faddr.h>
+#include <macros.h>
 
 #include "../private/thread.h"
 #include "../private/futex.h"
@@ -76,6 +77,26 @@ typedef struct {
 	ipc_call_t call;
 } _ipc_buffer_t;
 
+/** Maximum number of runners with their own ready queue. */
+#define RUNNER_MAX  64
+
+/** Ready queue of a runner (i.e. a thread executing fibrils).
+ *
+ * A fibril which becomes ready is queued at the runner it last ran on.
+ * Runners which find their own queue empty steal ready fibrils from the
+ * queues of other runners.
+ */
+struct runner {
+	/** Protects the ready list. */
+	futex_t futex;
+	/** Ready fibrils. */
+	list_t ready;
+	/** Index of the runner in runners. */
+	int idx;
+	/** Whether a thread currently runs as this runner. */
+	bool active;
+};
+
 typedef enum {
 	SWITCH_FROM_DEAD,
 	SWITCH_FROM_HELPER,
@@ -90,7 +111,20 @@ static futex_t fibril_futex;
 static futex_t ready_semaphore;
 static long ready_st_count;
 
-static LIST_INITIALIZE(ready_list);
+/*
+ * Ready queues of all runners. The first one is shared by threads which
+ * do not have a runner of their own (yet).
+ */
+static runner_t main_runner;
+static runner_t *_Atomic runners[RUNNER_MAX];
+static atomic_int runner_count;
+
+/* Serializes creation and reuse of runners. */
+static futex_t runners_futex;
+
+/* Number of runner threads spawned so far. */
+static atomic_int runner_threads;
+
 static LIST_INITIALIZE(fibril_list);
 static LIST_INITIALIZE(timeout_list);
 
@@ -110,8 +144,13 @@ static inline void _ready_debug_check(void)
 {
 #ifdef READY_DEBUG
 	assert(!multithreaded);
-	long count = (long) list_count(&ready_list) +
-	    (long) list_count(&ipc_buffer_free_list);
+	long count = (long) list_count(&ipc_buffer_free_list);
+	int nrunners = min(atomic_load(&runner_count), RUNNER_MAX);
+	for (int i = 0; i < nrunners; i++) {
+		runner_t *r = atomic_load(&runners[i]);
+		if (r != NULL)
+			count += (long) list_count(&r->ready);
+	}
 	assert(ready_st_count == count);
 #endif
 }
@@ -138,6 +177,122 @@ static inline errno_t _ready_down(const struct timespec *expires)
 
 static atomic_int threads_in_ipc_wait;
 
+/** Create a ready queue for a new runner thread.
+ *
+ * The queue of a runner whose thread has exited is reused if there is one.
+ * Runners are never freed, since fibrils which last ran on them may still
+ * refer to them.
+ *
+ * Must not be called with fibril_futex held.
+ *
+ * @return New runner or NULL if the maximum number of runners has been
+ *         reached or there is not enough memory. Fibrils on threads
+ *         without their own runner use the main runner.
+ */
+static runner_t *_runner_create(void)
+{
+	futex_assert_is_not_locked(&fibril_futex);
+
+	futex_lock(&runners_futex);
+
+	int nrunners = atomic_load(&runner_count);
+	for (int i = 1; i < nrunners; i++) {
+		runner_t *r = atomic_load(&runners[i]);
+
+		futex_lock(&r->futex);
+		bool reuse = !r->active;
+		r->active = true;
+		futex_unlock(&r->futex);
+
+		if (reuse) {
+			futex_unlock(&runners_futex);
+			return r;
+		}
+	}
+
+	runner_t *r = NULL;
+	if (nrunners < RUNNER_MAX)
+		r = calloc(1, sizeof(runner_t));
+
+	if (r && futex_initialize(&r->futex, 1) != EOK) {
+		free(r);
+		r = NULL;
+	}
+
+	if (r) {
+		list_initialize(&r->ready);
+		r->idx = nrunners;
+		r->active = true;
+		atomic_store(&runners[r->idx], r);
+		atomic_store(&runner_count, nrunners + 1);
+	}
+
+	futex_unlock(&runners_futex);
+	return r;
+}
+
+/** Retire the runner of an exiting thread.
+ *
+ * Fibrils left in its ready queue are moved to the main runner. Fibrils
+ * which become ready later and still refer to the runner are queued at
+ * the main runner as well, until the runner is reused.
+ */
+static void _runner_destroy(runner_t *r)
+{
+	futex_lock(&r->futex);
+	r->active = false;
+
+	futex_lock(&main_runner.futex);
+	list_concat(&main_runner.ready, &r->ready);
+	futex_unlock(&main_runner.futex);
+
+	futex_unlock(&r->futex);
+}
+
+/** Get the runner of the current thread. */
+static runner_t *_runner_self(void)
+{
+	fibril_t *f = fibril_self();
+	fibril_t *ctx = f->thread_ctx ? f->thread_ctx : f;
+
+	return ctx->runner ? ctx->runner : &main_runner;
+}
+
+/** Take the first fibril from the ready queue of a runner. */
+static fibril_t *_runner_pop(runner_t *r)
+{
+	futex_lock(&r->futex);
+	fibril_t *f = list_pop(&r->ready, fibril_t, link);
+	futex_unlock(&r->futex);
+	return f;
+}
+
+/**
+ * Take a ready fibril, preferably from the ready queue of the current
+ * runner. If it is empty, steal the oldest ready fibril from another runner.
+ */
+static fibril_t *_runner_pop_any(void)
+{
+	runner_t *self = _runner_self();
+
+	fibril_t *f = _runner_pop(self);
+	if (f)
+		return f;
+
+	int nrunners = min(atomic_load(&runner_count), RUNNER_MAX);
+	for (int i = 1; i < nrunners; i++) {
+		runner_t *r = atomic_load(&runners[(self->idx + i) % nrunners]);
+		if (!r)
+			continue;
+
+		f = _runner_pop(r);
+		if (f)
+			return f;
+	}
+
+	return NULL;
+}
+
 /** Function that spans the whole life-cycle of a fibril.
  *
  * Each fibril begins execution in this function. Then the function implementing
@@ -195,9 +350,18 @@ void fibril_teardown(fibril_t *fibril)
 	list_remove(&fibril->all_link);
 	futex_unlock(&fibril_futex);
 
+	/*
+	 * Return the cached heap blocks and make sure that the fibril
+	 * cache is not used any more, even if we are tearing down
+	 * ourselves.
+	 */
+	tcb_t *tcb = fibril->tcb;
+	tcb->fibril_data = NULL;
+	__malloc_cache_flush(&fibril->malloc_cache);
+
 	if (fibril->is_freeable) {
-		tls_free(fibril->tcb);
 		free(fibril);
+		tls_free(tcb);
 	}
 }
 
@@ -282,17 +446,19 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	 * for each entry of the call buffer.
 	 */
 
-	if (!locked)
-		futex_lock(&fibril_futex);
-	fibril_t *f = list_pop(&ready_list, fibril_t, link);
-	if (!f)
-		atomic_fetch_add_explicit(&threads_in_ipc_wait, 1,
-		    memory_order_relaxed);
-	if (!locked)
-		futex_unlock(&fibril_futex);
+	/*
+	 * Announce the intention to wait for IPC before looking for a ready
+	 * fibril. A fibril made ready concurrently is either found here, or
+	 * its producer notices us and pokes us out of the IPC wait.
+	 */
+	atomic_fetch_add(&threads_in_ipc_wait, 1);
+	atomic_thread_fence(memory_order_seq_cst);
 
-	if (f)
+	fibril_t *f = _runner_pop_any();
+	if (f) {
+		atomic_fetch_sub(&threads_in_ipc_wait, 1);
 		return f;
+	}
 
 	if (!multithreaded)
 		assert(list_empty(&ipc_buffer_list));
@@ -359,18 +525,36 @@ static fibril_t *_ready_list_pop_nonblocking(bool locked)
 	return _ready_list_pop(&tv, locked);
 }
 
+/**
+ * Make a fibril ready. It is queued at the runner it last ran on, so that
+ * it is likely to find its data in the cache. Fibrils which have not run
+ * yet are queued at the current runner.
+ *
+ * Switching to the fibril requires fibril_futex, so the fibril cannot be
+ * resumed before the switch away from it is complete even though the ready
+ * queues are not protected by fibril_futex.
+ */
 static void _ready_list_push(fibril_t *f)
 {
 	if (!f)
 		return;
 
-	futex_assert_is_locked(&fibril_futex);
+	runner_t *r = f->runner ? f->runner : _runner_self();
+
+	futex_lock(&r->futex);
+	if (!r->active) {
+		/* The thread of the runner has exited. */
+		futex_unlock(&r->futex);
+		r = &main_runner;
+		futex_lock(&r->futex);
+	}
+	list_append(&f->link, &r->ready);
+	futex_unlock(&r->futex);
 
-	/* Enqueue in ready_list. */
-	list_append(&f->link, &ready_list);
 	_ready_up();
 
-	if (atomic_load_explicit(&threads_in_ipc_wait, memory_order_relaxed)) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&threads_in_ipc_wait)) {
 		DPRINTF("Poking.\n");
 		/* Wakeup one thread sleeping in SYS_IPC_WAIT. */
 		ipc_poke();
@@ -488,6 +672,10 @@ static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf, bool locked)
 	dstf->thread_ctx = srcf->thread_ctx;
 	srcf->thread_ctx = NULL;
 
+	/* Remember where the fibril runs for locality-aware wakeups. */
+	if (dstf->thread_ctx && dstf->thread_ctx->runner)
+		dstf->runner = dstf->thread_ctx->runner;
+
 	/* Just some bookkeeping to allow better debugging of futex locks. */
 	futex_give_to(&fibril_futex, dstf);
 
@@ -631,10 +819,12 @@ errno_t fibril_wait_timeout(fibril_event_t *event,
 	DPRINTF("### Fibril %p sleeping on event %p.\n", fibril_self(), event);
 
 	if (!fibril_self()->thread_ctx) {
-		fibril_self()->thread_ctx =
+		fibril_t *helper =
 		    fibril_create_generic(_helper_fibril_fn, NULL, PAGE_SIZE);
-		if (!fibril_self()->thread_ctx)
+		if (!helper)
 			return ENOMEM;
+
+		fibril_self()->thread_ctx = helper;
 	}
 
 	futex_lock(&fibril_futex);
@@ -782,13 +972,22 @@ void fibril_yield(void)
 
 static void _runner_fn(void *arg)
 {
+	/* A runner thread gets its own ready queue. */
+	runner_t *r = _runner_create();
+	fibril_self()->runner = r;
+
 	_helper_fibril_fn(arg);
+
+	fibril_self()->runner = NULL;
+	if (r)
+		_runner_destroy(r);
 }
 
 /**
  * Spawn a given number of runners (i.e. OS threads) immediately, and
  * unconditionally. This is meant to be used for tests and debugging.
- * Regular programs should just use `fibril_enable_multithreaded()`.
+ * Regular programs should just use `fibril_enable_multithreaded()`
+ * or `fibril_request_runners()`.
  *
  * @param n  Number of runners to spawn.
  * @return   Number of runners successfully spawned.
@@ -812,11 +1011,32 @@ int fibril_test_spawn_runners(int n)
 		if (rc != EOK)
 			return i;
 		thread_detach(tid);
+		atomic_fetch_add(&runner_threads, 1);
 	}
 
 	return n;
 }
 
+/**
+ * Make sure that fibrils of the task are executed by at least the given
+ * number of runners (i.e. OS threads), including the main thread.
+ *
+ * Each runner has its own queue of ready fibrils. Idle runners steal
+ * ready fibrils from the queues of other runners.
+ *
+ * @param n  Requested number of runners.
+ * @return   Number of runners the task has.
+ */
+int fibril_request_runners(int n)
+{
+	int have = atomic_load(&runner_threads) + 1;
+
+	if (n > have)
+		(void) fibril_test_spawn_runners(n - have);
+
+	return atomic_load(&runner_threads) + 1;
+}
+
 /**
  * Opt-in to have more than one runner thread.
  *
@@ -831,7 +1051,7 @@ void fibril_enable_multithreaded(void)
 	// TODO: Implement better.
 	//       For now, 4 total runners is a sensible default.
 	if (!multithreaded) {
-		fibril_test_spawn_runners(3);
+		fibril_request_runners(4);
 	}
 }
 
@@ -869,6 +1089,16 @@ void __fibrils_init(void)
 		abort();
 	if (futex_initialize(&ipc_lists_futex, 1) != EOK)
 		abort();
+	if (futex_initialize(&main_runner.futex, 1) != EOK)
+		abort();
+	if (futex_initialize(&runners_futex, 1) != EOK)
+		abort();
+
+	list_initialize(&main_runner.ready);
+	main_runner.idx = 0;
+	main_runner.active = true;
+	atomic_store(&runners[0], &main_runner);
+	atomic_store(&runner_count, 1);
 
 	/*
 	 * We allow a fixed, small amount of parallelism for IPC reads, but
@@ -889,6 +1119,8 @@ void __fibrils_fini(void)
 {
 	futex_destroy(&fibril_futex);
 	futex_destroy(&ipc_lists_futex);
+	futex_destroy(&main_runner.futex);
+	futex_destroy(&runners_futex);
 }
 
 void fibril_usleep(usec_t timeout)
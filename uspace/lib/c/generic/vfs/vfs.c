@@ -224,6 +224,53 @@ char *vfs_absolutize(const char *path, size_t *retlen)
 	return ncwd_path;
 }
 
+/** Get block cache statistics of a file system instance
+ *
+ * @param file          File located on the queried file system
+ * @param[out] st       Buffer for storing the statistics
+ *
+ * @return              EOK on success or an error code, ENOTSUP if the file
+ *                      system does not use a block cache
+ */
+errno_t vfs_cache_stats(int file, vfs_cache_stats_t *st)
+{
+	errno_t rc, ret;
+	aid_t req;
+
+	async_exch_t *exch = vfs_exchange_begin();
+
+	req = async_send_1(exch, VFS_IN_CACHE_STATS, file, NULL);
+	rc = async_data_read_start(exch, (void *) st, sizeof(*st));
+
+	vfs_exchange_end(exch);
+	async_wait_for(req, &ret);
+
+	rc = (ret != EOK ? ret : rc);
+
+	return rc;
+}
+
+/** Get block cache statistics of a file system instance
+ *
+ * @param path          Path pointing to the queried file system
+ * @param[out] st       Buffer for storing the statistics
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_cache_stats_path(const char *path, vfs_cache_stats_t *st)
+{
+	int file;
+	errno_t rc = vfs_lookup(path, 0, &file);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_cache_stats(file, st);
+
+	vfs_put(file);
+
+	return rc;
+}
+
 /** Clone a file handle
  *
  * The caller can choose whether to clone an existing file handle into another
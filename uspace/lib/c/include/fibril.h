@@ -67,6 +67,7 @@ extern void fibril_sleep(sec_t);
 
 extern void fibril_enable_multithreaded(void);
 extern int fibril_test_spawn_runners(int);
+extern int fibril_request_runners(int);
 
 extern void fibril_detach(fid_t fid);
 
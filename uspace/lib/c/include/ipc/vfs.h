@@ -61,8 +61,26 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * All changes to the namespace go through VFS, so VFS may cache
+	 * the results of name lookups.
+	 */
+	bool dentry_cache;
+	/**
+	 * The fs keeps file pages in shareable memory and implements
+	 * VFS_OUT_PAGE_MAP, so VFS may hand them out to pagers directly.
+	 */
+	bool page_map;
 } vfs_info_t;
 
+/** Location of a file page inside the area shared by VFS_OUT_PAGE_MAP. */
+typedef struct {
+	/** Size of the area that has to be shared in. */
+	size_t area_size;
+	/** Offset of the requested page within the area. */
+	size_t offset;
+} vfs_page_map_t;
+
 /** Data returned by filesystem probe regarding a specific volume. */
 typedef struct {
 	char label[FS_LABEL_MAXLEN + 1];
@@ -70,7 +88,8 @@ typedef struct {
 } vfs_fs_probe_info_t;
 
 typedef enum {
-	VFS_IN_CLONE = IPC_FIRST_USER_METHOD,
+	VFS_IN_CACHE_STATS = IPC_FIRST_USER_METHOD,
+	VFS_IN_CLONE,
 	VFS_IN_FSPROBE,
 	VFS_IN_FSTYPES,
 	VFS_IN_MOUNT,
@@ -91,7 +110,8 @@ typedef enum {
 } vfs_in_request_t;
 
 typedef enum {
-	VFS_OUT_CLOSE = IPC_FIRST_USER_METHOD,
+	VFS_OUT_CACHE_STATS = IPC_FIRST_USER_METHOD,
+	VFS_OUT_CLOSE,
 	VFS_OUT_DESTROY,
 	VFS_OUT_FSPROBE,
 	VFS_OUT_IS_EMPTY,
@@ -99,6 +119,7 @@ typedef enum {
 	VFS_OUT_LOOKUP,
 	VFS_OUT_MOUNTED,
 	VFS_OUT_OPEN_NODE,
+	VFS_OUT_PAGE_MAP,
 	VFS_OUT_READ,
 	VFS_OUT_STAT,
 	VFS_OUT_STATFS,
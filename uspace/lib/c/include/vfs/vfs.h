@@ -71,6 +71,18 @@ typedef struct {
 	uint64_t f_bfree;    /* free blocks in fs */
 } vfs_statfs_t;
 
+/** Block cache statistics of a file system instance */
+typedef struct {
+	uint64_t hits;       /* lookups satisfied from the cache */
+	uint64_t misses;     /* lookups that had to read the device */
+	uint64_t ra_blocks;  /* blocks brought in by read-ahead */
+	uint64_t ra_hits;    /* read-ahead blocks that were used later */
+	uint64_t writes;     /* write requests issued to the device */
+	uint64_t written;    /* blocks written to the device */
+	uint64_t cached;     /* blocks currently in the cache */
+	uint64_t target;     /* target size of the cache in blocks */
+} vfs_cache_stats_t;
+
 /** List of file system types */
 typedef struct {
 	char **fstypes;
@@ -81,6 +93,8 @@ typedef struct {
 extern errno_t vfs_fhandle(FILE *, int *);
 
 extern char *vfs_absolutize(const char *, size_t *);
+extern errno_t vfs_cache_stats(int, vfs_cache_stats_t *);
+extern errno_t vfs_cache_stats_path(const char *, vfs_cache_stats_t *);
 extern errno_t vfs_clone(int, int, bool, int *);
 extern errno_t vfs_cwd_get(char *path, size_t);
 extern errno_t vfs_cwd_set(const char *path);
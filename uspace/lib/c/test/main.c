@@ -41,6 +41,7 @@ PCUT_IMPORT(gsort);
 PCUT_IMPORT(ieee_double);
 PCUT_IMPORT(imath);
 PCUT_IMPORT(inttypes);
+PCUT_IMPORT(malloc);
 PCUT_IMPORT(mem);
 PCUT_IMPORT(odict);
 PCUT_IMPORT(perf);
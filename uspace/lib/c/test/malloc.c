@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <malloc.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(malloc);
+
+/** Small blocks are reused and remain usable after being cached */
+PCUT_TEST(small_reuse)
+{
+	void *blocks[128];
+
+	for (int round = 0; round < 4; round++) {
+		for (size_t i = 0; i < 128; i++) {
+			blocks[i] = malloc(1 + i * 2);
+			PCUT_ASSERT_NOT_NULL(blocks[i]);
+			PCUT_ASSERT_INT_EQUALS(0, (uintptr_t) blocks[i] % 16);
+			memset(blocks[i], (int) i, 1 + i * 2);
+		}
+
+		for (size_t i = 0; i < 128; i++) {
+			uint8_t *p = blocks[i];
+			PCUT_ASSERT_INT_EQUALS(i & 0xff, p[i * 2]);
+			free(blocks[i]);
+		}
+	}
+
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+/** Blocks allocated from the cache can be reallocated */
+PCUT_TEST(realloc_cached)
+{
+	char *p = malloc(24);
+	PCUT_ASSERT_NOT_NULL(p);
+	memset(p, 'a', 24);
+
+	p = realloc(p, 4096);
+	PCUT_ASSERT_NOT_NULL(p);
+	PCUT_ASSERT_INT_EQUALS('a', p[23]);
+
+	p = realloc(p, 40);
+	PCUT_ASSERT_NOT_NULL(p);
+	PCUT_ASSERT_INT_EQUALS('a', p[0]);
+
+	free(p);
+	PCUT_ASSERT_NULL(heap_check());
+}
+
+/** Zero-sized allocations work */
+PCUT_TEST(zero_size)
+{
+	void *p = malloc(0);
+	PCUT_ASSERT_NOT_NULL(p);
+	free(p);
+}
+
+PCUT_EXPORT(malloc);
@@ -40,6 +40,7 @@
 #include <fibril_synch.h>
 #include <stdbool.h>
 #include <offset.h>
+#include <types/bd.h>
 
 typedef struct bd_ops bd_ops_t;
 
@@ -54,6 +55,12 @@ typedef struct {
 	bd_srvs_t *srvs;
 	async_sess_t *client_sess;
 	void *carg;
+	/** Protects @c pending */
+	fibril_mutex_t lock;
+	/** Signalled when a vectored request completes */
+	fibril_condvar_t cv;
+	/** Number of vectored requests in progress */
+	unsigned pending;
 } bd_srv_t;
 
 struct bd_ops {
@@ -65,6 +72,12 @@ struct bd_ops {
 	errno_t (*write_blocks)(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 	errno_t (*get_block_size)(bd_srv_t *, size_t *);
 	errno_t (*get_num_blocks)(bd_srv_t *, aoff64_t *);
+	/*
+	 * Optional, vectored requests are split into read_blocks and
+	 * write_blocks calls if these are not provided.
+	 */
+	errno_t (*read_blocks_v)(bd_srv_t *, bd_vec_t *, size_t);
+	errno_t (*write_blocks_v)(bd_srv_t *, bd_vec_t *, size_t);
 };
 
 extern void bd_srvs_init(bd_srvs_t *);
@@ -36,6 +36,7 @@
 #define _LIBC_IPC_BD_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	BD_GET_BLOCK_SIZE = IPC_FIRST_USER_METHOD,
@@ -43,9 +44,21 @@ typedef enum {
 	BD_READ_BLOCKS,
 	BD_SYNC_CACHE,
 	BD_WRITE_BLOCKS,
-	BD_READ_TOC
+	BD_READ_TOC,
+	BD_READ_BLOCKS_V,
+	BD_WRITE_BLOCKS_V
 } bd_request_t;
 
+/** Block range as transferred by BD_READ_BLOCKS_V and BD_WRITE_BLOCKS_V */
+typedef struct {
+	/** Address of the first block */
+	uint64_t ba;
+	/** Number of blocks */
+	uint64_t cnt;
+	/** Size of the range's data in bytes */
+	uint64_t size;
+} bd_ipc_range_t;
+
 #endif
 
 /** @}
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <bd.h>
 #include <errno.h>
+#include <fibril.h>
 #include <ipc/bd.h>
 #include <ipc/services.h>
 #include <loc.h>
@@ -45,6 +46,18 @@
 #include <stdlib.h>
 #include <offset.h>
 
+/** Vectored request sent to the server */
+typedef struct {
+	/** The request itself */
+	aid_t req;
+	/** Data transfers of a read request, one for each range */
+	aid_t data[BD_VEC_MAX];
+	size_t ndata;
+	/** Completion callback of an asynchronous request */
+	bd_cb_t cb;
+	void *arg;
+} bd_vreq_t;
+
 static void bd_cb_conn(ipc_call_t *icall, void *arg);
 
 errno_t bd_open(async_sess_t *sess, bd_t **rbd)
@@ -153,6 +166,218 @@ errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
 	return EOK;
 }
 
+/** Send a vectored request.
+ *
+ * The ranges are described to the server first, then the data of each range
+ * is transferred separately, directly from or to the caller's buffers. The
+ * data of a read request is transferred by the server once the request is
+ * served.
+ *
+ * @param bd	Block device.
+ * @param read	@c true to read, @c false to write.
+ * @param vec	Block ranges.
+ * @param nvec	Number of block ranges, at most BD_VEC_MAX.
+ * @param vreq	Request to fill in.
+ *
+ * @return	EOK on success or an error code.
+ */
+static errno_t bd_vreq_send(bd_t *bd, bool read, bd_vec_t *vec, size_t nvec,
+    bd_vreq_t *vreq)
+{
+	bd_ipc_range_t ranges[BD_VEC_MAX];
+	size_t i;
+
+	if (nvec == 0 || nvec > BD_VEC_MAX)
+		return EINVAL;
+
+	for (i = 0; i < nvec; i++) {
+		ranges[i].ba = vec[i].ba;
+		ranges[i].cnt = vec[i].cnt;
+		ranges[i].size = vec[i].size;
+	}
+
+	vreq->ndata = 0;
+
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	vreq->req = async_send_1(exch, read ? BD_READ_BLOCKS_V :
+	    BD_WRITE_BLOCKS_V, nvec, NULL);
+	errno_t rc = async_data_write_start(exch, ranges,
+	    nvec * sizeof(bd_ipc_range_t));
+
+	for (i = 0; i < nvec && rc == EOK; i++) {
+		if (read) {
+			vreq->data[i] = async_data_read(exch, vec[i].buf,
+			    vec[i].size, NULL);
+			if (vreq->data[i] == 0)
+				rc = ENOMEM;
+			else
+				vreq->ndata++;
+		} else {
+			rc = async_data_write_start(exch, vec[i].buf,
+			    vec[i].size);
+		}
+	}
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		for (i = 0; i < vreq->ndata; i++)
+			async_forget(vreq->data[i]);
+		async_forget(vreq->req);
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Wait for the completion of a vectored request.
+ *
+ * @param vreq	Request sent by bd_vreq_send().
+ *
+ * @return	Result of the request.
+ */
+static errno_t bd_vreq_wait(bd_vreq_t *vreq)
+{
+	errno_t rc = EOK;
+	errno_t retval;
+	size_t i;
+
+	for (i = 0; i < vreq->ndata; i++) {
+		async_wait_for(vreq->data[i], &retval);
+		if (rc == EOK)
+			rc = retval;
+	}
+
+	async_wait_for(vreq->req, &retval);
+	if (retval != EOK)
+		return retval;
+
+	return rc;
+}
+
+/** Read several ranges of blocks with a single request.
+ *
+ * @param bd	Block device.
+ * @param vec	Block ranges and buffers for the data.
+ * @param nvec	Number of block ranges, at most BD_VEC_MAX.
+ *
+ * @return	EOK on success or an error code.
+ */
+errno_t bd_read_blocks_v(bd_t *bd, bd_vec_t *vec, size_t nvec)
+{
+	bd_vreq_t vreq;
+
+	errno_t rc = bd_vreq_send(bd, true, vec, nvec, &vreq);
+	if (rc != EOK)
+		return rc;
+
+	return bd_vreq_wait(&vreq);
+}
+
+/** Write several ranges of blocks with a single request.
+ *
+ * @param bd	Block device.
+ * @param vec	Block ranges and the data to write.
+ * @param nvec	Number of block ranges, at most BD_VEC_MAX.
+ *
+ * @return	EOK on success or an error code.
+ */
+errno_t bd_write_blocks_v(bd_t *bd, bd_vec_t *vec, size_t nvec)
+{
+	bd_vreq_t vreq;
+
+	errno_t rc = bd_vreq_send(bd, false, vec, nvec, &vreq);
+	if (rc != EOK)
+		return rc;
+
+	return bd_vreq_wait(&vreq);
+}
+
+/** Wait for an asynchronous request and report its completion. */
+static errno_t bd_vreq_fibril(void *arg)
+{
+	bd_vreq_t *vreq = (bd_vreq_t *) arg;
+
+	errno_t rc = bd_vreq_wait(vreq);
+	vreq->cb(vreq->arg, rc);
+	free(vreq);
+	return EOK;
+}
+
+static errno_t bd_rw_blocks_async(bd_t *bd, bool read, bd_vec_t *vec,
+    size_t nvec, bd_cb_t cb, void *arg)
+{
+	bd_vreq_t *vreq = malloc(sizeof(bd_vreq_t));
+	if (vreq == NULL)
+		return ENOMEM;
+
+	vreq->cb = cb;
+	vreq->arg = arg;
+
+	fid_t fid = fibril_create(bd_vreq_fibril, vreq);
+	if (fid == 0) {
+		free(vreq);
+		return ENOMEM;
+	}
+
+	errno_t rc = bd_vreq_send(bd, read, vec, nvec, vreq);
+	if (rc != EOK) {
+		fibril_destroy(fid);
+		free(vreq);
+		return rc;
+	}
+
+	fibril_add_ready(fid);
+	return EOK;
+}
+
+/** Start reading several ranges of blocks.
+ *
+ * Several requests can be outstanding at the same time. The buffers must not
+ * be touched until @a cb is called. Outstanding vectored requests are not
+ * ordered with respect to each other. Other requests sent afterwards are
+ * served only after them.
+ *
+ * @param bd	Block device.
+ * @param vec	Block ranges and buffers for the data. The array itself is
+ *		not needed after the function returns.
+ * @param nvec	Number of block ranges, at most BD_VEC_MAX.
+ * @param cb	Callback called from a separate fibril on completion.
+ * @param arg	Argument of @a cb.
+ *
+ * @return	EOK if the request was sent and @a cb will be called, an error
+ *		code otherwise.
+ */
+errno_t bd_read_blocks_async(bd_t *bd, bd_vec_t *vec, size_t nvec,
+    bd_cb_t cb, void *arg)
+{
+	return bd_rw_blocks_async(bd, true, vec, nvec, cb, arg);
+}
+
+/** Start writing several ranges of blocks.
+ *
+ * Several requests can be outstanding at the same time. The data is
+ * transferred to the server before the function returns. Outstanding
+ * vectored requests are not ordered with respect to each other. Other
+ * requests sent afterwards, such as bd_sync_cache(), are served only after
+ * them.
+ *
+ * @param bd	Block device.
+ * @param vec	Block ranges and the data to write.
+ * @param nvec	Number of block ranges, at most BD_VEC_MAX.
+ * @param cb	Callback called from a separate fibril on completion.
+ * @param arg	Argument of @a cb.
+ *
+ * @return	EOK if the request was sent and @a cb will be called, an error
+ *		code otherwise.
+ */
+errno_t bd_write_blocks_async(bd_t *bd, bd_vec_t *vec, size_t nvec,
+    bd_cb_t cb, void *arg)
+{
+	return bd_rw_blocks_async(bd, false, vec, nvec, cb, arg);
+}
+
 errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
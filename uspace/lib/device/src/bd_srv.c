@@ -34,6 +34,7 @@
  * @brief Block device server stub
  */
 #include <errno.h>
+#include <fibril.h>
 #include <ipc/bd.h>
 #include <macros.h>
 #include <stdlib.h>
@@ -175,6 +176,246 @@ static void bd_write_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+/** Vectored request being served */
+typedef struct {
+	bd_srv_t *srv;
+	ipc_call_t call;
+	bool read;
+	/** Ranges as received from the client */
+	bd_ipc_range_t ranges[BD_VEC_MAX];
+	size_t nranges;
+	/** Data transfers of a read request, one for each range */
+	ipc_call_t rcall[BD_VEC_MAX];
+	/** Adjacent ranges merged */
+	bd_vec_t vec[BD_VEC_MAX];
+	size_t nvec;
+	/** Data of all ranges in the order of the ranges */
+	void *buf;
+} bd_vreq_srv_t;
+
+/** Perform a vectored request and answer it.
+ *
+ * Runs in a fibril of its own so that the connection fibril can receive
+ * further requests in the meantime.
+ */
+static errno_t bd_vreq_srv_fibril(void *arg)
+{
+	bd_vreq_srv_t *vreq = (bd_vreq_srv_t *) arg;
+	bd_srv_t *srv = vreq->srv;
+	bd_ops_t *ops = srv->srvs->ops;
+	errno_t rc = EOK;
+	size_t i;
+
+	if (vreq->read && ops->read_blocks_v != NULL) {
+		rc = ops->read_blocks_v(srv, vreq->vec, vreq->nvec);
+	} else if (!vreq->read && ops->write_blocks_v != NULL) {
+		rc = ops->write_blocks_v(srv, vreq->vec, vreq->nvec);
+	} else {
+		for (i = 0; i < vreq->nvec && rc == EOK; i++) {
+			bd_vec_t *v = &vreq->vec[i];
+
+			if (vreq->read) {
+				rc = ops->read_blocks(srv, v->ba, v->cnt,
+				    v->buf, v->size);
+			} else {
+				rc = ops->write_blocks(srv, v->ba, v->cnt,
+				    v->buf, v->size);
+			}
+		}
+	}
+
+	if (vreq->read) {
+		size_t off = 0;
+
+		for (i = 0; i < vreq->nranges; i++) {
+			if (rc == EOK) {
+				async_data_read_finalize(&vreq->rcall[i],
+				    vreq->buf + off, vreq->ranges[i].size);
+			} else {
+				async_answer_0(&vreq->rcall[i], rc);
+			}
+			off += vreq->ranges[i].size;
+		}
+	}
+
+	async_answer_0(&vreq->call, rc);
+
+	free(vreq->buf);
+	free(vreq);
+
+	fibril_mutex_lock(&srv->lock);
+	srv->pending--;
+	fibril_condvar_broadcast(&srv->cv);
+	fibril_mutex_unlock(&srv->lock);
+
+	return EOK;
+}
+
+/** Wait for the vectored requests of a client still in progress.
+ *
+ * Vectored requests are served by fibrils of their own. Other requests are
+ * served only after them, so that they are ordered after the vectored
+ * requests received before.
+ */
+static void bd_srv_wait_pending(bd_srv_t *srv)
+{
+	fibril_mutex_lock(&srv->lock);
+	while (srv->pending > 0)
+		fibril_condvar_wait(&srv->cv, &srv->lock);
+	fibril_mutex_unlock(&srv->lock);
+}
+
+/** Receive a vectored request.
+ *
+ * All data transfers belonging to the request are received here. The data of
+ * all ranges is kept in one buffer so that ranges adjacent on the device can
+ * be served as a single range.
+ *
+ * Vectored requests received one after another may be served concurrently,
+ * the client orders them by waiting for the completion.
+ */
+static void bd_rw_blocks_v_srv(bd_srv_t *srv, ipc_call_t *call, bool read)
+{
+	bd_vreq_srv_t *vreq;
+	ipc_call_t wcall;
+	size_t block_size;
+	size_t nranges;
+	size_t total;
+	size_t size;
+	size_t off;
+	size_t i;
+
+	nranges = ipc_get_arg1(call);
+	if (nranges == 0 || nranges > BD_VEC_MAX) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if ((read && srv->srvs->ops->read_blocks == NULL &&
+	    srv->srvs->ops->read_blocks_v == NULL) ||
+	    (!read && srv->srvs->ops->write_blocks == NULL &&
+	    srv->srvs->ops->write_blocks_v == NULL) ||
+	    srv->srvs->ops->get_block_size == NULL) {
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
+
+	errno_t rc = srv->srvs->ops->get_block_size(srv, &block_size);
+	if (rc != EOK || block_size == 0) {
+		async_answer_0(call, rc != EOK ? rc : EIO);
+		return;
+	}
+
+	vreq = calloc(1, sizeof(bd_vreq_srv_t));
+	if (vreq == NULL) {
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	vreq->srv = srv;
+	vreq->call = *call;
+	vreq->read = read;
+	vreq->nranges = nranges;
+
+	if (!async_data_write_receive(&wcall, &size) ||
+	    size != nranges * sizeof(bd_ipc_range_t)) {
+		async_answer_0(&wcall, EINVAL);
+		async_answer_0(call, EINVAL);
+		free(vreq);
+		return;
+	}
+
+	(void) async_data_write_finalize(&wcall, vreq->ranges, size);
+
+	/*
+	 * The size of each range must match its blocks, so that the offsets
+	 * of merged ranges line up with the block addresses. The total size
+	 * is bounded by the limit of a single data transfer.
+	 */
+	total = 0;
+	for (i = 0; i < nranges; i++) {
+		bd_ipc_range_t *r = &vreq->ranges[i];
+
+		if (r->size > DATA_XFER_PINNED_LIMIT - total ||
+		    r->cnt > r->size / block_size ||
+		    r->cnt * block_size != r->size) {
+			async_answer_0(call, EINVAL);
+			free(vreq);
+			return;
+		}
+
+		total += r->size;
+	}
+
+	vreq->buf = malloc(total);
+	if (vreq->buf == NULL) {
+		async_answer_0(call, ENOMEM);
+		free(vreq);
+		return;
+	}
+
+	/* Receive the data transfers and merge adjacent ranges */
+	off = 0;
+	for (i = 0; i < nranges; i++) {
+		bd_ipc_range_t *r = &vreq->ranges[i];
+		bool ok;
+
+		if (read) {
+			ok = async_data_read_receive(&vreq->rcall[i], &size) &&
+			    size == r->size;
+		} else {
+			ok = async_data_write_receive(&wcall, &size) &&
+			    size == r->size;
+			if (ok) {
+				ok = async_data_write_finalize(&wcall,
+				    vreq->buf + off, size) == EOK;
+			} else {
+				async_answer_0(&wcall, EINVAL);
+			}
+		}
+
+		if (!ok) {
+			if (read) {
+				async_answer_0(&vreq->rcall[i], EINVAL);
+				while (i > 0)
+					async_answer_0(&vreq->rcall[--i], EINVAL);
+			}
+			async_answer_0(call, EINVAL);
+			free(vreq->buf);
+			free(vreq);
+			return;
+		}
+
+		bd_vec_t *last = vreq->nvec > 0 ? &vreq->vec[vreq->nvec - 1] :
+		    NULL;
+		if (last != NULL && last->ba + last->cnt == r->ba) {
+			last->cnt += r->cnt;
+			last->size += r->size;
+		} else {
+			bd_vec_t *v = &vreq->vec[vreq->nvec++];
+			v->ba = r->ba;
+			v->cnt = r->cnt;
+			v->buf = vreq->buf + off;
+			v->size = r->size;
+		}
+
+		off += r->size;
+	}
+
+	fibril_mutex_lock(&srv->lock);
+	srv->pending++;
+	fibril_mutex_unlock(&srv->lock);
+
+	fid_t fid = fibril_create(bd_vreq_srv_fibril, vreq);
+	if (fid == 0) {
+		/* Serve the request synchronously */
+		(void) bd_vreq_srv_fibril(vreq);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
 static void bd_get_block_size_srv(bd_srv_t *srv, ipc_call_t *call)
 {
 	errno_t rc;
@@ -212,6 +453,8 @@ static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 		return NULL;
 
 	srv->srvs = srvs;
+	fibril_mutex_initialize(&srv->lock);
+	fibril_condvar_initialize(&srv->cv);
 	return srv;
 }
 
@@ -256,15 +499,19 @@ errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
 
 		switch (method) {
 		case BD_READ_BLOCKS:
+			bd_srv_wait_pending(srv);
 			bd_read_blocks_srv(srv, &call);
 			break;
 		case BD_READ_TOC:
+			bd_srv_wait_pending(srv);
 			bd_read_toc_srv(srv, &call);
 			break;
 		case BD_SYNC_CACHE:
+			bd_srv_wait_pending(srv);
 			bd_sync_cache_srv(srv, &call);
 			break;
 		case BD_WRITE_BLOCKS:
+			bd_srv_wait_pending(srv);
 			bd_write_blocks_srv(srv, &call);
 			break;
 		case BD_GET_BLOCK_SIZE:
@@ -273,11 +520,20 @@ errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
 		case BD_GET_NUM_BLOCKS:
 			bd_get_num_blocks_srv(srv, &call);
 			break;
+		case BD_READ_BLOCKS_V:
+			bd_rw_blocks_v_srv(srv, &call, true);
+			break;
+		case BD_WRITE_BLOCKS_V:
+			bd_rw_blocks_v_srv(srv, &call, false);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
 	}
 
+	/* Wait for the vectored requests still in progress */
+	bd_srv_wait_pending(srv);
+
 	rc = srvs->ops->close(srv);
 	free(srv);
 
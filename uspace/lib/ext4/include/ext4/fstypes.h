@@ -35,6 +35,7 @@
 #define LIBEXT4_FSTYPES_H_
 
 #include <adt/list.h>
+#include <fibril_synch.h>
 #include <libfs.h>
 #include <loc.h>
 #include "ext4/types.h"
@@ -58,6 +59,11 @@ typedef struct ext4_node {
 	fs_node_t *fs_node;
 	ht_link_t link;
 	unsigned int references;
+	/**
+	 * Serializes modifications of the node's contents and size with
+	 * reads and writes of the node.
+	 */
+	fibril_rwlock_t contents_lock;
 } ext4_node_t;
 
 #define EXT4_NODE(node) \
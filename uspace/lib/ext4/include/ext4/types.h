@@ -35,7 +35,9 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -211,7 +213,9 @@ typedef struct ext4_superblock {
 #define EXT4_FEATURE_INCOMPAT_EA_INODE     0x0400  /* EA in inode */
 #define EXT4_FEATURE_INCOMPAT_DIRDATA      0x1000  /* data in dirent */
 
-#define EXT4_FEATURE_COMPAT_SUPP  (EXT4_FEATURE_COMPAT_DIR_INDEX)
+#define EXT4_FEATURE_COMPAT_SUPP \
+	(EXT4_FEATURE_COMPAT_DIR_INDEX | \
+	EXT4_FEATURE_COMPAT_HAS_JOURNAL)
 
 #define EXT4_FEATURE_INCOMPAT_SUPP \
 	(EXT4_FEATURE_INCOMPAT_FILETYPE | \
@@ -227,11 +231,30 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+typedef struct ext4_journal ext4_journal_t;
+
+/** Blocks reserved for future allocations of one inode */
+typedef struct ext4_prealloc {
+	link_t link;            /* Link to ext4_filesystem_t.prealloc_list */
+	uint32_t index;         /* Index number of the owner inode */
+	uint32_t start;         /* First reserved block */
+	uint32_t count;         /* Number of reserved blocks left */
+	uint32_t size;          /* Size of the last reservation */
+} ext4_prealloc_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+
+	/** Preallocation windows, most recently used first */
+	list_t prealloc_list;
+	unsigned prealloc_count;
+	fibril_mutex_t prealloc_lock;
+
+	/** Metadata journal or NULL if the volume has none */
+	ext4_journal_t *journal;
 } ext4_filesystem_t;
 
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
@@ -557,6 +580,102 @@ typedef struct ext4_hash_info {
 	const uint32_t *seed;
 } ext4_hash_info_t;
 
+/*
+ * Journal (JBD2) on-disk structures, all fields are big endian
+ */
+#define EXT4_JOURNAL_MAGIC  0xC03B3998
+
+#define EXT4_JOURNAL_DESCRIPTOR_BLOCK  1
+#define EXT4_JOURNAL_COMMIT_BLOCK      2
+#define EXT4_JOURNAL_SUPERBLOCK_V1     3
+#define EXT4_JOURNAL_SUPERBLOCK_V2     4
+#define EXT4_JOURNAL_REVOKE_BLOCK      5
+
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE        0x0001
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT         0x0002
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT  0x0004
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2       0x0008
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3       0x0010
+
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_SUPP \
+	(EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)
+
+#define EXT4_JOURNAL_FLAG_ESCAPE     0x0001  /* Block had the magic number */
+#define EXT4_JOURNAL_FLAG_SAME_UUID  0x0002  /* UUID is omitted */
+#define EXT4_JOURNAL_FLAG_DELETED    0x0004
+#define EXT4_JOURNAL_FLAG_LAST_TAG   0x0008  /* Last tag in the descriptor */
+
+typedef struct ext4_journal_header {
+	uint32_t magic;
+	uint32_t blocktype;
+	uint32_t sequence;
+} __attribute__((packed)) ext4_journal_header_t;
+
+typedef struct ext4_journal_superblock {
+	ext4_journal_header_t header;
+
+	/* Static information describing the journal */
+	uint32_t block_size;            /* Journal device block size */
+	uint32_t max_len;               /* Total blocks in journal file */
+	uint32_t first;                 /* First block of log information */
+
+	/* Dynamic information describing the current state of the log */
+	uint32_t sequence;              /* First commit ID expected in log */
+	uint32_t start;                 /* Block number of start of log */
+	uint32_t error;                 /* Error value, as set by abort */
+
+	/* Remaining fields are only valid in a version 2 superblock */
+	uint32_t features_compatible;
+	uint32_t features_incompatible;
+	uint32_t features_read_only;
+	uint8_t uuid[16];               /* 128-bit uuid for journal */
+	uint32_t nr_users;              /* Nr of filesystems sharing log */
+	uint32_t dyn_super;             /* Blocknr of dynamic superblock copy */
+	uint32_t max_transaction;       /* Limit of journal blocks per trans */
+	uint32_t max_trans_data;        /* Limit of data blocks per trans */
+	uint8_t checksum_type;
+	uint8_t padding2[3];
+	uint32_t num_fc_blocks;         /* Number of fast commit blocks */
+	uint32_t padding[41];
+	uint32_t checksum;              /* Checksum of the superblock */
+	uint8_t users[16 * 48];         /* IDs of all filesystems sharing log */
+} __attribute__((packed)) ext4_journal_superblock_t;
+
+/** Tag describing one block in a descriptor block (without CSUM_V3) */
+typedef struct ext4_journal_block_tag {
+	uint32_t blocknr;
+	uint16_t checksum;
+	uint16_t flags;
+	uint32_t blocknr_high;          /* Only with INCOMPAT_64BIT */
+} __attribute__((packed)) ext4_journal_block_tag_t;
+
+/** Tag describing one block in a descriptor block (with CSUM_V3) */
+typedef struct ext4_journal_block_tag3 {
+	uint32_t blocknr;
+	uint32_t flags;
+	uint32_t blocknr_high;
+	uint32_t checksum;
+} __attribute__((packed)) ext4_journal_block_tag3_t;
+
+typedef struct ext4_journal_commit_header {
+	ext4_journal_header_t header;
+	uint8_t chksum_type;
+	uint8_t chksum_size;
+	uint8_t padding[2];
+	uint32_t chksum[8];
+	uint64_t commit_sec;
+	uint32_t commit_nsec;
+} __attribute__((packed)) ext4_journal_commit_header_t;
+
+typedef struct ext4_journal_revoke_header {
+	ext4_journal_header_t header;
+	uint32_t count;                 /* Bytes used in the block */
+} __attribute__((packed)) ext4_journal_revoke_header_t;
+
 #endif
 
 /**
@@ -35,14 +35,19 @@
  * @brief Physical block allocator.
  */
 
+#include <assert.h>
 #include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
@@ -74,15 +79,19 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	uint32_t bitmap_block_addr =
 	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
 	block_t *bitmap_block;
-	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr, 0);
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_META);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
 	}
 
+	/* The block may be reused for anything, forget its logged contents */
+	ext4_journal_revoke(fs, block_addr, 1);
+
 	/* Modify bitmap */
 	ext4_bitmap_free_bit(bitmap_block->data, index_in_group);
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -119,10 +128,30 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
+/** Number of blocks reserved by the first preallocation of an inode */
+#define EXT4_PREALLOC_MIN  8
+
+/** Maximal number of blocks reserved by one preallocation */
+#define EXT4_PREALLOC_MAX  256
+
+/** Maximal number of inodes with a preallocation window */
+#define EXT4_PREALLOC_WINDOWS  32
+
+/** Return continuous set of blocks within one block group to free space.
+ *
+ * Only the bitmap and the free blocks counters are updated, the blocks
+ * are not accounted to any inode.
+ *
+ * @param fs    Filesystem
+ * @param first First block to release
+ * @param count Number of blocks to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_release_blocks(ext4_filesystem_t *fs,
     uint32_t first, uint32_t count)
 {
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	/* Compute indexes */
@@ -147,15 +176,19 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
 
 	block_t *bitmap_block;
-	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr, 0);
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_META);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
 	}
 
+	/* The blocks may be reused for anything, forget their logged contents */
+	ext4_journal_revoke(fs, first, count);
+
 	/* Modify bitmap */
 	ext4_bitmap_free_bits(bitmap_block->data, index_in_group_first, count);
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(fs, bitmap_block);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -165,21 +198,12 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 		return rc;
 	}
 
-	uint32_t block_size = ext4_superblock_get_block_size(sb);
-
 	/* Update superblock free blocks count */
 	uint32_t sb_free_blocks =
 	    ext4_superblock_get_free_blocks_count(sb);
 	sb_free_blocks += count;
 	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
 
-	/* Update inode blocks count */
-	uint64_t ino_blocks =
-	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
-	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
-	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
-	inode_ref->dirty = true;
-
 	/* Update block group free blocks count */
 	uint32_t free_blocks =
 	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
@@ -192,6 +216,37 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+/** Update number of blocks accounted to inode.
+ *
+ * @param inode_ref Inode to update
+ * @param count     Number of filesystem blocks to add (negative to subtract)
+ *
+ */
+static void ext4_balloc_inode_add_blocks(ext4_inode_ref_t *inode_ref,
+    int32_t count)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Inode blocks are counted in different block size! */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += (int64_t) count * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+}
+
+static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
+    uint32_t first, uint32_t count)
+{
+	errno_t rc = ext4_balloc_release_blocks(inode_ref->fs, first, count);
+	if (rc != EOK)
+		return rc;
+
+	ext4_balloc_inode_add_blocks(inode_ref, -(int32_t) count);
+	return EOK;
+}
+
 /** Free continuous set of blocks.
  *
  * @param inode_ref Inode, where the blocks are allocated
@@ -335,15 +390,17 @@ static errno_t ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-/** Data block allocation algorithm.
+/** Allocate single data block near to goal.
  *
  * @param inode_ref Inode to allocate block for
+ * @param goal      Preferred block address
  * @param fblock    Allocated block address
  *
  * @return Error code
  *
  */
-errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
+static errno_t ext4_balloc_alloc_block_goal(ext4_inode_ref_t *inode_ref,
+    uint32_t goal, uint32_t *fblock)
 {
 	uint32_t allocated_block = 0;
 
@@ -351,13 +408,8 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	block_t *bitmap_block;
 	uint32_t rel_block_idx = 0;
 	uint32_t free_blocks;
-	uint32_t goal;
 	uint32_t block_size;
-
-	/* Find GOAL */
-	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
-	if (rc != EOK)
-		return rc;
+	errno_t rc;
 
 	ext4_superblock_t *sb = inode_ref->fs->superblock;
 
@@ -395,7 +447,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
 
 	rc = block_get(&bitmap_block, inode_ref->fs->device,
-	    bitmap_block_addr, BLOCK_FLAGS_NONE);
+	    bitmap_block_addr, BLOCK_FLAGS_META);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
@@ -404,7 +456,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	/* Check if goal is free */
 	if (ext4_bitmap_is_free_bit(bitmap_block->data, index_in_group)) {
 		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
-		bitmap_block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, bitmap_block);
 		rc = block_put(bitmap_block);
 		if (rc != EOK) {
 			ext4_filesystem_put_block_group_ref(bg_ref);
@@ -430,7 +482,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	    ++tmp_idx) {
 		if (ext4_bitmap_is_free_bit(bitmap_block->data, tmp_idx)) {
 			ext4_bitmap_set_bit(bitmap_block->data, tmp_idx);
-			bitmap_block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, bitmap_block);
 			rc = block_put(bitmap_block);
 			if (rc != EOK)
 				return rc;
@@ -447,7 +499,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	rc = ext4_bitmap_find_free_byte_and_set_bit(bitmap_block->data,
 	    index_in_group, &rel_block_idx, blocks_in_group);
 	if (rc == EOK) {
-		bitmap_block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, bitmap_block);
 		rc = block_put(bitmap_block);
 		if (rc != EOK)
 			return rc;
@@ -463,7 +515,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	rc = ext4_bitmap_find_free_bit_and_set(bitmap_block->data,
 	    index_in_group, &rel_block_idx, blocks_in_group);
 	if (rc == EOK) {
-		bitmap_block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, bitmap_block);
 		rc = block_put(bitmap_block);
 		if (rc != EOK)
 			return rc;
@@ -512,7 +564,7 @@ goal_failed:
 		    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
 
 		rc = block_get(&bitmap_block, inode_ref->fs->device,
-		    bitmap_block_addr, 0);
+		    bitmap_block_addr, BLOCK_FLAGS_META);
 		if (rc != EOK) {
 			ext4_filesystem_put_block_group_ref(bg_ref);
 			return rc;
@@ -535,7 +587,7 @@ goal_failed:
 		rc = ext4_bitmap_find_free_byte_and_set_bit(bitmap_block->data,
 		    index_in_group, &rel_block_idx, blocks_in_group);
 		if (rc == EOK) {
-			bitmap_block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, bitmap_block);
 			rc = block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
@@ -553,7 +605,7 @@ goal_failed:
 		rc = ext4_bitmap_find_free_bit_and_set(bitmap_block->data,
 		    index_in_group, &rel_block_idx, blocks_in_group);
 		if (rc == EOK) {
-			bitmap_block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, bitmap_block);
 			rc = block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
@@ -614,6 +666,339 @@ success:
 	return rc;
 }
 
+/** Allocate continuous set of data blocks.
+ *
+ * The run starts at goal if it is free, otherwise the first run of the
+ * requested length is taken from the goal's block group or the groups
+ * following it. If there is no such run in a group, the longest shorter
+ * one is used, so the result may be shorter than requested.
+ *
+ * The blocks are not accounted to any inode.
+ *
+ * @param fs    Filesystem
+ * @param goal  Preferred address of the first block
+ * @param want  Requested number of blocks
+ * @param start Output value - address of the first allocated block
+ * @param len   Output value - number of allocated blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_alloc_run(ext4_filesystem_t *fs, uint32_t goal,
+    uint32_t want, uint32_t *start, uint32_t *len)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+
+	uint32_t bgid = ext4_filesystem_blockaddr2group(sb, goal);
+	uint32_t goal_index =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+
+	for (uint32_t count = block_group_count; count > 0; count--) {
+		ext4_block_group_ref_t *bg_ref;
+		errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid,
+		    &bg_ref);
+		if (rc != EOK)
+			return rc;
+
+		uint32_t free_blocks =
+		    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+		if (free_blocks == 0)
+			goto next_group;
+
+		/* Compute indexes */
+		uint32_t first_in_group =
+		    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
+		uint32_t first_index =
+		    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+		uint32_t blocks_in_group =
+		    ext4_superblock_get_blocks_in_group(sb, bgid);
+		uint32_t from = max(goal_index, first_index);
+
+		/* Load block with bitmap */
+		uint32_t bitmap_block_addr =
+		    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+		block_t *bitmap_block;
+		rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+		    BLOCK_FLAGS_META);
+		if (rc != EOK) {
+			ext4_filesystem_put_block_group_ref(bg_ref);
+			return rc;
+		}
+
+		/* Prefer continuing right at the goal */
+		uint32_t run_index = from;
+		uint32_t run_len = 0;
+		if (from < blocks_in_group) {
+			run_len = ext4_bitmap_free_run_length(bitmap_block->data,
+			    from, blocks_in_group, want);
+		}
+
+		rc = EOK;
+		if (run_len == 0) {
+			rc = ext4_bitmap_find_free_run(bitmap_block->data, from,
+			    blocks_in_group, want, &run_index, &run_len);
+			if ((rc == ENOSPC) && (from > first_index)) {
+				rc = ext4_bitmap_find_free_run(bitmap_block->data,
+				    first_index, from, want, &run_index, &run_len);
+			}
+		}
+
+		if (rc == EOK) {
+			ext4_bitmap_set_bits(bitmap_block->data, run_index,
+			    run_len);
+			ext4_journal_dirty(fs, bitmap_block);
+		}
+
+		errno_t rc2 = block_put(bitmap_block);
+		if (rc2 != EOK) {
+			ext4_filesystem_put_block_group_ref(bg_ref);
+			return rc2;
+		}
+
+		if (rc == EOK) {
+			/* Update superblock free blocks count */
+			uint32_t sb_free_blocks =
+			    ext4_superblock_get_free_blocks_count(sb);
+			sb_free_blocks -= run_len;
+			ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+
+			/* Update block group free blocks count */
+			free_blocks -= run_len;
+			ext4_block_group_set_free_blocks_count(bg_ref->block_group,
+			    sb, free_blocks);
+			bg_ref->dirty = true;
+
+			*start = ext4_filesystem_index_in_group2blockaddr(sb,
+			    run_index, bgid);
+			*len = run_len;
+
+			return ext4_filesystem_put_block_group_ref(bg_ref);
+		}
+
+	next_group:
+		rc = ext4_filesystem_put_block_group_ref(bg_ref);
+		if (rc != EOK)
+			return rc;
+
+		/* Goto next group */
+		bgid = (bgid + 1) % block_group_count;
+		goal_index = 0;
+	}
+
+	return ENOSPC;
+}
+
+/** Find preallocation window of inode.
+ *
+ * Must be called with prealloc_lock held.
+ *
+ * @param fs    Filesystem
+ * @param index Index number of the inode
+ *
+ * @return Preallocation window or NULL if the inode has none
+ *
+ */
+static ext4_prealloc_t *ext4_balloc_prealloc_find(ext4_filesystem_t *fs,
+    uint32_t index)
+{
+	list_foreach(fs->prealloc_list, link, ext4_prealloc_t, pa) {
+		if (pa->index == index)
+			return pa;
+	}
+
+	return NULL;
+}
+
+/** Take block from preallocation window of inode.
+ *
+ * Must be called with prealloc_lock held.
+ *
+ * @param inode_ref Inode to allocate block for
+ * @param pa        Preallocation window of the inode
+ * @param fblock    Allocated block address
+ *
+ */
+static void ext4_balloc_prealloc_take(ext4_inode_ref_t *inode_ref,
+    ext4_prealloc_t *pa, uint32_t *fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+
+	assert(pa->count > 0);
+
+	*fblock = pa->start;
+	pa->start++;
+	pa->count--;
+
+	/* Keep the list in most recently used order */
+	list_remove(&pa->link);
+	list_prepend(&pa->link, &fs->prealloc_list);
+
+	ext4_balloc_inode_add_blocks(inode_ref, 1);
+}
+
+/** Reserve new preallocation window for inode.
+ *
+ * The first block of the new window is allocated to the inode right away.
+ * Each refill of the same inode doubles the size of the window, so that
+ * files written sequentially end up in few large extents. When there are
+ * too many windows, the least recently used one is returned to free space.
+ *
+ * Must be called with prealloc_lock held.
+ *
+ * @param inode_ref Inode to allocate block for
+ * @param pa        Current preallocation window of the inode or NULL
+ * @param goal      Preferred block address
+ * @param fblock    Allocated block address
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_prealloc_refill(ext4_inode_ref_t *inode_ref,
+    ext4_prealloc_t *pa, uint32_t goal, uint32_t *fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	errno_t rc;
+
+	if (pa == NULL) {
+		if (fs->prealloc_count >= EXT4_PREALLOC_WINDOWS) {
+			/* Recycle the least recently used window */
+			pa = list_get_instance(list_last(&fs->prealloc_list),
+			    ext4_prealloc_t, link);
+			if (pa->count > 0) {
+				rc = ext4_balloc_release_blocks(fs, pa->start,
+				    pa->count);
+				if (rc != EOK)
+					return rc;
+			}
+
+			list_remove(&pa->link);
+			fs->prealloc_count--;
+		} else {
+			pa = malloc(sizeof(ext4_prealloc_t));
+			if (pa == NULL)
+				return ENOMEM;
+		}
+
+		link_initialize(&pa->link);
+		pa->index = inode_ref->index;
+		pa->size = EXT4_PREALLOC_MIN;
+		list_prepend(&pa->link, &fs->prealloc_list);
+		fs->prealloc_count++;
+	} else {
+		pa->size = min(2 * pa->size, EXT4_PREALLOC_MAX);
+		list_remove(&pa->link);
+		list_prepend(&pa->link, &fs->prealloc_list);
+	}
+
+	uint32_t start;
+	uint32_t len;
+	rc = ext4_balloc_alloc_run(fs, goal, pa->size, &start, &len);
+	if (rc != EOK) {
+		pa->count = 0;
+		return rc;
+	}
+
+	pa->start = start;
+	pa->count = len;
+
+	ext4_balloc_prealloc_take(inode_ref, pa, fblock);
+	return EOK;
+}
+
+/** Return preallocation window to free space and destroy it.
+ *
+ * Must be called with prealloc_lock held.
+ *
+ * @param fs Filesystem
+ * @param pa Preallocation window
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_prealloc_destroy(ext4_filesystem_t *fs,
+    ext4_prealloc_t *pa)
+{
+	if (pa->count > 0) {
+		errno_t rc = ext4_balloc_release_blocks(fs, pa->start,
+		    pa->count);
+		if (rc != EOK)
+			return rc;
+	}
+
+	list_remove(&pa->link);
+	fs->prealloc_count--;
+	free(pa);
+
+	return EOK;
+}
+
+/** Data block allocation algorithm.
+ *
+ * Blocks of regular files are allocated from a per-inode preallocation
+ * window of continuous blocks reserved in advance, other blocks are
+ * allocated one by one as near to the goal as possible.
+ *
+ * @param inode_ref Inode to allocate block for
+ * @param fblock    Allocated block address
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	bool prealloc = ext4_inode_is_type(fs->superblock, inode_ref->inode,
+	    EXT4_INODE_MODE_FILE);
+
+	if (prealloc) {
+		fibril_mutex_lock(&fs->prealloc_lock);
+
+		ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs,
+		    inode_ref->index);
+		if ((pa != NULL) && (pa->count > 0)) {
+			ext4_balloc_prealloc_take(inode_ref, pa, fblock);
+			fibril_mutex_unlock(&fs->prealloc_lock);
+			return EOK;
+		}
+
+		fibril_mutex_unlock(&fs->prealloc_lock);
+	}
+
+	/* Find GOAL */
+	uint32_t goal;
+	errno_t rc = ext4_balloc_find_goal(inode_ref, &goal);
+	if (rc != EOK)
+		return rc;
+
+	if (prealloc) {
+		fibril_mutex_lock(&fs->prealloc_lock);
+
+		ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs,
+		    inode_ref->index);
+		if ((pa != NULL) && (pa->count > 0)) {
+			/* Refilled by a concurrent request meanwhile */
+			ext4_balloc_prealloc_take(inode_ref, pa, fblock);
+			rc = EOK;
+		} else {
+			rc = ext4_balloc_prealloc_refill(inode_ref, pa, goal,
+			    fblock);
+		}
+
+		fibril_mutex_unlock(&fs->prealloc_lock);
+
+		if (rc != ENOSPC)
+			return rc;
+
+		/* Free space may be held in windows of other inodes */
+		rc = ext4_balloc_discard_all_prealloc(fs);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return ext4_balloc_alloc_block_goal(inode_ref, goal, fblock);
+}
+
 /** Try to allocate concrete block.
  *
  * @param inode_ref Inode to allocate block for
@@ -631,6 +1016,18 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
+	/* Block reserved for this inode continues its preallocation window */
+	fibril_mutex_lock(&fs->prealloc_lock);
+	ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs, inode_ref->index);
+	if ((pa != NULL) && (pa->count > 0) && (pa->start == fblock)) {
+		uint32_t taken;
+		ext4_balloc_prealloc_take(inode_ref, pa, &taken);
+		fibril_mutex_unlock(&fs->prealloc_lock);
+		*free = true;
+		return EOK;
+	}
+	fibril_mutex_unlock(&fs->prealloc_lock);
+
 	/* Compute indexes */
 	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, fblock);
 	uint32_t index_in_group =
@@ -646,7 +1043,8 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	uint32_t bitmap_block_addr =
 	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
 	block_t *bitmap_block;
-	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr, 0);
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_META);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
@@ -658,7 +1056,7 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	/* Allocate block if possible */
 	if (*free) {
 		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
-		bitmap_block->dirty = true;
+		ext4_journal_dirty(fs, bitmap_block);
 	}
 
 	/* Release block with bitmap */
@@ -699,6 +1097,59 @@ terminate:
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+/** Return unused preallocated blocks of inode to free space.
+ *
+ * Called when the file is closed, truncated or deleted.
+ *
+ * @param fs    Filesystem
+ * @param index Index number of the inode
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_prealloc(ext4_filesystem_t *fs, uint32_t index)
+{
+	errno_t rc = EOK;
+
+	ext4_journal_start(fs);
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs, index);
+	if (pa != NULL)
+		rc = ext4_balloc_prealloc_destroy(fs, pa);
+
+	fibril_mutex_unlock(&fs->prealloc_lock);
+	ext4_journal_stop(fs);
+	return rc;
+}
+
+/** Return all unused preallocated blocks to free space.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_all_prealloc(ext4_filesystem_t *fs)
+{
+	errno_t rc = EOK;
+
+	ext4_journal_start(fs);
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	while (!list_empty(&fs->prealloc_list)) {
+		ext4_prealloc_t *pa = list_get_instance(
+		    list_first(&fs->prealloc_list), ext4_prealloc_t, link);
+		rc = ext4_balloc_prealloc_destroy(fs, pa);
+		if (rc != EOK)
+			break;
+	}
+
+	fibril_mutex_unlock(&fs->prealloc_lock);
+	ext4_journal_stop(fs);
+	return rc;
+}
+
 /**
  * @}
  */
@@ -134,6 +134,42 @@ void ext4_bitmap_set_bit(uint8_t *bitmap, uint32_t index)
 	*target |= 1 << bit_index;
 }
 
+/** Set continuous set of bits (set to 1).
+ *
+ * Index and count must be checked by caller, if they aren't out of bounds.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of first bit to set
+ * @param count  Number of bits to be set
+ *
+ */
+void ext4_bitmap_set_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
+{
+	uint32_t idx = index;
+	uint32_t remaining = count;
+
+	/* Align index to multiple of 8 */
+	while (((idx % 8) != 0) && (remaining > 0)) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+
+	/* Set the whole bytes */
+	while (remaining >= 8) {
+		bitmap[idx / 8] = 0xff;
+		idx += 8;
+		remaining -= 8;
+	}
+
+	/* Set remaining bits */
+	while (remaining != 0) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+}
+
 /** Check if requested bit is free.
  *
  * @param bitmap Pointer to bitmap
@@ -264,6 +300,95 @@ errno_t ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
 	return ENOSPC;
 }
 
+/** Measure length of a run of free bits.
+ *
+ * @param bitmap  Pointer to bitmap
+ * @param index   Index of the first bit of the run
+ * @param max     Upper bound (exclusive) of the run
+ * @param max_len Maximum length to measure
+ *
+ * @return Number of consecutive free bits starting at index
+ *
+ */
+uint32_t ext4_bitmap_free_run_length(uint8_t *bitmap, uint32_t index,
+    uint32_t max, uint32_t max_len)
+{
+	uint32_t idx = index;
+
+	while ((idx < max) && (idx - index < max_len)) {
+		/* Skip whole free bytes */
+		if (((idx % 8) == 0) && (max - idx >= 8) &&
+		    (idx - index + 8 <= max_len) && (bitmap[idx / 8] == 0)) {
+			idx += 8;
+			continue;
+		}
+
+		if (!ext4_bitmap_is_free_bit(bitmap, idx))
+			break;
+
+		idx++;
+	}
+
+	return idx - index;
+}
+
+/** Find a run of free bits.
+ *
+ * Looks for the first run of at least want free bits starting at or after
+ * start. If there is no such run, the longest shorter one is returned.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param start  Index of bit to start searching from
+ * @param max    Upper bound (exclusive) of the search
+ * @param want   Requested length of the run
+ * @param index  Output value - index of the first bit of the run
+ * @param len    Output value - length of the run
+ *
+ * @return Error code, ENOSPC if there is no free bit
+ *
+ */
+errno_t ext4_bitmap_find_free_run(uint8_t *bitmap, uint32_t start,
+    uint32_t max, uint32_t want, uint32_t *index, uint32_t *len)
+{
+	uint32_t best_index = 0;
+	uint32_t best_len = 0;
+	uint32_t idx = start;
+
+	while (idx < max) {
+		/* Skip whole used bytes */
+		if (((idx % 8) == 0) && (bitmap[idx / 8] == 0xff)) {
+			idx += 8;
+			continue;
+		}
+
+		if (!ext4_bitmap_is_free_bit(bitmap, idx)) {
+			idx++;
+			continue;
+		}
+
+		uint32_t run = ext4_bitmap_free_run_length(bitmap, idx, max, want);
+		if (run >= want) {
+			*index = idx;
+			*len = run;
+			return EOK;
+		}
+
+		if (run > best_len) {
+			best_index = idx;
+			best_len = run;
+		}
+
+		idx += run;
+	}
+
+	if (best_len == 0)
+		return ENOSPC;
+
+	*index = best_index;
+	*len = best_len;
+	return EOK;
+}
+
 /**
  * @}
  */
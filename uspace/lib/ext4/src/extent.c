@@ -41,6 +41,7 @@
 #include "ext4/balloc.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Get logical number of the block covered by extent.
@@ -677,7 +678,7 @@ errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
 	}
 
 	ext4_extent_header_set_entries_count(path_ptr->header, entries);
-	path_ptr->block->dirty = true;
+	ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 	/* If leaf node is empty, parent entry must be modified */
 	bool remove_parent_record = false;
@@ -716,7 +717,7 @@ errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
 		}
 
 		ext4_extent_header_set_entries_count(path_ptr->header, entries);
-		path_ptr->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 		/* Free the node if it is empty */
 		if ((entries == 0) && (path_ptr != path)) {
@@ -828,7 +829,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 			ext4_extent_header_set_depth(path_ptr->header, path_ptr->depth);
 			ext4_extent_header_set_generation(path_ptr->header, 0);
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			/* Jump to the preceeding item */
 			path_ptr--;
@@ -844,7 +845,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 			}
 
 			ext4_extent_header_set_entries_count(path_ptr->header, entries + 1);
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			/* No more splitting needed */
 			return EOK;
@@ -914,7 +915,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		ext4_extent_header_set_entries_count(old_root->header, entries + 1);
 		ext4_extent_header_set_max_entries_count(old_root->header, limit);
 
-		old_root->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, old_root->block);
 
 		/* Re-initialize new root metadata */
 		new_root->depth = root_depth + 1;
@@ -930,7 +931,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		ext4_extent_index_set_first_block(new_root->index, 0);
 		ext4_extent_index_set_leaf(new_root->index, new_fblock);
 
-		new_root->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, new_root->block);
 	} else {
 		if (path->depth) {
 			path->index = EXT4_EXTENT_FIRST_INDEX(path->header) + entries;
@@ -942,7 +943,7 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 		}
 
 		ext4_extent_header_set_entries_count(path->header, entries + 1);
-		path->block->dirty = true;
+		ext4_journal_dirty(inode_ref->fs, path->block);
 	}
 
 	return EOK;
@@ -1016,7 +1017,7 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 				inode_ref->dirty = true;
 			}
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			goto finish;
 		} else {
@@ -1044,7 +1045,7 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 				inode_ref->dirty = true;
 			}
 
-			path_ptr->block->dirty = true;
+			ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 			goto finish;
 		}
@@ -1080,7 +1081,7 @@ append_extent:
 		inode_ref->dirty = true;
 	}
 
-	path_ptr->block->dirty = true;
+	ext4_journal_dirty(inode_ref->fs, path_ptr->block);
 
 finish:
 	rc2 = EOK;
@@ -53,6 +53,7 @@
 #include "ext4/filesystem.h"
 #include "ext4/ialloc.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/superblock.h"
 
@@ -80,6 +81,11 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	ext4_superblock_t *temp_superblock = NULL;
 
 	fs->device = service_id;
+	fs->journal = NULL;
+
+	list_initialize(&fs->prealloc_list);
+	fs->prealloc_count = 0;
+	fibril_mutex_initialize(&fs->prealloc_lock);
 
 	/* Initialize block library (4096 is size of communication channel) */
 	rc = block_init(fs->device, 4096);
@@ -440,13 +446,29 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 
 	fs_inited = 1;
 
+	/* Replay the journal if the volume was not unmounted cleanly */
+	rc = ext4_journal_open(fs);
+	if (rc != EOK)
+		goto error;
+
 	/* Read root node */
 	rc = ext4_node_get_core(&root_node, inst, EXT4_INODE_ROOT_INDEX);
 	if (rc != EOK)
 		goto error;
 
-	/* Mark system as mounted */
-	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	/*
+	 * Mark system as mounted. With a journal, the volume stays consistent
+	 * and only needs the journal to be replayed after a crash.
+	 */
+	if (fs->journal != NULL) {
+		uint32_t incompat =
+		    ext4_superblock_get_features_incompatible(fs->superblock);
+		ext4_superblock_set_features_incompatible(fs->superblock,
+		    incompat | EXT4_FEATURE_INCOMPAT_RECOVER);
+	} else {
+		ext4_superblock_set_state(fs->superblock,
+		    EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	}
 	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		goto error;
@@ -465,8 +487,10 @@ error:
 	if (root_node != NULL)
 		ext4_node_put(root_node);
 
-	if (fs_inited)
+	if (fs_inited) {
+		(void) ext4_journal_close(fs);
 		ext4_filesystem_fini(fs);
+	}
 	free(fs);
 	return rc;
 }
@@ -481,9 +505,24 @@ error:
  */
 errno_t ext4_filesystem_close(ext4_filesystem_t *fs)
 {
+	/* Return preallocated blocks before the free counts are written */
+	errno_t rc = ext4_balloc_discard_all_prealloc(fs);
+	if (rc != EOK)
+		return rc;
+
+	/* Commit and checkpoint the journal */
+	rc = ext4_journal_close(fs);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t incompat =
+	    ext4_superblock_get_features_incompatible(fs->superblock);
+	ext4_superblock_set_features_incompatible(fs->superblock,
+	    incompat & ~EXT4_FEATURE_INCOMPAT_RECOVER);
+
 	/* Write the superblock to the device */
 	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_VALID_FS);
-	errno_t rc = ext4_superblock_write_direct(fs->device, fs->superblock);
+	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		return rc;
 
@@ -521,6 +560,12 @@ static errno_t ext4_filesystem_check_features(ext4_filesystem_t *fs,
 	incompatible_features =
 	    ext4_superblock_get_features_incompatible(fs->superblock);
 	incompatible_features &= ~EXT4_FEATURE_INCOMPAT_SUPP;
+
+	/* Recovery is done by replaying the journal */
+	if (ext4_superblock_has_feature_compatible(fs->superblock,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL))
+		incompatible_features &= ~EXT4_FEATURE_INCOMPAT_RECOVER;
+
 	if (incompatible_features > 0)
 		return ENOTSUP;
 
@@ -689,7 +734,7 @@ static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *fs)
 			bg_block0 += ext4_superblock_get_blocks_per_group(sb);
 		}
 
-		block->dirty = true;
+		ext4_journal_dirty(fs, block);
 
 		rc = block_put(block);
 		if (rc != EOK)
@@ -800,7 +845,7 @@ static errno_t ext4_filesystem_init_block_bitmap(ext4_block_group_ref_t *bg_ref)
 		ext4_bitmap_set_bit(bitmap, block);
 	}
 
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(bg_ref->fs, bitmap_block);
 
 	/* Save bitmap */
 	return block_put(bitmap_block);
@@ -843,7 +888,7 @@ static errno_t ext4_filesystem_init_inode_bitmap(ext4_block_group_ref_t *bg_ref)
 	if (i < end_bit)
 		memset(bitmap + (i >> 3), 0xff, (end_bit - i) >> 3);
 
-	bitmap_block->dirty = true;
+	ext4_journal_dirty(bg_ref->fs, bitmap_block);
 
 	/* Save bitmap */
 	return block_put(bitmap_block);
@@ -886,7 +931,7 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 			return rc;
 
 		memset(block->data, 0, block_size);
-		block->dirty = true;
+		ext4_journal_dirty(bg_ref->fs, block);
 
 		rc = block_put(block);
 		if (rc != EOK)
@@ -929,7 +974,8 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 	    ext4_superblock_get_desc_size(fs->superblock);
 
 	/* Load block with descriptors */
-	errno_t rc = block_get(&newref->block, fs->device, block_id, 0);
+	errno_t rc = block_get(&newref->block, fs->device, block_id,
+	    BLOCK_FLAGS_META);
 	if (rc != EOK) {
 		free(newref);
 		return rc;
@@ -1097,7 +1143,7 @@ errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 		ext4_block_group_set_checksum(ref->block_group, checksum);
 
 		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
+		ext4_journal_dirty(ref->fs, ref->block);
 	}
 
 	/* Put back block, that contains block group descriptor */
@@ -1125,6 +1171,9 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 	if (newref == NULL)
 		return ENOMEM;
 
+	/* Modifications are made only while an i-node reference is held */
+	ext4_journal_start(fs);
+
 	/* Compute number of i-nodes, that fits in one data block */
 	uint32_t inodes_per_group =
 	    ext4_superblock_get_inodes_per_group(fs->superblock);
@@ -1141,6 +1190,7 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 	ext4_block_group_ref_t *bg_ref;
 	errno_t rc = ext4_filesystem_get_block_group_ref(fs, block_group, &bg_ref);
 	if (rc != EOK) {
+		ext4_journal_stop(fs);
 		free(newref);
 		return rc;
 	}
@@ -1153,6 +1203,7 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 	/* Put back block group reference (not needed more) */
 	rc = ext4_filesystem_put_block_group_ref(bg_ref);
 	if (rc != EOK) {
+		ext4_journal_stop(fs);
 		free(newref);
 		return rc;
 	}
@@ -1164,8 +1215,10 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 
 	/* Compute block address */
 	aoff64_t block_id = inode_table_start + (byte_offset_in_group / block_size);
-	rc = block_get(&newref->block, fs->device, block_id, 0);
+	rc = block_get(&newref->block, fs->device, block_id,
+	    BLOCK_FLAGS_META);
 	if (rc != EOK) {
+		ext4_journal_stop(fs);
 		free(newref);
 		return rc;
 	}
@@ -1196,13 +1249,15 @@ errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *ref)
 	/* Check if reference modified */
 	if (ref->dirty) {
 		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
+		ext4_journal_dirty(ref->fs, ref->block);
 	}
 
 	/* Put back block, that contains i-node */
+	ext4_filesystem_t *fs = ref->fs;
 	errno_t rc = block_put(ref->block);
 	free(ref);
 
+	ext4_journal_stop(fs);
 	return rc;
 }
 
@@ -1312,19 +1367,23 @@ errno_t ext4_filesystem_alloc_inode(ext4_filesystem_t *fs,
 	if (flags & L_DIRECTORY)
 		is_dir = true;
 
+	/* The i-node must not be committed without its initialization */
+	ext4_journal_start(fs);
+
 	/* Allocate inode by allocation algorithm */
 	uint32_t index;
 	errno_t rc = ext4_ialloc_alloc_inode(fs, &index, is_dir);
-	if (rc != EOK)
+	if (rc != EOK) {
+		ext4_journal_stop(fs);
 		return rc;
+	}
 
 	rc = ext4_filesystem_init_inode(fs, index, inode_ref, flags);
-	if (rc != EOK) {
+	if (rc != EOK)
 		ext4_ialloc_free_inode(fs, index, is_dir);
-		return rc;
-	}
 
-	return EOK;
+	ext4_journal_stop(fs);
+	return rc;
 }
 
 /** Allocate specific i-node in the filesystem.
@@ -1370,6 +1429,10 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 {
 	ext4_filesystem_t *fs = inode_ref->fs;
 
+	errno_t rc = ext4_balloc_discard_prealloc(fs, inode_ref->index);
+	if (rc != EOK)
+		return rc;
+
 	/* For extents must be data block destroyed by other way */
 	if ((ext4_superblock_has_feature_incompatible(fs->superblock,
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
@@ -1383,7 +1446,7 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 	/* 1) Single indirect */
 	uint32_t fblock = ext4_inode_get_indirect_block(inode_ref->inode, 0);
 	if (fblock != 0) {
-		errno_t rc = ext4_balloc_free_block(inode_ref, fblock);
+		rc = ext4_balloc_free_block(inode_ref, fblock);
 		if (rc != EOK)
 			return rc;
 
@@ -1397,7 +1460,7 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 	/* 2) Double indirect */
 	fblock = ext4_inode_get_indirect_block(inode_ref->inode, 1);
 	if (fblock != 0) {
-		errno_t rc = block_get(&block, fs->device, fblock, BLOCK_FLAGS_NONE);
+		rc = block_get(&block, fs->device, fblock, BLOCK_FLAGS_NONE);
 		if (rc != EOK)
 			return rc;
 
@@ -1429,7 +1492,7 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 	block_t *subblock;
 	fblock = ext4_inode_get_indirect_block(inode_ref->inode, 2);
 	if (fblock != 0) {
-		errno_t rc = block_get(&block, fs->device, fblock, BLOCK_FLAGS_NONE);
+		rc = block_get(&block, fs->device, fblock, BLOCK_FLAGS_NONE);
 		if (rc != EOK)
 			return rc;
 
@@ -1494,7 +1557,7 @@ finish:
 	uint32_t xattr_block = ext4_inode_get_file_acl(
 	    inode_ref->inode, fs->superblock);
 	if (xattr_block) {
-		errno_t rc = ext4_balloc_free_block(inode_ref, xattr_block);
+		rc = ext4_balloc_free_block(inode_ref, xattr_block);
 		if (rc != EOK)
 			return rc;
 
@@ -1502,7 +1565,6 @@ finish:
 	}
 
 	/* Free inode by allocator */
-	errno_t rc;
 	if (ext4_inode_is_type(fs->superblock, inode_ref->inode,
 	    EXT4_INODE_MODE_DIRECTORY))
 		rc = ext4_ialloc_free_inode(fs, inode_ref->index, true);
@@ -1538,6 +1600,12 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	if (old_size < new_size)
 		return EINVAL;
 
+	/* Blocks reserved past the old end would no longer follow the file */
+	errno_t rc = ext4_balloc_discard_prealloc(inode_ref->fs,
+	    inode_ref->index);
+	if (rc != EOK)
+		return rc;
+
 	/* Compute how many blocks will be released */
 	aoff64_t size_diff = old_size - new_size;
 	uint32_t block_size  = ext4_superblock_get_block_size(sb);
@@ -1553,7 +1621,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
 		/* Extents require special operation */
-		errno_t rc = ext4_extent_release_blocks_from(inode_ref,
+		rc = ext4_extent_release_blocks_from(inode_ref,
 		    old_blocks_count - diff_blocks_count);
 		if (rc != EOK)
 			return rc;
@@ -1562,7 +1630,7 @@ errno_t ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 
 		/* Starting from 1 because of logical blocks are numbered from 0 */
 		for (uint32_t i = 1; i <= diff_blocks_count; ++i) {
-			errno_t rc = ext4_filesystem_release_inode_block(inode_ref,
+			rc = ext4_filesystem_release_inode_block(inode_ref,
 			    old_blocks_count - i);
 			if (rc != EOK)
 				return rc;
@@ -1767,7 +1835,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 
 		/* Initialize new block */
 		memset(new_block->data, 0, block_size);
-		new_block->dirty = true;
+		ext4_journal_dirty(fs, new_block);
 
 		/* Put back the allocated block */
 		rc = block_put(new_block);
@@ -1807,7 +1875,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 
 			/* Initialize allocated block */
 			memset(new_block->data, 0, block_size);
-			new_block->dirty = true;
+			ext4_journal_dirty(fs, new_block);
 
 			rc = block_put(new_block);
 			if (rc != EOK) {
@@ -1818,7 +1886,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			/* Write block address to the parent */
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(new_block_addr);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 			current_block = new_block_addr;
 		}
 
@@ -1826,7 +1894,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 		if (level == 1) {
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(fblock);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 		}
 
 		rc = block_put(block);
@@ -1927,7 +1995,7 @@ errno_t ext4_filesystem_release_inode_block(ext4_inode_ref_t *inode_ref,
 		if (level == 1) {
 			((uint32_t *) block->data)[offset_in_block] =
 			    host2uint32_t_le(0);
-			block->dirty = true;
+			ext4_journal_dirty(fs, block);
 		}
 
 		rc = block_put(block);
@@ -0,0 +1,1710 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext4
+ * @{
+ */
+/**
+ * @file  journal.c
+ * @brief JBD2 compatible metadata journal.
+ *
+ * Metadata blocks modified by file system operations are collected in the
+ * running transaction, which holds a reference to each of them. libblock
+ * neither writes back nor evicts a block somebody holds a reference to, so
+ * the blocks stay in memory until the transaction is committed. The commit
+ * fibril periodically closes the running transaction, writes copies of its
+ * blocks to the journal followed by a commit block and only then drops the
+ * references, letting the blocks reach their home location.
+ *
+ * Operations are bracketed by ext4_journal_start() and ext4_journal_stop(),
+ * which happens implicitly while an i-node reference is held. A transaction
+ * is closed only when no operation is in progress, so it never contains half
+ * of an operation. Many operations share one commit.
+ *
+ * Before a transaction is written, all other dirty blocks are written back.
+ * This orders file data before the metadata referencing it. A committed
+ * transaction stays in the log until each of its blocks has either reached
+ * its home location or been logged again by a later transaction. Only then
+ * the start of the log is moved past it.
+ */
+
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <assert.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <time.h>
+#include "ext4/filesystem.h"
+#include "ext4/inode.h"
+#include "ext4/journal.h"
+#include "ext4/superblock.h"
+#include "../private/journal.h"
+
+/** Interval between commits of the running transaction (usec) */
+#define EXT4_JOURNAL_COMMIT_INTERVAL  5000000
+
+/** Maximal number of journal blocks written by a single request */
+#define EXT4_JOURNAL_WRITE_RUN  16
+
+/** Size of UUID following a tag without EXT4_JOURNAL_FLAG_SAME_UUID */
+#define EXT4_JOURNAL_UUID_SIZE  16
+
+/** Size of descriptor block tail with checksum */
+#define EXT4_JOURNAL_TAIL_SIZE  4
+
+/** Number of attempts to write back the blocks of the log when waiting */
+#define EXT4_JOURNAL_CHECKPOINT_RETRIES  50
+
+/** Delay between the attempts to write back the blocks of the log (usec) */
+#define EXT4_JOURNAL_CHECKPOINT_DELAY  100000
+
+/** Metadata block modified by a transaction */
+typedef struct {
+	ht_link_t hash_link;
+	link_t link;
+	block_t *block;
+	/** Contents of the block at the time of commit */
+	void *copy;
+} ext4_journal_block_t;
+
+typedef struct {
+	uint32_t sequence;
+	/** Blocks of the transaction hashed by address */
+	hash_table_t blocks;
+	/** Blocks of the transaction in the order they were added */
+	list_t block_list;
+	size_t block_count;
+	/** Freed blocks which must not be replayed from older transactions */
+	uint64_t *revoked;
+	size_t revoked_count;
+	size_t revoked_size;
+} ext4_transaction_t;
+
+/** Committed transaction which may still be needed for recovery */
+typedef struct {
+	link_t link;
+	/** First journal block of the transaction, 0 until it is written */
+	uint32_t start;
+	uint32_t sequence;
+	/** Sorted addresses of the logged blocks */
+	uint64_t *blocks;
+	size_t count;
+} ext4_journal_logged_t;
+
+/** Revoke record found during recovery */
+typedef struct {
+	ht_link_t hash_link;
+	uint64_t block;
+	uint32_t sequence;
+} ext4_journal_revoke_t;
+
+struct ext4_journal {
+	ext4_filesystem_t *fs;
+	size_t block_size;
+	/** Number of device blocks per file system block */
+	size_t pblocks;
+	/** Home address of each journal block */
+	uint32_t *map;
+	uint32_t first;
+	uint32_t max_len;
+	uint32_t features;
+	size_t tag_size;
+	uint8_t uuid[EXT4_JOURNAL_UUID_SIZE];
+	ext4_journal_superblock_t *sb;
+
+	/**
+	 * First journal block of the oldest transaction in the log as recorded
+	 * in the journal superblock, 0 if empty
+	 */
+	uint32_t tail;
+	/** First free journal block */
+	uint32_t head;
+	/** Number of blocks of a transaction which trigger an early commit */
+	size_t max_transaction;
+
+	fibril_mutex_t lock;
+	/** Signalled when operations may proceed or when they all finished */
+	fibril_condvar_t handle_cv;
+	/** Wakes up the commit fibril */
+	fibril_condvar_t commit_cv;
+	/** Signalled when a commit finishes or the commit fibril exits */
+	fibril_condvar_t done_cv;
+
+	/** Number of operations in progress */
+	unsigned handles;
+	/** Running transaction is being closed, operations must wait */
+	bool locked;
+	bool committing;
+	bool commit_request;
+	bool stop;
+	bool fibril_running;
+	/** Journaling failed, the volume is no longer protected */
+	bool aborted;
+	/** The log was emptied after the abort */
+	bool abort_handled;
+
+	ext4_transaction_t txn[2];
+	ext4_transaction_t *running;
+
+	/** Transactions which are not checkpointed yet, oldest first */
+	list_t logged;
+};
+
+/** Number of operations of the current fibril in progress */
+static fibril_local unsigned ext4_journal_handles;
+
+static size_t ext4_journal_key_hash(const void *key)
+{
+	const aoff64_t *lba = key;
+	return *lba;
+}
+
+static size_t ext4_journal_block_hash(const ht_link_t *item)
+{
+	ext4_journal_block_t *jb =
+	    hash_table_get_inst(item, ext4_journal_block_t, hash_link);
+	return jb->block->lba;
+}
+
+static bool ext4_journal_block_key_equal(const void *key, const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	ext4_journal_block_t *jb =
+	    hash_table_get_inst(item, ext4_journal_block_t, hash_link);
+	return jb->block->lba == *lba;
+}
+
+static hash_table_ops_t ext4_journal_block_ops = {
+	.hash = ext4_journal_block_hash,
+	.key_hash = ext4_journal_key_hash,
+	.key_equal = ext4_journal_block_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t ext4_journal_revoke_hash(const ht_link_t *item)
+{
+	ext4_journal_revoke_t *rv =
+	    hash_table_get_inst(item, ext4_journal_revoke_t, hash_link);
+	return rv->block;
+}
+
+static bool ext4_journal_revoke_key_equal(const void *key,
+    const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	ext4_journal_revoke_t *rv =
+	    hash_table_get_inst(item, ext4_journal_revoke_t, hash_link);
+	return rv->block == *lba;
+}
+
+static void ext4_journal_revoke_remove(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, ext4_journal_revoke_t, hash_link));
+}
+
+static hash_table_ops_t ext4_journal_revoke_ops = {
+	.hash = ext4_journal_revoke_hash,
+	.key_hash = ext4_journal_key_hash,
+	.key_equal = ext4_journal_revoke_key_equal,
+	.equal = NULL,
+	.remove_callback = ext4_journal_revoke_remove
+};
+
+static int ext4_journal_lba_cmp(const void *a, const void *b)
+{
+	uint64_t la = *(const uint64_t *) a;
+	uint64_t lb = *(const uint64_t *) b;
+
+	if (la < lb)
+		return -1;
+	return (la > lb) ? 1 : 0;
+}
+
+/** Get journal block following the given one in the circular log. */
+static uint32_t ext4_journal_next(ext4_journal_t *j, uint32_t pos)
+{
+	return (pos + 1 < j->max_len) ? pos + 1 : j->first;
+}
+
+/** Number of journal blocks between two positions in the circular log. */
+static uint32_t ext4_journal_distance(ext4_journal_t *j, uint32_t from,
+    uint32_t to)
+{
+	if (to >= from)
+		return to - from;
+	return (j->max_len - from) + (to - j->first);
+}
+
+/** Read journal block.
+ *
+ * @param j   Journal
+ * @param pos Index of the block within the journal
+ * @param buf Buffer for one file system block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_read(ext4_journal_t *j, uint32_t pos, void *buf)
+{
+	return block_read_direct(j->fs->device, (aoff64_t) j->map[pos] * j->pblocks,
+	    j->pblocks, buf);
+}
+
+/** Write consecutive journal blocks.
+ *
+ * Blocks which are adjacent on the device are written by a single request.
+ *
+ * @param j     Journal
+ * @param pos   Index of the first block within the journal
+ * @param bufs  Contents of the blocks
+ * @param count Number of blocks
+ * @param run   Buffer for EXT4_JOURNAL_WRITE_RUN blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write(ext4_journal_t *j, uint32_t pos,
+    void **bufs, size_t count, uint8_t *run)
+{
+	size_t i = 0;
+
+	while (i < count) {
+		uint32_t start = pos;
+		size_t n = 0;
+
+		do {
+			memcpy(run + n * j->block_size, bufs[i], j->block_size);
+			n++;
+			i++;
+			pos = ext4_journal_next(j, pos);
+		} while ((i < count) && (n < EXT4_JOURNAL_WRITE_RUN) &&
+		    (pos != j->first) && (j->map[pos] == j->map[start] + n));
+
+		errno_t rc = block_write_direct(j->fs->device,
+		    (aoff64_t) j->map[start] * j->pblocks, n * j->pblocks, run);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Write journal superblock.
+ *
+ * @param j        Journal
+ * @param start    First block of the log, 0 if the log is empty
+ * @param sequence Sequence number of the transaction starting the log
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write_sb(ext4_journal_t *j, uint32_t start,
+    uint32_t sequence)
+{
+	j->sb->start = host2uint32_t_be(start);
+	j->sb->sequence = host2uint32_t_be(sequence);
+
+	return block_write_direct(j->fs->device, (aoff64_t) j->map[0] * j->pblocks,
+	    j->pblocks, j->sb);
+}
+
+/** Compute size of a block tag in descriptor blocks. */
+static size_t ext4_journal_tag_size(uint32_t features)
+{
+	if (features & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)
+		return sizeof(ext4_journal_block_tag3_t);
+
+	size_t size = sizeof(ext4_journal_block_tag_t);
+	if (features & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2)
+		size += sizeof(uint16_t);
+	if (features & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT)
+		return size;
+
+	return size - sizeof(uint32_t);
+}
+
+/** Check whether descriptor and revoke blocks carry a checksum tail. */
+static bool ext4_journal_has_csum(uint32_t features)
+{
+	return (features & (EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 |
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)) != 0;
+}
+
+/** Decode block tag.
+ *
+ * @param j     Journal
+ * @param tag   Pointer to the tag
+ * @param block Output value - home address of the block
+ * @param flags Output value - tag flags
+ *
+ */
+static void ext4_journal_decode_tag(ext4_journal_t *j, const uint8_t *tag,
+    uint64_t *block, uint32_t *flags)
+{
+	bool is64 = (j->features & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) != 0;
+
+	if (j->features & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3) {
+		const ext4_journal_block_tag3_t *tag3 =
+		    (const ext4_journal_block_tag3_t *) tag;
+		*block = uint32_t_be2host(tag3->blocknr);
+		*flags = uint32_t_be2host(tag3->flags);
+		if (is64)
+			*block |= (uint64_t) uint32_t_be2host(tag3->blocknr_high) << 32;
+	} else {
+		const ext4_journal_block_tag_t *tag2 =
+		    (const ext4_journal_block_tag_t *) tag;
+		*block = uint32_t_be2host(tag2->blocknr);
+		*flags = uint16_t_be2host(tag2->flags);
+
+		/* Without INCOMPAT_64BIT the tag ends before blocknr_high */
+		if (is64)
+			*block |= (uint64_t) uint32_t_be2host(tag2->blocknr_high) << 32;
+	}
+}
+
+/** Passes of journal recovery */
+typedef enum {
+	/** Find the end of the committed part of the log */
+	EXT4_JOURNAL_PASS_SCAN,
+	/** Collect revoke records */
+	EXT4_JOURNAL_PASS_REVOKE,
+	/** Write logged blocks to their home location */
+	EXT4_JOURNAL_PASS_REPLAY
+} ext4_journal_pass_t;
+
+/** Replay one logged block.
+ *
+ * The block is written through the block cache, which may already contain
+ * blocks read while the journal was being opened.
+ *
+ * @param j     Journal
+ * @param block Home address of the block
+ * @param data  Logged contents of the block
+ * @param flags Flags of the tag describing the block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_replay_block(ext4_journal_t *j, uint64_t block,
+    uint8_t *data, uint32_t flags)
+{
+	if (flags & EXT4_JOURNAL_FLAG_ESCAPE)
+		*(uint32_t *) data = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+
+	block_t *b;
+	errno_t rc = block_get(&b, j->fs->device, block, BLOCK_FLAGS_NOREAD);
+	if (rc != EOK)
+		return rc;
+
+	memcpy(b->data, data, j->block_size);
+	b->dirty = true;
+
+	return block_put(b);
+}
+
+/** Walk the log.
+ *
+ * @param j       Journal
+ * @param pass    Recovery pass
+ * @param revokes Hash table of revoke records
+ * @param end     Sequence number of the first transaction which is not
+ *                committed. Output value of the scan pass, input value of
+ *                the other passes.
+ * @param buf     Buffer for one block
+ * @param data    Buffer for one block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_walk(ext4_journal_t *j, ext4_journal_pass_t pass,
+    hash_table_t *revokes, uint32_t *end, uint8_t *buf, uint8_t *data)
+{
+	uint32_t pos = uint32_t_be2host(j->sb->start);
+	uint32_t sequence = uint32_t_be2host(j->sb->sequence);
+	uint32_t area = j->max_len - j->first;
+	uint32_t walked = 0;
+	size_t tail = ext4_journal_has_csum(j->features) ?
+	    EXT4_JOURNAL_TAIL_SIZE : 0;
+	size_t rec_size =
+	    (j->features & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) ? 8 : 4;
+	errno_t rc;
+
+	while (walked < area) {
+		if ((pass != EXT4_JOURNAL_PASS_SCAN) && (sequence == *end))
+			break;
+
+		rc = ext4_journal_read(j, pos, buf);
+		if (rc != EOK)
+			return rc;
+
+		ext4_journal_header_t *header = (ext4_journal_header_t *) buf;
+		if ((uint32_t_be2host(header->magic) != EXT4_JOURNAL_MAGIC) ||
+		    (uint32_t_be2host(header->sequence) != sequence))
+			break;
+
+		uint32_t blocktype = uint32_t_be2host(header->blocktype);
+		pos = ext4_journal_next(j, pos);
+		walked++;
+
+		if (blocktype == EXT4_JOURNAL_DESCRIPTOR_BLOCK) {
+			size_t off = sizeof(ext4_journal_header_t);
+
+			while (off + j->tag_size <= j->block_size - tail) {
+				uint64_t block;
+				uint32_t flags;
+				ext4_journal_decode_tag(j, buf + off, &block, &flags);
+
+				if (pass == EXT4_JOURNAL_PASS_REPLAY) {
+					rc = ext4_journal_read(j, pos, data);
+					if (rc != EOK)
+						return rc;
+
+					ht_link_t *link = hash_table_find(revokes, &block);
+					ext4_journal_revoke_t *rv = (link != NULL) ?
+					    hash_table_get_inst(link,
+					    ext4_journal_revoke_t, hash_link) : NULL;
+
+					/* Revoke applies to older transactions */
+					if ((rv == NULL) ||
+					    ((int32_t) (rv->sequence - sequence) < 0)) {
+						rc = ext4_journal_replay_block(j, block,
+						    data, flags);
+						if (rc != EOK)
+							return rc;
+					}
+				}
+
+				pos = ext4_journal_next(j, pos);
+				walked++;
+
+				off += j->tag_size;
+				if (!(flags & EXT4_JOURNAL_FLAG_SAME_UUID))
+					off += EXT4_JOURNAL_UUID_SIZE;
+				if (flags & EXT4_JOURNAL_FLAG_LAST_TAG)
+					break;
+			}
+		} else if (blocktype == EXT4_JOURNAL_COMMIT_BLOCK) {
+			sequence++;
+			if (pass == EXT4_JOURNAL_PASS_SCAN)
+				*end = sequence;
+		} else if (blocktype == EXT4_JOURNAL_REVOKE_BLOCK) {
+			if (pass != EXT4_JOURNAL_PASS_REVOKE)
+				continue;
+
+			ext4_journal_revoke_header_t *rh =
+			    (ext4_journal_revoke_header_t *) buf;
+			size_t count = min(uint32_t_be2host(rh->count),
+			    j->block_size);
+
+			for (size_t off = sizeof(ext4_journal_revoke_header_t);
+			    off + rec_size <= count; off += rec_size) {
+				uint64_t block = (rec_size == 8) ?
+				    uint64_t_be2host(*(uint64_t *) (buf + off)) :
+				    uint32_t_be2host(*(uint32_t *) (buf + off));
+
+				ht_link_t *link = hash_table_find(revokes, &block);
+				if (link != NULL) {
+					ext4_journal_revoke_t *rv = hash_table_get_inst(
+					    link, ext4_journal_revoke_t, hash_link);
+					rv->sequence = sequence;
+					continue;
+				}
+
+				ext4_journal_revoke_t *rv =
+				    malloc(sizeof(ext4_journal_revoke_t));
+				if (rv == NULL)
+					return ENOMEM;
+
+				rv->block = block;
+				rv->sequence = sequence;
+				hash_table_insert(revokes, &rv->hash_link);
+			}
+		} else {
+			break;
+		}
+	}
+
+	return EOK;
+}
+
+/** Recover the volume from the journal.
+ *
+ * Blocks of all committed transactions in the log are written to their home
+ * location, unless a later transaction revoked them.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_recover(ext4_journal_t *j)
+{
+	ext4_filesystem_t *fs = j->fs;
+	hash_table_t revokes;
+	uint32_t end = uint32_t_be2host(j->sb->sequence);
+	errno_t rc;
+
+	if (j->sb->start == 0)
+		return EOK;
+
+	uint8_t *buf = malloc(2 * j->block_size);
+	if (buf == NULL)
+		return ENOMEM;
+
+	if (!hash_table_create(&revokes, 0, 0, &ext4_journal_revoke_ops)) {
+		free(buf);
+		return ENOMEM;
+	}
+
+	rc = ext4_journal_walk(j, EXT4_JOURNAL_PASS_SCAN, &revokes, &end,
+	    buf, buf + j->block_size);
+	if (rc == EOK) {
+		rc = ext4_journal_walk(j, EXT4_JOURNAL_PASS_REVOKE, &revokes,
+		    &end, buf, buf + j->block_size);
+	}
+	if (rc == EOK) {
+		rc = ext4_journal_walk(j, EXT4_JOURNAL_PASS_REPLAY, &revokes,
+		    &end, buf, buf + j->block_size);
+	}
+
+	hash_table_destroy(&revokes);
+	free(buf);
+
+	if (rc != EOK)
+		return rc;
+
+	/* Replayed blocks must be on the device before the log is emptied */
+	rc = block_cache_flush(fs->device);
+	if (rc != EOK)
+		return rc;
+
+	rc = ext4_journal_write_sb(j, 0, end);
+	if (rc != EOK)
+		return rc;
+
+	/* The superblock itself may have been replayed */
+	ext4_superblock_t *sb;
+	rc = ext4_superblock_read_direct(fs->device, &sb);
+	if (rc != EOK)
+		return rc;
+
+	ext4_superblock_release(fs->superblock);
+	fs->superblock = sb;
+
+	return EOK;
+}
+
+/** Initialize transaction.
+ *
+ * @param txn      Transaction
+ * @param sequence Sequence number of the transaction
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_transaction_init(ext4_transaction_t *txn,
+    uint32_t sequence)
+{
+	if (!hash_table_create(&txn->blocks, 0, 0, &ext4_journal_block_ops))
+		return ENOMEM;
+
+	list_initialize(&txn->block_list);
+	txn->sequence = sequence;
+	txn->block_count = 0;
+	txn->revoked = NULL;
+	txn->revoked_count = 0;
+	txn->revoked_size = 0;
+
+	return EOK;
+}
+
+/** Drop all blocks of transaction.
+ *
+ * Dropping the references allows the blocks to be written back.
+ *
+ * @param txn Transaction
+ *
+ */
+static void ext4_transaction_release(ext4_transaction_t *txn)
+{
+	while (!list_empty(&txn->block_list)) {
+		ext4_journal_block_t *jb = list_get_instance(
+		    list_first(&txn->block_list), ext4_journal_block_t, link);
+
+		list_remove(&jb->link);
+		hash_table_remove_item(&txn->blocks, &jb->hash_link);
+		(void) block_put(jb->block);
+		free(jb->copy);
+		free(jb);
+	}
+
+	txn->block_count = 0;
+	txn->revoked_count = 0;
+}
+
+static void ext4_transaction_fini(ext4_transaction_t *txn)
+{
+	ext4_transaction_release(txn);
+	hash_table_destroy(&txn->blocks);
+	free(txn->revoked);
+}
+
+/** Stop protecting the volume by the journal.
+ *
+ * Must be called with the journal lock held.
+ *
+ * @param j  Journal
+ * @param rc Error which caused the abort
+ *
+ */
+static void ext4_journal_abort(ext4_journal_t *j, errno_t rc)
+{
+	if (j->aborted)
+		return;
+
+	printf("ext4: journal aborted (%s), volume needs to be checked\n",
+	    str_error(rc));
+	j->aborted = true;
+	j->commit_request = true;
+	fibril_condvar_signal(&j->commit_cv);
+}
+
+static void ext4_journal_logged_destroy(ext4_journal_logged_t *lt)
+{
+	free(lt->blocks);
+	free(lt);
+}
+
+/** Check whether a block is logged by a transaction. */
+static bool ext4_journal_logged_has(ext4_journal_logged_t *lt,
+    uint64_t block)
+{
+	return bsearch(&block, lt->blocks, lt->count, sizeof(uint64_t),
+	    ext4_journal_lba_cmp) != NULL;
+}
+
+/** Check whether a block is in the log or about to be written to it. */
+static bool ext4_journal_in_log(ext4_journal_t *j, uint64_t block)
+{
+	list_foreach(j->logged, link, ext4_journal_logged_t, lt) {
+		if (ext4_journal_logged_has(lt, block))
+			return true;
+	}
+
+	return false;
+}
+
+/** Take snapshot of the blocks of a closed transaction.
+ *
+ * The transaction is appended to the transactions in the log, although it
+ * is written only later.
+ *
+ * Must be called with the journal lock held.
+ *
+ * @param j      Journal
+ * @param txn    Transaction
+ * @param logged Output pointer for the record of the transaction in the log
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_snapshot(ext4_journal_t *j,
+    ext4_transaction_t *txn, ext4_journal_logged_t **logged)
+{
+	ext4_journal_logged_t *lt = malloc(sizeof(ext4_journal_logged_t));
+	if (lt == NULL)
+		return ENOMEM;
+
+	lt->start = 0;
+	lt->sequence = txn->sequence;
+	lt->count = txn->block_count;
+	lt->blocks = malloc(txn->block_count * sizeof(uint64_t));
+	if ((lt->blocks == NULL) && (txn->block_count > 0)) {
+		free(lt);
+		return ENOMEM;
+	}
+
+	size_t i = 0;
+	list_foreach(txn->block_list, link, ext4_journal_block_t, jb) {
+		jb->copy = malloc(j->block_size);
+		if (jb->copy == NULL) {
+			ext4_journal_logged_destroy(lt);
+			return ENOMEM;
+		}
+
+		memcpy(jb->copy, jb->block->data, j->block_size);
+		lt->blocks[i++] = jb->block->lba;
+	}
+
+	qsort(lt->blocks, lt->count, sizeof(uint64_t), ext4_journal_lba_cmp);
+
+	list_append(&lt->link, &j->logged);
+	*logged = lt;
+
+	return EOK;
+}
+
+/** Check whether a transaction in the log is still needed for recovery.
+ *
+ * It is not, once each of its blocks has reached its home location or has
+ * been logged by a later transaction.
+ *
+ * @param j  Journal
+ * @param lt Transaction in the log
+ *
+ * @return True if the transaction is still needed
+ *
+ */
+static bool ext4_journal_logged_needed(ext4_journal_t *j,
+    ext4_journal_logged_t *lt)
+{
+	for (size_t i = 0; i < lt->count; i++) {
+		bool relogged = false;
+
+		for (link_t *link = list_next(&lt->link, &j->logged);
+		    link != NULL; link = list_next(link, &j->logged)) {
+			ext4_journal_logged_t *later = list_get_instance(link,
+			    ext4_journal_logged_t, link);
+
+			if ((later->start != 0) &&
+			    ext4_journal_logged_has(later, lt->blocks[i])) {
+				relogged = true;
+				break;
+			}
+		}
+
+		if (!relogged && !block_cache_clean(j->fs->device, lt->blocks[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/** Drop the transactions which are no longer needed from the log.
+ *
+ * Dirty blocks are written back and the start of the log is moved past the
+ * transactions whose blocks have all reached their home location. Blocks in
+ * use are not written back. When waiting, the write back is retried until
+ * the log is empty or EXT4_JOURNAL_CHECKPOINT_RETRIES attempts fail.
+ *
+ * Must be called without the journal lock held by the fibril committing
+ * transactions.
+ *
+ * @param j    Journal
+ * @param wait Retry until the log is empty
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_checkpoint(ext4_journal_t *j, bool wait)
+{
+	unsigned attempts = wait ? EXT4_JOURNAL_CHECKPOINT_RETRIES : 1;
+	ext4_journal_logged_t *lt = NULL;
+	errno_t rc;
+
+	while (true) {
+		rc = block_cache_flush(j->fs->device);
+		if ((rc != EOK) && (rc != EBUSY))
+			return rc;
+
+		while (!list_empty(&j->logged)) {
+			lt = list_get_instance(list_first(&j->logged),
+			    ext4_journal_logged_t, link);
+			if ((lt->start == 0) || ext4_journal_logged_needed(j, lt))
+				break;
+
+			fibril_mutex_lock(&j->lock);
+			list_remove(&lt->link);
+			fibril_mutex_unlock(&j->lock);
+			ext4_journal_logged_destroy(lt);
+			lt = NULL;
+		}
+
+		if ((lt == NULL) || (lt->start == 0) || (--attempts == 0))
+			break;
+
+		fibril_usleep(EXT4_JOURNAL_CHECKPOINT_DELAY);
+	}
+
+	uint32_t start = 0;
+	fibril_mutex_lock(&j->lock);
+	uint32_t sequence = j->running->sequence;
+	fibril_mutex_unlock(&j->lock);
+
+	if ((lt != NULL) && (lt->start != 0)) {
+		start = lt->start;
+		sequence = lt->sequence;
+	}
+
+	if (start == j->tail)
+		return EOK;
+
+	/* The oldest transaction still needed starts the log */
+	rc = ext4_journal_write_sb(j, start, sequence);
+	if (rc != EOK)
+		return rc;
+
+	j->tail = start;
+	if (start == 0)
+		j->head = j->first;
+
+	return EOK;
+}
+
+/** Compute the number of block tags which fit into a descriptor block.
+ *
+ * The first tag of a descriptor block is followed by the journal UUID, the
+ * other ones carry EXT4_JOURNAL_FLAG_SAME_UUID.
+ *
+ * @param block_size Journal block size
+ * @param features   Incompatible features of the journal
+ *
+ * @return Number of tags
+ *
+ */
+size_t ext4_journal_desc_tags(size_t block_size, uint32_t features)
+{
+	size_t tag_size = ext4_journal_tag_size(features);
+
+	return (block_size - sizeof(ext4_journal_header_t) -
+	    EXT4_JOURNAL_UUID_SIZE - tag_size) / tag_size + 1;
+}
+
+/** Fill a descriptor block with tags of the blocks which follow it.
+ *
+ * Blocks which could be mistaken for journal blocks are escaped in place.
+ *
+ * @param desc       Zeroed descriptor block
+ * @param block_size Journal block size
+ * @param features   Incompatible features of the journal
+ * @param uuid       Journal UUID
+ * @param sequence   Sequence number of the transaction
+ * @param lba        Home addresses of the logged blocks
+ * @param data       Contents of the logged blocks
+ * @param count      Number of logged blocks left in the transaction
+ *
+ * @return Number of blocks described by the descriptor block
+ *
+ */
+size_t ext4_journal_desc_fill(uint8_t *desc, size_t block_size,
+    uint32_t features, const uint8_t *uuid, uint32_t sequence,
+    const uint64_t *lba, void **data, size_t count)
+{
+	size_t tag_size = ext4_journal_tag_size(features);
+	size_t tags = min(count, ext4_journal_desc_tags(block_size, features));
+
+	assert(tags > 0);
+
+	ext4_journal_header_t *header = (ext4_journal_header_t *) desc;
+	header->magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	header->blocktype = host2uint32_t_be(EXT4_JOURNAL_DESCRIPTOR_BLOCK);
+	header->sequence = host2uint32_t_be(sequence);
+
+	size_t off = sizeof(ext4_journal_header_t);
+	ext4_journal_block_tag_t *tag = NULL;
+
+	for (size_t i = 0; i < tags; i++) {
+		uint16_t flags = 0;
+
+		/* Logged blocks must not look like journal blocks */
+		if (uint32_t_be2host(*(uint32_t *) data[i]) ==
+		    EXT4_JOURNAL_MAGIC) {
+			*(uint32_t *) data[i] = 0;
+			flags |= EXT4_JOURNAL_FLAG_ESCAPE;
+		}
+
+		if (i > 0)
+			flags |= EXT4_JOURNAL_FLAG_SAME_UUID;
+		if (i == tags - 1)
+			flags |= EXT4_JOURNAL_FLAG_LAST_TAG;
+
+		tag = (ext4_journal_block_tag_t *) (desc + off);
+		tag->blocknr = host2uint32_t_be((uint32_t) lba[i]);
+		tag->flags = host2uint16_t_be(flags);
+		if (features & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT)
+			tag->blocknr_high = host2uint32_t_be(lba[i] >> 32);
+
+		off += tag_size;
+		if (i == 0) {
+			memcpy(desc + off, uuid, EXT4_JOURNAL_UUID_SIZE);
+			off += EXT4_JOURNAL_UUID_SIZE;
+		}
+
+		assert(off <= block_size);
+	}
+
+	return tags;
+}
+
+/** Write transaction to the log.
+ *
+ * If the log was empty, the transaction becomes part of it only once
+ * ext4_journal_checkpoint() records its start in the journal superblock.
+ *
+ * @param j     Journal
+ * @param txn   Closed transaction with a snapshot of its blocks
+ * @param lt    Record of the transaction in the log
+ *
+ * @return Error code, ENOSPC if the transaction does not fit into the log
+ *
+ */
+static errno_t ext4_journal_write_transaction(ext4_journal_t *j,
+    ext4_transaction_t *txn, ext4_journal_logged_t *lt)
+{
+	size_t bs = j->block_size;
+	size_t rec_size =
+	    (j->features & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) ? 8 : 4;
+	size_t tags_per_desc = ext4_journal_desc_tags(bs, j->features);
+	size_t recs_per_revoke = (bs - sizeof(ext4_journal_revoke_header_t)) /
+	    rec_size;
+
+	size_t desc_count = (txn->block_count + tags_per_desc - 1) /
+	    tags_per_desc;
+	size_t revoke_count = (txn->revoked_count + recs_per_revoke - 1) /
+	    recs_per_revoke;
+	size_t total = desc_count + txn->block_count + revoke_count + 1;
+
+	/* Transactions needed for recovery must stay in the log */
+	uint32_t used = (j->tail == 0) ? 0 :
+	    ext4_journal_distance(j, j->tail, j->head);
+	if (used + total > j->max_len - j->first)
+		return ENOSPC;
+
+	void **bufs = calloc(total, sizeof(void *));
+	uint8_t *meta = calloc(desc_count + revoke_count + 1, bs);
+	uint8_t *run = malloc(EXT4_JOURNAL_WRITE_RUN * bs);
+	uint64_t *lba = malloc(txn->block_count * sizeof(uint64_t));
+	void **data = malloc(txn->block_count * sizeof(void *));
+	if ((bufs == NULL) || (meta == NULL) || (run == NULL) ||
+	    (((lba == NULL) || (data == NULL)) && (txn->block_count > 0))) {
+		free(bufs);
+		free(meta);
+		free(run);
+		free(lba);
+		free(data);
+		return ENOMEM;
+	}
+
+	size_t i = 0;
+	list_foreach(txn->block_list, link, ext4_journal_block_t, jb) {
+		lba[i] = jb->block->lba;
+		data[i] = jb->copy;
+		i++;
+	}
+
+	size_t n = 0;
+	uint8_t *next_meta = meta;
+
+	/* Descriptor blocks, each followed by the blocks it describes */
+	for (size_t done = 0; done < txn->block_count; ) {
+		uint8_t *desc = next_meta;
+		next_meta += bs;
+		bufs[n++] = desc;
+
+		size_t tags = ext4_journal_desc_fill(desc, bs, j->features,
+		    j->uuid, txn->sequence, &lba[done], &data[done],
+		    txn->block_count - done);
+		for (size_t k = 0; k < tags; k++)
+			bufs[n++] = data[done + k];
+
+		done += tags;
+	}
+
+	free(lba);
+	free(data);
+
+	/* Revoke blocks */
+	for (size_t i = 0; i < txn->revoked_count; i += recs_per_revoke) {
+		uint8_t *rblock = next_meta;
+		next_meta += bs;
+		bufs[n++] = rblock;
+
+		ext4_journal_revoke_header_t *rh =
+		    (ext4_journal_revoke_header_t *) rblock;
+		rh->header.magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+		rh->header.blocktype = host2uint32_t_be(EXT4_JOURNAL_REVOKE_BLOCK);
+		rh->header.sequence = host2uint32_t_be(txn->sequence);
+
+		size_t off = sizeof(ext4_journal_revoke_header_t);
+		for (size_t k = i; (k < txn->revoked_count) &&
+		    (k < i + recs_per_revoke); k++) {
+			if (rec_size == 8) {
+				*(uint64_t *) (rblock + off) =
+				    host2uint64_t_be(txn->revoked[k]);
+			} else {
+				*(uint32_t *) (rblock + off) =
+				    host2uint32_t_be((uint32_t) txn->revoked[k]);
+			}
+			off += rec_size;
+		}
+
+		rh->count = host2uint32_t_be(off);
+	}
+
+	/* Commit block */
+	ext4_journal_commit_header_t *commit =
+	    (ext4_journal_commit_header_t *) next_meta;
+	commit->header.magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	commit->header.blocktype = host2uint32_t_be(EXT4_JOURNAL_COMMIT_BLOCK);
+	commit->header.sequence = host2uint32_t_be(txn->sequence);
+
+	struct timespec now;
+	getrealtime(&now);
+	commit->commit_sec = host2uint64_t_be(now.tv_sec);
+	commit->commit_nsec = host2uint32_t_be(now.tv_nsec);
+
+	assert(n + 1 == total);
+	bufs[n] = commit;
+
+	uint32_t start = j->head;
+
+	/* The commit block is written only after the rest of the transaction */
+	errno_t rc = ext4_journal_write(j, start, bufs, n, run);
+	if (rc == EOK) {
+		uint32_t pos = start;
+		for (size_t i = 0; i < n; i++)
+			pos = ext4_journal_next(j, pos);
+
+		rc = ext4_journal_write(j, pos, &bufs[n], 1, run);
+		if (rc == EOK) {
+			lt->start = start;
+			j->head = ext4_journal_next(j, pos);
+		}
+	}
+
+	free(bufs);
+	free(meta);
+	free(run);
+	return rc;
+}
+
+/** Commit the running transaction.
+ *
+ * Must be called with the journal lock held and outside of any operation.
+ *
+ * @param j Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_commit_locked(ext4_journal_t *j)
+{
+	ext4_filesystem_t *fs = j->fs;
+	ext4_journal_logged_t *lt = NULL;
+	errno_t rc = EOK;
+
+	assert(ext4_journal_handles == 0);
+
+	/* Only one commit at a time */
+	while (j->committing)
+		fibril_condvar_wait(&j->done_cv, &j->lock);
+
+	ext4_transaction_t *txn = j->running;
+	j->commit_request = false;
+
+	if (list_empty(&txn->block_list) && (txn->revoked_count == 0) &&
+	    (!j->aborted || j->abort_handled))
+		return j->aborted ? EIO : EOK;
+
+	j->committing = true;
+
+	/* Let the operations in progress finish and hold off new ones */
+	j->locked = true;
+	while (j->handles > 0)
+		fibril_condvar_wait(&j->handle_cv, &j->lock);
+
+	if (!j->aborted) {
+		rc = ext4_journal_snapshot(j, txn, &lt);
+		if (rc != EOK)
+			ext4_journal_abort(j, rc);
+	}
+
+	/* Open the next transaction */
+	j->running = (txn == &j->txn[0]) ? &j->txn[1] : &j->txn[0];
+	assert(list_empty(&j->running->block_list));
+	j->running->sequence = txn->sequence + 1;
+	j->locked = false;
+	fibril_condvar_broadcast(&j->handle_cv);
+
+	bool aborted = j->aborted;
+	size_t block_count = txn->block_count;
+	fibril_mutex_unlock(&j->lock);
+
+	if (!aborted) {
+		/*
+		 * Write back file data before the metadata referencing it
+		 * is committed. Blocks in use are skipped.
+		 */
+		rc = block_cache_flush(fs->device);
+		if (rc == EBUSY)
+			rc = EOK;
+		if (rc == EOK)
+			rc = ext4_journal_write_transaction(j, txn, lt);
+
+		if (rc == ENOSPC) {
+			/* Wait for older transactions to leave the log */
+			rc = ext4_journal_checkpoint(j, true);
+			if (rc == EOK)
+				rc = ext4_journal_write_transaction(j, txn, lt);
+			if (rc == ENOSPC) {
+				printf("ext4: transaction of %zu blocks does not "
+				    "fit into the journal\n", block_count);
+			}
+		}
+
+		if (rc == EOK)
+			rc = ext4_journal_checkpoint(j, false);
+	}
+
+	/* Let the blocks be written back to their home location */
+	ext4_transaction_release(txn);
+
+	fibril_mutex_lock(&j->lock);
+
+	if ((rc != EOK) && !j->aborted)
+		ext4_journal_abort(j, rc);
+
+	if (j->aborted && !j->abort_handled) {
+		j->abort_handled = true;
+
+		/* Blocks are no longer held until they are logged */
+		ext4_transaction_release(j->running);
+
+		/* The transaction which failed to be written is not in the log */
+		if (!list_empty(&j->logged)) {
+			lt = list_get_instance(list_last(&j->logged),
+			    ext4_journal_logged_t, link);
+			if (lt->start == 0) {
+				list_remove(&lt->link);
+				ext4_journal_logged_destroy(lt);
+			}
+		}
+
+		fibril_mutex_unlock(&j->lock);
+
+		/*
+		 * Mark the volume as possibly inconsistent while it is mounted.
+		 * The log may contain transactions older than what is written
+		 * back now. It is emptied once all their blocks have reached
+		 * their home location.
+		 */
+		ext4_superblock_set_state(fs->superblock,
+		    EXT4_SUPERBLOCK_STATE_ERROR_FS);
+		(void) ext4_superblock_write_direct(fs->device, fs->superblock);
+
+		(void) ext4_journal_checkpoint(j, true);
+		if (j->tail != 0)
+			printf("ext4: journal could not be emptied\n");
+
+		fibril_mutex_lock(&j->lock);
+	}
+
+	j->committing = false;
+	fibril_condvar_broadcast(&j->done_cv);
+
+	return j->aborted ? EIO : EOK;
+}
+
+/** Commit fibril.
+ *
+ * Commits the running transaction every EXT4_JOURNAL_COMMIT_INTERVAL or
+ * sooner when it grows too large.
+ *
+ * @param arg Journal
+ *
+ * @return EOK
+ *
+ */
+static errno_t ext4_journal_committer(void *arg)
+{
+	ext4_journal_t *j = (ext4_journal_t *) arg;
+
+	fibril_mutex_lock(&j->lock);
+	while (!j->stop) {
+		if (!j->commit_request) {
+			(void) fibril_condvar_wait_timeout(&j->commit_cv,
+			    &j->lock, EXT4_JOURNAL_COMMIT_INTERVAL);
+			if (j->stop)
+				break;
+		}
+
+		(void) ext4_journal_commit_locked(j);
+	}
+
+	j->fibril_running = false;
+	fibril_condvar_broadcast(&j->done_cv);
+	fibril_mutex_unlock(&j->lock);
+	return EOK;
+}
+
+/** Compute home address of each journal block.
+ *
+ * @param j     Journal
+ * @param index Index of the journal i-node
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_load_map(ext4_journal_t *j, uint32_t index)
+{
+	ext4_inode_ref_t *inode_ref;
+	errno_t rc = ext4_filesystem_get_inode_ref(j->fs, index, &inode_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint64_t size = ext4_inode_get_size(j->fs->superblock, inode_ref->inode);
+	uint32_t count = size / j->block_size;
+
+	j->map = malloc(count * sizeof(uint32_t));
+	if (j->map == NULL) {
+		ext4_filesystem_put_inode_ref(inode_ref);
+		return ENOMEM;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref, i,
+		    &j->map[i]);
+		if (rc != EOK)
+			break;
+
+		/* The journal must not be sparse */
+		if (j->map[i] == 0) {
+			rc = EINVAL;
+			break;
+		}
+	}
+
+	errno_t rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	if (rc != EOK)
+		return rc;
+	if (rc2 != EOK)
+		return rc2;
+
+	j->max_len = count;
+	return EOK;
+}
+
+/** Read and check journal superblock.
+ *
+ * @param j Journal with the block map loaded
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_load_sb(ext4_journal_t *j)
+{
+	j->sb = malloc(j->block_size);
+	if (j->sb == NULL)
+		return ENOMEM;
+
+	errno_t rc = ext4_journal_read(j, 0, j->sb);
+	if (rc != EOK)
+		return rc;
+
+	ext4_journal_superblock_t *sb = j->sb;
+	uint32_t blocktype = uint32_t_be2host(sb->header.blocktype);
+
+	if ((uint32_t_be2host(sb->header.magic) != EXT4_JOURNAL_MAGIC) ||
+	    ((blocktype != EXT4_JOURNAL_SUPERBLOCK_V1) &&
+	    (blocktype != EXT4_JOURNAL_SUPERBLOCK_V2)))
+		return EINVAL;
+
+	uint32_t max_len = uint32_t_be2host(sb->max_len);
+	uint32_t first = uint32_t_be2host(sb->first);
+
+	if ((uint32_t_be2host(sb->block_size) != j->block_size) ||
+	    (max_len > j->max_len) || (first == 0) || (first >= max_len))
+		return EINVAL;
+
+	j->max_len = max_len;
+	j->first = first;
+	j->features = 0;
+
+	if (blocktype == EXT4_JOURNAL_SUPERBLOCK_V2) {
+		j->features = uint32_t_be2host(sb->features_incompatible);
+		if (j->features & ~EXT4_JOURNAL_FEATURE_INCOMPAT_SUPP)
+			return ENOTSUP;
+
+		memcpy(j->uuid, sb->uuid, EXT4_JOURNAL_UUID_SIZE);
+	}
+
+	j->tag_size = ext4_journal_tag_size(j->features);
+	return EOK;
+}
+
+static void ext4_journal_destroy(ext4_journal_t *j)
+{
+	ext4_transaction_fini(&j->txn[0]);
+	ext4_transaction_fini(&j->txn[1]);
+
+	while (!list_empty(&j->logged)) {
+		ext4_journal_logged_t *lt = list_get_instance(
+		    list_first(&j->logged), ext4_journal_logged_t, link);
+		list_remove(&lt->link);
+		ext4_journal_logged_destroy(lt);
+	}
+
+	free(j->sb);
+	free(j->map);
+	free(j);
+}
+
+/** Open journal of the file system and recover the volume if needed.
+ *
+ * Volumes without a journal are left alone. Journals with checksums are
+ * replayed, but not written, as metadata checksums are not supported.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_open(ext4_filesystem_t *fs)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	errno_t rc;
+
+	fs->journal = NULL;
+
+	if (!ext4_superblock_has_feature_compatible(sb,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL))
+		return EOK;
+
+	/* External journal devices are not supported */
+	uint32_t index = ext4_superblock_get_journal_inode_number(sb);
+	if ((index == 0) || ext4_superblock_has_feature_incompatible(sb,
+	    EXT4_FEATURE_INCOMPAT_JOURNAL_DEV))
+		return ENOTSUP;
+
+	size_t dev_bsize;
+	rc = block_get_bsize(fs->device, &dev_bsize);
+	if (rc != EOK)
+		return rc;
+
+	ext4_journal_t *j = calloc(1, sizeof(ext4_journal_t));
+	if (j == NULL)
+		return ENOMEM;
+
+	j->fs = fs;
+	j->block_size = ext4_superblock_get_block_size(sb);
+	j->pblocks = j->block_size / dev_bsize;
+	fibril_mutex_initialize(&j->lock);
+	fibril_condvar_initialize(&j->handle_cv);
+	fibril_condvar_initialize(&j->commit_cv);
+	fibril_condvar_initialize(&j->done_cv);
+	list_initialize(&j->logged);
+
+	rc = ext4_transaction_init(&j->txn[0], 0);
+	if (rc != EOK) {
+		free(j);
+		return rc;
+	}
+
+	rc = ext4_transaction_init(&j->txn[1], 0);
+	if (rc != EOK) {
+		ext4_transaction_fini(&j->txn[0]);
+		free(j);
+		return rc;
+	}
+
+	rc = ext4_journal_load_map(j, index);
+	if (rc == EOK)
+		rc = ext4_journal_load_sb(j);
+	if (rc == EOK)
+		rc = ext4_journal_recover(j);
+	if (rc != EOK) {
+		ext4_journal_destroy(j);
+		return rc;
+	}
+
+	if (ext4_journal_has_csum(j->features)) {
+		ext4_journal_destroy(j);
+		return EOK;
+	}
+
+	j->running = &j->txn[0];
+	j->running->sequence = uint32_t_be2host(j->sb->sequence);
+	j->head = j->first;
+	j->tail = 0;
+	j->max_transaction = (j->max_len - j->first) / 4;
+
+	fid_t fid = fibril_create(ext4_journal_committer, j);
+	if (fid == 0) {
+		ext4_journal_destroy(j);
+		return ENOMEM;
+	}
+
+	j->fibril_running = true;
+	fs->journal = j;
+	fibril_add_ready(fid);
+
+	return EOK;
+}
+
+/** Commit all changes, checkpoint the log and close the journal.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_close(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+	if (j == NULL)
+		return EOK;
+
+	fibril_mutex_lock(&j->lock);
+
+	j->stop = true;
+	fibril_condvar_broadcast(&j->commit_cv);
+	while (j->fibril_running)
+		fibril_condvar_wait(&j->done_cv, &j->lock);
+
+	errno_t rc = ext4_journal_commit_locked(j);
+	bool aborted = j->aborted;
+
+	fibril_mutex_unlock(&j->lock);
+
+	if (!aborted) {
+		/* Everything in the log reaches its home location */
+		rc = ext4_journal_checkpoint(j, true);
+		if ((rc == EOK) && (j->tail != 0))
+			rc = EBUSY;
+	}
+
+	fs->journal = NULL;
+	ext4_journal_destroy(j);
+	return aborted ? EOK : rc;
+}
+
+/** Start operation modifying the file system.
+ *
+ * Operations may nest, only the outermost one is accounted.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_journal_start(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+	if (j == NULL)
+		return;
+
+	if (ext4_journal_handles++ > 0)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+	while (j->locked)
+		fibril_condvar_wait(&j->handle_cv, &j->lock);
+	j->handles++;
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Finish operation modifying the file system.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_journal_stop(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+	if (j == NULL)
+		return;
+
+	assert(ext4_journal_handles > 0);
+	if (--ext4_journal_handles > 0)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+	assert(j->handles > 0);
+	j->handles--;
+	if ((j->handles == 0) && j->locked)
+		fibril_condvar_broadcast(&j->handle_cv);
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Mark metadata block dirty and add it to the running transaction.
+ *
+ * Used instead of setting the dirty flag directly for all blocks except
+ * file data.
+ *
+ * @param fs    Filesystem
+ * @param block Modified block
+ *
+ */
+void ext4_journal_dirty(ext4_filesystem_t *fs, block_t *block)
+{
+	ext4_journal_t *j = fs->journal;
+
+	block->dirty = true;
+	if (j == NULL)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+
+	if (j->aborted)
+		goto out;
+
+	ext4_transaction_t *txn = j->running;
+
+	/* The block is in use again, a revoke must not hide it */
+	for (size_t i = 0; i < txn->revoked_count; i++) {
+		if (txn->revoked[i] == block->lba) {
+			txn->revoked[i] = txn->revoked[--txn->revoked_count];
+			break;
+		}
+	}
+
+	if (hash_table_find(&txn->blocks, &block->lba) != NULL)
+		goto out;
+
+	ext4_journal_block_t *jb = malloc(sizeof(ext4_journal_block_t));
+	if (jb == NULL) {
+		ext4_journal_abort(j, ENOMEM);
+		goto out;
+	}
+
+	/* Hold the block until the transaction is committed */
+	errno_t rc = block_get(&jb->block, fs->device, block->lba,
+	    BLOCK_FLAGS_NOREAD);
+	if (rc != EOK) {
+		free(jb);
+		ext4_journal_abort(j, rc);
+		goto out;
+	}
+
+	assert(jb->block == block);
+	jb->copy = NULL;
+	hash_table_insert(&txn->blocks, &jb->hash_link);
+	list_append(&jb->link, &txn->block_list);
+	txn->block_count++;
+
+	if ((txn->block_count >= j->max_transaction) && !j->commit_request) {
+		j->commit_request = true;
+		fibril_condvar_signal(&j->commit_cv);
+	}
+
+out:
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Record freed blocks.
+ *
+ * Freed blocks are dropped from the running transaction. If they are in the
+ * log, a revoke record keeps them from being replayed over whatever the
+ * blocks are reused for.
+ *
+ * @param fs    Filesystem
+ * @param first First freed block
+ * @param count Number of freed blocks
+ *
+ */
+void ext4_journal_revoke(ext4_filesystem_t *fs, uint64_t first,
+    uint32_t count)
+{
+	ext4_journal_t *j = fs->journal;
+	if (j == NULL)
+		return;
+
+	fibril_mutex_lock(&j->lock);
+
+	if (j->aborted)
+		goto out;
+
+	ext4_transaction_t *txn = j->running;
+
+	for (uint64_t block = first; block < first + count; block++) {
+		ht_link_t *link = hash_table_find(&txn->blocks, &block);
+		if (link != NULL) {
+			ext4_journal_block_t *jb = hash_table_get_inst(link,
+			    ext4_journal_block_t, hash_link);
+
+			hash_table_remove_item(&txn->blocks, &jb->hash_link);
+			list_remove(&jb->link);
+			txn->block_count--;
+			(void) block_put(jb->block);
+			free(jb);
+		}
+
+		if (!ext4_journal_in_log(j, block))
+			continue;
+
+		if (txn->revoked_count == txn->revoked_size) {
+			size_t size = max(2 * txn->revoked_size, 16);
+			uint64_t *revoked = realloc(txn->revoked,
+			    size * sizeof(uint64_t));
+			if (revoked == NULL) {
+				ext4_journal_abort(j, ENOMEM);
+				goto out;
+			}
+
+			txn->revoked = revoked;
+			txn->revoked_size = size;
+		}
+
+		txn->revoked[txn->revoked_count++] = block;
+	}
+
+out:
+	fibril_mutex_unlock(&j->lock);
+}
+
+/** Commit the running transaction and wait for it to reach the disk.
+ *
+ * Must not be called from within an operation.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_commit(ext4_filesystem_t *fs)
+{
+	ext4_journal_t *j = fs->journal;
+	if (j == NULL)
+		return EOK;
+
+	fibril_mutex_lock(&j->lock);
+	errno_t rc = ext4_journal_commit_locked(j);
+	fibril_mutex_unlock(&j->lock);
+
+	return rc;
+}
+
+/**
+ * @}
+ */
@@ -50,6 +50,7 @@
 #include "ext4/directory_index.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/filesystem.h"
 #include "ext4/fstypes.h"
@@ -333,6 +334,7 @@ errno_t ext4_node_get_core(fs_node_t **rfn, ext4_instance_t *inst,
 	enode->inode_ref = inode_ref;
 	enode->instance = inst;
 	enode->references = 1;
+	fibril_rwlock_initialize(&enode->contents_lock);
 	enode->fs_node = fs_node;
 
 	fs_node->data = enode;
@@ -461,6 +463,7 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	enode->inode_ref = inode_ref;
 	enode->instance = inst;
 	enode->references = 1;
+	fibril_rwlock_initialize(&enode->contents_lock);
 
 	fibril_mutex_lock(&open_nodes_lock);
 	hash_table_insert(&open_nodes, &enode->link);
@@ -889,7 +892,8 @@ libfs_ops_t ext4_libfs_ops = {
 	.service_get = ext4_service_get,
 	.size_block = ext4_size_block,
 	.total_block_count = ext4_total_block_count,
-	.free_block_count = ext4_free_block_count
+	.free_block_count = ext4_free_block_count,
+	.cache_stats = block_cache_stats
 };
 
 /*
@@ -1035,21 +1039,20 @@ static errno_t ext4_read(service_id_t service_id, fs_index_t index, aoff64_t pos
 		return EINVAL;
 	}
 
-	ext4_instance_t *inst;
-	errno_t rc = ext4_instance_get(service_id, &inst);
-	if (rc != EOK) {
-		async_answer_0(&call, rc);
-		return rc;
-	}
-
 	/* Load i-node */
-	ext4_inode_ref_t *inode_ref;
-	rc = ext4_filesystem_get_inode_ref(inst->filesystem, index, &inode_ref);
+	fs_node_t *fn;
+	errno_t rc = ext4_node_get(&fn, service_id, index);
 	if (rc != EOK) {
 		async_answer_0(&call, rc);
 		return rc;
 	}
 
+	ext4_node_t *enode = EXT4_NODE(fn);
+	ext4_instance_t *inst = enode->instance;
+	ext4_inode_ref_t *inode_ref = enode->inode_ref;
+
+	fibril_rwlock_read_lock(&enode->contents_lock);
+
 	/* Read from i-node by type */
 	if (ext4_inode_is_type(inst->filesystem->superblock, inode_ref->inode,
 	    EXT4_INODE_MODE_FILE)) {
@@ -1065,7 +1068,9 @@ static errno_t ext4_read(service_id_t service_id, fs_index_t index, aoff64_t pos
 		rc = ENOTSUP;
 	}
 
-	errno_t const rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	fibril_rwlock_read_unlock(&enode->contents_lock);
+
+	errno_t const rc2 = ext4_node_put(fn);
 
 	return rc == EOK ? rc2 : rc;
 }
@@ -1286,6 +1291,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 {
 	fs_node_t *fn;
 	errno_t rc2;
+	bool exclusive = false;
 	errno_t rc = ext4_node_get(&fn, service_id, index);
 	if (rc != EOK)
 		return rc;
@@ -1315,11 +1321,34 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	/* Load inode */
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
+
+	/*
+	 * Overwriting already allocated contents does not modify the i-node
+	 * and can run in parallel with reads and other such writes. Anything
+	 * else needs the node for itself.
+	 */
+	fibril_rwlock_read_lock(&enode->contents_lock);
+	if (pos + bytes > ext4_inode_get_size(fs->superblock,
+	    inode_ref->inode)) {
+		fibril_rwlock_read_unlock(&enode->contents_lock);
+		fibril_rwlock_write_lock(&enode->contents_lock);
+		exclusive = true;
+	}
+
+retry:
 	rc = ext4_filesystem_get_inode_data_block_index(inode_ref, iblock,
 	    &fblock);
 	if (rc != EOK) {
 		async_answer_0(&call, rc);
-		goto exit;
+		goto unlock;
+	}
+
+	if (fblock == 0 && !exclusive) {
+		/* Filling a hole modifies the i-node. */
+		fibril_rwlock_read_unlock(&enode->contents_lock);
+		fibril_rwlock_write_lock(&enode->contents_lock);
+		exclusive = true;
+		goto retry;
 	}
 
 	/* Check for sparse file */
@@ -1336,7 +1365,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 				    &fblock, true);
 				if (rc != EOK) {
 					async_answer_0(&call, rc);
-					goto exit;
+					goto unlock;
 				}
 			}
 
@@ -1344,13 +1373,13 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 			    &fblock, false);
 			if (rc != EOK) {
 				async_answer_0(&call, rc);
-				goto exit;
+				goto unlock;
 			}
 		} else {
 			rc = ext4_balloc_alloc_block(inode_ref, &fblock);
 			if (rc != EOK) {
 				async_answer_0(&call, rc);
-				goto exit;
+				goto unlock;
 			}
 
 			rc = ext4_filesystem_set_inode_data_block_index(inode_ref,
@@ -1358,7 +1387,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 			if (rc != EOK) {
 				ext4_balloc_free_block(inode_ref, fblock);
 				async_answer_0(&call, rc);
-				goto exit;
+				goto unlock;
 			}
 		}
 
@@ -1371,7 +1400,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 	rc = block_get(&write_block, service_id, fblock, flags);
 	if (rc != EOK) {
 		async_answer_0(&call, rc);
-		goto exit;
+		goto unlock;
 	}
 
 	if (flags == BLOCK_FLAGS_NOREAD)
@@ -1381,14 +1410,14 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 	    (pos % block_size), bytes);
 	if (rc != EOK) {
 		block_put(write_block);
-		goto exit;
+		goto unlock;
 	}
 
 	write_block->dirty = true;
 
 	rc = block_put(write_block);
 	if (rc != EOK)
-		goto exit;
+		goto unlock;
 
 	/* Do some counting */
 	uint32_t old_inode_size = ext4_inode_get_size(fs->superblock,
@@ -1401,6 +1430,12 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 	*nsize = ext4_inode_get_size(fs->superblock, inode_ref->inode);
 	*wbytes = bytes;
 
+unlock:
+	if (exclusive)
+		fibril_rwlock_write_unlock(&enode->contents_lock);
+	else
+		fibril_rwlock_read_unlock(&enode->contents_lock);
+
 exit:
 	rc2 = ext4_node_put(fn);
 	return rc == EOK ? rc2 : rc;
@@ -1428,7 +1463,10 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
 
+	fibril_rwlock_write_lock(&enode->contents_lock);
 	rc = ext4_filesystem_truncate_inode(inode_ref, new_size);
+	fibril_rwlock_write_unlock(&enode->contents_lock);
+
 	errno_t const rc2 = ext4_node_put(fn);
 
 	return rc == EOK ? rc2 : rc;
@@ -1444,7 +1482,13 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
  */
 static errno_t ext4_close(service_id_t service_id, fs_index_t index)
 {
-	return EOK;
+	ext4_instance_t *inst;
+	errno_t rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+
+	/* Unused preallocated blocks must not outlive the open file */
+	return ext4_balloc_discard_prealloc(inst->filesystem, index);
 }
 
 /** Destroy node specified by index.
@@ -1480,9 +1524,15 @@ static errno_t ext4_sync(service_id_t service_id, fs_index_t index)
 		return rc;
 
 	ext4_node_t *enode = EXT4_NODE(fn);
+	ext4_filesystem_t *fs = enode->instance->filesystem;
 	enode->inode_ref->dirty = true;
 
-	return ext4_node_put(fn);
+	rc = ext4_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	/* Make everything done so far durable */
+	return ext4_journal_commit(fs);
 }
 
 /** VFS operations
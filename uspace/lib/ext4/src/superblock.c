@@ -988,6 +988,20 @@ void ext4_superblock_set_last_orphan(ext4_superblock_t *sb,
 	sb->last_orphan = host2uint32_t_le(last_orphan);
 }
 
+/** Get index of the i-node containing the journal.
+ *
+ * Valid only if EXT4_FEATURE_COMPAT_HAS_JOURNAL is set.
+ *
+ * @param sb Superblock
+ *
+ * @return Journal i-node index, 0 for an external journal
+ *
+ */
+uint32_t ext4_superblock_get_journal_inode_number(ext4_superblock_t *sb)
+{
+	return uint32_t_le2host(sb->journal_inode_number);
+}
+
 /** Get hash seed for directory index hash function.
  *
  * @param sb Superblock
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <byteorder.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include "ext4/types.h"
+#include "../private/journal.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(journal);
+
+enum {
+	test_block_size = 4096
+};
+
+static const uint8_t test_uuid[16] = {
+	1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+
+/** Lay out a transaction the same way the commit does.
+ *
+ * @param features Journal incompatible features
+ * @param count    Number of logged blocks
+ * @param tag_size Size of a block tag
+ */
+static void test_transaction(uint32_t features, size_t count,
+    size_t tag_size)
+{
+	size_t tags_per_desc = ext4_journal_desc_tags(test_block_size,
+	    features);
+	size_t desc_count = (count + tags_per_desc - 1) / tags_per_desc;
+
+	uint8_t *meta = calloc(desc_count, test_block_size);
+	uint8_t *blocks = calloc(count, test_block_size);
+	uint64_t *lba = calloc(count, sizeof(uint64_t));
+	void **data = calloc(count, sizeof(void *));
+	PCUT_ASSERT_NOT_NULL(meta);
+	PCUT_ASSERT_NOT_NULL(blocks);
+	PCUT_ASSERT_NOT_NULL(lba);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	for (size_t i = 0; i < count; i++) {
+		lba[i] = UINT64_C(0x100000000) + i;
+		data[i] = blocks + i * test_block_size;
+	}
+
+	/* One logged block looks like a journal block and must be escaped */
+	*(uint32_t *) data[count - 1] = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+
+	size_t done = 0;
+	size_t used = 0;
+	while (done < count) {
+		PCUT_ASSERT_TRUE(used < desc_count);
+
+		uint8_t *desc = meta + used * test_block_size;
+		size_t tags = ext4_journal_desc_fill(desc, test_block_size,
+		    features, test_uuid, 7, &lba[done], &data[done],
+		    count - done);
+		PCUT_ASSERT_TRUE(tags <= tags_per_desc);
+
+		/* All tags, including the first one's UUID, fit */
+		size_t end = sizeof(ext4_journal_header_t) + 16 +
+		    tags * tag_size;
+		PCUT_ASSERT_TRUE(end <= test_block_size);
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(desc +
+		    sizeof(ext4_journal_header_t) + tag_size, test_uuid, 16));
+
+		ext4_journal_block_tag_t *last = (ext4_journal_block_tag_t *)
+		    (desc + end - tag_size);
+		PCUT_ASSERT_TRUE((uint16_t_be2host(last->flags) &
+		    EXT4_JOURNAL_FLAG_LAST_TAG) != 0);
+		PCUT_ASSERT_INT_EQUALS((uint32_t) lba[done + tags - 1],
+		    uint32_t_be2host(last->blocknr));
+
+		done += tags;
+		used++;
+	}
+
+	PCUT_ASSERT_INT_EQUALS(desc_count, used);
+	PCUT_ASSERT_INT_EQUALS(0, *(uint32_t *) data[count - 1]);
+
+	free(meta);
+	free(blocks);
+	free(lba);
+	free(data);
+}
+
+/** Number of tags per descriptor block accounts for the UUID */
+PCUT_TEST(desc_tags)
+{
+	PCUT_ASSERT_INT_EQUALS(508, ext4_journal_desc_tags(test_block_size, 0));
+	PCUT_ASSERT_INT_EQUALS(339, ext4_journal_desc_tags(test_block_size,
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT));
+}
+
+/** Transaction one block longer than a descriptor block can describe */
+PCUT_TEST(transaction_desc_overflow)
+{
+	size_t tags = ext4_journal_desc_tags(test_block_size, 0);
+	test_transaction(0, tags + 1, 8);
+}
+
+/** Same with 64-bit block numbers */
+PCUT_TEST(transaction_desc_overflow_64bit)
+{
+	uint32_t features = EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT;
+	size_t tags = ext4_journal_desc_tags(test_block_size, features);
+	test_transaction(features, tags + 1, 12);
+}
+
+/** Transaction which exactly fills a descriptor block */
+PCUT_TEST(transaction_desc_full)
+{
+	size_t tags = ext4_journal_desc_tags(test_block_size, 0);
+	test_transaction(0, tags, 8);
+}
+
+PCUT_EXPORT(journal);
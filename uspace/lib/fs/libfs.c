@@ -75,6 +75,7 @@ static void libfs_lookup(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_stat(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_open_node(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_statfs(libfs_ops_t *, fs_handle_t, ipc_call_t *);
+static void libfs_cache_stats(libfs_ops_t *, ipc_call_t *);
 
 static void vfs_out_fsprobe(ipc_call_t *req)
 {
@@ -185,6 +186,24 @@ static void vfs_out_write(ipc_call_t *req)
 		async_answer_0(req, rc);
 }
 
+static void vfs_out_page_map(ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
+	fs_index_t index = (fs_index_t) ipc_get_arg2(req);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(ipc_get_arg3(req),
+	    ipc_get_arg4(req));
+	errno_t rc;
+
+	if (vfs_out_ops->page_map == NULL) {
+		async_answer_0(req, ENOTSUP);
+		return;
+	}
+
+	rc = vfs_out_ops->page_map(service_id, index, pos);
+
+	async_answer_0(req, rc);
+}
+
 static void vfs_out_truncate(ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
@@ -252,6 +271,11 @@ static void vfs_out_statfs(ipc_call_t *req)
 	libfs_statfs(libfs_ops, reg.fs_handle, req);
 }
 
+static void vfs_out_cache_stats(ipc_call_t *req)
+{
+	libfs_cache_stats(libfs_ops, req);
+}
+
 static void vfs_out_is_empty(ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
@@ -316,6 +340,9 @@ static void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_OUT_WRITE:
 			vfs_out_write(&call);
 			break;
+		case VFS_OUT_PAGE_MAP:
+			vfs_out_page_map(&call);
+			break;
 		case VFS_OUT_TRUNCATE:
 			vfs_out_truncate(&call);
 			break;
@@ -337,6 +364,9 @@ static void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_OUT_STATFS:
 			vfs_out_statfs(&call);
 			break;
+		case VFS_OUT_CACHE_STATS:
+			vfs_out_cache_stats(&call);
+			break;
 		case VFS_OUT_IS_EMPTY:
 			vfs_out_is_empty(&call);
 			break;
@@ -800,6 +830,39 @@ error:
 	async_answer_0(req, EINVAL);
 }
 
+void libfs_cache_stats(libfs_ops_t *ops, ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
+
+	ipc_call_t call;
+	size_t size;
+	if ((!async_data_read_receive(&call, &size)) ||
+	    (size != sizeof(vfs_cache_stats_t))) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(req, EINVAL);
+		return;
+	}
+
+	if (ops->cache_stats == NULL) {
+		async_answer_0(&call, ENOTSUP);
+		async_answer_0(req, ENOTSUP);
+		return;
+	}
+
+	vfs_cache_stats_t st;
+	memset(&st, 0, sizeof(vfs_cache_stats_t));
+
+	errno_t rc = ops->cache_stats(service_id, &st);
+	if (rc != EOK) {
+		async_answer_0(&call, rc);
+		async_answer_0(req, rc);
+		return;
+	}
+
+	async_data_read_finalize(&call, &st, sizeof(vfs_cache_stats_t));
+	async_answer_0(req, EOK);
+}
+
 /** Open VFS triplet.
  *
  * @param ops libfs operations structure with function pointers to
@@ -37,6 +37,7 @@
 #define LIBFS_LIBFS_H_
 
 #include <ipc/vfs.h>
+#include <vfs/vfs.h>
 #include <offset.h>
 #include <async.h>
 #include <loc.h>
@@ -52,6 +53,8 @@ typedef struct {
 	errno_t (*close)(service_id_t, fs_index_t);
 	errno_t (*destroy)(service_id_t, fs_index_t);
 	errno_t (*sync)(service_id_t, fs_index_t);
+	/* Optional, see vfs_info_t.page_map */
+	errno_t (*page_map)(service_id_t, fs_index_t, aoff64_t);
 } vfs_out_ops_t;
 
 typedef struct {
@@ -87,6 +90,7 @@ typedef struct {
 	errno_t (*size_block)(service_id_t, uint32_t *);
 	errno_t (*total_block_count)(service_id_t, uint64_t *);
 	errno_t (*free_block_count)(service_id_t, uint64_t *);
+	errno_t (*cache_stats)(service_id_t, vfs_cache_stats_t *);
 } libfs_ops_t;
 
 typedef struct {
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libmemgfx
+ * @{
+ */
+/**
+ * @file Scanline blitting kernels
+ *
+ * Each function processes a single run of adjacent pixels. Where the
+ * target has a vector unit that is always available (SSE2 on amd64,
+ * Advanced SIMD on arm64) the color key kernels process four pixels at
+ * a time, otherwise they fall back to plain C.
+ */
+
+#include <io/pixel.h>
+#include <mem.h>
+#include <stddef.h>
+#include "../private/blit.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/** Copy a run of pixels.
+ *
+ * @param dst Destination
+ * @param src Source
+ * @param n Number of pixels
+ */
+void mem_gc_row_copy(pixel_t *dst, const pixel_t *src, size_t n)
+{
+	memcpy(dst, src, n * sizeof(pixel_t));
+}
+
+/** Fill a run of pixels with a constant color.
+ *
+ * @param dst Destination
+ * @param color Color
+ * @param n Number of pixels
+ */
+void mem_gc_row_fill(pixel_t *dst, pixel_t color, size_t n)
+{
+#if defined(__SSE2__)
+	__m128i vcolor = _mm_set1_epi32(color);
+
+	for (; n >= 4; n -= 4, dst += 4)
+		_mm_storeu_si128((__m128i *) dst, vcolor);
+#elif defined(__ARM_NEON)
+	uint32x4_t vcolor = vdupq_n_u32(color);
+
+	for (; n >= 4; n -= 4, dst += 4)
+		vst1q_u32(dst, vcolor);
+#endif
+	for (; n > 0; n--)
+		*dst++ = color;
+}
+
+/** Copy a run of pixels, skipping pixels equal to the key color.
+ *
+ * @param dst Destination
+ * @param src Source
+ * @param n Number of pixels
+ * @param key Key color
+ */
+void mem_gc_row_key(pixel_t *dst, const pixel_t *src, size_t n, pixel_t key)
+{
+#if defined(__SSE2__)
+	__m128i vkey = _mm_set1_epi32(key);
+	__m128i s, d, m;
+
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		s = _mm_loadu_si128((const __m128i *) src);
+		m = _mm_cmpeq_epi32(s, vkey);
+		d = _mm_loadu_si128((const __m128i *) dst);
+		d = _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, s));
+		_mm_storeu_si128((__m128i *) dst, d);
+	}
+#elif defined(__ARM_NEON)
+	uint32x4_t vkey = vdupq_n_u32(key);
+	uint32x4_t s, d, m;
+
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		s = vld1q_u32(src);
+		m = vceqq_u32(s, vkey);
+		d = vld1q_u32(dst);
+		vst1q_u32(dst, vbslq_u32(m, d, s));
+	}
+#endif
+	for (; n > 0; n--, dst++, src++) {
+		if (*src != key)
+			*dst = *src;
+	}
+}
+
+/** Paint a run of pixels with a color where the source differs from key.
+ *
+ * @param dst Destination
+ * @param src Source
+ * @param n Number of pixels
+ * @param key Key color
+ * @param color Color to paint non-key pixels with
+ */
+void mem_gc_row_key_colorize(pixel_t *dst, const pixel_t *src, size_t n,
+    pixel_t key, pixel_t color)
+{
+#if defined(__SSE2__)
+	__m128i vkey = _mm_set1_epi32(key);
+	__m128i vcolor = _mm_set1_epi32(color);
+	__m128i s, d, m;
+
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		s = _mm_loadu_si128((const __m128i *) src);
+		m = _mm_cmpeq_epi32(s, vkey);
+		d = _mm_loadu_si128((const __m128i *) dst);
+		d = _mm_or_si128(_mm_and_si128(m, d),
+		    _mm_andnot_si128(m, vcolor));
+		_mm_storeu_si128((__m128i *) dst, d);
+	}
+#elif defined(__ARM_NEON)
+	uint32x4_t vkey = vdupq_n_u32(key);
+	uint32x4_t vcolor = vdupq_n_u32(color);
+	uint32x4_t s, d, m;
+
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		s = vld1q_u32(src);
+		m = vceqq_u32(s, vkey);
+		d = vld1q_u32(dst);
+		vst1q_u32(dst, vbslq_u32(m, d, vcolor));
+	}
+#endif
+	for (; n > 0; n--, dst++, src++) {
+		if (*src != key)
+			*dst = color;
+	}
+}
+
+/** @}
+ */
@@ -42,9 +42,9 @@
 #include <gfx/context.h>
 #include <gfx/render.h>
 #include <io/pixel.h>
-#include <io/pixelmap.h>
 #include <memgfx/memgc.h>
 #include <stdlib.h>
+#include "../private/blit.h"
 #include "../private/memgc.h"
 
 static errno_t mem_gc_set_clip_rect(void *, gfx_rect_t *);
@@ -56,6 +56,8 @@ static errno_t mem_gc_bitmap_create(void *, gfx_bitmap_params_t *,
 static errno_t mem_gc_bitmap_destroy(void *);
 static errno_t mem_gc_bitmap_render(void *, gfx_rect_t *, gfx_coord2_t *);
 static errno_t mem_gc_bitmap_get_alloc(void *, gfx_bitmap_alloc_t *);
+static pixel_t *mem_gc_pixel_at(gfx_bitmap_alloc_t *, gfx_coord_t,
+    gfx_coord_t);
 static void mem_gc_invalidate_rect(mem_gc_t *, gfx_rect_t *);
 
 gfx_context_ops_t mem_gc_ops = {
@@ -118,8 +120,8 @@ static errno_t mem_gc_fill_rect(void *arg, gfx_rect_t *rect)
 {
 	mem_gc_t *mgc = (mem_gc_t *) arg;
 	gfx_rect_t crect;
-	gfx_coord_t x, y;
-	pixelmap_t pixelmap;
+	gfx_coord_t y;
+	pixel_t *drow;
 
 	/* Make sure we have a sorted, clipped rectangle */
 	gfx_rect_clip(rect, &mgc->clip_rect, &crect);
@@ -127,14 +129,10 @@ static errno_t mem_gc_fill_rect(void *arg, gfx_rect_t *rect)
 	assert(mgc->rect.p0.x == 0);
 	assert(mgc->rect.p0.y == 0);
 	assert(mgc->alloc.pitch == mgc->rect.p1.x * (int)sizeof(uint32_t));
-	pixelmap.width = mgc->rect.p1.x;
-	pixelmap.height = mgc->rect.p1.y;
-	pixelmap.data = mgc->alloc.pixels;
 
 	for (y = crect.p0.y; y < crect.p1.y; y++) {
-		for (x = crect.p0.x; x < crect.p1.x; x++) {
-			pixelmap_put_pixel(&pixelmap, x, y, mgc->color);
-		}
+		drow = mem_gc_pixel_at(&mgc->alloc, crect.p0.x, y);
+		mem_gc_row_fill(drow, mgc->color, crect.p1.x - crect.p0.x);
 	}
 
 	mem_gc_invalidate_rect(mgc, &crect);
@@ -243,6 +241,19 @@ gfx_context_t *mem_gc_get_ctx(mem_gc_t *mgc)
 	return mgc->gc;
 }
 
+/** Get pointer to pixel in a memory block.
+ *
+ * @param alloc Allocation info
+ * @param x X coordinate relative to the start of the block
+ * @param y Y coordinate relative to the start of the block
+ * @return Pointer to pixel
+ */
+static pixel_t *mem_gc_pixel_at(gfx_bitmap_alloc_t *alloc, gfx_coord_t x,
+    gfx_coord_t y)
+{
+	return (pixel_t *)((char *) alloc->pixels + y * alloc->pitch) + x;
+}
+
 static void mem_gc_invalidate_rect(mem_gc_t *mgc, gfx_rect_t *rect)
 {
 	mgc->invalidate(mgc->cb_arg, rect);
@@ -373,10 +384,11 @@ static errno_t mem_gc_bitmap_render(void *bm, gfx_rect_t *srect0,
 	gfx_rect_t drect;
 	gfx_rect_t crect;
 	gfx_coord2_t offs;
-	gfx_coord_t x, y;
-	pixelmap_t smap;
-	pixelmap_t dmap;
-	pixel_t pixel;
+	gfx_coord_t y;
+	gfx_coord_t sx, sy;
+	size_t width;
+	pixel_t *srow;
+	pixel_t *drow;
 
 	if (srect0 != NULL)
 		gfx_rect_clip(srect0, &mbm->rect, &srect);
@@ -398,51 +410,39 @@ static errno_t mem_gc_bitmap_render(void *bm, gfx_rect_t *srect0,
 
 	assert(mbm->alloc.pitch == (mbm->rect.p1.x - mbm->rect.p0.x) *
 	    (int)sizeof(uint32_t));
-	smap.width = mbm->rect.p1.x - mbm->rect.p0.x;
-	smap.height = mbm->rect.p1.y - mbm->rect.p0.y;
-	smap.data = mbm->alloc.pixels;
 
 	assert(mbm->mgc->rect.p0.x == 0);
 	assert(mbm->mgc->rect.p0.y == 0);
 	assert(mbm->mgc->alloc.pitch == mbm->mgc->rect.p1.x * (int)sizeof(uint32_t));
-	dmap.width = mbm->mgc->rect.p1.x;
-	dmap.height = mbm->mgc->rect.p1.y;
-	dmap.data = mbm->mgc->alloc.pixels;
+
+	/* Position of the top-left corner of crect within the bitmap */
+	sx = crect.p0.x - mbm->rect.p0.x - offs.x;
+	sy = crect.p0.y - mbm->rect.p0.y - offs.y;
+	width = crect.p1.x - crect.p0.x;
 
 	if ((mbm->flags & bmpf_direct_output) != 0) {
 		/* Nothing to do */
 	} else if ((mbm->flags & bmpf_color_key) == 0) {
 		/* Simple copy */
-		for (y = crect.p0.y; y < crect.p1.y; y++) {
-			for (x = crect.p0.x; x < crect.p1.x; x++) {
-				pixel = pixelmap_get_pixel(&smap,
-				    x - mbm->rect.p0.x - offs.x,
-				    y - mbm->rect.p0.y - offs.y);
-				pixelmap_put_pixel(&dmap, x, y, pixel);
-			}
+		for (y = crect.p0.y; y < crect.p1.y; y++, sy++) {
+			srow = mem_gc_pixel_at(&mbm->alloc, sx, sy);
+			drow = mem_gc_pixel_at(&mbm->mgc->alloc, crect.p0.x, y);
+			mem_gc_row_copy(drow, srow, width);
 		}
 	} else if ((mbm->flags & bmpf_colorize) == 0) {
 		/* Color key */
-		for (y = crect.p0.y; y < crect.p1.y; y++) {
-			for (x = crect.p0.x; x < crect.p1.x; x++) {
-				pixel = pixelmap_get_pixel(&smap,
-				    x - mbm->rect.p0.x - offs.x,
-				    y - mbm->rect.p0.y - offs.y);
-				if (pixel != mbm->key_color)
-					pixelmap_put_pixel(&dmap, x, y, pixel);
-			}
+		for (y = crect.p0.y; y < crect.p1.y; y++, sy++) {
+			srow = mem_gc_pixel_at(&mbm->alloc, sx, sy);
+			drow = mem_gc_pixel_at(&mbm->mgc->alloc, crect.p0.x, y);
+			mem_gc_row_key(drow, srow, width, mbm->key_color);
 		}
 	} else {
 		/* Color key & colorization */
-		for (y = crect.p0.y; y < crect.p1.y; y++) {
-			for (x = crect.p0.x; x < crect.p1.x; x++) {
-				pixel = pixelmap_get_pixel(&smap,
-				    x - mbm->rect.p0.x - offs.x,
-				    y - mbm->rect.p0.y - offs.y);
-				if (pixel != mbm->key_color)
-					pixelmap_put_pixel(&dmap, x, y,
-					    mbm->mgc->color);
-			}
+		for (y = crect.p0.y; y < crect.p1.y; y++, sy++) {
+			srow = mem_gc_pixel_at(&mbm->alloc, sx, sy);
+			drow = mem_gc_pixel_at(&mbm->mgc->alloc, crect.p0.x, y);
+			mem_gc_row_key_colorize(drow, srow, width,
+			    mbm->key_color, mbm->mgc->color);
 		}
 	}
 
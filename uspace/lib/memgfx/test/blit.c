@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <io/pixel.h>
+#include <pcut/pcut.h>
+#include <stddef.h>
+#include "../private/blit.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(blit);
+
+/** Longest run tested, long enough to cover vector loop and tail */
+#define RUN_MAX 19
+
+static pixel_t src[RUN_MAX + 1];
+static pixel_t dst[RUN_MAX + 1];
+
+/** Fill source with a pattern that contains the key color 1 */
+static void test_init(void)
+{
+	size_t i;
+
+	for (i = 0; i < RUN_MAX + 1; i++) {
+		src[i] = (i % 3 == 0) ? 1 : PIXEL(0, i, 2 * i, 3 * i);
+		dst[i] = PIXEL(0, 255, 0, 255);
+	}
+}
+
+/** Copying a run copies exactly that many pixels */
+PCUT_TEST(row_copy)
+{
+	size_t n, i;
+
+	for (n = 0; n <= RUN_MAX; n++) {
+		test_init();
+		mem_gc_row_copy(dst, src, n);
+
+		for (i = 0; i < n; i++)
+			PCUT_ASSERT_INT_EQUALS(src[i], dst[i]);
+		PCUT_ASSERT_INT_EQUALS(PIXEL(0, 255, 0, 255), dst[n]);
+	}
+}
+
+/** Filling a run fills exactly that many pixels */
+PCUT_TEST(row_fill)
+{
+	size_t n, i;
+
+	for (n = 0; n <= RUN_MAX; n++) {
+		test_init();
+		mem_gc_row_fill(dst, PIXEL(0, 1, 2, 3), n);
+
+		for (i = 0; i < n; i++)
+			PCUT_ASSERT_INT_EQUALS(PIXEL(0, 1, 2, 3), dst[i]);
+		PCUT_ASSERT_INT_EQUALS(PIXEL(0, 255, 0, 255), dst[n]);
+	}
+}
+
+/** Color key copy leaves pixels matching the key color untouched */
+PCUT_TEST(row_key)
+{
+	size_t n, i;
+
+	for (n = 0; n <= RUN_MAX; n++) {
+		test_init();
+		mem_gc_row_key(dst, src, n, 1);
+
+		for (i = 0; i < n; i++) {
+			PCUT_ASSERT_INT_EQUALS(src[i] == 1 ?
+			    PIXEL(0, 255, 0, 255) : src[i], dst[i]);
+		}
+		PCUT_ASSERT_INT_EQUALS(PIXEL(0, 255, 0, 255), dst[n]);
+	}
+}
+
+/** Colorization paints pixels not matching the key color */
+PCUT_TEST(row_key_colorize)
+{
+	size_t n, i;
+
+	for (n = 0; n <= RUN_MAX; n++) {
+		test_init();
+		mem_gc_row_key_colorize(dst, src, n, 1, PIXEL(0, 1, 2, 3));
+
+		for (i = 0; i < n; i++) {
+			PCUT_ASSERT_INT_EQUALS(src[i] == 1 ?
+			    PIXEL(0, 255, 0, 255) : PIXEL(0, 1, 2, 3), dst[i]);
+		}
+		PCUT_ASSERT_INT_EQUALS(PIXEL(0, 255, 0, 255), dst[n]);
+	}
+}
+
+PCUT_EXPORT(blit);
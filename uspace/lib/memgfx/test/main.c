@@ -30,6 +30,7 @@
 
 PCUT_INIT;
 
+PCUT_IMPORT(blit);
 PCUT_IMPORT(memgfx);
 
 PCUT_MAIN();
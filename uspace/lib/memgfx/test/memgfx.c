@@ -255,6 +255,117 @@ PCUT_TEST(bitmap_render)
 	free(alloc.pixels);
 }
 
+/** Test rendering a color-keyed bitmap with offset in memory GC */
+PCUT_TEST(bitmap_render_key_offs)
+{
+	mem_gc_t *mgc;
+	gfx_rect_t rect;
+	gfx_bitmap_alloc_t alloc;
+	gfx_context_t *gc;
+	gfx_coord2_t pos;
+	gfx_coord2_t offs;
+	gfx_coord2_t spos;
+	gfx_bitmap_params_t params;
+	gfx_bitmap_alloc_t balloc;
+	gfx_bitmap_t *bitmap;
+	pixelmap_t bpmap;
+	pixelmap_t dpmap;
+	pixel_t pixel;
+	pixel_t expected;
+	test_resp_t resp;
+	errno_t rc;
+
+	/* Bounding rectangle for memory GC */
+	rect.p0.x = 0;
+	rect.p0.y = 0;
+	rect.p1.x = 10;
+	rect.p1.y = 10;
+
+	alloc.pitch = (rect.p1.x - rect.p0.x) * sizeof(uint32_t);
+	alloc.off0 = 0;
+	alloc.pixels = calloc(1, alloc.pitch * (rect.p1.y - rect.p0.y));
+	PCUT_ASSERT_NOT_NULL(alloc.pixels);
+
+	rc = mem_gc_create(&rect, &alloc, test_invalidate_rect,
+	    test_update, &resp, &mgc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	gc = mem_gc_get_ctx(mgc);
+	PCUT_ASSERT_NOT_NULL(gc);
+
+	/* Create bitmap that does not start at the origin */
+
+	gfx_bitmap_params_init(&params);
+	params.rect.p0.x = 1;
+	params.rect.p0.y = 2;
+	params.rect.p1.x = 8;
+	params.rect.p1.y = 6;
+	params.flags = bmpf_color_key;
+	params.key_color = PIXEL(0, 255, 0, 255);
+
+	rc = gfx_bitmap_create(gc, &params, NULL, &bitmap);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = gfx_bitmap_get_alloc(bitmap, &balloc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	bpmap.width = params.rect.p1.x - params.rect.p0.x;
+	bpmap.height = params.rect.p1.y - params.rect.p0.y;
+	bpmap.data = balloc.pixels;
+
+	/* Fill bitmap with a pattern where every third pixel is key color */
+	for (pos.y = 0; pos.y < (gfx_coord_t) bpmap.height; pos.y++) {
+		for (pos.x = 0; pos.x < (gfx_coord_t) bpmap.width; pos.x++) {
+			pixelmap_put_pixel(&bpmap, pos.x, pos.y,
+			    (pos.x + pos.y) % 3 == 0 ? params.key_color :
+			    PIXEL(0, pos.x, pos.y, 1));
+		}
+	}
+
+	dpmap.width = rect.p1.x - rect.p0.x;
+	dpmap.height = rect.p1.y - rect.p0.y;
+	dpmap.data = alloc.pixels;
+
+	memset(&resp, 0, sizeof(resp));
+
+	/* Render the bitmap, part of it ends up outside of the GC */
+	offs.x = 3;
+	offs.y = 1;
+	rc = gfx_bitmap_render(bitmap, NULL, &offs);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Check non-key pixels are copied and nothing else is touched */
+	for (pos.y = rect.p0.y; pos.y < rect.p1.y; pos.y++) {
+		for (pos.x = rect.p0.x; pos.x < rect.p1.x; pos.x++) {
+			gfx_coord2_subtract(&pos, &offs, &spos);
+			if (gfx_pix_inside_rect(&spos, &params.rect)) {
+				gfx_coord2_subtract(&spos, &params.rect.p0,
+				    &spos);
+				expected = pixelmap_get_pixel(&bpmap, spos.x,
+				    spos.y);
+				if (expected == params.key_color)
+					expected = PIXEL(0, 0, 0, 0);
+			} else {
+				expected = PIXEL(0, 0, 0, 0);
+			}
+
+			pixel = pixelmap_get_pixel(&dpmap, pos.x, pos.y);
+			PCUT_ASSERT_INT_EQUALS(expected, pixel);
+		}
+	}
+
+	/* Invalidate rect is the bitmap rect translated and clipped */
+	PCUT_ASSERT_TRUE(resp.invalidate_called);
+	PCUT_ASSERT_INT_EQUALS(4, resp.inv_rect.p0.x);
+	PCUT_ASSERT_INT_EQUALS(3, resp.inv_rect.p0.y);
+	PCUT_ASSERT_INT_EQUALS(10, resp.inv_rect.p1.x);
+	PCUT_ASSERT_INT_EQUALS(7, resp.inv_rect.p1.y);
+
+	gfx_bitmap_destroy(bitmap);
+	mem_gc_delete(mgc);
+	free(alloc.pixels);
+}
+
 /** Test gfx_update() on a memory GC */
 PCUT_TEST(gfx_update)
 {
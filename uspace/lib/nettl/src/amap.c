@@ -47,9 +47,15 @@
  *
  * In the unspecified case only the local port is known and the entry matches
  * all remote and local addresses.
+ *
+ * Repla, laddr and llink entries are kept in hash tables indexed by their
+ * key so that looking up the association for an incoming segment does not
+ * depend on the number of associations in the map. A lookup falls back from
+ * the most specific table to the least specific one.
  */
 
-#include <adt/list.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <errno.h>
 #include <inet/addr.h>
 #include <inet/inet.h>
@@ -58,6 +64,152 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+/** Repla hash table key */
+typedef struct {
+	/** Remote endpoint */
+	inet_ep_t *rep;
+	/** Local address */
+	inet_addr_t *laddr;
+} amap_repla_key_t;
+
+/** Compute hash of an address.
+ *
+ * @param addr Address
+ * @return Hash value (not yet mixed)
+ */
+static size_t amap_addr_hash(inet_addr_t *addr)
+{
+	size_t hash;
+	uint32_t w;
+	unsigned i;
+
+	hash = addr->version;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < 16; i += 4) {
+			w = ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3];
+			hash = hash_combine(hash, w);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+/** Compute hash of a repla key.
+ *
+ * @param rep Remote endpoint
+ * @param la  Local address
+ * @return Hash value
+ */
+static size_t amap_repla_hash_key(inet_ep_t *rep, inet_addr_t *la)
+{
+	size_t hash;
+
+	hash = amap_addr_hash(&rep->addr);
+	hash = hash_combine(hash, rep->port);
+	hash = hash_combine(hash, amap_addr_hash(la));
+	return hash_mix(hash);
+}
+
+static size_t amap_repla_key_hash(const void *key)
+{
+	const amap_repla_key_t *rkey = key;
+
+	return amap_repla_hash_key(rkey->rep, rkey->laddr);
+}
+
+static size_t amap_repla_hash(const ht_link_t *item)
+{
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+
+	return amap_repla_hash_key(&repla->rep, &repla->laddr);
+}
+
+static bool amap_repla_key_equal(const void *key, const ht_link_t *item)
+{
+	const amap_repla_key_t *rkey = key;
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+
+	return repla->rep.port == rkey->rep->port &&
+	    inet_addr_compare(&repla->rep.addr, &rkey->rep->addr) &&
+	    inet_addr_compare(&repla->laddr, rkey->laddr);
+}
+
+/** Repla hash table operations */
+static hash_table_ops_t amap_repla_ops = {
+	.hash = amap_repla_hash,
+	.key_hash = amap_repla_key_hash,
+	.key_equal = amap_repla_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t amap_laddr_key_hash(const void *key)
+{
+	return hash_mix(amap_addr_hash((inet_addr_t *) key));
+}
+
+static size_t amap_laddr_hash(const ht_link_t *item)
+{
+	amap_laddr_t *laddr = hash_table_get_inst(item, amap_laddr_t, lamap);
+
+	return hash_mix(amap_addr_hash(&laddr->laddr));
+}
+
+static bool amap_laddr_key_equal(const void *key, const ht_link_t *item)
+{
+	amap_laddr_t *laddr = hash_table_get_inst(item, amap_laddr_t, lamap);
+
+	return inet_addr_compare(&laddr->laddr, (const inet_addr_t *) key);
+}
+
+/** Laddr hash table operations */
+static hash_table_ops_t amap_laddr_ops = {
+	.hash = amap_laddr_hash,
+	.key_hash = amap_laddr_key_hash,
+	.key_equal = amap_laddr_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t amap_llink_key_hash(const void *key)
+{
+	return hash_mix(*(const service_id_t *) key);
+}
+
+static size_t amap_llink_hash(const ht_link_t *item)
+{
+	amap_llink_t *llink = hash_table_get_inst(item, amap_llink_t, lamap);
+
+	return hash_mix(llink->llink);
+}
+
+static bool amap_llink_key_equal(const void *key, const ht_link_t *item)
+{
+	amap_llink_t *llink = hash_table_get_inst(item, amap_llink_t, lamap);
+
+	return llink->llink == *(const service_id_t *) key;
+}
+
+/** Llink hash table operations */
+static hash_table_ops_t amap_llink_ops = {
+	.hash = amap_llink_hash,
+	.key_hash = amap_llink_key_hash,
+	.key_equal = amap_llink_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
 /** Convert association map flags to port range flags.
  *
  * @param flags Association map flags
@@ -93,16 +245,29 @@ errno_t amap_create(amap_t **rmap)
 	rc = portrng_create(&map->unspec);
 	if (rc != EOK) {
 		assert(rc == ENOMEM);
-		free(map);
-		return ENOMEM;
+		goto error;
 	}
 
-	list_initialize(&map->repla);
-	list_initialize(&map->laddr);
-	list_initialize(&map->llink);
+	if (!hash_table_create(&map->repla, 0, 0, &amap_repla_ops))
+		goto error;
+
+	if (!hash_table_create(&map->laddr, 0, 0, &amap_laddr_ops))
+		goto error;
+
+	if (!hash_table_create(&map->llink, 0, 0, &amap_llink_ops))
+		goto error;
 
 	*rmap = map;
 	return EOK;
+error:
+	if (map->laddr.bucket != NULL)
+		hash_table_destroy(&map->laddr);
+	if (map->repla.bucket != NULL)
+		hash_table_destroy(&map->repla);
+	if (map->unspec != NULL)
+		portrng_destroy(map->unspec);
+	free(map);
+	return ENOMEM;
 }
 
 /** Destroy association map.
@@ -113,9 +278,12 @@ void amap_destroy(amap_t *map)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_destroy()");
 
-	assert(list_empty(&map->repla));
-	assert(list_empty(&map->laddr));
-	assert(list_empty(&map->llink));
+	assert(hash_table_empty(&map->repla));
+	assert(hash_table_empty(&map->laddr));
+	assert(hash_table_empty(&map->llink));
+	hash_table_destroy(&map->repla);
+	hash_table_destroy(&map->laddr);
+	hash_table_destroy(&map->llink);
 	free(map);
 }
 
@@ -133,34 +301,20 @@ void amap_destroy(amap_t *map)
 static errno_t amap_repla_find(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
     amap_repla_t **rrepla)
 {
-	char *sraddr, *sladdr;
-
-	(void) inet_addr_format(&rep->addr, &sraddr);
-	(void) inet_addr_format(la, &sladdr);
-
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): rep=(%s,%" PRIu16
-	    ") la=%s", sraddr, rep->port, sladdr);
-	free(sraddr);
-	free(sladdr);
-
-	list_foreach(map->repla, lamap, amap_repla_t, repla) {
-		(void) inet_addr_format(&repla->rep.addr, &sraddr);
-		(void) inet_addr_format(&repla->laddr, &sladdr);
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): "
-		    "compare to rep=(%s, %" PRIu16 ") la=%s",
-		    sraddr, repla->rep.port, sladdr);
-		free(sraddr);
-		free(sladdr);
-		if (inet_addr_compare(&repla->rep.addr, &rep->addr) &&
-		    repla->rep.port == rep->port &&
-		    inet_addr_compare(&repla->laddr, la)) {
-			*rrepla = repla;
-			return EOK;
-		}
+	amap_repla_key_t key;
+	ht_link_t *link;
+
+	key.rep = rep;
+	key.laddr = la;
+
+	link = hash_table_find(&map->repla, &key);
+	if (link == NULL) {
+		*rrepla = NULL;
+		return ENOENT;
 	}
 
-	*rrepla = NULL;
-	return ENOENT;
+	*rrepla = hash_table_get_inst(link, amap_repla_t, lamap);
+	return EOK;
 }
 
 /** Insert repla.
@@ -194,7 +348,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
 
 	repla->rep = *rep;
 	repla->laddr = *la;
-	list_append(&repla->lamap, &map->repla);
+	hash_table_insert(&map->repla, &repla->lamap);
 
 	*rrepla = repla;
 	return EOK;
@@ -209,7 +363,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
  */
 static void amap_repla_remove(amap_t *map, amap_repla_t *repla)
 {
-	list_remove(&repla->lamap);
+	hash_table_remove_item(&map->repla, &repla->lamap);
 	portrng_destroy(repla->portrng);
 	free(repla);
 }
@@ -227,15 +381,16 @@ static void amap_repla_remove(amap_t *map, amap_repla_t *repla)
 static errno_t amap_laddr_find(amap_t *map, inet_addr_t *addr,
     amap_laddr_t **rladdr)
 {
-	list_foreach(map->laddr, lamap, amap_laddr_t, laddr) {
-		if (inet_addr_compare(&laddr->laddr, addr)) {
-			*rladdr = laddr;
-			return EOK;
-		}
+	ht_link_t *link;
+
+	link = hash_table_find(&map->laddr, addr);
+	if (link == NULL) {
+		*rladdr = NULL;
+		return ENOENT;
 	}
 
-	*rladdr = NULL;
-	return ENOENT;
+	*rladdr = hash_table_get_inst(link, amap_laddr_t, lamap);
+	return EOK;
 }
 
 /** Insert laddr.
@@ -266,7 +421,7 @@ static errno_t amap_laddr_insert(amap_t *map, inet_addr_t *addr,
 	}
 
 	laddr->laddr = *addr;
-	list_append(&laddr->lamap, &map->laddr);
+	hash_table_insert(&map->laddr, &laddr->lamap);
 
 	*rladdr = laddr;
 	return EOK;
@@ -281,7 +436,7 @@ static errno_t amap_laddr_insert(amap_t *map, inet_addr_t *addr,
  */
 static void amap_laddr_remove(amap_t *map, amap_laddr_t *laddr)
 {
-	list_remove(&laddr->lamap);
+	hash_table_remove_item(&map->laddr, &laddr->lamap);
 	portrng_destroy(laddr->portrng);
 	free(laddr);
 }
@@ -296,18 +451,19 @@ static void amap_laddr_remove(amap_t *map, amap_laddr_t *laddr)
  *
  * @return EOK on success, ENOENT if not found.
  */
-static errno_t amap_llink_find(amap_t *map, sysarg_t link_id,
+static errno_t amap_llink_find(amap_t *map, service_id_t link_id,
     amap_llink_t **rllink)
 {
-	list_foreach(map->llink, lamap, amap_llink_t, llink) {
-		if (llink->llink == link_id) {
-			*rllink = llink;
-			return EOK;
-		}
+	ht_link_t *link;
+
+	link = hash_table_find(&map->llink, &link_id);
+	if (link == NULL) {
+		*rllink = NULL;
+		return ENOENT;
 	}
 
-	*rllink = NULL;
-	return ENOENT;
+	*rllink = hash_table_get_inst(link, amap_llink_t, lamap);
+	return EOK;
 }
 
 /** Insert llink.
@@ -338,7 +494,7 @@ static errno_t amap_llink_insert(amap_t *map, sysarg_t link_id,
 	}
 
 	llink->llink = link_id;
-	list_append(&llink->lamap, &map->llink);
+	hash_table_insert(&map->llink, &llink->lamap);
 
 	*rllink = llink;
 	return EOK;
@@ -353,7 +509,7 @@ static errno_t amap_llink_insert(amap_t *map, sysarg_t link_id,
  */
 static void amap_llink_remove(amap_t *map, amap_llink_t *llink)
 {
-	list_remove(&llink->lamap);
+	hash_table_remove_item(&map->llink, &llink->lamap);
 	portrng_destroy(llink->portrng);
 	free(llink);
 }
@@ -727,55 +883,44 @@ errno_t amap_find_match(amap_t *map, inet_ep2_t *epp, void **rarg)
 	amap_laddr_t *laddr;
 	amap_llink_t *llink;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_find_match(llink=%zu)",
-	    epp->local_link);
+	/*
+	 * This is called for every incoming segment or datagram. Do not
+	 * log here, each message costs a round trip to the logger.
+	 */
 
-	/* Remode endpoint, local address */
+	/* Remote endpoint, local address */
 	rc = amap_repla_find(map, &epp->remote, &epp->local.addr, &repla);
 	if (rc == EOK) {
 		rc = portrng_find_port(repla->portrng, epp->local.port,
 		    rarg);
-		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched repla / "
-			    "port %" PRIu16, epp->local.port);
+		if (rc == EOK)
 			return EOK;
-		}
 	}
 
 	/* Local address */
-	rc = amap_laddr_find(map, &epp->local.addr, &laddr);
-	if (rc == EOK) {
-		rc = portrng_find_port(laddr->portrng, epp->local.port,
-		    rarg);
+	if (!hash_table_empty(&map->laddr)) {
+		rc = amap_laddr_find(map, &epp->local.addr, &laddr);
 		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched laddr / "
-			    "port %" PRIu16, epp->local.port);
-			return EOK;
+			rc = portrng_find_port(laddr->portrng,
+			    epp->local.port, rarg);
+			if (rc == EOK)
+				return EOK;
 		}
 	}
 
 	/* Local link */
-	rc = amap_llink_find(map, epp->local_link, &llink);
-	if (epp->local_link != 0 && rc == EOK) {
-		rc = portrng_find_port(llink->portrng, epp->local.port,
-		    rarg);
+	if (epp->local_link != 0 && !hash_table_empty(&map->llink)) {
+		rc = amap_llink_find(map, epp->local_link, &llink);
 		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched llink / "
-			    "port %" PRIu16, epp->local.port);
-			return EOK;
+			rc = portrng_find_port(llink->portrng,
+			    epp->local.port, rarg);
+			if (rc == EOK)
+				return EOK;
 		}
 	}
 
 	/* Unspecified */
-	rc = portrng_find_port(map->unspec, epp->local.port, rarg);
-	if (rc == EOK) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched unspec / port %" PRIu16,
-		    epp->local.port);
-		return EOK;
-	}
-
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "No match.");
-	return ENOENT;
+	return portrng_find_port(map->unspec, epp->local.port, rarg);
 }
 
 /**
@@ -63,6 +63,11 @@
 
 #define VIRTIO_F_VERSION_1	1
 
+/** Driver can use descriptors with the VIRTQ_DESC_F_INDIRECT flag set */
+#define VIRTIO_F_RING_INDIRECT_DESC	(1U << 28)
+/** Driver and device can suppress notifications using the event indices */
+#define VIRTIO_F_RING_EVENT_IDX		(1U << 29)
+
 /** Common configuration structure layout according to VIRTIO version 1.0 */
 typedef struct virtio_pci_common_cfg {
 	ioport32_t device_feature_select;
@@ -150,6 +155,8 @@ typedef struct {
 	/** Virtual address of the used ring */
 	virtq_used_t *used;
 	uint16_t used_last_idx;
+	/** Available ring index at the time of the last notification */
+	uint16_t avail_kicked_idx;
 
 	/** Address of the queue's notification register */
 	ioport16_t *notify;
@@ -179,6 +186,9 @@ typedef struct {
 	/** Device-specific configuration */
 	void *device_cfg;
 
+	/** Negotiated feature bits 0 - 31 */
+	uint32_t features;
+
 	/** Virtqueues */
 	virtq_t *queues;
 } virtio_dev_t;
@@ -198,13 +208,18 @@ extern uint16_t virtio_alloc_desc(virtio_dev_t *, uint16_t, uint16_t *);
 extern void virtio_free_desc(virtio_dev_t *, uint16_t, uint16_t *, uint16_t);
 
 extern void virtio_virtq_produce_available(virtio_dev_t *, uint16_t, uint16_t);
+extern void virtio_virtq_push_available(virtio_dev_t *, uint16_t, uint16_t);
+extern void virtio_virtq_kick(virtio_dev_t *, uint16_t);
 extern bool virtio_virtq_consume_used(virtio_dev_t *, uint16_t, uint16_t *,
     uint32_t *);
+extern void virtio_virtq_disable_interrupts(virtio_dev_t *, uint16_t);
+extern bool virtio_virtq_enable_interrupts(virtio_dev_t *, uint16_t);
 
+extern uint16_t virtio_virtq_max_size(virtio_dev_t *, uint16_t);
 extern errno_t virtio_virtq_setup(virtio_dev_t *, uint16_t, uint16_t);
 extern void virtio_virtq_teardown(virtio_dev_t *, uint16_t);
 
-extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t);
+extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t, uint32_t);
 extern void virtio_device_setup_fail(virtio_dev_t *);
 extern void virtio_device_setup_finalize(virtio_dev_t *);
 
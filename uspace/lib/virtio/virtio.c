@@ -170,8 +170,48 @@ void virtio_free_desc(virtio_dev_t *vdev, uint16_t num, uint16_t *head,
 	fibril_mutex_unlock(&q->lock);
 }
 
+/** Location of the driver-written used_event index
+ *
+ * The index immediately follows the available ring.
+ */
+static ioport16_t *virtq_used_event(virtq_t *q)
+{
+	return &q->avail->ring[q->queue_size];
+}
+
+/** Location of the device-written avail_event index
+ *
+ * The index immediately follows the used ring.
+ */
+static ioport16_t *virtq_avail_event(virtq_t *q)
+{
+	return (ioport16_t *) &q->used->ring[q->queue_size];
+}
+
+/** Offer a descriptor chain to the device and notify it
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head descriptor of the chain.
+ */
 void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
+{
+	virtio_virtq_push_available(vdev, num, descno);
+	virtio_virtq_kick(vdev, num);
+}
+
+/** Offer a descriptor chain to the device without notifying it
+ *
+ * Several chains can be offered this way and then announced to the device by
+ * a single virtio_virtq_kick().
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head descriptor of the chain.
+ */
+void virtio_virtq_push_available(virtio_dev_t *vdev, uint16_t num,
+    uint16_t descno)
 {
 	virtq_t *q = &vdev->queues[num];
 
@@ -180,8 +220,47 @@ void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
 	pio_write_le16(&q->avail->ring[idx % q->queue_size], descno);
 	write_barrier();
 	pio_write_le16(&q->avail->idx, idx + 1);
-	write_barrier();
-	pio_write_le16(q->notify, num);
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Notify the device about the descriptor chains offered since the last kick
+ *
+ * The notification is omitted if the device does not want it. That is either
+ * when it set VIRTQ_USED_F_NO_NOTIFY or, if VIRTIO_F_RING_EVENT_IDX was
+ * negotiated, when its avail_event index was not crossed by the new chains.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_kick(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+
+	/* Make the new available index visible before looking at the device */
+	memory_barrier();
+
+	uint16_t new_idx = pio_read_le16(&q->avail->idx);
+	uint16_t old_idx = q->avail_kicked_idx;
+	if (new_idx == old_idx) {
+		fibril_mutex_unlock(&q->lock);
+		return;
+	}
+	q->avail_kicked_idx = new_idx;
+
+	bool notify;
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX) {
+		uint16_t event = pio_read_le16(virtq_avail_event(q));
+		notify = (uint16_t) (new_idx - event - 1) <
+		    (uint16_t) (new_idx - old_idx);
+	} else {
+		notify = !(pio_read_le16(&q->used->flags) &
+		    VIRTQ_USED_F_NO_NOTIFY);
+	}
+
+	if (notify)
+		pio_write_le16(q->notify, num);
 	fibril_mutex_unlock(&q->lock);
 }
 
@@ -196,6 +275,7 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 		fibril_mutex_unlock(&q->lock);
 		return false;
 	}
+	read_barrier();
 
 	*descno = (uint16_t) pio_read_le32(&q->used->ring[last_idx].id);
 	*len = pio_read_le32(&q->used->ring[last_idx].len);
@@ -206,6 +286,71 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 	return true;
 }
 
+/** Ask the device not to interrupt on further used descriptor chains
+ *
+ * This is only a hint, the driver must cope with spurious interrupts.
+ * With VIRTIO_F_RING_EVENT_IDX the device does not interrupt again until
+ * virtio_virtq_enable_interrupts() moves the used_event index anyway.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_disable_interrupts(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX)
+		return;
+
+	fibril_mutex_lock(&q->lock);
+	pio_write_le16(&q->avail->flags, VIRTQ_AVAIL_F_NO_INTERRUPT);
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Ask the device to interrupt on the next used descriptor chain
+ *
+ * A chain used by the device before it noticed the request would not raise
+ * an interrupt, so the caller must consume the used ring again if this
+ * function returns true.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ *
+ * @return  True if there are used descriptor chains not consumed yet.
+ */
+bool virtio_virtq_enable_interrupts(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX)
+		pio_write_le16(virtq_used_event(q), q->used_last_idx);
+	else
+		pio_write_le16(&q->avail->flags, 0);
+	memory_barrier();
+	bool pending = (q->used_last_idx % q->queue_size) !=
+	    (pio_read_le16(&q->used->idx) % q->queue_size);
+	fibril_mutex_unlock(&q->lock);
+
+	return pending;
+}
+
+/** Get the maximum size of a virtqueue supported by the device
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ *
+ * @return  Maximum number of descriptors in the virtqueue or zero if the
+ *          virtqueue is not available.
+ */
+uint16_t virtio_virtq_max_size(virtio_dev_t *vdev, uint16_t num)
+{
+	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
+
+	pio_write_le16(&cfg->queue_select, num);
+	return pio_read_le16(&cfg->queue_size);
+}
+
 errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -258,6 +403,7 @@ errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 	q->avail = q->virt + avail_offset;
 	q->used = q->virt + used_offset;
 	q->used_last_idx = 0;
+	q->avail_kicked_idx = 0;
 
 	memset(q->virt, 0, q->size);
 
@@ -299,8 +445,12 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * The device must offer all of \a features, of \a optional only the offered
+ * bits are accepted. The negotiated set is stored in \a vdev->features.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -329,7 +479,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features |= optional & device_features;
 
 	if (reserved_features != (reserved_features & device_reserved_features))
 		return ENOTSUP;
@@ -343,6 +493,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	ddf_msg(LVL_NOTE, "accepted features %x, reserved features %x",
 	    features, reserved_features);
+	vdev->features = features;
 
 	/* 5. Set FEATURES_OK */
 	status |= VIRTIO_DEV_STATUS_FEATURES_OK;
@@ -33,6 +33,7 @@
  * @file
  */
 
+#include <assert.h>
 #include <adt/list.h>
 #include <bd_srv.h>
 #include <block.h>
@@ -68,6 +69,8 @@ static errno_t vbds_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *,
     size_t);
 static errno_t vbds_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t vbds_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static errno_t vbds_bd_read_blocks_v(bd_srv_t *, bd_vec_t *, size_t);
+static errno_t vbds_bd_write_blocks_v(bd_srv_t *, bd_vec_t *, size_t);
 
 static errno_t vbds_bsa_translate(vbds_part_t *, aoff64_t, size_t, aoff64_t *);
 
@@ -90,7 +93,9 @@ static bd_ops_t vbds_bd_ops = {
 	.sync_cache = vbds_bd_sync_cache,
 	.write_blocks = vbds_bd_write_blocks,
 	.get_block_size = vbds_bd_get_block_size,
-	.get_num_blocks = vbds_bd_get_num_blocks
+	.get_num_blocks = vbds_bd_get_num_blocks,
+	.read_blocks_v = vbds_bd_read_blocks_v,
+	.write_blocks_v = vbds_bd_write_blocks_v
 };
 
 /** Provide disk access to liblabel */
@@ -1042,6 +1047,55 @@ static errno_t vbds_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return rc;
 }
 
+/** Translate the ranges of a vectored request and forward it to the disk. */
+static errno_t vbds_bd_rw_blocks_v(bd_srv_t *bd, bd_vec_t *vec, size_t nvec,
+    bool read)
+{
+	vbds_part_t *part = bd_srv_part(bd);
+	bd_vec_t gvec[BD_VEC_MAX];
+	errno_t rc;
+	size_t i;
+
+	assert(nvec <= BD_VEC_MAX);
+
+	fibril_rwlock_read_lock(&part->lock);
+
+	for (i = 0; i < nvec; i++) {
+		if (vec[i].cnt * part->disk->block_size < vec[i].size) {
+			fibril_rwlock_read_unlock(&part->lock);
+			return EINVAL;
+		}
+
+		gvec[i] = vec[i];
+		if (vbds_bsa_translate(part, vec[i].ba, vec[i].cnt,
+		    &gvec[i].ba) != EOK) {
+			fibril_rwlock_read_unlock(&part->lock);
+			return ELIMIT;
+		}
+	}
+
+	if (read)
+		rc = block_read_direct_v(part->disk->svc_id, gvec, nvec);
+	else
+		rc = block_write_direct_v(part->disk->svc_id, gvec, nvec);
+
+	fibril_rwlock_read_unlock(&part->lock);
+	return rc;
+}
+
+static errno_t vbds_bd_read_blocks_v(bd_srv_t *bd, bd_vec_t *vec, size_t nvec)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks_v()");
+	return vbds_bd_rw_blocks_v(bd, vec, nvec, true);
+}
+
+static errno_t vbds_bd_write_blocks_v(bd_srv_t *bd, bd_vec_t *vec,
+    size_t nvec)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks_v()");
+	return vbds_bd_rw_blocks_v(bd, vec, nvec, false);
+}
+
 static errno_t vbds_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
 {
 	vbds_part_t *part = bd_srv_part(bd);
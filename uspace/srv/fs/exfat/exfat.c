@@ -53,8 +53,9 @@
 
 vfs_info_t exfat_vfs_info = {
 	.name = NAME,
-	.concurrent_read_write = false,
+	.concurrent_read_write = true,
 	.write_retains_size = false,
+	.dentry_cache = true,
 	.instance = 0,
 };
 
@@ -147,6 +147,11 @@ typedef struct exfat_node {
 	unsigned		lnkcnt;
 	unsigned		refcnt;
 	bool			dirty;
+	/**
+	 * Serializes modifications of the node's contents, size and cluster
+	 * chain with reads and writes of the node.
+	 */
+	fibril_rwlock_t		contents_lock;
 	/* Should we do walk-on-FAT or not */
 	bool			fragmented;
 
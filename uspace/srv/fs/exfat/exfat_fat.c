@@ -236,7 +236,7 @@ exfat_get_cluster(exfat_bs_t *bs, service_id_t service_id,
 
 	offset = clst * sizeof(exfat_cluster_t);
 
-	rc = block_get(&b, service_id, FAT_FS(bs) + offset / BPS(bs), BLOCK_FLAGS_NONE);
+	rc = block_get(&b, service_id, FAT_FS(bs) + offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -266,7 +266,7 @@ exfat_set_cluster(exfat_bs_t *bs, service_id_t service_id,
 
 	offset = clst * sizeof(exfat_cluster_t);
 
-	rc = block_get(&b, service_id, FAT_FS(bs) + offset / BPS(bs), BLOCK_FLAGS_NONE);
+	rc = block_get(&b, service_id, FAT_FS(bs) + offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -106,6 +106,7 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->lnkcnt = 0;
 	node->refcnt = 0;
 	node->dirty = false;
+	fibril_rwlock_initialize(&node->contents_lock);
 	node->fragmented = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
@@ -1008,7 +1009,8 @@ libfs_ops_t exfat_libfs_ops = {
 	.service_get = exfat_service_get,
 	.size_block = exfat_size_block,
 	.total_block_count = exfat_total_block_count,
-	.free_block_count = exfat_free_block_count
+	.free_block_count = exfat_free_block_count,
+	.cache_stats = block_cache_stats
 };
 
 static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
@@ -1345,6 +1347,8 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 	bs = block_bb_get(service_id);
 
+	fibril_rwlock_read_lock(&nodep->contents_lock);
+
 	if (nodep->type == EXFAT_FILE) {
 		/*
 		 * Our strategy for regular file reads is to read one block at
@@ -1361,6 +1365,7 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			rc = exfat_block_get(&b, bs, nodep, pos / BPS(bs),
 			    BLOCK_FLAGS_NONE);
 			if (rc != EOK) {
+				fibril_rwlock_read_unlock(&nodep->contents_lock);
 				exfat_node_put(fn);
 				async_answer_0(&call, rc);
 				return rc;
@@ -1369,12 +1374,14 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			    b->data + pos % BPS(bs), bytes);
 			rc = block_put(b);
 			if (rc != EOK) {
+				fibril_rwlock_read_unlock(&nodep->contents_lock);
 				exfat_node_put(fn);
 				return rc;
 			}
 		}
 	} else {
 		if (nodep->type != EXFAT_DIRECTORY) {
+			fibril_rwlock_read_unlock(&nodep->contents_lock);
 			async_answer_0(&call, ENOTSUP);
 			return ENOTSUP;
 		}
@@ -1408,6 +1415,7 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		(void) exfat_directory_close(&di);
 
 	err:
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
 		(void) exfat_node_put(fn);
 		async_answer_0(&call, rc);
 		return rc;
@@ -1416,6 +1424,7 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		rc = exfat_directory_close(&di);
 		if (rc != EOK)
 			goto err;
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
 		rc = exfat_node_put(fn);
 		async_answer_0(&call, rc != EOK ? rc : ENOENT);
 		*rbytes = 0;
@@ -1431,6 +1440,7 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		bytes = (pos - spos) + 1;
 	}
 
+	fibril_rwlock_read_unlock(&nodep->contents_lock);
 	rc = exfat_node_put(fn);
 	*rbytes = bytes;
 	return rc;
@@ -1452,13 +1462,71 @@ static errno_t exfat_sync(service_id_t service_id, fs_index_t index)
 
 	exfat_node_t *nodep = EXFAT_NODE(fn);
 
+	fibril_rwlock_read_lock(&nodep->contents_lock);
 	nodep->dirty = true;
 	rc = exfat_node_sync(nodep);
+	fibril_rwlock_read_unlock(&nodep->contents_lock);
 
 	exfat_node_put(fn);
 	return rc;
 }
 
+/** Write data to an exFAT node.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		exFAT node with contents_lock held for writing or, if
+ *			the write stays within the current size of the node,
+ *			at least for reading.
+ * @param call		Data write call to finalize.
+ * @param pos		Position in the node.
+ * @param bytes		Number of bytes to write, which fit in one block.
+ * @param flags		Flags passed to libblock.
+ *
+ * @return		EOK on success or an error code. The call is answered
+ *			on failure unless the data were already transferred.
+ */
+static errno_t exfat_write_locked(exfat_bs_t *bs, exfat_node_t *nodep,
+    ipc_call_t *call, aoff64_t pos, size_t bytes, int flags)
+{
+	block_t *b;
+	aoff64_t boundary;
+	errno_t rc;
+
+	boundary = ROUND_UP(nodep->size, BPC(bs));
+	if (pos >= boundary) {
+		unsigned nclsts;
+		nclsts = (ROUND_UP(pos + bytes, BPC(bs)) - boundary) / BPC(bs);
+		rc = exfat_node_expand(nodep->idx->service_id, nodep, nclsts);
+		if (rc != EOK) {
+			/* could not expand node */
+			async_answer_0(call, rc);
+			return rc;
+		}
+	}
+
+	if (pos + bytes > nodep->size) {
+		nodep->size = pos + bytes;
+		nodep->dirty = true;	/* need to sync node */
+	}
+
+	/*
+	 * This is the easier case - we are either overwriting already
+	 * existing contents or writing behind the EOF, but still within
+	 * the limits of the last cluster. The node size may grow to the
+	 * next block size boundary.
+	 */
+	rc = exfat_block_get(&b, bs, nodep, pos / BPS(bs), flags);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return rc;
+	}
+
+	(void) async_data_write_finalize(call,
+	    b->data + pos % BPS(bs), bytes);
+	b->dirty = true;		/* need to sync block */
+	return block_put(b);
+}
+
 static errno_t
 exfat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -1467,8 +1535,7 @@ exfat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	exfat_node_t *nodep;
 	exfat_bs_t *bs;
 	size_t bytes;
-	block_t *b;
-	aoff64_t boundary;
+	bool exclusive = false;
 	int flags = BLOCK_FLAGS_NONE;
 	errno_t rc;
 
@@ -1500,49 +1567,33 @@ exfat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	if (bytes == BPS(bs))
 		flags |= BLOCK_FLAGS_NOREAD;
 
-	boundary = ROUND_UP(nodep->size, BPC(bs));
-	if (pos >= boundary) {
-		unsigned nclsts;
-		nclsts = (ROUND_UP(pos + bytes, BPC(bs)) - boundary) / BPC(bs);
-		rc = exfat_node_expand(service_id, nodep, nclsts);
-		if (rc != EOK) {
-			/* could not expand node */
-			(void) exfat_node_put(fn);
-			async_answer_0(&call, rc);
-			return rc;
-		}
-	}
-
-	if (pos + bytes > nodep->size) {
-		nodep->size = pos + bytes;
-		nodep->dirty = true;	/* need to sync node */
-	}
-
 	/*
-	 * This is the easier case - we are either overwriting already
-	 * existing contents or writing behind the EOF, but still within
-	 * the limits of the last cluster. The node size may grow to the
-	 * next block size boundary.
+	 * Overwriting existing contents does not modify the node and can run
+	 * in parallel with reads and other such writes. Anything else needs
+	 * the node for itself.
 	 */
-	rc = exfat_block_get(&b, bs, nodep, pos / BPS(bs), flags);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		async_answer_0(&call, rc);
-		return rc;
+	fibril_rwlock_read_lock(&nodep->contents_lock);
+	if (pos + bytes > nodep->size) {
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
+		fibril_rwlock_write_lock(&nodep->contents_lock);
+		exclusive = true;
 	}
 
-	(void) async_data_write_finalize(&call,
-	    b->data + pos % BPS(bs), bytes);
-	b->dirty = true;		/* need to sync block */
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	rc = exfat_write_locked(bs, nodep, &call, pos, bytes, flags);
+	if (rc == EOK) {
+		*wbytes = bytes;
+		*nsize = nodep->size;
 	}
 
-	*wbytes = bytes;
-	*nsize = nodep->size;
-	rc = exfat_node_put(fn);
+	if (exclusive)
+		fibril_rwlock_write_unlock(&nodep->contents_lock);
+	else
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
+
+	errno_t rc2 = exfat_node_put(fn);
+	if (rc == EOK && rc2 != EOK)
+		rc = rc2;
+
 	return rc;
 }
 
@@ -1563,6 +1614,8 @@ exfat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 
 	bs = block_bb_get(service_id);
 
+	fibril_rwlock_write_lock(&nodep->contents_lock);
+
 	if (nodep->size == size) {
 		rc = EOK;
 	} else if (nodep->size < size) {
@@ -1582,6 +1635,8 @@ exfat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 		rc = exfat_node_shrink(service_id, nodep, size);
 	}
 
+	fibril_rwlock_write_unlock(&nodep->contents_lock);
+
 	errno_t rc2 = exfat_node_put(fn);
 	if (rc == EOK && rc2 != EOK)
 		rc = rc2;
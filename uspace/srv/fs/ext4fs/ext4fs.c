@@ -50,7 +50,10 @@
 
 vfs_info_t ext4fs_vfs_info = {
 	.name = NAME,
-	.instance = 0
+	.instance = 0,
+	.concurrent_read_write = true,
+	.write_retains_size = false,
+	.dentry_cache = true
 };
 
 int main(int argc, char **argv)
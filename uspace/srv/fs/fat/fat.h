@@ -221,6 +221,16 @@ typedef struct {
 	struct fat_node	*nodep;
 } fat_idx_t;
 
+/** Extent of a node's cluster chain occupying consecutive clusters. */
+typedef struct {
+	/** Index of the first cluster of the extent within the node. */
+	uint32_t	lcn;
+	/** Cluster number of the first cluster of the extent. */
+	fat_cluster_t	pcn;
+	/** Number of clusters in the extent. */
+	uint32_t	count;
+} fat_extent_t;
+
 /** FAT in-core node. */
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
@@ -242,17 +252,31 @@ typedef struct fat_node {
 	unsigned		refcnt;
 	bool			dirty;
 
+	/**
+	 * Serializes modifications of the node's contents, size and cluster
+	 * chain with reads and writes of the node.
+	 */
+	fibril_rwlock_t		contents_lock;
+
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
 	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Extent map of the node's cluster chain. It is built lazily as the
+	 * chain is walked and covers the first map_clusters clusters of the
+	 * node, so that random access does not need to follow the chain from
+	 * its beginning.
+	 */
+	fibril_mutex_t	map_lock;
+	fat_extent_t	*map;
+	size_t		map_extents;
+	size_t		map_size;
+	uint32_t	map_clusters;
 } fat_node_t;
 
 typedef struct {
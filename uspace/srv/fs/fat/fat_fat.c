@@ -42,6 +42,7 @@
 #include "../../vfs/vfs.h"
 #include <libfs.h>
 #include <block.h>
+#include <adt/list.h>
 #include <errno.h>
 #include <byteorder.h>
 #include <align.h>
@@ -52,13 +53,49 @@
 
 #define IS_ODD(number)	(number & 0x1)
 
+/** Number of clusters represented by one word of the allocation bitmap. */
+#define FAT_ALLOC_WORD	32
+/** Number of clusters in one group of the allocation bitmap. */
+#define FAT_ALLOC_GROUP	4096
+
+/** Initial number of extents in a node's extent map. */
+#define FAT_MAP_INIT	8
+
+/**
+ * In-core allocation state of one mounted file system.
+ *
+ * Each cluster is represented by one bit in the bitmap, which is set for
+ * clusters that are not free (including the reserved and bad ones and the
+ * padding at the end of the last word). The number of free clusters in each
+ * group of FAT_ALLOC_GROUP clusters is maintained as well so that the full
+ * parts of the volume can be skipped quickly.
+ */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+
+	/** Number of clusters including the two reserved ones. */
+	uint32_t clusters;
+	/** Allocation bitmap. */
+	uint32_t *bitmap;
+	/** Number of free clusters in each group. */
+	uint16_t *group_free;
+	/** Number of free clusters on the volume. */
+	uint32_t free;
+	/** Cluster where the next search for free clusters starts. */
+	fat_cluster_t next;
+} fat_alloc_t;
+
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * during allocation of clusters and the in-core allocation state. The lock
+ * does not have to be held durring deallocation of clusters in FAT.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
+/** List of fat_alloc_t structures of all mounted file systems. */
+static LIST_INITIALIZE(fat_alloc_list);
+
 /** Walk the cluster chain.
  *
  * @param bs		Buffer holding the boot sector for the file.
@@ -112,6 +149,176 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Initialize the extent map of a node.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_map_init(fat_node_t *nodep)
+{
+	fibril_mutex_initialize(&nodep->map_lock);
+	nodep->map = NULL;
+	nodep->map_extents = 0;
+	nodep->map_size = 0;
+	nodep->map_clusters = 0;
+}
+
+/** Release the extent map of a node.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_map_fini(fat_node_t *nodep)
+{
+	free(nodep->map);
+	nodep->map = NULL;
+	nodep->map_extents = 0;
+	nodep->map_size = 0;
+	nodep->map_clusters = 0;
+}
+
+/** Append the next cluster of the node's chain to its extent map.
+ *
+ * @param nodep		FAT node with map_lock held.
+ * @param clst		Cluster following the last mapped cluster in the chain.
+ *
+ * @return		EOK on success or ENOMEM.
+ */
+static errno_t fat_map_append(fat_node_t *nodep, fat_cluster_t clst)
+{
+	fat_extent_t *e;
+
+	if (nodep->map_extents > 0) {
+		e = &nodep->map[nodep->map_extents - 1];
+		if (e->pcn + e->count == clst) {
+			/* The chain continues with the adjacent cluster. */
+			e->count++;
+			nodep->map_clusters++;
+			return EOK;
+		}
+	}
+
+	if (nodep->map_extents == nodep->map_size) {
+		size_t size = nodep->map_size ? 2 * nodep->map_size :
+		    FAT_MAP_INIT;
+		e = realloc(nodep->map, size * sizeof(fat_extent_t));
+		if (!e)
+			return ENOMEM;
+		nodep->map = e;
+		nodep->map_size = size;
+	}
+
+	e = &nodep->map[nodep->map_extents++];
+	e->lcn = nodep->map_clusters;
+	e->pcn = clst;
+	e->count = 1;
+	nodep->map_clusters++;
+
+	return EOK;
+}
+
+/** Find the cluster with the given index within a node.
+ *
+ * The extent map of the node is extended by walking the cluster chain from
+ * the last mapped cluster if the cluster has not been mapped yet.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param cidx		Index of the cluster within the node.
+ * @param clst		Output argument holding the cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the node has fewer clusters,
+ *			ENOMEM if the map cannot be extended or another error
+ *			code.
+ */
+errno_t fat_map_cluster_get(fat_bs_t *bs, fat_node_t *nodep, uint32_t cidx,
+    fat_cluster_t *clst)
+{
+	service_id_t service_id = nodep->idx->service_id;
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_cluster_t next;
+	fat_extent_t *e;
+	size_t lo, hi;
+	errno_t rc;
+
+	assert(FAT_IS_FAT32(bs) || nodep->firstc != FAT_CLST_ROOT);
+
+	fibril_mutex_lock(&nodep->map_lock);
+
+	while (nodep->map_clusters <= cidx) {
+		if (nodep->map_extents == 0) {
+			next = nodep->firstc;
+		} else {
+			e = &nodep->map[nodep->map_extents - 1];
+			rc = fat_get_cluster(bs, service_id, FAT1,
+			    e->pcn + e->count - 1, &next);
+			if (rc != EOK) {
+				fibril_mutex_unlock(&nodep->map_lock);
+				return rc;
+			}
+		}
+
+		if (next < FAT_CLST_FIRST || next >= clst_last1) {
+			/* The chain ends before the requested cluster. */
+			fibril_mutex_unlock(&nodep->map_lock);
+			return ELIMIT;
+		}
+
+		rc = fat_map_append(nodep, next);
+		if (rc != EOK) {
+			fibril_mutex_unlock(&nodep->map_lock);
+			return rc;
+		}
+	}
+
+	/* Binary search for the extent containing the cluster. */
+	lo = 0;
+	hi = nodep->map_extents;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (nodep->map[mid].lcn <= cidx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	e = &nodep->map[lo];
+	assert(cidx >= e->lcn && cidx - e->lcn < e->count);
+	*clst = e->pcn + (cidx - e->lcn);
+
+	fibril_mutex_unlock(&nodep->map_lock);
+	return EOK;
+}
+
+/** Forget the part of a node's extent map following a cluster.
+ *
+ * @param nodep		FAT node.
+ * @param lcl		Last cluster which remains in the node or
+ *			FAT_CLST_RES0 if no clusters remain.
+ */
+static void fat_map_truncate(fat_node_t *nodep, fat_cluster_t lcl)
+{
+	size_t i;
+
+	fibril_mutex_lock(&nodep->map_lock);
+
+	for (i = 0; i < nodep->map_extents; i++) {
+		fat_extent_t *e = &nodep->map[i];
+
+		if (lcl >= e->pcn && lcl - e->pcn < e->count) {
+			e->count = lcl - e->pcn + 1;
+			nodep->map_extents = i + 1;
+			nodep->map_clusters = e->lcn + e->count;
+			fibril_mutex_unlock(&nodep->map_lock);
+			return;
+		}
+	}
+
+	/* The cluster is not mapped, start over. */
+	nodep->map_extents = 0;
+	nodep->map_clusters = 0;
+
+	fibril_mutex_unlock(&nodep->map_lock);
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +333,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	fat_cluster_t c;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +354,17 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
+	rc = fat_map_cluster_get(bs, nodep, bn / SPC(bs), &c);
+	if (rc == ENOMEM) {
+		/* The extent map cannot grow, walk the cluster chain. */
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
 	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, CLBN2PBN(bs, c, bn),
+	    flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -302,7 +497,7 @@ fat_get_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 		return ERANGE;
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -314,7 +509,7 @@ fat_get_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 			/* No, read the next sector */
 			rc = block_get(&b1, service_id, 1 + RSCNT(bs) +
 			    SF(bs) * fatno + offset / BPS(bs),
-			    BLOCK_FLAGS_NONE);
+			    BLOCK_FLAGS_META);
 			if (rc != EOK) {
 				block_put(b);
 				return rc;
@@ -369,7 +564,7 @@ fat_get_cluster_fat16(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	offset = (clst * FAT16_CLST_SIZE);
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -400,7 +595,7 @@ fat_get_cluster_fat32(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	offset = (clst * FAT32_CLST_SIZE);
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -463,7 +658,7 @@ fat_set_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 		return ERANGE;
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -476,7 +671,7 @@ fat_set_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 			/* No, read the next sector */
 			rc = block_get(&b1, service_id, 1 + RSCNT(bs) +
 			    SF(bs) * fatno + offset / BPS(bs),
-			    BLOCK_FLAGS_NONE);
+			    BLOCK_FLAGS_META);
 			if (rc != EOK) {
 				block_put(b);
 				return rc;
@@ -548,7 +743,7 @@ fat_set_cluster_fat16(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	offset = (clst * FAT16_CLST_SIZE);
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -582,7 +777,7 @@ fat_set_cluster_fat32(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	offset = (clst * FAT32_CLST_SIZE);
 
 	rc = block_get(&b, service_id, RSCNT(bs) + SF(bs) * fatno +
-	    offset / BPS(bs), BLOCK_FLAGS_NONE);
+	    offset / BPS(bs), BLOCK_FLAGS_META);
 	if (rc != EOK)
 		return rc;
 
@@ -654,6 +849,356 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+/** Find the allocation state of a file system.
+ *
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		Allocation state or NULL if there is none. The caller
+ *			must hold fat_alloc_lock.
+ */
+static fat_alloc_t *fat_alloc_find(service_id_t service_id)
+{
+	list_foreach(fat_alloc_list, link, fat_alloc_t, fa) {
+		if (fa->service_id == service_id)
+			return fa;
+	}
+
+	return NULL;
+}
+
+static inline bool fat_alloc_is_used(fat_alloc_t *fa, fat_cluster_t clst)
+{
+	return (fa->bitmap[clst / FAT_ALLOC_WORD] &
+	    (1U << (clst % FAT_ALLOC_WORD))) != 0;
+}
+
+/** Mark a cluster as used or free in the allocation bitmap.
+ *
+ * @param fa		Allocation state.
+ * @param clst		Cluster to mark.
+ * @param used		True if the cluster becomes used, false if it becomes
+ *			free.
+ */
+static void fat_alloc_mark(fat_alloc_t *fa, fat_cluster_t clst, bool used)
+{
+	uint32_t mask = 1U << (clst % FAT_ALLOC_WORD);
+
+	assert(clst >= FAT_CLST_FIRST && clst < fa->clusters);
+	assert(fat_alloc_is_used(fa, clst) != used);
+
+	if (used) {
+		fa->bitmap[clst / FAT_ALLOC_WORD] |= mask;
+		fa->group_free[clst / FAT_ALLOC_GROUP]--;
+		fa->free--;
+	} else {
+		fa->bitmap[clst / FAT_ALLOC_WORD] &= ~mask;
+		fa->group_free[clst / FAT_ALLOC_GROUP]++;
+		fa->free++;
+	}
+}
+
+/** Skip clusters which are known to be used without testing each of them.
+ *
+ * @param fa		Allocation state.
+ * @param clst		Cluster where the search is.
+ *
+ * @return		Number of clusters starting at @a clst which are all
+ *			used. Zero if the cluster has to be tested.
+ */
+static uint32_t fat_alloc_skip(fat_alloc_t *fa, fat_cluster_t clst)
+{
+	if (clst % FAT_ALLOC_GROUP == 0 &&
+	    fa->group_free[clst / FAT_ALLOC_GROUP] == 0)
+		return FAT_ALLOC_GROUP;
+	if (clst % FAT_ALLOC_WORD == 0 &&
+	    fa->bitmap[clst / FAT_ALLOC_WORD] == UINT32_MAX)
+		return FAT_ALLOC_WORD;
+
+	return 0;
+}
+
+/** Find a run of free clusters in the allocation bitmap.
+ *
+ * The search starts where the previous allocation ended and wraps around
+ * the end of the volume.
+ *
+ * @param fa		Allocation state.
+ * @param nclsts	Length of the run.
+ * @param first		Output argument holding the first cluster of the run.
+ *
+ * @return		True if a run was found.
+ */
+static bool fat_alloc_find_run(fat_alloc_t *fa, unsigned nclsts,
+    fat_cluster_t *first)
+{
+	fat_cluster_t clst = fa->next;
+	fat_cluster_t start = 0;
+	uint32_t scanned = 0;
+	uint32_t len = 0;
+	uint32_t skip;
+
+	while (scanned < fa->clusters) {
+		if (clst >= fa->clusters) {
+			/* Runs do not wrap around. */
+			clst = 0;
+			len = 0;
+		}
+
+		if (len == 0 && (skip = fat_alloc_skip(fa, clst)) > 0) {
+			clst += skip;
+			scanned += skip;
+			continue;
+		}
+
+		if (fat_alloc_is_used(fa, clst)) {
+			len = 0;
+		} else {
+			if (len == 0)
+				start = clst;
+			if (++len == nclsts) {
+				*first = start;
+				return true;
+			}
+		}
+
+		clst++;
+		scanned++;
+	}
+
+	return false;
+}
+
+/** Find the first free cluster at or after the given one.
+ *
+ * @param fa		Allocation state with at least one free cluster.
+ * @param clst		Cluster where to start the search.
+ *
+ * @return		Free cluster.
+ */
+static fat_cluster_t fat_alloc_next_free(fat_alloc_t *fa, fat_cluster_t clst)
+{
+	uint32_t skip;
+
+	assert(fa->free > 0);
+
+	while (true) {
+		if (clst >= fa->clusters)
+			clst = 0;
+
+		skip = fat_alloc_skip(fa, clst);
+		if (skip > 0) {
+			clst += skip;
+			continue;
+		}
+
+		if (!fat_alloc_is_used(fa, clst))
+			return clst;
+		clst++;
+	}
+}
+
+/** Take clusters from the allocation bitmap.
+ *
+ * A run of consecutive free clusters is preferred. If there is none, the free
+ * clusters following the end of the previous allocation are taken. The
+ * clusters are marked as used.
+ *
+ * @param fa		Allocation state.
+ * @param nclsts	Number of clusters to take.
+ * @param lifo		Array to be filled with the clusters in the reverse
+ *			order of the future cluster chain.
+ *
+ * @return		EOK on success or ENOSPC.
+ */
+static errno_t fat_alloc_take(fat_alloc_t *fa, unsigned nclsts,
+    fat_cluster_t *lifo)
+{
+	fat_cluster_t clst;
+	unsigned i;
+
+	if (fa->free < nclsts)
+		return ENOSPC;
+
+	if (fat_alloc_find_run(fa, nclsts, &clst)) {
+		for (i = 0; i < nclsts; i++, clst++) {
+			fat_alloc_mark(fa, clst, true);
+			lifo[nclsts - 1 - i] = clst;
+		}
+	} else {
+		clst = fa->next;
+		for (i = 0; i < nclsts; i++, clst++) {
+			clst = fat_alloc_next_free(fa, clst);
+			fat_alloc_mark(fa, clst, true);
+			lifo[nclsts - 1 - i] = clst;
+		}
+	}
+
+	fa->next = lifo[0] + 1;
+	return EOK;
+}
+
+/** Build the in-core allocation state of a file system.
+ *
+ * The first FAT is scanned once and the allocation of clusters is then served
+ * from memory.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t fat_alloc_init_by_service_id(fat_bs_t *bs, service_id_t service_id)
+{
+	fat_alloc_t *fa;
+	fat_cluster_t clst, value;
+	uint32_t words, groups;
+	block_t *b;
+	errno_t rc;
+
+	fa = malloc(sizeof(fat_alloc_t));
+	if (!fa)
+		return ENOMEM;
+
+	link_initialize(&fa->link);
+	fa->service_id = service_id;
+	fa->clusters = CC(bs) + FAT_CLST_FIRST;
+	fa->free = 0;
+	fa->next = FAT_CLST_FIRST;
+
+	words = (fa->clusters + FAT_ALLOC_WORD - 1) / FAT_ALLOC_WORD;
+	groups = (fa->clusters + FAT_ALLOC_GROUP - 1) / FAT_ALLOC_GROUP;
+	fa->bitmap = malloc(words * sizeof(uint32_t));
+	fa->group_free = calloc(groups, sizeof(uint16_t));
+	if (!fa->bitmap || !fa->group_free) {
+		free(fa->bitmap);
+		free(fa->group_free);
+		free(fa);
+		return ENOMEM;
+	}
+
+	/* Everything is used until proven otherwise. */
+	memset(fa->bitmap, 0xff, words * sizeof(uint32_t));
+
+	if (FAT_IS_FAT12(bs)) {
+		for (clst = FAT_CLST_FIRST; clst < fa->clusters; clst++) {
+			rc = fat_get_cluster(bs, service_id, FAT1, clst,
+			    &value);
+			if (rc != EOK)
+				goto error;
+			if (value == FAT_CLST_RES0)
+				fat_alloc_mark(fa, clst, false);
+		}
+	} else {
+		unsigned per_block = BPS(bs) / FAT_CLST_SIZE(bs);
+		unsigned i, bn;
+
+		/* Decode whole sectors of FAT1 rather than single entries. */
+		clst = 0;
+		for (bn = 0; bn < SF(bs) && clst < fa->clusters; bn++) {
+			rc = block_get(&b, service_id, RSCNT(bs) + bn,
+			    BLOCK_FLAGS_META);
+			if (rc != EOK)
+				goto error;
+
+			for (i = 0; i < per_block && clst < fa->clusters;
+			    i++, clst++) {
+				if (FAT_IS_FAT32(bs)) {
+					value = uint32_t_le2host(
+					    ((uint32_t *) b->data)[i]) &
+					    FAT32_MASK;
+				} else {
+					value = uint16_t_le2host(
+					    ((uint16_t *) b->data)[i]);
+				}
+
+				if (clst >= FAT_CLST_FIRST &&
+				    value == FAT_CLST_RES0)
+					fat_alloc_mark(fa, clst, false);
+			}
+
+			rc = block_put(b);
+			if (rc != EOK)
+				goto error;
+		}
+	}
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	list_append(&fa->link, &fat_alloc_list);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return EOK;
+
+error:
+	free(fa->bitmap);
+	free(fa->group_free);
+	free(fa);
+	return rc;
+}
+
+/** Destroy the in-core allocation state of a file system.
+ *
+ * @param service_id	Service ID of the file system.
+ */
+void fat_alloc_fini_by_service_id(service_id_t service_id)
+{
+	fat_alloc_t *fa;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	fa = fat_alloc_find(service_id);
+	if (fa)
+		list_remove(&fa->link);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	if (fa) {
+		free(fa->bitmap);
+		free(fa->group_free);
+		free(fa);
+	}
+}
+
+/** Get the number of free clusters from the in-core allocation state.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param count		Output argument holding the number of free clusters.
+ * @param next		If non-NULL, output argument holding the cluster where
+ *			the next allocation will look for free clusters.
+ *
+ * @return		EOK on success or ENOENT if the file system has no
+ *			in-core allocation state.
+ */
+errno_t fat_alloc_free_count(service_id_t service_id, uint32_t *count,
+    fat_cluster_t *next)
+{
+	fat_alloc_t *fa;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	fa = fat_alloc_find(service_id);
+	if (fa) {
+		*count = fa->free;
+		if (next)
+			*next = fa->next;
+	}
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return fa ? EOK : ENOENT;
+}
+
+/** Return a cluster freed in all copies of FAT to the allocation bitmap.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param clst		Freed cluster.
+ */
+static void fat_alloc_release(service_id_t service_id, fat_cluster_t clst)
+{
+	fat_alloc_t *fa;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	fa = fat_alloc_find(service_id);
+	if (fa && fat_alloc_is_used(fa, clst))
+		fat_alloc_mark(fa, clst, false);
+	fibril_mutex_unlock(&fat_alloc_lock);
+}
+
 /** Allocate clusters in all copies of FAT.
  *
  * This function will attempt to allocate the requested number of clusters in
@@ -661,6 +1206,9 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  * clusters form an independent chain (i.e. a chain which does not belong to any
  * file yet).
  *
+ * If the file system has an in-core allocation state, the clusters are taken
+ * from it, contiguous if possible. Otherwise FAT1 is searched linearly.
+ *
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
  * @param nclsts	Number of clusters to allocate.
@@ -677,6 +1225,7 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 {
 	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
 	unsigned found = 0;     /* top of the free cluster number stack */
+	fat_alloc_t *fa;
 	fat_cluster_t clst;
 	fat_cluster_t value = 0;
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
@@ -686,10 +1235,34 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 	if (!lifo)
 		return ENOMEM;
 
+	fibril_mutex_lock(&fat_alloc_lock);
+
+	fa = fat_alloc_find(service_id);
+	if (fa) {
+		rc = fat_alloc_take(fa, nclsts, lifo);
+		if (rc != EOK) {
+			free(lifo);
+			fibril_mutex_unlock(&fat_alloc_lock);
+			return rc;
+		}
+
+		/*
+		 * Link the clusters into a chain in FAT1, the same way the
+		 * linear search does.
+		 */
+		for (found = 0; found < nclsts; found++) {
+			rc = fat_set_cluster(bs, service_id, FAT1, lifo[found],
+			    (found == 0) ?  clst_last1 : lifo[found - 1]);
+			if (rc != EOK)
+				break;
+		}
+
+		goto done;
+	}
+
 	/*
 	 * Search FAT1 for unused clusters.
 	 */
-	fibril_mutex_lock(&fat_alloc_lock);
 	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
 	    clst++) {
 		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
@@ -711,6 +1284,7 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		}
 	}
 
+done:
 	if (rc == EOK && found == nclsts) {
 		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
 		if (rc == EOK) {
@@ -728,6 +1302,11 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		    FAT_CLST_RES0);
 	}
 
+	if (fa) {
+		for (found = 0; found < nclsts; found++)
+			fat_alloc_mark(fa, lifo[found], false);
+	}
+
 	free(lifo);
 	fibril_mutex_unlock(&fat_alloc_lock);
 
@@ -765,6 +1344,7 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		fat_alloc_release(service_id, firstc);
 		firstc = nextc;
 	}
 
@@ -837,8 +1417,7 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
+	fat_map_truncate(nodep, lcl);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
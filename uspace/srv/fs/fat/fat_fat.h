@@ -133,6 +133,16 @@ extern errno_t fat_fill_gap(struct fat_bs *, struct fat_node *, fat_cluster_t,
 extern errno_t fat_zero_cluster(struct fat_bs *, service_id_t, fat_cluster_t);
 extern errno_t fat_sanity_check(struct fat_bs *, service_id_t);
 
+extern void fat_map_init(struct fat_node *);
+extern void fat_map_fini(struct fat_node *);
+extern errno_t fat_map_cluster_get(struct fat_bs *, struct fat_node *,
+    uint32_t, fat_cluster_t *);
+
+extern errno_t fat_alloc_init_by_service_id(struct fat_bs *, service_id_t);
+extern void fat_alloc_fini_by_service_id(service_id_t);
+extern errno_t fat_alloc_free_count(service_id_t, uint32_t *,
+    fat_cluster_t *);
+
 #endif
 
 /**
@@ -106,11 +106,10 @@ static void fat_node_initialize(fat_node_t *node)
 	node->lnkcnt = 0;
 	node->refcnt = 0;
 	node->dirty = false;
+	fibril_rwlock_initialize(&node->contents_lock);
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	fat_map_init(node);
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +191,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_map_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,6 +230,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_map_fini(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -238,6 +239,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fat_map_fini(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -569,6 +571,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_map_fini(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -868,6 +871,12 @@ errno_t fat_free_block_count(service_id_t service_id, uint64_t *count)
 	uint64_t block_count;
 	errno_t rc;
 	uint32_t cluster_no, clusters;
+	uint32_t free_clusters;
+
+	if (fat_alloc_free_count(service_id, &free_clusters, NULL) == EOK) {
+		*count = free_clusters;
+		return EOK;
+	}
 
 	block_count = 0;
 	bs = block_bb_get(service_id);
@@ -905,7 +914,8 @@ libfs_ops_t fat_libfs_ops = {
 	.service_get = fat_service_get,
 	.size_block = fat_size_block,
 	.total_block_count = fat_total_block_count,
-	.free_block_count = fat_free_block_count
+	.free_block_count = fat_free_block_count,
+	.cache_stats = block_cache_stats
 };
 
 static errno_t fat_fs_open(service_id_t service_id, enum cache_mode cmode,
@@ -1024,8 +1034,10 @@ static errno_t fat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 static void fat_fs_close(service_id_t service_id, fs_node_t *rfn)
 {
+	fat_map_fini(FAT_NODE(rfn));
 	free(rfn->data);
 	free(rfn);
+	fat_alloc_fini_by_service_id(service_id);
 	(void) block_cache_fini(service_id);
 	block_fini(service_id);
 	fat_idx_fini_by_service_id(service_id);
@@ -1105,6 +1117,18 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return rc;
 	}
 
+	/*
+	 * Build the in-core allocation state. If there is not enough memory
+	 * for it, clusters will be allocated by searching the FAT.
+	 */
+	rc = fat_alloc_init_by_service_id(block_bb_get(service_id),
+	    service_id);
+	if (rc != EOK && rc != ENOMEM) {
+		fat_fs_close(service_id, rfn);
+		free(instance);
+		return rc;
+	}
+
 	fibril_mutex_lock(&ridxp->lock);
 
 	rc = fs_instance_create(service_id, instance);
@@ -1127,6 +1151,8 @@ static errno_t fat_update_fat32_fsinfo(service_id_t service_id)
 {
 	fat_bs_t *bs;
 	fat32_fsinfo_t *info;
+	uint32_t free_clusters;
+	fat_cluster_t next;
 	block_t *b;
 	errno_t rc;
 
@@ -1147,8 +1173,13 @@ static errno_t fat_update_fat32_fsinfo(service_id_t service_id)
 		return EINVAL;
 	}
 
-	/* For now, invalidate the counter. */
-	info->free_clusters = host2uint16_t_le(-1);
+	if (fat_alloc_free_count(service_id, &free_clusters, &next) == EOK) {
+		info->free_clusters = host2uint32_t_le(free_clusters);
+		info->last_allocated_cluster = host2uint32_t_le(next);
+	} else {
+		/* Invalidate the counter. */
+		info->free_clusters = host2uint16_t_le(-1);
+	}
 
 	b->dirty = true;
 	return block_put(b);
@@ -1234,6 +1265,8 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 	bs = block_bb_get(service_id);
 
+	fibril_rwlock_read_lock(&nodep->contents_lock);
+
 	if (nodep->type == FAT_FILE) {
 		/*
 		 * Our strategy for regular file reads is to read one block at
@@ -1250,6 +1283,7 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			rc = fat_block_get(&b, bs, nodep, pos / BPS(bs),
 			    BLOCK_FLAGS_NONE);
 			if (rc != EOK) {
+				fibril_rwlock_read_unlock(&nodep->contents_lock);
 				fat_node_put(fn);
 				async_answer_0(&call, rc);
 				return rc;
@@ -1258,6 +1292,7 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			    b->data + pos % BPS(bs), bytes);
 			rc = block_put(b);
 			if (rc != EOK) {
+				fibril_rwlock_read_unlock(&nodep->contents_lock);
 				fat_node_put(fn);
 				return rc;
 			}
@@ -1288,6 +1323,7 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			goto miss;
 
 	err:
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
 		(void) fat_node_put(fn);
 		async_answer_0(&call, rc);
 		return rc;
@@ -1296,6 +1332,7 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		rc = fat_directory_close(&di);
 		if (rc != EOK)
 			goto err;
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
 		rc = fat_node_put(fn);
 		async_answer_0(&call, rc != EOK ? rc : ENOENT);
 		*rbytes = 0;
@@ -1311,52 +1348,34 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		bytes = (pos - spos) + 1;
 	}
 
+	fibril_rwlock_read_unlock(&nodep->contents_lock);
 	rc = fat_node_put(fn);
 	*rbytes = bytes;
 	return rc;
 }
 
-static errno_t
-fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
-    size_t *wbytes, aoff64_t *nsize)
+/** Write data to a FAT node.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node with contents_lock held for writing or, if the
+ *			write stays within the current size of the node, at
+ *			least for reading.
+ * @param call		Data write call to finalize.
+ * @param pos		Position in the node.
+ * @param bytes		Number of bytes to write, which fit in one block.
+ * @param flags		Flags passed to libblock.
+ *
+ * @return		EOK on success or an error code. The call is answered
+ *			on failure unless the data were already transferred.
+ */
+static errno_t fat_write_locked(fat_bs_t *bs, fat_node_t *nodep,
+    ipc_call_t *call, aoff64_t pos, size_t bytes, int flags)
 {
-	fs_node_t *fn;
-	fat_node_t *nodep;
-	fat_bs_t *bs;
-	size_t bytes;
+	service_id_t service_id = nodep->idx->service_id;
 	block_t *b;
 	aoff64_t boundary;
-	int flags = BLOCK_FLAGS_NONE;
 	errno_t rc;
 
-	rc = fat_node_get(&fn, service_id, index);
-	if (rc != EOK)
-		return rc;
-	if (!fn)
-		return ENOENT;
-	nodep = FAT_NODE(fn);
-
-	ipc_call_t call;
-	size_t len;
-	if (!async_data_write_receive(&call, &len)) {
-		(void) fat_node_put(fn);
-		async_answer_0(&call, EINVAL);
-		return EINVAL;
-	}
-
-	bs = block_bb_get(service_id);
-
-	/*
-	 * In all scenarios, we will attempt to write out only one block worth
-	 * of data at maximum. There might be some more efficient approaches,
-	 * but this one greatly simplifies fat_write(). Note that we can afford
-	 * to do this because the client must be ready to handle the return
-	 * value signalizing a smaller number of bytes written.
-	 */
-	bytes = min(len, BPS(bs) - pos % BPS(bs));
-	if (bytes == BPS(bs))
-		flags |= BLOCK_FLAGS_NOREAD;
-
 	boundary = ROUND_UP(nodep->size, BPC(bs));
 	if (pos < boundary) {
 		/*
@@ -1367,32 +1386,25 @@ fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		 */
 		rc = fat_fill_gap(bs, nodep, FAT_CLST_RES0, pos);
 		if (rc != EOK) {
-			(void) fat_node_put(fn);
-			async_answer_0(&call, rc);
+			async_answer_0(call, rc);
 			return rc;
 		}
 		rc = fat_block_get(&b, bs, nodep, pos / BPS(bs), flags);
 		if (rc != EOK) {
-			(void) fat_node_put(fn);
-			async_answer_0(&call, rc);
+			async_answer_0(call, rc);
 			return rc;
 		}
-		(void) async_data_write_finalize(&call,
+		(void) async_data_write_finalize(call,
 		    b->data + pos % BPS(bs), bytes);
 		b->dirty = true;		/* need to sync block */
 		rc = block_put(b);
-		if (rc != EOK) {
-			(void) fat_node_put(fn);
+		if (rc != EOK)
 			return rc;
-		}
 		if (pos + bytes > nodep->size) {
 			nodep->size = pos + bytes;
 			nodep->dirty = true;	/* need to sync node */
 		}
-		*wbytes = bytes;
-		*nsize = nodep->size;
-		rc = fat_node_put(fn);
-		return rc;
+		return EOK;
 	} else {
 		/*
 		 * This is the more difficult case. We must allocate new
@@ -1406,33 +1418,29 @@ fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		rc = fat_alloc_clusters(bs, service_id, nclsts, &mcl, &lcl);
 		if (rc != EOK) {
 			/* could not allocate a chain of nclsts clusters */
-			(void) fat_node_put(fn);
-			async_answer_0(&call, rc);
+			async_answer_0(call, rc);
 			return rc;
 		}
 		/* zero fill any gaps */
 		rc = fat_fill_gap(bs, nodep, mcl, pos);
 		if (rc != EOK) {
 			(void) fat_free_clusters(bs, service_id, mcl);
-			(void) fat_node_put(fn);
-			async_answer_0(&call, rc);
+			async_answer_0(call, rc);
 			return rc;
 		}
 		rc = _fat_block_get(&b, bs, service_id, lcl, NULL,
 		    (pos / BPS(bs)) % SPC(bs), flags);
 		if (rc != EOK) {
 			(void) fat_free_clusters(bs, service_id, mcl);
-			(void) fat_node_put(fn);
-			async_answer_0(&call, rc);
+			async_answer_0(call, rc);
 			return rc;
 		}
-		(void) async_data_write_finalize(&call,
+		(void) async_data_write_finalize(call,
 		    b->data + pos % BPS(bs), bytes);
 		b->dirty = true;		/* need to sync block */
 		rc = block_put(b);
 		if (rc != EOK) {
 			(void) fat_free_clusters(bs, service_id, mcl);
-			(void) fat_node_put(fn);
 			return rc;
 		}
 		/*
@@ -1442,15 +1450,79 @@ fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		rc = fat_append_clusters(bs, nodep, mcl, lcl);
 		if (rc != EOK) {
 			(void) fat_free_clusters(bs, service_id, mcl);
-			(void) fat_node_put(fn);
 			return rc;
 		}
-		*nsize = nodep->size = pos + bytes;
-		rc = fat_node_put(fn);
+		nodep->size = pos + bytes;
 		nodep->dirty = true;		/* need to sync node */
-		*wbytes = bytes;
+		return EOK;
+	}
+}
+
+static errno_t
+fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
+    size_t *wbytes, aoff64_t *nsize)
+{
+	fs_node_t *fn;
+	fat_node_t *nodep;
+	fat_bs_t *bs;
+	size_t bytes;
+	bool exclusive = false;
+	int flags = BLOCK_FLAGS_NONE;
+	errno_t rc;
+
+	rc = fat_node_get(&fn, service_id, index);
+	if (rc != EOK)
 		return rc;
+	if (!fn)
+		return ENOENT;
+	nodep = FAT_NODE(fn);
+
+	ipc_call_t call;
+	size_t len;
+	if (!async_data_write_receive(&call, &len)) {
+		(void) fat_node_put(fn);
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
 	}
+
+	bs = block_bb_get(service_id);
+
+	/*
+	 * In all scenarios, we will attempt to write out only one block worth
+	 * of data at maximum. There might be some more efficient approaches,
+	 * but this one greatly simplifies fat_write(). Note that we can afford
+	 * to do this because the client must be ready to handle the return
+	 * value signalizing a smaller number of bytes written.
+	 */
+	bytes = min(len, BPS(bs) - pos % BPS(bs));
+	if (bytes == BPS(bs))
+		flags |= BLOCK_FLAGS_NOREAD;
+
+	/*
+	 * Overwriting existing contents does not modify the node and can run
+	 * in parallel with reads and other such writes. Anything else needs
+	 * the node for itself.
+	 */
+	fibril_rwlock_read_lock(&nodep->contents_lock);
+	if (pos + bytes > nodep->size) {
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
+		fibril_rwlock_write_lock(&nodep->contents_lock);
+		exclusive = true;
+	}
+
+	rc = fat_write_locked(bs, nodep, &call, pos, bytes, flags);
+	if (rc == EOK) {
+		*wbytes = bytes;
+		*nsize = nodep->size;
+	}
+
+	if (exclusive)
+		fibril_rwlock_write_unlock(&nodep->contents_lock);
+	else
+		fibril_rwlock_read_unlock(&nodep->contents_lock);
+
+	(void) fat_node_put(fn);
+	return rc;
 }
 
 static errno_t
@@ -1470,6 +1542,8 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 
 	bs = block_bb_get(service_id);
 
+	fibril_rwlock_write_lock(&nodep->contents_lock);
+
 	if (nodep->size == size) {
 		rc = EOK;
 	} else if (nodep->size < size) {
@@ -1495,8 +1569,13 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = fat_map_cluster_get(bs, nodep,
+			    (size - 1) / BPC(bs), &lastc);
+			if (rc == ENOMEM) {
+				rc = fat_cluster_walk(bs, service_id,
+				    nodep->firstc, &lastc, NULL,
+				    (size - 1) / BPC(bs));
+			}
 			if (rc != EOK)
 				goto out;
 			rc = fat_chop_clusters(bs, nodep, lastc);
@@ -1508,6 +1587,7 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 		rc = EOK;
 	}
 out:
+	fibril_rwlock_write_unlock(&nodep->contents_lock);
 	fat_node_put(fn);
 	return rc;
 }
@@ -1551,8 +1631,10 @@ static errno_t fat_sync(service_id_t service_id, fs_index_t index)
 
 	fat_node_t *nodep = FAT_NODE(fn);
 
+	fibril_rwlock_read_lock(&nodep->contents_lock);
 	nodep->dirty = true;
 	rc = fat_node_sync(nodep);
+	fibril_rwlock_read_unlock(&nodep->contents_lock);
 
 	fat_node_put(fn);
 	return rc;
@@ -51,8 +51,9 @@
 
 vfs_info_t mfs_vfs_info = {
 	.name = NAME,
-	.concurrent_read_write = false,
+	.concurrent_read_write = true,
 	.write_retains_size = false,
+	.dentry_cache = true,
 	.instance = 0,
 };
 
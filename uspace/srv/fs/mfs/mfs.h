@@ -38,6 +38,7 @@
 #include <block.h>
 #include <libfs.h>
 #include <adt/list.h>
+#include <fibril_synch.h>
 #include <mem.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -162,6 +163,11 @@ struct mfs_node {
 	struct mfs_ino_info *ino_i;
 	struct mfs_instance *instance;
 	unsigned refcnt;
+	/**
+	 * Serializes modifications of the node's contents and size with reads
+	 * and writes of the node.
+	 */
+	fibril_rwlock_t contents_lock;
 	fs_node_t *fsnode;
 	ht_link_t link;
 };
@@ -89,7 +89,8 @@ libfs_ops_t mfs_libfs_ops = {
 	.lnkcnt_get = mfs_lnkcnt_get,
 	.size_block = mfs_size_block,
 	.total_block_count = mfs_total_block_count,
-	.free_block_count = mfs_free_block_count
+	.free_block_count = mfs_free_block_count,
+	.cache_stats = block_cache_stats
 };
 
 /* Hash table interface for open nodes hash table */
@@ -458,6 +459,7 @@ mfs_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	mnode->ino_i = ino_i;
 	mnode->instance = inst;
 	mnode->refcnt = 1;
+	fibril_rwlock_initialize(&mnode->contents_lock);
 
 	fibril_mutex_lock(&open_nodes_lock);
 	hash_table_insert(&open_nodes, &mnode->link);
@@ -651,6 +653,7 @@ mfs_node_core_get(fs_node_t **rfn, struct mfs_instance *inst,
 	ino_i->index = index;
 	mnode->ino_i = ino_i;
 	mnode->refcnt = 1;
+	fibril_rwlock_initialize(&mnode->contents_lock);
 
 	mnode->instance = inst;
 	node->data = mnode;
@@ -841,6 +844,8 @@ mfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	mnode = fn->data;
 	ino_i = mnode->ino_i;
 
+	fibril_rwlock_read_lock(&mnode->contents_lock);
+
 	if (!async_data_read_receive(&call, &len)) {
 		rc = EINVAL;
 		goto out_error;
@@ -867,6 +872,7 @@ mfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			}
 		}
 
+		fibril_rwlock_read_unlock(&mnode->contents_lock);
 		rc = mfs_node_put(fn);
 		async_answer_0(&call, rc != EOK ? rc : ENOENT);
 		return rc;
@@ -917,15 +923,18 @@ mfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 		rc = block_put(b);
 		if (rc != EOK) {
+			fibril_rwlock_read_unlock(&mnode->contents_lock);
 			mfs_node_put(fn);
 			return rc;
 		}
 	}
 out_success:
+	fibril_rwlock_read_unlock(&mnode->contents_lock);
 	rc = mfs_node_put(fn);
 	*rbytes = bytes;
 	return rc;
 out_error:
+	fibril_rwlock_read_unlock(&mnode->contents_lock);
 	tmp = mfs_node_put(fn);
 	async_answer_0(&call, tmp != EOK ? tmp : rc);
 	return tmp != EOK ? tmp : rc;
@@ -938,6 +947,7 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	fs_node_t *fn;
 	errno_t r;
 	int flags = BLOCK_FLAGS_NONE;
+	bool exclusive = false;
 
 	r = mfs_node_get(&fn, service_id, index);
 	if (r != EOK)
@@ -948,12 +958,14 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	ipc_call_t call;
 	size_t len;
 
+	struct mfs_node *mnode = fn->data;
+
 	if (!async_data_write_receive(&call, &len)) {
-		r = EINVAL;
-		goto out_err;
+		mfs_node_put(fn);
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
 	}
 
-	struct mfs_node *mnode = fn->data;
 	struct mfs_sb_info *sbi = mnode->instance->sbi;
 	struct mfs_ino_info *ino_i = mnode->ino_i;
 	const size_t bs = sbi->block_size;
@@ -963,6 +975,19 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	if (bytes == bs)
 		flags = BLOCK_FLAGS_NOREAD;
 
+	/*
+	 * Overwriting already allocated contents does not modify the node and
+	 * can run in parallel with reads and other such writes. Anything else
+	 * needs the node for itself.
+	 */
+	fibril_rwlock_read_lock(&mnode->contents_lock);
+	if (pos + bytes > ino_i->i_size) {
+		fibril_rwlock_read_unlock(&mnode->contents_lock);
+		fibril_rwlock_write_lock(&mnode->contents_lock);
+		exclusive = true;
+	}
+
+retry:
 	r = mfs_read_map(&block, mnode, pos);
 	if (r != EOK)
 		goto out_err;
@@ -970,6 +995,14 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	if (block == 0) {
 		uint32_t dummy;
 
+		if (!exclusive) {
+			/* Filling a hole modifies the node. */
+			fibril_rwlock_read_unlock(&mnode->contents_lock);
+			fibril_rwlock_write_lock(&mnode->contents_lock);
+			exclusive = true;
+			goto retry;
+		}
+
 		r = mfs_alloc_zone(mnode->instance, &block);
 		if (r != EOK)
 			goto out_err;
@@ -995,24 +1028,28 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	b->dirty = true;
 
 	r = block_put(b);
-	if (r != EOK) {
-		mfs_node_put(fn);
-		return r;
-	}
+	if (r != EOK)
+		goto out;
 
 	if (pos + bytes > ino_i->i_size) {
 		ino_i->i_size = pos + bytes;
 		ino_i->dirty = true;
 	}
-	r = mfs_node_put(fn);
 	*nsize = ino_i->i_size;
 	*wbytes = bytes;
-	return r;
+
+out:
+	if (exclusive)
+		fibril_rwlock_write_unlock(&mnode->contents_lock);
+	else
+		fibril_rwlock_read_unlock(&mnode->contents_lock);
+
+	errno_t r2 = mfs_node_put(fn);
+	return r != EOK ? r : r2;
 
 out_err:
-	mfs_node_put(fn);
 	async_answer_0(&call, r);
-	return r;
+	goto out;
 }
 
 static errno_t
@@ -1074,11 +1111,15 @@ mfs_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 	struct mfs_node *mnode = fn->data;
 	struct mfs_ino_info *ino_i = mnode->ino_i;
 
+	fibril_rwlock_write_lock(&mnode->contents_lock);
+
 	if (ino_i->i_size == size)
 		r = EOK;
 	else
 		r = mfs_inode_shrink(mnode, ino_i->i_size - size);
 
+	fibril_rwlock_write_unlock(&mnode->contents_lock);
+
 	mfs_node_put(fn);
 	return r;
 }
@@ -58,6 +58,8 @@ vfs_info_t tmpfs_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.dentry_cache = true,
+	.page_map = true,
 	.instance = 0,
 };
 
@@ -35,6 +35,7 @@
 
 #include <libfs.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <adt/hash_table.h>
 
@@ -47,6 +48,23 @@ typedef enum {
 	TMPFS_DIRECTORY
 } tmpfs_dentry_type_t;
 
+/** Number of file pages in a full chunk, at most 32. */
+#define TMPFS_CHUNK_SHIFT	4
+#define TMPFS_CHUNK_PAGES	(1 << TMPFS_CHUNK_SHIFT)
+
+/** Piece of file contents backed by one anonymous address space area.
+ *
+ * The first few chunks of a file double in size until they reach
+ * TMPFS_CHUNK_PAGES so that small files do not reserve much memory. The
+ * areas are shareable so that VFS can map file pages directly.
+ */
+typedef struct {
+	void *base;		/**< Base of the area. */
+	size_t first;		/**< Index of the first file page in the area. */
+	size_t pages;		/**< Number of pages in the area. */
+	uint32_t present;	/**< Bitmap of pages which hold data. */
+} tmpfs_chunk_t;
+
 /* forward declaration */
 struct tmpfs_node;
 
@@ -64,7 +82,8 @@ typedef struct tmpfs_node {
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
 	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	tmpfs_chunk_t **chunks;	/**< File contents if type is TMPFS_FILE. */
+	size_t chunks_cnt;	/**< Number of entries in chunks. */
 	list_t cs_list;		/**< Child's siblings list. */
 } tmpfs_node_t;
 
@@ -134,6 +134,179 @@ libfs_ops_t tmpfs_libfs_ops = {
 	.service_get = tmpfs_service_get
 };
 
+/*
+ * Management of file contents.
+ */
+
+/** Zeroes served for reads of file holes. */
+static const uint8_t tmpfs_zero_page[PAGE_SIZE];
+
+/** Find the chunk covering a file page.
+ *
+ * Chunk idx < TMPFS_CHUNK_SHIFT covers 2^idx pages starting at page
+ * 2^idx - 1, all further chunks cover TMPFS_CHUNK_PAGES pages.
+ *
+ * @param page  Index of the file page.
+ * @param first Place to store the index of the first page of the chunk.
+ * @param pages Place to store the number of pages in the chunk.
+ *
+ * @return Index of the chunk.
+ */
+static size_t tmpfs_chunk_locate(size_t page, size_t *first, size_t *pages)
+{
+	size_t idx = 0;
+
+	if (page < TMPFS_CHUNK_PAGES - 1) {
+		while (((size_t) 2 << idx) - 1 <= page)
+			idx++;
+		*first = ((size_t) 1 << idx) - 1;
+		*pages = (size_t) 1 << idx;
+		return idx;
+	}
+
+	idx = (page - (TMPFS_CHUNK_PAGES - 1)) / TMPFS_CHUNK_PAGES;
+	*first = TMPFS_CHUNK_PAGES - 1 + idx * TMPFS_CHUNK_PAGES;
+	*pages = TMPFS_CHUNK_PAGES;
+	return TMPFS_CHUNK_SHIFT + idx;
+}
+
+/** Return the number of chunks spanned by a file of the given size. */
+static size_t tmpfs_chunks_needed(size_t size)
+{
+	size_t first;
+	size_t pages;
+
+	if (size == 0)
+		return 0;
+
+	return tmpfs_chunk_locate((size - 1) / PAGE_SIZE, &first, &pages) + 1;
+}
+
+static bool tmpfs_chunk_present(tmpfs_chunk_t *chunk, size_t page)
+{
+	return (chunk->present & (1U << (page - chunk->first))) != 0;
+}
+
+static void tmpfs_chunk_destroy(tmpfs_chunk_t *chunk)
+{
+	as_area_destroy(chunk->base);
+	free(chunk);
+}
+
+/** Get the chunk covering a file page.
+ *
+ * @param nodep  TMPFS node of a file.
+ * @param page   Index of the file page.
+ * @param create Create the chunk if the page lies in a hole.
+ * @param rchunk Place to store the chunk.
+ *
+ * @return EOK on success, ENOENT if the page lies in a hole and @a create is
+ *         false or ENOMEM.
+ */
+static errno_t tmpfs_chunk_get(tmpfs_node_t *nodep, size_t page, bool create,
+    tmpfs_chunk_t **rchunk)
+{
+	size_t first;
+	size_t pages;
+	size_t idx = tmpfs_chunk_locate(page, &first, &pages);
+
+	if (idx < nodep->chunks_cnt && nodep->chunks[idx] != NULL) {
+		*rchunk = nodep->chunks[idx];
+		return EOK;
+	}
+
+	if (!create)
+		return ENOENT;
+
+	if (idx >= nodep->chunks_cnt) {
+		size_t cnt = max(idx + 1, 2 * nodep->chunks_cnt);
+		tmpfs_chunk_t **chunks = realloc(nodep->chunks,
+		    cnt * sizeof(tmpfs_chunk_t *));
+		if (!chunks)
+			return ENOMEM;
+
+		memset(&chunks[nodep->chunks_cnt], 0,
+		    (cnt - nodep->chunks_cnt) * sizeof(tmpfs_chunk_t *));
+		nodep->chunks = chunks;
+		nodep->chunks_cnt = cnt;
+	}
+
+	tmpfs_chunk_t *chunk = malloc(sizeof(tmpfs_chunk_t));
+	if (!chunk)
+		return ENOMEM;
+
+	/* Anonymous memory is zero-filled on first touch. */
+	chunk->base = as_area_create(AS_AREA_ANY, pages * PAGE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (chunk->base == AS_MAP_FAILED) {
+		free(chunk);
+		return ENOMEM;
+	}
+
+	chunk->first = first;
+	chunk->pages = pages;
+	chunk->present = 0;
+
+	nodep->chunks[idx] = chunk;
+	*rchunk = chunk;
+	return EOK;
+}
+
+/** Drop the contents of a file beyond the given size.
+ *
+ * Bytes of present pages beyond the size of the file are always kept zero so
+ * that growing the file needs no clearing.
+ *
+ * @param nodep TMPFS node of a file.
+ * @param size  New size of the file.
+ */
+static void tmpfs_contents_shrink(tmpfs_node_t *nodep, size_t size)
+{
+	size_t npages = size / PAGE_SIZE + (size % PAGE_SIZE != 0);
+	size_t cnt = tmpfs_chunks_needed(size);
+
+	for (size_t idx = (cnt > 0) ? cnt - 1 : 0; idx < nodep->chunks_cnt;
+	    idx++) {
+		tmpfs_chunk_t *chunk = nodep->chunks[idx];
+		if (chunk == NULL)
+			continue;
+
+		for (size_t i = 0; i < chunk->pages; i++) {
+			if (chunk->first + i < npages ||
+			    !(chunk->present & (1U << i)))
+				continue;
+
+			memset(chunk->base + i * PAGE_SIZE, 0, PAGE_SIZE);
+			chunk->present &= ~(1U << i);
+		}
+
+		if (chunk->present == 0) {
+			tmpfs_chunk_destroy(chunk);
+			nodep->chunks[idx] = NULL;
+		}
+	}
+
+	tmpfs_chunk_t *chunk;
+	if (size % PAGE_SIZE != 0 &&
+	    tmpfs_chunk_get(nodep, size / PAGE_SIZE, false, &chunk) == EOK &&
+	    tmpfs_chunk_present(chunk, size / PAGE_SIZE)) {
+		size_t off = size - chunk->first * PAGE_SIZE;
+		memset(chunk->base + off, 0, PAGE_SIZE - size % PAGE_SIZE);
+	}
+
+	if (cnt == 0) {
+		free(nodep->chunks);
+		nodep->chunks = NULL;
+		nodep->chunks_cnt = 0;
+	} else if (cnt < nodep->chunks_cnt) {
+		tmpfs_chunk_t **chunks = realloc(nodep->chunks,
+		    cnt * sizeof(tmpfs_chunk_t *));
+		if (chunks)
+			nodep->chunks = chunks;
+		nodep->chunks_cnt = cnt;
+	}
+}
+
 /** Hash table of all TMPFS nodes. */
 hash_table_t nodes;
 
@@ -179,9 +352,9 @@ static void nodes_remove_callback(ht_link_t *item)
 		free(dentryp);
 	}
 
-	if (nodep->data) {
+	if (nodep->chunks) {
 		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
+		tmpfs_contents_shrink(nodep, 0);
 	}
 	free(nodep->bp);
 	free(nodep);
@@ -204,7 +377,8 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
+	nodep->chunks = NULL;
+	nodep->chunks_cnt = 0;
 	list_initialize(&nodep->cs_list);
 }
 
@@ -491,9 +665,35 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
+		if (pos >= nodep->size) {
+			(void) async_data_read_finalize(&call, tmpfs_zero_page, 0);
+			*rbytes = 0;
+			return EOK;
+		}
+
+		size_t page = pos / PAGE_SIZE;
+		size_t off = pos % PAGE_SIZE;
+		tmpfs_chunk_t *chunk;
+
 		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(&call, nodep->data + pos,
-		    bytes);
+		if (tmpfs_chunk_get(nodep, page, false, &chunk) == EOK &&
+		    tmpfs_chunk_present(chunk, page)) {
+			/* Read the run of present pages within the chunk. */
+			size_t i = page - chunk->first;
+			size_t end = i + 1;
+			while (end < chunk->pages &&
+			    (chunk->present & (1U << end)))
+				end++;
+
+			bytes = min(bytes, (end - i) * PAGE_SIZE - off);
+			(void) async_data_read_finalize(&call,
+			    chunk->base + i * PAGE_SIZE + off, bytes);
+		} else {
+			/* The page is a hole. */
+			bytes = min(bytes, PAGE_SIZE - off);
+			(void) async_data_read_finalize(&call, tmpfs_zero_page,
+			    bytes);
+		}
 	} else {
 		tmpfs_dentry_t *dentryp;
 		link_t *lnk;
@@ -552,34 +752,40 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		return EINVAL;
 	}
 
-	/*
-	 * Check whether the file needs to grow.
-	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(&call, nodep->data + pos,
-		    size);
+	if (size == 0) {
+		(void) async_data_write_finalize(&call, NULL, 0);
+		goto out;
+	}
+
+	if (pos > SIZE_MAX - size) {
+		async_answer_0(&call, ENOMEM);
+		size = 0;
 		goto out;
 	}
-	size_t delta = (pos + size) - nodep->size;
+
 	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
+	 * Write directly into the pages of the chunk covering pos. The client
+	 * sends the rest of the data by another request.
 	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
+	size_t page = pos / PAGE_SIZE;
+	size_t off = pos % PAGE_SIZE;
+	tmpfs_chunk_t *chunk;
+	if (tmpfs_chunk_get(nodep, page, true, &chunk) != EOK) {
 		async_answer_0(&call, ENOMEM);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(&call, nodep->data + pos, size);
+
+	size_t i = page - chunk->first;
+	size = min(size, (chunk->pages - i) * PAGE_SIZE - off);
+	(void) async_data_write_finalize(&call,
+	    chunk->base + i * PAGE_SIZE + off, size);
+
+	for (size_t last = (off + size - 1) / PAGE_SIZE + i; i <= last; i++)
+		chunk->present |= 1U << i;
+
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -609,17 +815,11 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size > SIZE_MAX)
 		return ENOMEM;
 
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
-
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
-	}
+	/* Growing the file just leaves a hole at its end. */
+	if (size < nodep->size)
+		tmpfs_contents_shrink(nodep, size);
 
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
@@ -643,6 +843,70 @@ static errno_t tmpfs_destroy(service_id_t service_id, fs_index_t index)
 	return tmpfs_destroy_node(FS_NODE(nodep));
 }
 
+/** Let VFS share the area which holds a file page.
+ *
+ * Holes and pages past the end of the file are refused, VFS reads them the
+ * usual way.
+ */
+static errno_t tmpfs_page_map(service_id_t service_id, fs_index_t index,
+    aoff64_t pos)
+{
+	ipc_call_t call;
+	size_t size;
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	if (size != sizeof(vfs_page_map_t)) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	node_key_t key = {
+		.service_id = service_id,
+		.index = index
+	};
+
+	ht_link_t *hlp = hash_table_find(&nodes, &key);
+	if (!hlp) {
+		async_answer_0(&call, ENOENT);
+		return ENOENT;
+	}
+	tmpfs_node_t *nodep = hash_table_get_inst(hlp, tmpfs_node_t, nh_link);
+
+	tmpfs_chunk_t *chunk;
+	if (nodep->type != TMPFS_FILE || pos % PAGE_SIZE != 0 ||
+	    pos >= nodep->size ||
+	    tmpfs_chunk_get(nodep, pos / PAGE_SIZE, false, &chunk) != EOK ||
+	    !tmpfs_chunk_present(chunk, pos / PAGE_SIZE)) {
+		async_answer_0(&call, ENOENT);
+		return ENOENT;
+	}
+
+	vfs_page_map_t info = {
+		.area_size = chunk->pages * PAGE_SIZE,
+		.offset = pos - chunk->first * PAGE_SIZE
+	};
+
+	errno_t rc = async_data_read_finalize(&call, &info, sizeof(info));
+	if (rc != EOK)
+		return rc;
+
+	if (!async_share_in_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	if (size != info.area_size) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	return async_share_in_finalize(&call, chunk->base,
+	    AS_AREA_READ | AS_AREA_CACHEABLE);
+}
+
 static errno_t tmpfs_sync(service_id_t service_id, fs_index_t index)
 {
 	/*
@@ -662,6 +926,7 @@ vfs_out_ops_t tmpfs_ops = {
 	.close = tmpfs_close,
 	.destroy = tmpfs_destroy,
 	.sync = tmpfs_sync,
+	.page_map = tmpfs_page_map,
 };
 
 /**
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup display
+ * @{
+ */
+/**
+ * @file Display server damage region
+ *
+ * A damage region is kept as a small set of disjoint rectangles. When
+ * a rectangle is added, it is first coalesced with any rectangle whose
+ * bounding box with it would not waste much area. Whatever remains is
+ * cut into pieces that do not overlap the rectangles already in the
+ * region. If the region runs out of slots, it degrades to a single
+ * bounding rectangle.
+ */
+
+#include <gfx/coord.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "damage.h"
+
+static void ds_damage_add_disjoint(ds_damage_t *, gfx_rect_t *, size_t,
+    bool *);
+
+/** Initialize damage region to empty.
+ *
+ * @param dmg Damage region
+ */
+void ds_damage_init(ds_damage_t *dmg)
+{
+	dmg->count = 0;
+}
+
+/** Determine if damage region is empty.
+ *
+ * @param dmg Damage region
+ * @return @c true iff damage region is empty
+ */
+bool ds_damage_is_empty(ds_damage_t *dmg)
+{
+	return dmg->count == 0;
+}
+
+/** Compute area of a sorted rectangle.
+ *
+ * @param rect Rectangle
+ * @return Area in pixels
+ */
+static int64_t ds_damage_rect_area(gfx_rect_t *rect)
+{
+	return (int64_t)(rect->p1.x - rect->p0.x) *
+	    (int64_t)(rect->p1.y - rect->p0.y);
+}
+
+/** Determine if two rectangles should be merged into their bounding box.
+ *
+ * They are merged if the bounding box exceeds the union of the two
+ * rectangles by at most a quarter of the union. This merges rectangles
+ * that overlap heavily or lie next to each other, while small updates
+ * far apart are kept separate.
+ *
+ * @param a First rectangle
+ * @param b Second rectangle
+ * @return @c true if rectangles should be merged
+ */
+static bool ds_damage_should_merge(gfx_rect_t *a, gfx_rect_t *b)
+{
+	gfx_rect_t env;
+	gfx_rect_t isect;
+	int64_t uarea;
+	int64_t waste;
+
+	gfx_rect_envelope(a, b, &env);
+	gfx_rect_clip(a, b, &isect);
+
+	uarea = ds_damage_rect_area(a) + ds_damage_rect_area(b) -
+	    ds_damage_rect_area(&isect);
+	waste = ds_damage_rect_area(&env) - uarea;
+
+	return waste * 4 <= uarea;
+}
+
+/** Remove rectangle from damage region.
+ *
+ * @param dmg Damage region
+ * @param idx Index of rectangle to remove
+ */
+static void ds_damage_remove(ds_damage_t *dmg, size_t idx)
+{
+	dmg->rect[idx] = dmg->rect[dmg->count - 1];
+	--dmg->count;
+}
+
+/** Add rectangle to damage region.
+ *
+ * @param dmg Damage region
+ * @param rect Rectangle (need not be sorted)
+ */
+void ds_damage_add(ds_damage_t *dmg, gfx_rect_t *rect)
+{
+	gfx_rect_t srect;
+	gfx_rect_t env;
+	bool overflow;
+	size_t i;
+
+	gfx_rect_points_sort(rect, &srect);
+	if (gfx_rect_is_empty(&srect))
+		return;
+
+again:
+	i = 0;
+	while (i < dmg->count) {
+		/* Already covered? */
+		if (gfx_rect_is_inside(&srect, &dmg->rect[i]))
+			return;
+
+		/* Drop rectangles covered by the new one */
+		if (gfx_rect_is_inside(&dmg->rect[i], &srect)) {
+			ds_damage_remove(dmg, i);
+			continue;
+		}
+
+		++i;
+	}
+
+	for (i = 0; i < dmg->count; i++) {
+		if (ds_damage_should_merge(&dmg->rect[i], &srect)) {
+			gfx_rect_envelope(&dmg->rect[i], &srect, &env);
+			ds_damage_remove(dmg, i);
+			srect = env;
+			/* The bounding box may now touch other rectangles */
+			goto again;
+		}
+	}
+
+	overflow = false;
+	ds_damage_add_disjoint(dmg, &srect, 0, &overflow);
+
+	if (overflow) {
+		/* Out of slots, fall back to a single bounding rectangle */
+		for (i = 0; i < dmg->count; i++) {
+			gfx_rect_envelope(&srect, &dmg->rect[i], &env);
+			srect = env;
+		}
+
+		dmg->rect[0] = srect;
+		dmg->count = 1;
+	}
+}
+
+/** Add the parts of a rectangle not yet covered by damage region.
+ *
+ * @param dmg Damage region
+ * @param rect Sorted, non-empty rectangle
+ * @param start Index of first region rectangle to check against
+ * @param overflow Set to @c true if a rectangle could not be added
+ */
+static void ds_damage_add_disjoint(ds_damage_t *dmg, gfx_rect_t *rect,
+    size_t start, bool *overflow)
+{
+	gfx_rect_t *r;
+	gfx_rect_t piece;
+	gfx_coord_t y0, y1;
+	size_t i;
+
+	for (i = start; i < dmg->count; i++) {
+		r = &dmg->rect[i];
+		if (!gfx_rect_is_incident(rect, r))
+			continue;
+
+		/* Cut @a rect into up to four pieces around @a r */
+		y0 = rect->p0.y;
+		y1 = rect->p1.y;
+
+		if (r->p0.y > rect->p0.y) {
+			piece = *rect;
+			piece.p1.y = r->p0.y;
+			ds_damage_add_disjoint(dmg, &piece, i + 1, overflow);
+			y0 = r->p0.y;
+		}
+
+		if (r->p1.y < rect->p1.y) {
+			piece = *rect;
+			piece.p0.y = r->p1.y;
+			ds_damage_add_disjoint(dmg, &piece, i + 1, overflow);
+			y1 = r->p1.y;
+		}
+
+		if (r->p0.x > rect->p0.x) {
+			piece.p0.x = rect->p0.x;
+			piece.p0.y = y0;
+			piece.p1.x = r->p0.x;
+			piece.p1.y = y1;
+			ds_damage_add_disjoint(dmg, &piece, i + 1, overflow);
+		}
+
+		if (r->p1.x < rect->p1.x) {
+			piece.p0.x = r->p1.x;
+			piece.p0.y = y0;
+			piece.p1.x = rect->p1.x;
+			piece.p1.y = y1;
+			ds_damage_add_disjoint(dmg, &piece, i + 1, overflow);
+		}
+
+		return;
+	}
+
+	if (dmg->count >= DS_DAMAGE_MAX) {
+		*overflow = true;
+		return;
+	}
+
+	dmg->rect[dmg->count++] = *rect;
+}
+
+/** @}
+ */
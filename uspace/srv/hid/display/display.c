@@ -44,6 +44,7 @@
 #include "clonegc.h"
 #include "cursimg.h"
 #include "cursor.h"
+#include "damage.h"
 #include "seat.h"
 #include "window.h"
 #include "display.h"
@@ -464,10 +465,7 @@ static errno_t ds_display_alloc_backbuf(ds_display_t *disp)
 	if (rc != EOK)
 		goto error;
 
-	disp->dirty_rect.p0.x = 0;
-	disp->dirty_rect.p0.y = 0;
-	disp->dirty_rect.p1.x = 0;
-	disp->dirty_rect.p1.y = 0;
+	ds_damage_init(&disp->dirty);
 
 	return EOK;
 error:
@@ -658,13 +656,16 @@ errno_t ds_display_paint_bg(ds_display_t *disp, gfx_rect_t *rect)
 
 /** Update front buffer from back buffer.
  *
- * If the display is not double-buffered, no action is taken.
+ * Only the dirty region of the back buffer is transferred, one
+ * rectangle at a time. If the display is not double-buffered, no action
+ * is taken.
  *
  * @param disp Display
  * @return EOK on success, or an error code
  */
 static errno_t ds_display_update(ds_display_t *disp)
 {
+	size_t i;
 	errno_t rc;
 
 	if (disp->backbuf == NULL) {
@@ -672,24 +673,23 @@ static errno_t ds_display_update(ds_display_t *disp)
 		return EOK;
 	}
 
-	rc = gfx_bitmap_render(disp->backbuf, &disp->dirty_rect, NULL);
-	if (rc != EOK)
-		return rc;
-
-	disp->dirty_rect.p0.x = 0;
-	disp->dirty_rect.p0.y = 0;
-	disp->dirty_rect.p1.x = 0;
-	disp->dirty_rect.p1.y = 0;
+	for (i = 0; i < disp->dirty.count; i++) {
+		rc = gfx_bitmap_render(disp->backbuf, &disp->dirty.rect[i],
+		    NULL);
+		if (rc != EOK)
+			return rc;
+	}
 
+	ds_damage_init(&disp->dirty);
 	return EOK;
 }
 
-/** Paint display.
+/** Paint display contents into a rectangle without updating front buffer.
  *
  * @param display Display
  * @param rect Bounding rectangle or @c NULL to repaint entire display
  */
-errno_t ds_display_paint(ds_display_t *disp, gfx_rect_t *rect)
+static errno_t ds_display_paint_rect(ds_display_t *disp, gfx_rect_t *rect)
 {
 	errno_t rc;
 	ds_window_t *wnd;
@@ -730,13 +730,51 @@ errno_t ds_display_paint(ds_display_t *disp, gfx_rect_t *rect)
 		seat = ds_display_next_seat(seat);
 	}
 
+	return EOK;
+}
+
+/** Paint display.
+ *
+ * @param display Display
+ * @param rect Bounding rectangle or @c NULL to repaint entire display
+ */
+errno_t ds_display_paint(ds_display_t *disp, gfx_rect_t *rect)
+{
+	errno_t rc;
+
+	rc = ds_display_paint_rect(disp, rect);
+	if (rc != EOK)
+		return rc;
+
+	return ds_display_update(disp);
+}
+
+/** Paint damaged region of display.
+ *
+ * Each rectangle of the region is composited separately and then only
+ * the changed areas are transferred to the output devices.
+ *
+ * @param display Display
+ * @param dmg Damage region
+ */
+errno_t ds_display_paint_damage(ds_display_t *disp, ds_damage_t *dmg)
+{
+	size_t i;
+	errno_t rc;
+
+	for (i = 0; i < dmg->count; i++) {
+		rc = ds_display_paint_rect(disp, &dmg->rect[i]);
+		if (rc != EOK)
+			return rc;
+	}
+
 	return ds_display_update(disp);
 }
 
 /** Display invalidate callback.
  *
  * Called by backbuffer memory GC when something is rendered into it.
- * Updates the display's dirty rectangle.
+ * Adds the rectangle to the display's dirty region.
  *
  * @param arg Argument (display cast as void *)
  * @param rect Rectangle to update
@@ -744,10 +782,8 @@ errno_t ds_display_paint(ds_display_t *disp, gfx_rect_t *rect)
 static void ds_display_invalidate_cb(void *arg, gfx_rect_t *rect)
 {
 	ds_display_t *disp = (ds_display_t *) arg;
-	gfx_rect_t env;
 
-	gfx_rect_envelope(&disp->dirty_rect, rect, &env);
-	disp->dirty_rect = env;
+	ds_damage_add(&disp->dirty, rect);
 }
 
 /** Display update callback.
@@ -43,6 +43,7 @@
 #include <io/kbd_event.h>
 #include "types/display/client.h"
 #include "types/display/cursor.h"
+#include "types/display/damage.h"
 #include "types/display/ddev.h"
 #include "types/display/display.h"
 #include "types/display/ptd_event.h"
@@ -81,6 +82,7 @@ extern void ds_display_remove_cursor(ds_cursor_t *);
 extern gfx_context_t *ds_display_get_gc(ds_display_t *);
 extern errno_t ds_display_paint_bg(ds_display_t *, gfx_rect_t *);
 extern errno_t ds_display_paint(ds_display_t *, gfx_rect_t *);
+extern errno_t ds_display_paint_damage(ds_display_t *, ds_damage_t *);
 
 #endif
 
@@ -40,6 +40,7 @@
 #include <stdlib.h>
 #include "client.h"
 #include "cursor.h"
+#include "damage.h"
 #include "display.h"
 #include "seat.h"
 #include "window.h"
@@ -305,33 +306,15 @@ void ds_seat_get_pointer_rect(ds_seat_t *seat, gfx_rect_t *rect)
 static errno_t ds_seat_repaint_pointer(ds_seat_t *seat, gfx_rect_t *old_rect)
 {
 	gfx_rect_t new_rect;
-	gfx_rect_t envelope;
-	errno_t rc;
+	ds_damage_t dmg;
 
 	ds_seat_get_pointer_rect(seat, &new_rect);
 
-	if (gfx_rect_is_incident(old_rect, &new_rect)) {
-		/* Rectangles do not intersect. Repaint them separately. */
-		rc = ds_display_paint(seat->display, &new_rect);
-		if (rc != EOK)
-			return rc;
-
-		rc = ds_display_paint(seat->display, old_rect);
-		if (rc != EOK)
-			return rc;
-	} else {
-		/*
-		 * Rectangles intersect. As an optimization, repaint them
-		 * in a single operation.
-		 */
-		gfx_rect_envelope(old_rect, &new_rect, &envelope);
-
-		rc = ds_display_paint(seat->display, &envelope);
-		if (rc != EOK)
-			return rc;
-	}
+	ds_damage_init(&dmg);
+	ds_damage_add(&dmg, old_rect);
+	ds_damage_add(&dmg, &new_rect);
 
-	return EOK;
+	return ds_display_paint_damage(seat->display, &dmg);
 }
 
 /** Post pointing device event to the seat
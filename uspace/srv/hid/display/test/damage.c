@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gfx/coord.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../damage.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(damage);
+
+/** Set rectangle coordinates */
+static void test_rect(gfx_rect_t *rect, gfx_coord_t x0, gfx_coord_t y0,
+    gfx_coord_t x1, gfx_coord_t y1)
+{
+	rect->p0.x = x0;
+	rect->p0.y = y0;
+	rect->p1.x = x1;
+	rect->p1.y = y1;
+}
+
+/** Determine if pixel is covered by damage region */
+static bool test_covered(ds_damage_t *dmg, gfx_coord2_t *pos)
+{
+	size_t i;
+
+	for (i = 0; i < dmg->count; i++) {
+		if (gfx_pix_inside_rect(pos, &dmg->rect[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/** Check that region rectangles are pairwise disjoint */
+static bool test_disjoint(ds_damage_t *dmg)
+{
+	size_t i, j;
+
+	for (i = 0; i < dmg->count; i++) {
+		for (j = i + 1; j < dmg->count; j++) {
+			if (gfx_rect_is_incident(&dmg->rect[i], &dmg->rect[j]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/** Newly initialized region is empty, adding empty rectangle does nothing */
+PCUT_TEST(init_empty)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+
+	ds_damage_init(&dmg);
+	PCUT_ASSERT_TRUE(ds_damage_is_empty(&dmg));
+
+	test_rect(&rect, 10, 10, 10, 20);
+	ds_damage_add(&dmg, &rect);
+	PCUT_ASSERT_TRUE(ds_damage_is_empty(&dmg));
+}
+
+/** Rectangle covered by the region is not added again */
+PCUT_TEST(add_covered)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+
+	ds_damage_init(&dmg);
+
+	test_rect(&rect, 0, 0, 10, 10);
+	ds_damage_add(&dmg, &rect);
+	test_rect(&rect, 2, 2, 5, 5);
+	ds_damage_add(&dmg, &rect);
+
+	PCUT_ASSERT_INT_EQUALS(1, dmg.count);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.x);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.y);
+	PCUT_ASSERT_INT_EQUALS(10, dmg.rect[0].p1.x);
+	PCUT_ASSERT_INT_EQUALS(10, dmg.rect[0].p1.y);
+}
+
+/** Adjacent rectangles are coalesced, unsorted rectangle is accepted */
+PCUT_TEST(add_adjacent)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+
+	ds_damage_init(&dmg);
+
+	test_rect(&rect, 0, 0, 10, 10);
+	ds_damage_add(&dmg, &rect);
+	test_rect(&rect, 20, 0, 10, 10);
+	ds_damage_add(&dmg, &rect);
+
+	PCUT_ASSERT_INT_EQUALS(1, dmg.count);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.x);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.y);
+	PCUT_ASSERT_INT_EQUALS(20, dmg.rect[0].p1.x);
+	PCUT_ASSERT_INT_EQUALS(10, dmg.rect[0].p1.y);
+}
+
+/** Distant rectangles are kept separate */
+PCUT_TEST(add_distant)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+
+	ds_damage_init(&dmg);
+
+	test_rect(&rect, 0, 0, 2, 2);
+	ds_damage_add(&dmg, &rect);
+	test_rect(&rect, 100, 100, 102, 102);
+	ds_damage_add(&dmg, &rect);
+
+	PCUT_ASSERT_INT_EQUALS(2, dmg.count);
+}
+
+/** Partially overlapping rectangles are split into disjoint ones */
+PCUT_TEST(add_overlap)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+	gfx_coord2_t pos;
+
+	ds_damage_init(&dmg);
+
+	/* Horizontal and vertical bar crossing each other */
+	test_rect(&rect, 0, 10, 100, 12);
+	ds_damage_add(&dmg, &rect);
+	test_rect(&rect, 50, 0, 52, 100);
+	ds_damage_add(&dmg, &rect);
+
+	PCUT_ASSERT_TRUE(test_disjoint(&dmg));
+
+	for (pos.y = 0; pos.y < 110; pos.y++) {
+		for (pos.x = 0; pos.x < 110; pos.x++) {
+			PCUT_ASSERT_EQUALS((pos.y >= 10 && pos.y < 12 &&
+			    pos.x < 100) || (pos.x >= 50 && pos.x < 52 &&
+			    pos.y < 100), test_covered(&dmg, &pos));
+		}
+	}
+}
+
+/** Region that runs out of slots falls back to the bounding rectangle */
+PCUT_TEST(add_overflow)
+{
+	ds_damage_t dmg;
+	gfx_rect_t rect;
+	int i;
+
+	ds_damage_init(&dmg);
+
+	for (i = 0; i < DS_DAMAGE_MAX + 1; i++) {
+		test_rect(&rect, i * 10, i * 10, i * 10 + 1, i * 10 + 1);
+		ds_damage_add(&dmg, &rect);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(1, dmg.count);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.x);
+	PCUT_ASSERT_INT_EQUALS(0, dmg.rect[0].p0.y);
+	PCUT_ASSERT_INT_EQUALS(DS_DAMAGE_MAX * 10 + 1, dmg.rect[0].p1.x);
+	PCUT_ASSERT_INT_EQUALS(DS_DAMAGE_MAX * 10 + 1, dmg.rect[0].p1.y);
+}
+
+PCUT_EXPORT(damage);
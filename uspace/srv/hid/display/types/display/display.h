@@ -43,6 +43,7 @@
 #include <io/input.h>
 #include <memgfx/memgc.h>
 #include <types/display/cursor.h>
+#include "types/display/damage.h"
 #include "cursor.h"
 #include "clonegc.h"
 #include "window.h"
@@ -103,8 +104,8 @@ typedef struct ds_display {
 	/** Frontbuffer (clone) GC */
 	ds_clonegc_t *fbgc;
 
-	/** Backbuffer dirty rectangle */
-	gfx_rect_t dirty_rect;
+	/** Backbuffer dirty region */
+	ds_damage_t dirty;
 
 	/** Display flags */
 	ds_display_flags_t flags;
@@ -44,6 +44,7 @@
 #include <memgfx/memgc.h>
 #include <stdlib.h>
 #include "client.h"
+#include "damage.h"
 #include "display.h"
 #include "seat.h"
 #include "window.h"
@@ -51,6 +52,8 @@
 static void ds_window_invalidate_cb(void *, gfx_rect_t *);
 static void ds_window_update_cb(void *);
 static void ds_window_get_preview_rect(ds_window_t *, gfx_rect_t *);
+static void ds_window_get_display_rect(ds_window_t *, gfx_rect_t *);
+static void ds_window_damage_frame(ds_damage_t *, gfx_rect_t *);
 
 /** Create window.
  *
@@ -71,6 +74,7 @@ errno_t ds_window_create(ds_client_t *client, display_wnd_params_t *params,
 	gfx_coord2_t dims;
 	gfx_bitmap_params_t bparams;
 	gfx_bitmap_alloc_t alloc;
+	gfx_rect_t drect;
 	errno_t rc;
 
 	wnd = calloc(1, sizeof(ds_window_t));
@@ -134,7 +138,8 @@ errno_t ds_window_create(ds_client_t *client, display_wnd_params_t *params,
 	else
 		ds_seat_set_focus(seat, wnd);
 
-	(void) ds_display_paint(wnd->display, NULL);
+	ds_window_get_display_rect(wnd, &drect);
+	(void) ds_display_paint(wnd->display, &drect);
 
 	*rgc = wnd;
 	return EOK;
@@ -155,8 +160,10 @@ error:
 void ds_window_destroy(ds_window_t *wnd)
 {
 	ds_display_t *disp;
+	gfx_rect_t drect;
 
 	disp = wnd->display;
+	ds_window_get_display_rect(wnd, &drect);
 
 	ds_client_remove_window(wnd);
 	ds_display_remove_window(wnd);
@@ -168,7 +175,7 @@ void ds_window_destroy(ds_window_t *wnd)
 
 	free(wnd);
 
-	(void) ds_display_paint(disp, NULL);
+	(void) ds_display_paint(disp, &drect);
 }
 
 /** Bring window to top.
@@ -178,10 +185,13 @@ void ds_window_destroy(ds_window_t *wnd)
 void ds_window_bring_to_top(ds_window_t *wnd)
 {
 	ds_display_t *disp = wnd->display;
+	gfx_rect_t drect;
 
 	ds_display_remove_window(wnd);
 	ds_display_add_window(disp, wnd);
-	(void) ds_display_paint(wnd->display, NULL);
+
+	ds_window_get_display_rect(wnd, &drect);
+	(void) ds_display_paint(wnd->display, &drect);
 }
 
 /** Get generic graphic context from window.
@@ -255,6 +265,45 @@ static void ds_window_get_preview_rect(ds_window_t *wnd, gfx_rect_t *rect)
 	rect->p1.y = 0;
 }
 
+/** Get the rectangle covered by a window on the display.
+ *
+ * @param wnd Window
+ * @param rect Place to store rectangle in display coordinates
+ */
+static void ds_window_get_display_rect(ds_window_t *wnd, gfx_rect_t *rect)
+{
+	gfx_rect_translate(&wnd->dpos, &wnd->rect, rect);
+}
+
+/** Add the frame of a preview rectangle to a damage region.
+ *
+ * @param dmg Damage region
+ * @param rect Preview rectangle (can be empty)
+ */
+static void ds_window_damage_frame(ds_damage_t *dmg, gfx_rect_t *rect)
+{
+	gfx_rect_t edge;
+
+	if (gfx_rect_is_empty(rect))
+		return;
+
+	edge = *rect;
+	edge.p1.y = rect->p0.y + 1;
+	ds_damage_add(dmg, &edge);
+
+	edge = *rect;
+	edge.p0.y = rect->p1.y - 1;
+	ds_damage_add(dmg, &edge);
+
+	edge = *rect;
+	edge.p1.x = rect->p0.x + 1;
+	ds_damage_add(dmg, &edge);
+
+	edge = *rect;
+	edge.p0.x = rect->p1.x - 1;
+	ds_damage_add(dmg, &edge);
+}
+
 /** Paint window preview if the window is being moved or resized.
  *
  * If the window is not being resized or moved, take no action and return
@@ -345,11 +394,8 @@ errno_t ds_window_paint_preview(ds_window_t *wnd, gfx_rect_t *rect)
  */
 static errno_t ds_window_repaint_preview(ds_window_t *wnd, gfx_rect_t *old_rect)
 {
-	errno_t rc;
 	gfx_rect_t prect;
-	gfx_rect_t envelope;
-	bool oldr;
-	bool newr;
+	ds_damage_t dmg;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ds_window_repaint_preview");
 
@@ -359,36 +405,13 @@ static errno_t ds_window_repaint_preview(ds_window_t *wnd, gfx_rect_t *old_rect)
 	 */
 	ds_window_get_preview_rect(wnd, &prect);
 
-	oldr = (old_rect != NULL) && !gfx_rect_is_empty(old_rect);
-	newr = !gfx_rect_is_empty(&prect);
+	/* The preview is just a frame, only repaint its edges */
+	ds_damage_init(&dmg);
+	if (old_rect != NULL)
+		ds_window_damage_frame(&dmg, old_rect);
+	ds_window_damage_frame(&dmg, &prect);
 
-	if (oldr && newr && gfx_rect_is_incident(old_rect, &prect)) {
-		/*
-		 * As an optimization, repaint both rectangles in a single
-		 * operation.
-		 */
-
-		gfx_rect_envelope(old_rect, &prect, &envelope);
-
-		rc = ds_display_paint(wnd->display, &envelope);
-		if (rc != EOK)
-			return rc;
-	} else {
-		/* Repaint each rectangle separately */
-		if (oldr) {
-			rc = ds_display_paint(wnd->display, old_rect);
-			if (rc != EOK)
-				return rc;
-		}
-
-		if (newr) {
-			rc = ds_display_paint(wnd->display, &prect);
-			if (rc != EOK)
-				return rc;
-		}
-	}
-
-	return EOK;
+	return ds_display_paint_damage(wnd->display, &dmg);
 }
 
 /** Start moving a window by mouse drag.
@@ -421,6 +444,8 @@ static void ds_window_finish_move(ds_window_t *wnd, gfx_coord2_t *pos)
 	gfx_coord2_t dmove;
 	gfx_coord2_t nwpos;
 	gfx_rect_t old_rect;
+	gfx_rect_t drect;
+	ds_damage_t dmg;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ds_window_finish_move (%d, %d)",
 	    (int) pos->x, (int) pos->y);
@@ -430,12 +455,19 @@ static void ds_window_finish_move(ds_window_t *wnd, gfx_coord2_t *pos)
 	gfx_coord2_subtract(pos, &wnd->orig_pos, &dmove);
 	gfx_coord2_add(&wnd->dpos, &dmove, &nwpos);
 
+	ds_damage_init(&dmg);
 	ds_window_get_preview_rect(wnd, &old_rect);
+	ds_window_damage_frame(&dmg, &old_rect);
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
 
 	wnd->dpos = nwpos;
 	wnd->state = dsw_idle;
 
-	(void) ds_display_paint(wnd->display, NULL);
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
+
+	(void) ds_display_paint_damage(wnd->display, &dmg);
 }
 
 /** Update window position when moving by mouse drag.
@@ -503,6 +535,7 @@ static void ds_window_finish_resize(ds_window_t *wnd, gfx_coord2_t *pos)
 {
 	gfx_coord2_t dresize;
 	gfx_rect_t nrect;
+	gfx_rect_t old_rect;
 	ds_seat_t *seat;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ds_window_finish_resize (%d, %d)",
@@ -514,6 +547,7 @@ static void ds_window_finish_resize(ds_window_t *wnd, gfx_coord2_t *pos)
 	/* Compute new rectangle */
 	ds_window_calc_resize(wnd, &dresize, &nrect);
 
+	ds_window_get_preview_rect(wnd, &old_rect);
 	wnd->state = dsw_idle;
 	ds_client_post_resize_event(wnd->client, wnd, &nrect);
 
@@ -521,7 +555,8 @@ static void ds_window_finish_resize(ds_window_t *wnd, gfx_coord2_t *pos)
 	seat = ds_display_first_seat(wnd->display);
 	ds_seat_set_wm_cursor(seat, NULL);
 
-	(void) ds_display_paint(wnd->display, NULL);
+	/* Clear the preview, the client will repaint after resizing */
+	(void) ds_window_repaint_preview(wnd, &old_rect);
 }
 
 /** Update window position when resizing by mouse drag.
@@ -674,8 +709,19 @@ void ds_window_move_req(ds_window_t *wnd, gfx_coord2_t *pos)
  */
 void ds_window_move(ds_window_t *wnd, gfx_coord2_t *dpos)
 {
+	gfx_rect_t drect;
+	ds_damage_t dmg;
+
+	ds_damage_init(&dmg);
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
+
 	wnd->dpos = *dpos;
-	(void) ds_display_paint(wnd->display, NULL);
+
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
+
+	(void) ds_display_paint_damage(wnd->display, &dmg);
 }
 
 /** Get window position.
@@ -721,8 +767,14 @@ errno_t ds_window_resize(ds_window_t *wnd, gfx_coord2_t *offs,
 	gfx_coord2_t dims;
 	gfx_bitmap_alloc_t alloc;
 	gfx_coord2_t ndpos;
+	gfx_rect_t drect;
+	ds_damage_t dmg;
 	errno_t rc;
 
+	ds_damage_init(&dmg);
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
+
 	dgc = ds_display_get_gc(wnd->display);
 	if (dgc != NULL) {
 		gfx_bitmap_params_init(&bparams);
@@ -760,7 +812,10 @@ errno_t ds_window_resize(ds_window_t *wnd, gfx_coord2_t *offs,
 	wnd->dpos = ndpos;
 	wnd->rect = *nrect;
 
-	(void) ds_display_paint(wnd->display, NULL);
+	ds_window_get_display_rect(wnd, &drect);
+	ds_damage_add(&dmg, &drect);
+
+	(void) ds_display_paint_damage(wnd->display, &dmg);
 	return EOK;
 }
 
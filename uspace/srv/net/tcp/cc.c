@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Congestion control and RTT estimation
+ *
+ * Implements the standard TCP congestion control algorithms (slow start,
+ * congestion avoidance, fast retransmit and fast recovery) as described
+ * in RFC 5681, with the NewReno modification of fast recovery (RFC 6582)
+ * and retransmission timer computation per RFC 6298.
+ */
+
+#include <inttypes.h>
+#include <io/log.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Clock granularity used in RTO computation */
+#define TCP_CLOCK_G	1000
+
+/** Determine if sequence number @a a comes before @a b */
+static bool seq_lt(uint32_t a, uint32_t b)
+{
+	return ((a - b) & (0x1 << 31)) != 0;
+}
+
+/** Amount of data sent, but not yet acknowledged */
+static uint32_t tcp_cc_flight_size(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** Compute slow start threshold after a loss has been detected. */
+static uint32_t tcp_cc_loss_ssthresh(tcp_conn_t *conn)
+{
+	return max(tcp_cc_flight_size(conn) / 2, 2 * conn->cc.smss);
+}
+
+/** Increase congestion window, avoiding overflow. */
+static void tcp_cc_cwnd_inc(tcp_conn_t *conn, uint32_t inc)
+{
+	if (conn->cc.cwnd > UINT32_MAX / 2 - inc)
+		return;
+
+	conn->cc.cwnd += inc;
+}
+
+/** Initialize congestion control state of a connection.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_init(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	tcp_cc_set_smss(conn, TCP_DEFAULT_SMSS);
+	cc->ssthresh = UINT32_MAX;
+	cc->bytes_acked = 0;
+	cc->dupacks = 0;
+	cc->in_recovery = false;
+	cc->in_rto_recovery = false;
+	cc->recover = 0;
+
+	cc->rtt_valid = false;
+	cc->srtt = 0;
+	cc->rttvar = 0;
+	cc->rto = TCP_RTO_INIT;
+}
+
+/** Set sender maximum segment size.
+ *
+ * Also resets the congestion window to the initial window, so this
+ * should only be used during connection establishment.
+ *
+ * @param conn Connection
+ * @param smss Sender maximum segment size
+ */
+void tcp_cc_set_smss(tcp_conn_t *conn, uint32_t smss)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	cc->smss = smss;
+
+	/* Initial window (RFC 5681 3.1) */
+	cc->cwnd = min(4 * smss, max(2 * smss, 4380));
+}
+
+/** Get current value of the timestamp clock.
+ *
+ * @return Timestamp clock value in milliseconds
+ */
+uint32_t tcp_cc_ts_now(void)
+{
+	struct timespec ts;
+
+	getuptime(&ts);
+	return (uint32_t) (ts.tv_sec * 1000 + NSEC2MSEC(ts.tv_nsec));
+}
+
+/** Get effective send window.
+ *
+ * @param conn Connection
+ * @return Minimum of the peer's receive window and the congestion window
+ */
+uint32_t tcp_cc_send_wnd(tcp_conn_t *conn)
+{
+	return min(conn->snd_wnd, conn->cc.cwnd);
+}
+
+/** Update RTT estimate with a new measurement (RFC 6298 2.2, 2.3).
+ *
+ * @param conn Connection
+ * @param rtt Measured round-trip time
+ */
+void tcp_cc_rtt_sample(tcp_conn_t *conn, usec_t rtt)
+{
+	tcp_cc_t *cc = &conn->cc;
+	usec_t delta;
+
+	if (!cc->rtt_valid) {
+		cc->srtt = rtt;
+		cc->rttvar = rtt / 2;
+		cc->rtt_valid = true;
+	} else {
+		delta = cc->srtt > rtt ? cc->srtt - rtt : rtt - cc->srtt;
+		cc->rttvar = (3 * cc->rttvar + delta) / 4;
+		cc->srtt = (7 * cc->srtt + rtt) / 8;
+	}
+
+	cc->rto = cc->srtt + max(TCP_CLOCK_G, 4 * cc->rttvar);
+	if (cc->rto < TCP_RTO_MIN)
+		cc->rto = TCP_RTO_MIN;
+	if (cc->rto > TCP_RTO_MAX)
+		cc->rto = TCP_RTO_MAX;
+
+	++conn->stats.rtt_samples;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: RTT=%lld SRTT=%lld RTTVAR=%lld "
+	    "RTO=%lld", conn->name, (long long) rtt, (long long) cc->srtt,
+	    (long long) cc->rttvar, (long long) cc->rto);
+}
+
+/** Process ACK that acknowledges new data.
+ *
+ * Must be called after SND.UNA has been updated.
+ *
+ * @param conn Connection
+ * @param acked Number of newly acknowledged octets
+ * @return @c true if the first unacknowledged segment should be
+ *         retransmitted immediately
+ */
+bool tcp_cc_new_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+	bool rexmit = false;
+
+	conn->stats.bytes_acked += acked;
+	cc->dupacks = 0;
+
+	if (cc->in_recovery) {
+		if (seq_lt(conn->snd_una, cc->recover)) {
+			/*
+			 * Partial ACK (RFC 6582 3.2 step 3). Retransmit
+			 * the next unacknowledged segment and deflate the
+			 * congestion window by the amount of new data
+			 * acknowledged.
+			 */
+			cc->cwnd = cc->cwnd > acked ? cc->cwnd - acked : 0;
+			if (acked >= cc->smss)
+				cc->cwnd += cc->smss;
+			cc->cwnd = max(cc->cwnd, cc->smss);
+			return true;
+		}
+
+		/* Full ACK, exit fast recovery (RFC 6582 3.2 step 3) */
+		cc->cwnd = min(cc->ssthresh,
+		    max(tcp_cc_flight_size(conn), cc->smss) + cc->smss);
+		cc->in_recovery = false;
+		cc->bytes_acked = 0;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Leaving fast recovery, "
+		    "cwnd=%" PRIu32, conn->name, cc->cwnd);
+		return false;
+	}
+
+	if (cc->in_rto_recovery) {
+		/*
+		 * After a timeout everything sent before the loss is
+		 * suspect. Keep retransmitting as long as the ACKs do
+		 * not cover all data outstanding at the time of the
+		 * timeout.
+		 */
+		if (seq_lt(conn->snd_una, cc->recover))
+			rexmit = true;
+		else
+			cc->in_rto_recovery = false;
+	}
+
+	if (cc->cwnd < cc->ssthresh) {
+		/* Slow start */
+		tcp_cc_cwnd_inc(conn, min(acked, cc->smss));
+	} else {
+		/* Congestion avoidance with appropriate byte counting */
+		cc->bytes_acked += acked;
+		if (cc->bytes_acked >= cc->cwnd) {
+			cc->bytes_acked -= cc->cwnd;
+			tcp_cc_cwnd_inc(conn, cc->smss);
+		}
+	}
+
+	return rexmit;
+}
+
+/** Process duplicate ACK.
+ *
+ * @param conn Connection
+ * @return @c true if fast retransmit should be performed
+ */
+bool tcp_cc_dup_ack(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	++conn->stats.dup_acks;
+
+	if (cc->in_recovery) {
+		/* Inflate window for each segment that has left the network */
+		tcp_cc_cwnd_inc(conn, cc->smss);
+		return false;
+	}
+
+	++cc->dupacks;
+	if (cc->dupacks != TCP_DUPACK_THRESH)
+		return false;
+
+	/*
+	 * Do not enter fast recovery for losses of data sent before
+	 * a retransmission timeout (RFC 6582 3.2 step 2).
+	 */
+	if (cc->in_rto_recovery)
+		return false;
+
+	cc->ssthresh = tcp_cc_loss_ssthresh(conn);
+	cc->recover = conn->snd_nxt;
+	cc->cwnd = cc->ssthresh + TCP_DUPACK_THRESH * cc->smss;
+	cc->in_recovery = true;
+
+	++conn->stats.fast_retrans;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Fast retransmit, ssthresh=%"
+	    PRIu32 " cwnd=%" PRIu32, conn->name, cc->ssthresh, cc->cwnd);
+	return true;
+}
+
+/** Process retransmission timer expiration.
+ *
+ * Collapse the congestion window and back off the timer (RFC 5681 3.1,
+ * RFC 6298 5.5).
+ *
+ * @param conn Connection
+ */
+void tcp_cc_rto_expired(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	++conn->stats.rto_expired;
+
+	/* Do not lower ssthresh further when the same data times out again */
+	if (!cc->in_rto_recovery)
+		cc->ssthresh = tcp_cc_loss_ssthresh(conn);
+
+	cc->cwnd = cc->smss;
+	cc->bytes_acked = 0;
+	cc->dupacks = 0;
+	cc->in_recovery = false;
+	cc->in_rto_recovery = true;
+	cc->recover = conn->snd_nxt;
+
+	cc->rto = min(2 * cc->rto, TCP_RTO_MAX);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Retransmission timeout, "
+	    "ssthresh=%" PRIu32 " RTO=%lld", conn->name, cc->ssthresh,
+	    (long long) cc->rto);
+}
+
+/**
+ * @}
+ */
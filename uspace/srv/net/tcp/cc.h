@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/** @file Congestion control and RTT estimation
+ */
+
+#ifndef CC_H
+#define CC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "tcp_type.h"
+
+/** Default sender maximum segment size */
+#define TCP_DEFAULT_SMSS	1460
+/** Maximum segment size to assume if the peer did not send the MSS option */
+#define TCP_NOOPT_SMSS		536
+
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define TCP_DUPACK_THRESH	3
+
+/** Initial retransmission timeout (RFC 6298 2.1) */
+#define TCP_RTO_INIT	(1000 * 1000)
+/** Lower bound for retransmission timeout (RFC 6298 2.4) */
+#define TCP_RTO_MIN	(1000 * 1000)
+/** Upper bound for retransmission timeout (RFC 6298 2.5) */
+#define TCP_RTO_MAX	(60 * 1000 * 1000)
+
+extern void tcp_cc_init(tcp_conn_t *);
+extern void tcp_cc_set_smss(tcp_conn_t *, uint32_t);
+extern uint32_t tcp_cc_ts_now(void);
+extern uint32_t tcp_cc_send_wnd(tcp_conn_t *);
+extern void tcp_cc_rtt_sample(tcp_conn_t *, usec_t);
+extern bool tcp_cc_new_ack(tcp_conn_t *, uint32_t);
+extern bool tcp_cc_dup_ack(tcp_conn_t *);
+extern void tcp_cc_rto_expired(tcp_conn_t *);
+
+#endif
+
+/** @}
+ */
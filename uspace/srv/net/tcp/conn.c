@@ -42,19 +42,22 @@
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
+#include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+#define RCV_BUF_SIZE (128 * 1024)
+#define SND_BUF_SIZE (64 * 1024)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
@@ -65,8 +68,8 @@ static LIST_INITIALIZE(conn_list);
 static FIBRIL_MUTEX_INITIALIZE(conn_list_lock);
 /** Connection association map */
 static amap_t *amap;
-/** Taken after tcp_conn_t lock */
-static FIBRIL_MUTEX_INITIALIZE(amap_lock);
+/** Taken after tcp_conn_t lock, lookups only take it for reading */
+static FIBRIL_RWLOCK_INITIALIZE(amap_lock);
 
 /** Internal loopback configuration */
 tcp_lb_t tcp_conn_lb = tcp_lb_none;
@@ -105,6 +108,21 @@ void tcp_conns_fini(void)
 	amap = NULL;
 }
 
+/** Compute window scale shift count needed to advertise window.
+ *
+ * @param wnd	Window size
+ * @return	Smallest shift count such that @a wnd can be advertised
+ */
+static uint8_t tcp_conn_wscale_calc(size_t wnd)
+{
+	uint8_t shift = 0;
+
+	while ((wnd >> shift) > UINT16_MAX && shift < TCP_WSCALE_MAX)
+		++shift;
+
+	return shift;
+}
+
 /** Create new connection structure.
  *
  * @param epp		Endpoint pair (will be deeply copied)
@@ -151,6 +169,10 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
+	conn->rcv_wscale = tcp_conn_wscale_calc(conn->rcv_buf_size);
+
+	/* Initialize congestion control */
+	tcp_cc_init(conn);
 
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
@@ -310,20 +332,20 @@ errno_t tcp_conn_add(tcp_conn_t *conn)
 	errno_t rc;
 
 	tcp_conn_addref(conn);
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_write_lock(&amap_lock);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_add: conn=%p", conn);
 
 	rc = amap_insert(amap, &conn->ident, conn, af_allow_system, &aepp);
 	if (rc != EOK) {
 		tcp_conn_delref(conn);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_write_unlock(&amap_lock);
 		return rc;
 	}
 
 	conn->ident = aepp;
 	conn->mapped = true;
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_write_unlock(&amap_lock);
 
 	return EOK;
 }
@@ -337,10 +359,10 @@ static void tcp_conn_remove(tcp_conn_t *conn)
 	if (!conn->mapped)
 		return;
 
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_write_lock(&amap_lock);
 	amap_remove(amap, &conn->ident);
 	conn->mapped = false;
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_write_unlock(&amap_lock);
 	tcp_conn_delref(conn);
 }
 
@@ -432,19 +454,19 @@ tcp_conn_t *tcp_conn_find_ref(inet_ep2_t *epp)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_find_ref(%p)", epp);
 
-	fibril_mutex_lock(&amap_lock);
+	fibril_rwlock_read_lock(&amap_lock);
 
 	rc = amap_find_match(amap, epp, &arg);
 	if (rc != EOK) {
 		assert(rc == ENOENT);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_read_unlock(&amap_lock);
 		return NULL;
 	}
 
 	conn = (tcp_conn_t *)arg;
 	tcp_conn_addref(conn);
 
-	fibril_mutex_unlock(&amap_lock);
+	fibril_rwlock_read_unlock(&amap_lock);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_find_ref: got conn=%p",
 	    conn);
 	return conn;
@@ -511,6 +533,43 @@ bool tcp_conn_got_syn(tcp_conn_t *conn)
 	assert(false);
 }
 
+/** Process options of received SYN segment.
+ *
+ * Determine which options will be used on the connection. We offer all
+ * options we support, so an option is used iff the peer sent it.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+
+	if ((opts->present & TCP_SOPT_MSS) != 0 && opts->mss > 0)
+		tcp_cc_set_smss(conn, min(opts->mss, TCP_DEFAULT_SMSS));
+	else
+		tcp_cc_set_smss(conn, TCP_NOOPT_SMSS);
+
+	conn->ws_ok = (opts->present & TCP_SOPT_WS) != 0;
+	if (conn->ws_ok) {
+		conn->snd_wscale = min(opts->ws, TCP_WSCALE_MAX);
+		conn->rcv_wscale = tcp_conn_wscale_calc(conn->rcv_buf_size);
+	} else {
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	conn->sack_ok = (opts->present & TCP_SOPT_SACK_PERM) != 0;
+
+	conn->ts_ok = (opts->present & TCP_SOPT_TS) != 0;
+	if (conn->ts_ok)
+		conn->ts_recent = opts->ts_val;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: SMSS=%" PRIu32 " WS=%d(%u/%u) "
+	    "SACK=%d TS=%d", conn->name, conn->cc.smss, conn->ws_ok,
+	    conn->snd_wscale, conn->rcv_wscale, conn->sack_ok, conn->ts_ok);
+}
+
 /** Segment arrived in Listen state.
  *
  * @param conn		Connection
@@ -546,6 +605,8 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	if (seg->len > 1)
 		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
 
+	tcp_conn_syn_opts(conn, seg);
+
 	/* XXX select ISS */
 	conn->iss = 1;
 	conn->snd_nxt = conn->iss;
@@ -627,6 +688,8 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Sent SYN, got SYN.");
 
+	tcp_conn_syn_opts(conn, seg);
+
 	/*
 	 * Surprisingly the spec does not deal with initial window setting.
 	 * Set SND.WND = SEG.WND and set SND.WL1 so that next segment
@@ -663,8 +726,22 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
 
+	bool has_ts;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
+	has_ts = conn->ts_ok && (seg->opts.present & TCP_SOPT_TS) != 0;
+
+	/* Protection against wrapped sequence numbers (RFC 7323 5.3) */
+	if (has_ts && (seg->ctrl & CTL_RST) == 0 &&
+	    ((seg->opts.ts_val - conn->ts_recent) & (0x1 << 31)) != 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to segment with "
+		    "old timestamp.");
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_segment_delete(seg);
+		return;
+	}
+
 	/* Discard unacceptable segments ("old duplicates") */
 	if (!seq_no_segment_acceptable(conn, seg)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to unacceptable segment.");
@@ -673,6 +750,14 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/* Update TS.Recent if SEG.SEQ <= Last.ACK.sent (RFC 7323 4.3) */
+	if (has_ts && ((conn->last_ack_sent - seg->seq) & (0x1 << 31)) == 0)
+		conn->ts_recent = seg->opts.ts_val;
+
+	/* Window in SYN segments is never scaled (RFC 7323 2.2) */
+	if ((seg->ctrl & CTL_SYN) == 0)
+		seg->wnd <<= conn->snd_wscale;
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -684,6 +769,13 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	/*
+	 * Acknowledge out-of-order segments immediately (RFC 5681 4.2)
+	 * so that the peer can detect the loss and learn what we hold.
+	 */
+	if (!list_empty(&conn->incoming.list) && conn->cstate != st_closed)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -802,6 +894,22 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
 	return cp_continue;
 }
 
+/** Determine if segment is a duplicate ACK.
+ *
+ * Per RFC 5681 an ACK is considered a duplicate if it acknowledges
+ * SND.UNA, carries no data, SYN or FIN, does not update the window
+ * and there is outstanding data.
+ *
+ * @param conn		Connection
+ * @param seg		Segment
+ * @return		@c true iff @a seg is a duplicate ACK
+ */
+static bool tcp_conn_ack_is_dup(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	return seg->ack == conn->snd_una && seg->len == 0 &&
+	    seg->wnd == conn->snd_wnd && conn->snd_nxt != conn->snd_una;
+}
+
 /** Process segment ACK field in Established state.
  *
  * @param conn		Connection
@@ -811,6 +919,12 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	uint32_t acked = 0;
+	bool new_ack = false;
+	bool dup_ack = false;
+	bool rexmit = false;
+	uint32_t rtt;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_seg_proc_ack_est(%p, %p)", conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SEG.ACK=%u, SND.UNA=%u, SND.NXT=%u",
@@ -826,14 +940,44 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 			tcp_segment_delete(seg);
 			return cp_done;
+		} else if (tcp_conn_ack_is_dup(conn, seg)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate ACK.");
+			dup_ack = true;
 		} else {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring old ACK.");
 		}
 	} else {
 		/* Update SND.UNA */
+		acked = seg->ack - conn->snd_una;
 		conn->snd_una = seg->ack;
+		new_ack = true;
+	}
+
+	/* Note which segments the peer holds */
+	if (conn->sack_ok && (seg->opts.present & TCP_SOPT_SACK) != 0)
+		tcp_tqueue_sack_received(conn, seg);
+
+	if (new_ack) {
+		/* RTT measurement using echoed timestamp (RFC 7323 4.1) */
+		if (conn->ts_ok && (seg->opts.present & TCP_SOPT_TS) != 0 &&
+		    seg->opts.ts_ecr != 0) {
+			rtt = tcp_cc_ts_now() - seg->opts.ts_ecr;
+			tcp_cc_rtt_sample(conn, (usec_t) rtt * 1000);
+		}
+
+		rexmit = tcp_cc_new_ack(conn, acked);
+	} else if (dup_ack) {
+		rexmit = tcp_cc_dup_ack(conn);
+
+		/* Use SACK information to repair further holes */
+		if (!rexmit && conn->cc.in_recovery && conn->sack_ok)
+			(void) tcp_tqueue_retransmit_hole(conn);
 	}
 
+	/* Fast retransmit or NewReno partial ACK */
+	if (rexmit)
+		(void) tcp_tqueue_retransmit(conn);
+
 	if (seq_no_new_wnd_update(conn, seg)) {
 		conn->snd_wnd = seg->wnd;
 		conn->snd_wl1 = seg->seq;
@@ -1254,7 +1398,7 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 		oldepp = conn->ident;
 
 		/* Need to remove and re-insert connection with new identity */
-		fibril_mutex_lock(&amap_lock);
+		fibril_rwlock_write_lock(&amap_lock);
 
 		if (inet_addr_is_any(&conn->ident.remote.addr))
 			conn->ident.remote.addr = epp->remote.addr;
@@ -1270,13 +1414,13 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 			assert(rc != EEXIST);
 			assert(rc == ENOMEM);
 			log_msg(LOG_DEFAULT, LVL_ERROR, "Out of memory.");
-			fibril_mutex_unlock(&amap_lock);
+			fibril_rwlock_write_unlock(&amap_lock);
 			tcp_conn_unlock(conn);
 			return;
 		}
 
 		amap_remove(amap, &oldepp);
-		fibril_mutex_unlock(&amap_lock);
+		fibril_rwlock_write_unlock(&amap_lock);
 
 		conn->name = (char *) "a";
 	}
@@ -1411,16 +1555,14 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 
 	if (tcp_conn_lb == tcp_lb_segment) {
 		/* Loop back segment */
-#if 0
-		tcp_ncsim_bounce_seg(sp, seg);
-#endif
-
-		/* Reverse the identification */
-		tcp_ep2_flipped(epp, &rident);
-
-		/* Insert segment back into rqueue */
 		dseg = tcp_segment_dup(seg);
-		tcp_rqueue_insert_seg(&rident, dseg);
+		if (dseg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. Segment dropped.");
+			return;
+		}
+
+		/* Insert segment back into rqueue via network simulator */
+		tcp_ncsim_bounce_seg(epp, dseg);
 		return;
 	}
 
@@ -54,6 +54,7 @@ void tcp_iqueue_init(tcp_iqueue_t *iqueue, tcp_conn_t *conn)
 {
 	list_initialize(&iqueue->list);
 	iqueue->conn = conn;
+	iqueue->last_seq = 0;
 }
 
 /** Insert segment into incoming queue.
@@ -75,6 +76,7 @@ void tcp_iqueue_insert_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 	}
 
 	iqe->seg = seg;
+	iqueue->last_seq = seg->seq;
 
 	/* Sort by sequence number */
 
@@ -186,6 +188,88 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	return EOK;
 }
 
+/** Add SACK block to the list of blocks to report.
+ *
+ * The block containing the most recently received segment is always
+ * reported first (RFC 2018 section 4).
+ */
+static void tcp_iqueue_sack_add(tcp_iqueue_t *iqueue, uint32_t start,
+    uint32_t end, tcp_sack_block_t *blocks, size_t max, size_t *cnt)
+{
+	uint32_t rcv_nxt = iqueue->conn->rcv_nxt;
+	size_t i;
+
+	if (iqueue->last_seq - rcv_nxt >= start - rcv_nxt &&
+	    iqueue->last_seq - rcv_nxt < end - rcv_nxt) {
+		/* Make room at the beginning */
+		if (*cnt == max)
+			--*cnt;
+		for (i = *cnt; i > 0; i--)
+			blocks[i] = blocks[i - 1];
+		blocks[0].start = start;
+		blocks[0].end = end;
+		++*cnt;
+		return;
+	}
+
+	if (*cnt < max) {
+		blocks[*cnt].start = start;
+		blocks[*cnt].end = end;
+		++*cnt;
+	}
+}
+
+/** Get SACK blocks describing out-of-order data held in incoming queue.
+ *
+ * Adjacent and overlapping segments are merged into a single block.
+ *
+ * @param iqueue	Incoming queue
+ * @param blocks	Array to fill in
+ * @param max		Maximum number of blocks to return
+ * @return		Number of blocks stored in @a blocks
+ */
+size_t tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, tcp_sack_block_t *blocks,
+    size_t max)
+{
+	uint32_t rcv_nxt = iqueue->conn->rcv_nxt;
+	uint32_t start = 0, end = 0;
+	uint32_t seg_start, seg_end;
+	bool have = false;
+	size_t cnt = 0;
+
+	if (max == 0)
+		return 0;
+
+	list_foreach(iqueue->list, link, tcp_iqueue_entry_t, iqe) {
+		seg_start = iqe->seg->seq;
+		seg_end = iqe->seg->seq + iqe->seg->len;
+
+		/* Only data beyond RCV.NXT is reported */
+		if (iqe->seg->len == 0 || seg_start == rcv_nxt ||
+		    ((seg_start - rcv_nxt) & (0x1 << 31)) != 0)
+			continue;
+
+		if (have && seg_start - rcv_nxt <= end - rcv_nxt) {
+			/* Extend current block */
+			if (seg_end - rcv_nxt > end - rcv_nxt)
+				end = seg_end;
+			continue;
+		}
+
+		if (have)
+			tcp_iqueue_sack_add(iqueue, start, end, blocks, max, &cnt);
+
+		start = seg_start;
+		end = seg_end;
+		have = true;
+	}
+
+	if (have)
+		tcp_iqueue_sack_add(iqueue, start, end, blocks, max, &cnt);
+
+	return cnt;
+}
+
 /**
  * @}
  */
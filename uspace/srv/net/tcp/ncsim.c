@@ -33,9 +33,12 @@
 /**
  * @file Network condition simulator
  *
- * Simulate network conditions for testing the reliability implementation:
+ * Simulate network conditions for testing the reliability implementation
+ * and benchmarking congestion control:
  *    - variable latency
  *    - frame drop
+ *
+ * The simulator is used when segment loopback is enabled.
  */
 
 #include <adt/list.h>
@@ -45,15 +48,18 @@
 #include <io/log.h>
 #include <stdlib.h>
 #include <fibril.h>
+#include <fibril_synch.h>
+#include <time.h>
 #include "conn.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "tcp_type.h"
 
-static list_t sim_queue;
-static fibril_mutex_t sim_queue_lock;
-static fibril_condvar_t sim_queue_cv;
+static LIST_INITIALIZE(sim_queue);
+static FIBRIL_MUTEX_INITIALIZE(sim_queue_lock);
+static FIBRIL_CONDVAR_INITIALIZE(sim_queue_cv);
+static tcp_ncsim_params_t sim_params;
 
 /** Initialize segment receive queue. */
 void tcp_ncsim_init(void)
@@ -63,6 +69,20 @@ void tcp_ncsim_init(void)
 	fibril_condvar_initialize(&sim_queue_cv);
 }
 
+/** Set simulated network conditions.
+ *
+ * With all parameters zero (the default) segments are passed through
+ * immediately.
+ *
+ * @param params Network condition parameters
+ */
+void tcp_ncsim_set_params(tcp_ncsim_params_t *params)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_params = *params;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
 /** Bounce segment through simulator into receive queue.
  *
  * @param epp	Endpoint pair, oriented for transmission
@@ -72,48 +92,58 @@ void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	tcp_squeue_entry_t *sqe;
 	tcp_squeue_entry_t *old_qe;
+	tcp_ncsim_params_t params;
 	inet_ep2_t rident;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_bounce_seg()");
-	tcp_ep2_flipped(epp, &rident);
-	tcp_rqueue_insert_seg(&rident, seg);
-	return;
 
-	if (0 /* rand() % 4 == 3 */) {
+	fibril_mutex_lock(&sim_queue_lock);
+	params = sim_params;
+	fibril_mutex_unlock(&sim_queue_lock);
+
+	if (params.loss_pct > 0 && (unsigned) rand() % 100 < params.loss_pct) {
 		/* Drop segment */
-		log_msg(LOG_DEFAULT, LVL_ERROR, "NCSim dropping segment");
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim dropping segment");
 		tcp_segment_delete(seg);
 		return;
 	}
 
+	if (params.delay == 0 && params.jitter == 0) {
+		tcp_ep2_flipped(epp, &rident);
+		tcp_rqueue_insert_seg(&rident, seg);
+		return;
+	}
+
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating SQE.");
 		return;
 	}
 
-	sqe->delay = rand() % (1000 * 1000);
+	usec_t delay = params.delay;
+	if (params.jitter > 0)
+		delay += rand() % params.jitter;
+
+	getuptime(&sqe->deadline);
+	ts_add_diff(&sqe->deadline, USEC2NSEC(delay));
 	sqe->epp = *epp;
 	sqe->seg = seg;
 
 	fibril_mutex_lock(&sim_queue_lock);
 
+	/* Keep the queue sorted by deadline, FIFO among equal deadlines */
 	link = list_first(&sim_queue);
-	while (link != NULL && sqe->delay > 0) {
+	while (link != NULL) {
 		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+		if (!ts_gteq(&sqe->deadline, &old_qe->deadline))
 			break;
 
-		sqe->delay -= old_qe->delay;
-
-		link = link->next;
-		if (link == &sim_queue.head)
-			link = NULL;
+		link = list_next(link, &sim_queue);
 	}
 
 	if (link != NULL)
-		list_insert_after(&sqe->link, link);
+		list_insert_before(&sqe->link, link);
 	else
 		list_append(&sqe->link, &sim_queue);
 
@@ -124,29 +154,44 @@ void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 /** Network condition simulator handler fibril. */
 static errno_t tcp_ncsim_fibril(void *arg)
 {
-	link_t *link;
 	tcp_squeue_entry_t *sqe;
 	inet_ep2_t rident;
-	errno_t rc;
+	struct timespec now;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_fibril()");
 
 	while (true) {
 		fibril_mutex_lock(&sim_queue_lock);
 
-		while (list_empty(&sim_queue))
-			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
-
-		do {
-			link = list_first(&sim_queue);
-			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		while (true) {
+			if (list_empty(&sim_queue)) {
+				fibril_condvar_wait(&sim_queue_cv,
+				    &sim_queue_lock);
+				continue;
+			}
+
+			sqe = list_get_instance(list_first(&sim_queue),
+			    tcp_squeue_entry_t, link);
+
+			getuptime(&now);
+			if (ts_gteq(&now, &sqe->deadline))
+				break;
+
+			/*
+			 * Wait only for the rest of the delay. A new segment
+			 * may have become the head in the meantime.
+			 */
+			usec_t remaining = NSEC2USEC(ts_sub_diff(&sqe->deadline,
+			    &now));
+			if (remaining == 0)
+				remaining = 1;
 
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Sleep");
-			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
-			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+			(void) fibril_condvar_wait_timeout(&sim_queue_cv,
+			    &sim_queue_lock, remaining);
+		}
 
-		list_remove(link);
+		list_remove(&sqe->link);
 		fibril_mutex_unlock(&sim_queue_lock);
 
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - End Sleep");
@@ -38,6 +38,7 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <inet/endpoint.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "pdu.h"
@@ -125,7 +126,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t opts_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +137,8 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = ((sizeof(tcp_header_t) + opts_size) / sizeof(uint32_t)) <<
+	    DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -181,6 +184,210 @@ static ip_ver_t tcp_phdr_setup(tcp_pdu_t *pdu, tcp_phdr_t *phdr,
 	return src_ver;
 }
 
+/** Determine number of SACK blocks that fit in the options.
+ *
+ * @param opts Segment options
+ * @return Number of SACK blocks to encode
+ */
+static size_t tcp_opts_sack_cnt(tcp_seg_opts_t *opts)
+{
+	size_t avail;
+
+	if ((opts->present & TCP_SOPT_SACK) == 0)
+		return 0;
+
+	/* Space left after the other options, including alignment */
+	avail = TCP_OPTS_MAX_SIZE - 2 - OPT_SACK_LEN;
+	if ((opts->present & TCP_SOPT_TS) != 0)
+		avail -= 2 + OPT_TIMESTAMP_LEN;
+
+	return min(opts->sack_cnt, avail / OPT_SACK_BLOCK_LEN);
+}
+
+/** Compute size of encoded options.
+ *
+ * Each option is preceded by NOPs so that it ends on a 32-bit boundary.
+ *
+ * @param opts Segment options
+ * @return Size of encoded options in bytes (multiple of four)
+ */
+static size_t tcp_opts_size(tcp_seg_opts_t *opts)
+{
+	size_t size = 0;
+	size_t sack_cnt;
+
+	if ((opts->present & TCP_SOPT_MSS) != 0)
+		size += OPT_MAX_SEG_SIZE_LEN;
+	if ((opts->present & TCP_SOPT_WS) != 0)
+		size += 1 + OPT_WINDOW_SCALE_LEN;
+	if ((opts->present & TCP_SOPT_SACK_PERM) != 0)
+		size += 2 + OPT_SACK_PERMITTED_LEN;
+	if ((opts->present & TCP_SOPT_TS) != 0)
+		size += 2 + OPT_TIMESTAMP_LEN;
+
+	sack_cnt = tcp_opts_sack_cnt(opts);
+	if (sack_cnt > 0)
+		size += 2 + OPT_SACK_LEN + sack_cnt * OPT_SACK_BLOCK_LEN;
+
+	assert(size <= TCP_OPTS_MAX_SIZE);
+	return size;
+}
+
+/** Store 32-bit value in network byte order at unaligned position */
+static void tcp_opts_put32(uint8_t *p, uint32_t val)
+{
+	p[0] = val >> 24;
+	p[1] = (val >> 16) & 0xff;
+	p[2] = (val >> 8) & 0xff;
+	p[3] = val & 0xff;
+}
+
+/** Load 32-bit value in network byte order from unaligned position */
+static uint32_t tcp_opts_get32(uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	    ((uint32_t)p[2] << 8) | p[3];
+}
+
+/** Encode segment options.
+ *
+ * @param opts Segment options
+ * @param buf Buffer of size at least tcp_opts_size(@a opts)
+ */
+static void tcp_opts_encode(tcp_seg_opts_t *opts, uint8_t *buf)
+{
+	uint8_t *p = buf;
+	size_t sack_cnt;
+	size_t i;
+
+	if ((opts->present & TCP_SOPT_MSS) != 0) {
+		*p++ = OPT_MAX_SEG_SIZE;
+		*p++ = OPT_MAX_SEG_SIZE_LEN;
+		*p++ = opts->mss >> 8;
+		*p++ = opts->mss & 0xff;
+	}
+
+	if ((opts->present & TCP_SOPT_WS) != 0) {
+		*p++ = OPT_NOP;
+		*p++ = OPT_WINDOW_SCALE;
+		*p++ = OPT_WINDOW_SCALE_LEN;
+		*p++ = opts->ws;
+	}
+
+	if ((opts->present & TCP_SOPT_SACK_PERM) != 0) {
+		*p++ = OPT_NOP;
+		*p++ = OPT_NOP;
+		*p++ = OPT_SACK_PERMITTED;
+		*p++ = OPT_SACK_PERMITTED_LEN;
+	}
+
+	if ((opts->present & TCP_SOPT_TS) != 0) {
+		*p++ = OPT_NOP;
+		*p++ = OPT_NOP;
+		*p++ = OPT_TIMESTAMP;
+		*p++ = OPT_TIMESTAMP_LEN;
+		tcp_opts_put32(p, opts->ts_val);
+		tcp_opts_put32(p + 4, opts->ts_ecr);
+		p += 8;
+	}
+
+	sack_cnt = tcp_opts_sack_cnt(opts);
+	if (sack_cnt > 0) {
+		*p++ = OPT_NOP;
+		*p++ = OPT_NOP;
+		*p++ = OPT_SACK;
+		*p++ = OPT_SACK_LEN + sack_cnt * OPT_SACK_BLOCK_LEN;
+		for (i = 0; i < sack_cnt; i++) {
+			tcp_opts_put32(p, opts->sack[i].start);
+			tcp_opts_put32(p + 4, opts->sack[i].end);
+			p += OPT_SACK_BLOCK_LEN;
+		}
+	}
+
+	assert((size_t)(p - buf) == tcp_opts_size(opts));
+}
+
+/** Decode segment options.
+ *
+ * Unknown options and options with unexpected length are skipped.
+ * A malformed option list terminates parsing, options decoded so far
+ * are kept.
+ *
+ * @param buf Encoded options
+ * @param size Size of encoded options in bytes
+ * @param opts Place to store decoded options
+ */
+static void tcp_opts_decode(uint8_t *buf, size_t size, tcp_seg_opts_t *opts)
+{
+	size_t pos;
+	uint8_t kind;
+	uint8_t len;
+	size_t i;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	pos = 0;
+	while (pos < size) {
+		kind = buf[pos];
+		if (kind == OPT_END_LIST)
+			break;
+		if (kind == OPT_NOP) {
+			++pos;
+			continue;
+		}
+
+		if (size - pos < 2)
+			break;
+		len = buf[pos + 1];
+		if (len < 2 || len > size - pos)
+			break;
+
+		switch (kind) {
+		case OPT_MAX_SEG_SIZE:
+			if (len != OPT_MAX_SEG_SIZE_LEN)
+				break;
+			opts->present |= TCP_SOPT_MSS;
+			opts->mss = ((uint16_t)buf[pos + 2] << 8) | buf[pos + 3];
+			break;
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			opts->present |= TCP_SOPT_WS;
+			opts->ws = buf[pos + 2];
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			opts->present |= TCP_SOPT_SACK_PERM;
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			opts->present |= TCP_SOPT_TS;
+			opts->ts_val = tcp_opts_get32(&buf[pos + 2]);
+			opts->ts_ecr = tcp_opts_get32(&buf[pos + 6]);
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % OPT_SACK_BLOCK_LEN != 0)
+				break;
+			opts->present |= TCP_SOPT_SACK;
+			opts->sack_cnt = min((size_t)(len - OPT_SACK_LEN) /
+			    OPT_SACK_BLOCK_LEN, TCP_SACK_BLOCKS_MAX);
+			for (i = 0; i < opts->sack_cnt; i++) {
+				opts->sack[i].start = tcp_opts_get32(&buf[pos +
+				    OPT_SACK_LEN + i * OPT_SACK_BLOCK_LEN]);
+				opts->sack[i].end = tcp_opts_get32(&buf[pos +
+				    OPT_SACK_LEN + i * OPT_SACK_BLOCK_LEN + 4]);
+			}
+			break;
+		default:
+			break;
+		}
+
+		pos += len;
+	}
+}
+
 static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 {
 	tcp_header_decode_flags(uint16_t_be2host(hdr->doff_flags), &seg->ctrl);
@@ -194,14 +401,18 @@ static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	size_t opts_size;
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	opts_size = tcp_opts_size(&seg->opts);
+
+	hdr = calloc(1, sizeof(tcp_header_t) + opts_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, opts_size);
+	tcp_opts_encode(&seg->opts, (uint8_t *)hdr + sizeof(tcp_header_t));
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = sizeof(tcp_header_t) + opts_size;
 
 	return EOK;
 }
@@ -306,6 +517,10 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 	tcp_header_decode(pdu->header, nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
+	assert(pdu->header_size >= sizeof(tcp_header_t));
+	tcp_opts_decode((uint8_t *)pdu->header + sizeof(tcp_header_t),
+	    pdu->header_size - sizeof(tcp_header_t), &nseg->opts);
+
 	hdr = (tcp_header_t *)pdu->header;
 
 	epp->local.port = uint16_t_be2host(hdr->dest_port);
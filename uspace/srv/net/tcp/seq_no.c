@@ -143,8 +143,17 @@ bool seq_no_segment_ready(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 bool seq_no_segment_acked(tcp_conn_t *conn, tcp_segment_t *seg, uint32_t ack)
 {
+	uint32_t diff;
+
 	assert(seg->len > 0);
-	return seq_no_lt_le(seg->seq, seg->seq + seg->len, ack);
+
+	/*
+	 * SEG.SEQ + SEG.LEN <= ACK. Segments that lie entirely after
+	 * ACK must not be considered acked, so we cannot use the interval
+	 * test (SEG.SEQ, ACK] which would wrap around in that case.
+	 */
+	diff = ack - (seg->seq + seg->len);
+	return (diff & (0x1 << 31)) == 0;
 }
 
 /** Determine whether initial SYN is acked.
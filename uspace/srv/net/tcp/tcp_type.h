@@ -45,6 +45,7 @@
 #include <stdint.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
+#include <time.h>
 
 struct tcp_conn;
 
@@ -124,6 +125,8 @@ typedef enum {
 typedef struct {
 	struct tcp_conn *conn;
 	list_t list;
+	/** Sequence number of the most recently inserted segment */
+	uint32_t last_seq;
 } tcp_iqueue_t;
 
 /** Active or passive connection */
@@ -148,12 +151,87 @@ typedef struct {
 	void (*recv_data)(tcp_conn_t *, void *);
 } tcp_cb_t;
 
+/** Per-connection transmission statistics */
+typedef struct {
+	/** Number of segments transmitted (including retransmissions) */
+	uint64_t segs_sent;
+	/** Number of data octets transmitted for the first time */
+	uint64_t bytes_sent;
+	/** Number of data octets acknowledged by the peer */
+	uint64_t bytes_acked;
+	/** Number of segments retransmitted */
+	uint64_t segs_retrans;
+	/** Number of fast retransmissions (triggered by duplicate ACKs) */
+	uint64_t fast_retrans;
+	/** Number of retransmission timer expirations */
+	uint64_t rto_expired;
+	/** Number of duplicate ACKs received */
+	uint64_t dup_acks;
+	/** Number of RTT samples taken */
+	uint64_t rtt_samples;
+} tcp_conn_stats_t;
+
 /** Data returned by Status user call */
 typedef struct {
 	/** Connection state */
 	tcp_cstate_t cstate;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Smoothed round-trip time in microseconds */
+	usec_t srtt;
+	/** Round-trip time variation in microseconds */
+	usec_t rttvar;
+	/** Retransmission timeout in microseconds */
+	usec_t rto;
+	/** Transmission statistics */
+	tcp_conn_stats_t stats;
 } tcp_conn_status_t;
 
+/** Maximum number of SACK blocks in a segment */
+#define TCP_SACK_BLOCKS_MAX 4
+
+/** Segment options present */
+typedef enum {
+	/** Maximum segment size */
+	TCP_SOPT_MSS		= 0x1,
+	/** Window scale */
+	TCP_SOPT_WS		= 0x2,
+	/** SACK permitted */
+	TCP_SOPT_SACK_PERM	= 0x4,
+	/** SACK blocks */
+	TCP_SOPT_SACK		= 0x8,
+	/** Timestamps */
+	TCP_SOPT_TS		= 0x10
+} tcp_sopt_t;
+
+/** SACK block */
+typedef struct {
+	/** Sequence number of the first octet of the block */
+	uint32_t start;
+	/** Sequence number immediately following the block */
+	uint32_t end;
+} tcp_sack_block_t;
+
+/** Segment options */
+typedef struct {
+	/** Which options are present */
+	tcp_sopt_t present;
+	/** Maximum segment size */
+	uint16_t mss;
+	/** Window scale shift count */
+	uint8_t ws;
+	/** Timestamp value */
+	uint32_t ts_val;
+	/** Timestamp echo reply */
+	uint32_t ts_ecr;
+	/** Number of SACK blocks */
+	size_t sack_cnt;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
+} tcp_seg_opts_t;
+
 typedef struct {
 	/** SYN, FIN */
 	tcp_control_t ctrl;
@@ -168,6 +246,8 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Segment options */
+	tcp_seg_opts_t opts;
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
@@ -188,10 +268,21 @@ typedef struct {
 	void (*seg_received)(inet_ep2_t *, tcp_segment_t *);
 } tcp_rqueue_cb_t;
 
+/** Network conditions simulated by NCSim */
+typedef struct {
+	/** Probability of dropping a segment in percent */
+	unsigned loss_pct;
+	/** Fixed one-way delay */
+	usec_t delay;
+	/** Maximum random delay added to @c delay */
+	usec_t jitter;
+} tcp_ncsim_params_t;
+
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
-	usec_t delay;
+	/** Uptime at which the segment is delivered */
+	struct timespec deadline;
 	inet_ep2_t epp;
 	tcp_segment_t *seg;
 } tcp_squeue_entry_t;
@@ -207,6 +298,12 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Time when the segment was first transmitted */
+	struct timespec sent;
+	/** Segment has been retransmitted (Karn's algorithm) */
+	bool retransmitted;
+	/** Segment has been selectively acknowledged by the peer */
+	bool sacked;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -227,6 +324,37 @@ typedef struct {
 	tcp_tqueue_cb_t *cb;
 } tcp_tqueue_t;
 
+/** Congestion control state (RFC 5681, RFC 6582, RFC 6298) */
+typedef struct {
+	/** Sender maximum segment size */
+	uint32_t smss;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Octets acknowledged during congestion avoidance not yet
+	 * accounted for in @c cwnd
+	 */
+	uint32_t bytes_acked;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** Fast recovery is in progress */
+	bool in_recovery;
+	/** Loss recovery after retransmission timeout is in progress */
+	bool in_rto_recovery;
+	/** Highest sequence number sent when loss recovery started */
+	uint32_t recover;
+
+	/** We have a valid RTT measurement */
+	bool rtt_valid;
+	/** Smoothed round-trip time */
+	usec_t srtt;
+	/** Round-trip time variation */
+	usec_t rttvar;
+	/** Retransmission timeout */
+	usec_t rto;
+} tcp_cc_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -308,6 +436,11 @@ struct tcp_conn {
 	/** Initial send sequence number */
 	uint32_t iss;
 
+	/** Congestion control state */
+	tcp_cc_t cc;
+	/** Transmission statistics */
+	tcp_conn_stats_t stats;
+
 	/** Receive next */
 	uint32_t rcv_nxt;
 	/** Receive window */
@@ -316,6 +449,21 @@ struct tcp_conn {
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Window scaling is in use */
+	bool ws_ok;
+	/** Shift count applied to the peer's window advertisements */
+	uint8_t snd_wscale;
+	/** Shift count applied to our window advertisements */
+	uint8_t rcv_wscale;
+	/** SACK is in use */
+	bool sack_ok;
+	/** Timestamps are in use */
+	bool ts_ok;
+	/** Most recent timestamp to echo (TS.Recent) */
+	uint32_t ts_recent;
+	/** Last acknowledgement number sent (Last.ACK.sent) */
+	uint32_t last_ack_sent;
 };
 
 /** Continuation of processing.
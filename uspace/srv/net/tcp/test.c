@@ -38,7 +38,12 @@
 #include <errno.h>
 #include <stdio.h>
 #include <fibril.h>
+#include <inttypes.h>
+#include <mem.h>
 #include <str.h>
+#include <time.h>
+#include "conn.h"
+#include "ncsim.h"
 #include "tcp_type.h"
 #include "ucall.h"
 
@@ -46,6 +51,11 @@
 
 #define RCV_BUF_SIZE 64
 
+/** Amount of data transferred by the bulk transfer benchmark */
+#define BULK_SIZE (1024 * 1024)
+/** Bulk transfer benchmark block size */
+#define BULK_BLOCK_SIZE 1024
+
 static errno_t test_srv(void *arg)
 {
 	tcp_conn_t *conn;
@@ -122,10 +132,104 @@ static errno_t test_cli(void *arg)
 	return 0;
 }
 
+static errno_t test_bulk_srv(void *arg)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	char rcv_buf[BULK_BLOCK_SIZE];
+	size_t rcvd;
+	size_t total;
+	xflags_t xflags;
+
+	inet_ep2_init(&epp);
+
+	inet_addr(&epp.local.addr, 127, 0, 0, 1);
+	epp.local.port = 81;
+
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = 1025;
+
+	tcp_uc_open(&epp, ap_passive, 0, &conn);
+	conn->name = (char *) "BS";
+
+	total = 0;
+	while (true) {
+		tcp_uc_receive(conn, rcv_buf, BULK_BLOCK_SIZE, &rcvd, &xflags);
+		if (rcvd == 0)
+			break;
+		total += rcvd;
+	}
+
+	printf("BS: Received %zu bytes.\n", total);
+	tcp_uc_close(conn);
+	return 0;
+}
+
+/** Bulk transfer benchmark.
+ *
+ * Transfers data over segment loopback through the network condition
+ * simulator and reports the achieved throughput and congestion control
+ * statistics.
+ */
+static errno_t test_bulk_cli(void *arg)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	tcp_conn_status_t cstatus;
+	char buf[BULK_BLOCK_SIZE];
+	struct timespec start, end;
+	usec_t usec;
+	size_t sent;
+
+	inet_ep2_init(&epp);
+
+	inet_addr(&epp.local.addr, 127, 0, 0, 1);
+	epp.local.port = 1025;
+
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = 81;
+
+	memset(buf, 'x', sizeof(buf));
+
+	fibril_usleep(1000 * 1000);
+	tcp_uc_open(&epp, ap_active, 0, &conn);
+	conn->name = (char *) "BC";
+
+	getuptime(&start);
+
+	sent = 0;
+	while (sent < BULK_SIZE) {
+		if (tcp_uc_send(conn, buf, sizeof(buf), 0) != TCP_EOK)
+			break;
+		sent += sizeof(buf);
+	}
+
+	getuptime(&end);
+	usec = NSEC2USEC(ts_sub_diff(&end, &start));
+
+	tcp_uc_status(conn, &cstatus);
+
+	printf("BC: Sent %zu bytes in %lld us (%lld kB/s).\n", sent,
+	    (long long) usec, usec > 0 ? (long long) sent * 1000 / usec : 0);
+	printf("BC: cwnd=%" PRIu32 " ssthresh=%" PRIu32 " srtt=%lld "
+	    "rttvar=%lld rto=%lld\n", cstatus.cwnd, cstatus.ssthresh,
+	    (long long) cstatus.srtt, (long long) cstatus.rttvar,
+	    (long long) cstatus.rto);
+	printf("BC: segs_sent=%" PRIu64 " segs_retrans=%" PRIu64
+	    " fast_retrans=%" PRIu64 " rto_expired=%" PRIu64
+	    " dup_acks=%" PRIu64 "\n", cstatus.stats.segs_sent,
+	    cstatus.stats.segs_retrans, cstatus.stats.fast_retrans,
+	    cstatus.stats.rto_expired, cstatus.stats.dup_acks);
+
+	tcp_uc_close(conn);
+	return 0;
+}
+
 void tcp_test(void)
 {
 	fid_t srv_fid;
 	fid_t cli_fid;
+	tcp_ncsim_params_t params;
 
 	printf("tcp_test()\n");
 
@@ -150,6 +254,32 @@ void tcp_test(void)
 
 		fibril_add_ready(cli_fid);
 	}
+
+	if (0) {
+		/* Bulk transfer over a lossy link */
+		tcp_conn_lb = tcp_lb_segment;
+
+		params.loss_pct = 2;
+		params.delay = 10 * 1000;
+		params.jitter = 1000;
+		tcp_ncsim_set_params(&params);
+
+		srv_fid = fibril_create(test_bulk_srv, NULL);
+		if (srv_fid == 0) {
+			printf("Failed to create server fibril.\n");
+			return;
+		}
+
+		fibril_add_ready(srv_fid);
+
+		cli_fid = fibril_create(test_bulk_cli, NULL);
+		if (cli_fid == 0) {
+			printf("Failed to create client fibril.\n");
+			return;
+		}
+
+		fibril_add_ready(cli_fid);
+	}
 }
 
 /**
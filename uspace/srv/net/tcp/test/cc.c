@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+#include "../cc.h"
+#include "../conn.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+static tcp_conn_t *cc_conn;
+
+PCUT_TEST_BEFORE
+{
+	inet_ep2_t epp;
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = tcp_conns_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	inet_ep2_init(&epp);
+	cc_conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(cc_conn);
+
+	cc_conn->cstate = st_established;
+	cc_conn->snd_una = 1000;
+	cc_conn->snd_nxt = 1000;
+	cc_conn->snd_wnd = 65535;
+}
+
+PCUT_TEST_AFTER
+{
+	tcp_conn_lock(cc_conn);
+	tcp_conn_reset(cc_conn);
+	tcp_conn_unlock(cc_conn);
+	tcp_conn_delete(cc_conn);
+
+	tcp_conns_fini();
+}
+
+/** Test initial congestion control state */
+PCUT_TEST(init)
+{
+	PCUT_ASSERT_INT_EQUALS(TCP_DEFAULT_SMSS, cc_conn->cc.smss);
+	PCUT_ASSERT_INT_EQUALS(3 * TCP_DEFAULT_SMSS, cc_conn->cc.cwnd);
+	PCUT_ASSERT_TRUE(cc_conn->cc.ssthresh == UINT32_MAX);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == TCP_RTO_INIT);
+	PCUT_ASSERT_FALSE(cc_conn->cc.rtt_valid);
+
+	/* Send window is limited by the congestion window */
+	PCUT_ASSERT_INT_EQUALS(3 * TCP_DEFAULT_SMSS, tcp_cc_send_wnd(cc_conn));
+
+	/* ... and by the peer's receive window */
+	cc_conn->snd_wnd = 100;
+	PCUT_ASSERT_INT_EQUALS(100, tcp_cc_send_wnd(cc_conn));
+}
+
+/** Test RTT estimation and RTO computation */
+PCUT_TEST(rtt_sample)
+{
+	/* First measurement */
+	tcp_cc_rtt_sample(cc_conn, 800 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rtt_valid);
+	PCUT_ASSERT_TRUE(cc_conn->cc.srtt == 800 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rttvar == 400 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == 2400 * 1000);
+
+	/* Subsequent measurement */
+	tcp_cc_rtt_sample(cc_conn, 400 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.srtt == 750 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rttvar == 400 * 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == 2350 * 1000);
+
+	/* RTO is bounded from below */
+	cc_conn->cc.rtt_valid = false;
+	tcp_cc_rtt_sample(cc_conn, 1000);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == TCP_RTO_MIN);
+}
+
+/** Test slow start and congestion avoidance */
+PCUT_TEST(new_ack)
+{
+	uint32_t cwnd;
+	bool rexmit;
+
+	/* Slow start: cwnd grows by at most SMSS per ACK */
+	cwnd = cc_conn->cc.cwnd;
+	cc_conn->snd_una += 2 * TCP_DEFAULT_SMSS;
+	rexmit = tcp_cc_new_ack(cc_conn, 2 * TCP_DEFAULT_SMSS);
+	PCUT_ASSERT_FALSE(rexmit);
+	PCUT_ASSERT_INT_EQUALS(cwnd + TCP_DEFAULT_SMSS, cc_conn->cc.cwnd);
+
+	/* Congestion avoidance: cwnd grows by SMSS per cwnd acked */
+	cc_conn->cc.ssthresh = cc_conn->cc.cwnd;
+	cwnd = cc_conn->cc.cwnd;
+	rexmit = tcp_cc_new_ack(cc_conn, cwnd - 1);
+	PCUT_ASSERT_FALSE(rexmit);
+	PCUT_ASSERT_INT_EQUALS(cwnd, cc_conn->cc.cwnd);
+	rexmit = tcp_cc_new_ack(cc_conn, 1);
+	PCUT_ASSERT_FALSE(rexmit);
+	PCUT_ASSERT_INT_EQUALS(cwnd + TCP_DEFAULT_SMSS, cc_conn->cc.cwnd);
+}
+
+/** Test fast retransmit and NewReno fast recovery */
+PCUT_TEST(fast_recovery)
+{
+	uint32_t smss = TCP_DEFAULT_SMSS;
+
+	/* Ten segments in flight */
+	cc_conn->snd_nxt = cc_conn->snd_una + 10 * smss;
+
+	PCUT_ASSERT_FALSE(tcp_cc_dup_ack(cc_conn));
+	PCUT_ASSERT_FALSE(tcp_cc_dup_ack(cc_conn));
+	PCUT_ASSERT_TRUE(tcp_cc_dup_ack(cc_conn));
+
+	PCUT_ASSERT_TRUE(cc_conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(5 * smss, cc_conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(8 * smss, cc_conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(1, cc_conn->stats.fast_retrans);
+
+	/* Further duplicate ACKs inflate the window */
+	PCUT_ASSERT_FALSE(tcp_cc_dup_ack(cc_conn));
+	PCUT_ASSERT_INT_EQUALS(9 * smss, cc_conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(4, cc_conn->stats.dup_acks);
+
+	/* Partial ACK triggers retransmission of next segment */
+	cc_conn->snd_una += 2 * smss;
+	PCUT_ASSERT_TRUE(tcp_cc_new_ack(cc_conn, 2 * smss));
+	PCUT_ASSERT_TRUE(cc_conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(8 * smss, cc_conn->cc.cwnd);
+
+	/* Full ACK ends recovery */
+	cc_conn->snd_una = cc_conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_new_ack(cc_conn, 8 * smss));
+	PCUT_ASSERT_FALSE(cc_conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * smss, cc_conn->cc.cwnd);
+}
+
+/** Test retransmission timeout */
+PCUT_TEST(rto_expired)
+{
+	uint32_t smss = TCP_DEFAULT_SMSS;
+	int i;
+
+	cc_conn->snd_nxt = cc_conn->snd_una + 4 * smss;
+
+	tcp_cc_rto_expired(cc_conn);
+	PCUT_ASSERT_INT_EQUALS(smss, cc_conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(2 * smss, cc_conn->cc.ssthresh);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == 2 * TCP_RTO_INIT);
+	PCUT_ASSERT_TRUE(cc_conn->cc.in_rto_recovery);
+
+	/* Duplicate ACKs do not trigger fast retransmit after timeout */
+	for (i = 0; i < TCP_DUPACK_THRESH; i++)
+		PCUT_ASSERT_FALSE(tcp_cc_dup_ack(cc_conn));
+
+	/* Back-off is bounded */
+	for (i = 0; i < 10; i++)
+		tcp_cc_rto_expired(cc_conn);
+	PCUT_ASSERT_TRUE(cc_conn->cc.rto == TCP_RTO_MAX);
+	PCUT_ASSERT_INT_EQUALS(11, cc_conn->stats.rto_expired);
+
+	/* ACKs below the recovery point keep retransmitting */
+	cc_conn->snd_una += smss;
+	PCUT_ASSERT_TRUE(tcp_cc_new_ack(cc_conn, smss));
+	cc_conn->snd_una = cc_conn->snd_nxt;
+	PCUT_ASSERT_FALSE(tcp_cc_new_ack(cc_conn, 3 * smss));
+	PCUT_ASSERT_FALSE(cc_conn->cc.in_rto_recovery);
+}
+
+PCUT_EXPORT(cc);
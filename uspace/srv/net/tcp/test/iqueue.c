@@ -175,4 +175,66 @@ PCUT_TEST(two_segments)
 	tcp_conn_delete(conn);
 }
 
+/** Test generating SACK blocks from out-of-order segments */
+PCUT_TEST(sack_blocks)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	inet_ep2_t epp;
+	tcp_segment_t *seg[4];
+	tcp_sack_block_t blocks[TCP_SACK_BLOCKS_MAX];
+	uint8_t data[10] = { 0 };
+	size_t cnt;
+	int i;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 10;
+	conn->rcv_wnd = 100;
+
+	for (i = 0; i < 4; i++) {
+		seg[i] = tcp_segment_make_data(0, data, i == 1 ? 5 : 10);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+	}
+
+	seg[0]->seq = 20;
+	seg[1]->seq = 30;
+	seg[2]->seq = 50;
+	seg[3]->seq = 70;
+
+	tcp_iqueue_init(&iqueue, conn);
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(0, cnt);
+
+	tcp_iqueue_insert_seg(&iqueue, seg[0]);
+	tcp_iqueue_insert_seg(&iqueue, seg[2]);
+	tcp_iqueue_insert_seg(&iqueue, seg[1]);
+
+	/* Adjacent segments are merged, most recent block comes first */
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(2, cnt);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(35, blocks[0].end);
+	PCUT_ASSERT_INT_EQUALS(50, blocks[1].start);
+	PCUT_ASSERT_INT_EQUALS(60, blocks[1].end);
+
+	tcp_iqueue_insert_seg(&iqueue, seg[3]);
+
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, 2);
+	PCUT_ASSERT_INT_EQUALS(2, cnt);
+	PCUT_ASSERT_INT_EQUALS(70, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(80, blocks[0].end);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[1].start);
+	PCUT_ASSERT_INT_EQUALS(35, blocks[1].end);
+
+	for (i = 0; i < 4; i++) {
+		tcp_iqueue_remove_seg(&iqueue, seg[i]);
+		tcp_segment_delete(seg[i]);
+	}
+
+	tcp_conn_delete(conn);
+}
+
 PCUT_EXPORT(iqueue);
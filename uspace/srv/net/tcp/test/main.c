@@ -33,6 +33,30 @@
 #include "../segment.h"
 #include "../tcp_type.h"
 
+/** Verify that two sets of segment options are the same */
+static void test_seg_opts_same(tcp_seg_opts_t *a, tcp_seg_opts_t *b)
+{
+	size_t i;
+
+	PCUT_ASSERT_INT_EQUALS(a->present, b->present);
+	if ((a->present & TCP_SOPT_MSS) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->mss, b->mss);
+	if ((a->present & TCP_SOPT_WS) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->ws, b->ws);
+	if ((a->present & TCP_SOPT_TS) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->ts_val, b->ts_val);
+		PCUT_ASSERT_INT_EQUALS(a->ts_ecr, b->ts_ecr);
+	}
+	if ((a->present & TCP_SOPT_SACK) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->sack_cnt, b->sack_cnt);
+		for (i = 0; i < a->sack_cnt; i++) {
+			PCUT_ASSERT_INT_EQUALS(a->sack[i].start,
+			    b->sack[i].start);
+			PCUT_ASSERT_INT_EQUALS(a->sack[i].end, b->sack[i].end);
+		}
+	}
+}
+
 /** Verify that two segments have the same content */
 void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 {
@@ -42,6 +66,7 @@ void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 	PCUT_ASSERT_INT_EQUALS(a->len, b->len);
 	PCUT_ASSERT_INT_EQUALS(a->wnd, b->wnd);
 	PCUT_ASSERT_INT_EQUALS(a->up, b->up);
+	test_seg_opts_same(&a->opts, &b->opts);
 	PCUT_ASSERT_INT_EQUALS(tcp_segment_text_size(a),
 	    tcp_segment_text_size(b));
 	if (tcp_segment_text_size(a) != 0)
@@ -56,6 +81,7 @@ void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 
 PCUT_INIT;
 
+PCUT_IMPORT(cc);
 PCUT_IMPORT(conn);
 PCUT_IMPORT(iqueue);
 PCUT_IMPORT(pdu);
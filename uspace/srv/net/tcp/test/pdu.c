@@ -35,6 +35,7 @@
 #include "main.h"
 #include "../pdu.h"
 #include "../segment.h"
+#include "../std.h"
 
 PCUT_INIT;
 
@@ -108,4 +109,94 @@ PCUT_TEST(encdec_data)
 	free(data);
 }
 
+/** Test encode/decode round trip for SYN options */
+PCUT_TEST(encdec_syn_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_SYN);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->wnd = 18;
+	seg->opts.present = TCP_SOPT_MSS | TCP_SOPT_WS | TCP_SOPT_SACK_PERM |
+	    TCP_SOPT_TS;
+	seg->opts.mss = 1460;
+	seg->opts.ws = 7;
+	seg->opts.ts_val = 0x12345678;
+	seg->opts.ts_ecr = 0;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(tcp_header_t) + 24, pdu->header_size);
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
+/** Test encode/decode round trip for SACK blocks with timestamps */
+PCUT_TEST(encdec_sack_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	size_t i;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 100;
+	seg->wnd = 18;
+	seg->opts.present = TCP_SOPT_TS | TCP_SOPT_SACK;
+	seg->opts.ts_val = 1;
+	seg->opts.ts_ecr = 2;
+	seg->opts.sack_cnt = 3;
+	for (i = 0; i < 3; i++) {
+		seg->opts.sack[i].start = 200 + 100 * i;
+		seg->opts.sack[i].end = 250 + 100 * i;
+	}
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(tcp_header_t) + 40, pdu->header_size);
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+
+	/* A fourth block does not fit together with timestamps */
+	seg->opts.sack_cnt = 4;
+	seg->opts.sack[3].start = 600;
+	seg->opts.sack[3].end = 650;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(3, dseg->opts.sack_cnt);
+
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
 PCUT_EXPORT(pdu);
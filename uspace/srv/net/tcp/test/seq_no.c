@@ -214,6 +214,9 @@ PCUT_TEST(segment_acked)
 	PCUT_ASSERT_FALSE(seq_no_segment_acked(conn, seg, 24));
 	PCUT_ASSERT_TRUE(seq_no_segment_acked(conn, seg, 25));
 
+	/* Segment following ACK is not acked */
+	PCUT_ASSERT_FALSE(seq_no_segment_acked(conn, seg, 5));
+
 	tcp_segment_delete(seg);
 	tcp_conn_delete(conn);
 	free(data);
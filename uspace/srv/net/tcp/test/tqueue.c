@@ -203,6 +203,55 @@ PCUT_TEST(new_data_small_win)
 	tcp_segment_delete(trans_seg[0]);
 }
 
+/** Test that data is split into segments limited by SMSS and cwnd */
+PCUT_TEST(new_data_cwnd)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	uint32_t smss;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	smss = conn->cc.smss;
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = conn->snd_buf_size;
+	conn->cc.cwnd = 2 * smss + 100;
+	conn->snd_buf_used = conn->snd_buf_size;
+	conn->snd_buf_fin = false;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+
+	PCUT_ASSERT_INT_EQUALS(10 + 2 * smss + 100, conn->snd_nxt);
+	PCUT_ASSERT_INT_EQUALS(conn->snd_buf_size - 2 * smss - 100,
+	    conn->snd_buf_used);
+
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[0]->seq);
+	PCUT_ASSERT_INT_EQUALS(smss, trans_seg[0]->len);
+	PCUT_ASSERT_INT_EQUALS(10 + smss, trans_seg[1]->seq);
+	PCUT_ASSERT_INT_EQUALS(smss, trans_seg[1]->len);
+	PCUT_ASSERT_INT_EQUALS(10 + 2 * smss, trans_seg[2]->seq);
+	PCUT_ASSERT_INT_EQUALS(100, trans_seg[2]->len);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
 /** Test flushing tqueue due to receiving an ACK */
 PCUT_TEST(ack_received)
 {
@@ -257,6 +306,74 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test retransmission using SACK information */
+PCUT_TEST(sack_retransmit)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	tcp_segment_t *ack;
+	uint32_t smss;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	smss = conn->cc.smss;
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = conn->snd_buf_size;
+	conn->cc.cwnd = 4 * smss;
+	conn->snd_buf_used = 4 * smss;
+	conn->snd_buf_fin = false;
+	conn->sack_ok = true;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(4, seg_cnt);
+
+	/* Peer has received the second and fourth segment */
+	ack = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(ack);
+	ack->ack = 10;
+	ack->opts.present = TCP_SOPT_SACK;
+	ack->opts.sack_cnt = 2;
+	ack->opts.sack[0].start = 10 + 3 * smss;
+	ack->opts.sack[0].end = 10 + 4 * smss;
+	ack->opts.sack[1].start = 10 + smss;
+	ack->opts.sack[1].end = 10 + 2 * smss;
+	tcp_tqueue_sack_received(conn, ack);
+	tcp_segment_delete(ack);
+
+	/* First hole */
+	PCUT_ASSERT_ERRNO_VAL(EOK, tcp_tqueue_retransmit(conn));
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[4]->seq);
+
+	/* The first segment is acked, the third one is the next hole */
+	conn->snd_una = 10 + smss;
+	PCUT_ASSERT_ERRNO_VAL(EOK, tcp_tqueue_retransmit_hole(conn));
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10 + 2 * smss, trans_seg[5]->seq);
+
+	/* No more holes to fill */
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, tcp_tqueue_retransmit_hole(conn));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	trans_seg[seg_cnt++] = tcp_segment_dup(seg);
@@ -42,9 +42,12 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "iqueue.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
@@ -52,8 +55,6 @@
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
-
 static void retransmit_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
@@ -146,6 +147,11 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		tqe->conn = conn;
 		tqe->seg = rt_seg;
 		rt_seg->seq = conn->snd_nxt;
+		getuptime(&tqe->sent);
+		tqe->retransmitted = false;
+		tqe->sacked = false;
+
+		conn->stats.bytes_sent += tcp_segment_text_size(seg);
 
 		list_append(&tqe->link, &conn->retransmit.list);
 
@@ -173,11 +179,16 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 }
 
 /** Transmit data from the send buffer.
+ *
+ * Data is sent in segments of at most SMSS octets, as far as permitted
+ * by the send window and the congestion window.
  *
  * @param conn	Connection
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
 {
+	uint32_t flight_size;
+	uint32_t snd_wnd;
 	size_t avail_wnd;
 	size_t xfer_seqlen;
 	size_t snd_buf_seqlen;
@@ -189,52 +200,63 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
-	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
+	while (true) {
+		/* Number of free sequence numbers in send window */
+		flight_size = conn->snd_nxt - conn->snd_una;
+		snd_wnd = tcp_cc_send_wnd(conn);
+		avail_wnd = snd_wnd > flight_size ? snd_wnd - flight_size : 0;
+		snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
-	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
-	    xfer_seqlen);
+		xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, "
+		    "SND.WND = %" PRIu32 ", cwnd = %" PRIu32 ", "
+		    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen,
+		    conn->snd_wnd, conn->cc.cwnd, xfer_seqlen);
 
-	if (xfer_seqlen == 0)
-		return;
+		if (xfer_seqlen == 0)
+			return;
 
-	/* XXX Do not always send immediately */
+		/* XXX Do not always send immediately */
 
-	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
-	data_size = xfer_seqlen - (send_fin ? 1 : 0);
+		send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
+		data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+		if (data_size > conn->cc.smss) {
+			data_size = conn->cc.smss;
+			send_fin = false;
+		}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
-	}
+		if (send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.",
+			    conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+		seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			return;
+		}
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+		/* Remove data from send buffer */
+		memmove(conn->snd_buf, conn->snd_buf + data_size,
+		    conn->snd_buf_used - data_size);
+		conn->snd_buf_used -= data_size;
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+		if (send_fin)
+			conn->snd_buf_fin = false;
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+		if (send_fin)
+			tcp_conn_fin_sent(conn);
+
+		tcp_tqueue_seg(conn, seg);
+		tcp_segment_delete(seg);
+	}
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -245,6 +267,9 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	struct timespec now;
+	struct timespec sent;
+	bool have_sample = false;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
@@ -270,6 +295,15 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			/*
+			 * Only segments that were not retransmitted give
+			 * an unambiguous RTT measurement (Karn's algorithm).
+			 */
+			if (!tqe->retransmitted) {
+				sent = tqe->sent;
+				have_sample = true;
+			}
+
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
 
@@ -280,6 +314,12 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 		cur = next;
 	}
 
+	/* With timestamps RTT is measured using the echoed values */
+	if (have_sample && !conn->ts_ok) {
+		getuptime(&now);
+		tcp_cc_rtt_sample(conn, NSEC2USEC(ts_sub_diff(&now, &sent)));
+	}
+
 	/* Clear retransmission timer if the queue is empty. */
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
@@ -288,18 +328,193 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	tcp_tqueue_new_data(conn);
 }
 
+/** Retransmit segment from retransmission queue.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ * @return	EOK on success, ENOMEM if out of memory
+ */
+static errno_t tcp_tqueue_retransmit_tqe(tcp_conn_t *conn,
+    tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		return ENOMEM;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
+	tqe->retransmitted = true;
+	++conn->stats.segs_retrans;
+
+	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+	return EOK;
+}
+
+/** Retransmit the first unacknowledged segment.
+ *
+ * Segments that the peer has selectively acknowledged are skipped.
+ *
+ * @param conn	Connection
+ * @return	EOK on success, ENOENT if there is nothing to retransmit,
+ *		ENOMEM if out of memory
+ */
+errno_t tcp_tqueue_retransmit(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	/* Skip segments that are acknowledged but not pruned yet */
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (!tqe->sacked &&
+		    !seq_no_segment_acked(conn, tqe->seg, conn->snd_una))
+			return tcp_tqueue_retransmit_tqe(conn, tqe);
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "Nothing to retransmit");
+	return ENOENT;
+}
+
+/** Retransmit next hole indicated by SACK information.
+ *
+ * A segment is considered lost if it has not been acknowledged, but some
+ * later segment has been selectively acknowledged. Retransmit the first
+ * such segment which has not been retransmitted yet.
+ *
+ * @param conn	Connection
+ * @return	EOK on success, ENOENT if there is nothing to retransmit,
+ *		ENOMEM if out of memory
+ */
+errno_t tcp_tqueue_retransmit_hole(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *hole = NULL;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tqe->sacked) {
+			if (hole != NULL)
+				return tcp_tqueue_retransmit_tqe(conn, hole);
+			continue;
+		}
+
+		if (hole == NULL && !tqe->retransmitted &&
+		    !seq_no_segment_acked(conn, tqe->seg, conn->snd_una))
+			hole = tqe;
+	}
+
+	return ENOENT;
+}
+
+/** Process SACK blocks received from the peer.
+ *
+ * Mark segments in the retransmission queue that are fully covered by
+ * a SACK block so that they are not retransmitted.
+ *
+ * @param conn	Connection
+ * @param seg	Received segment
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	uint32_t flight_size = conn->snd_nxt - conn->snd_una;
+	uint32_t bstart, bend;
+	uint32_t sstart, send;
+	size_t i;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	for (i = 0; i < seg->opts.sack_cnt; i++) {
+		/* Offsets relative to SND.UNA */
+		bstart = seg->opts.sack[i].start - conn->snd_una;
+		bend = seg->opts.sack[i].end - conn->snd_una;
+
+		/* Ignore invalid blocks and blocks below SND.UNA */
+		if (bstart >= bend || bend > flight_size)
+			continue;
+
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    tqe) {
+			sstart = tqe->seg->seq - conn->snd_una;
+			send = sstart + tqe->seg->len;
+			if (sstart >= bstart && send <= bend && sstart < send)
+				tqe->sacked = true;
+		}
+	}
+}
+
+/** Fill in options of outgoing segment.
+ *
+ * In a SYN segment we offer all options we support, in a SYN-ACK
+ * we only acknowledge those the peer has offered. Later segments carry
+ * only the options that have been agreed upon.
+ *
+ * @param conn Connection
+ * @param seg Segment
+ */
+static void tcp_tqueue_seg_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+	bool syn = (seg->ctrl & CTL_SYN) != 0;
+	bool ack = (seg->ctrl & CTL_ACK) != 0;
+	bool offer = syn && !ack;
+	size_t sack_max;
+
+	opts->present = 0;
+	opts->sack_cnt = 0;
+
+	if (syn) {
+		opts->present |= TCP_SOPT_MSS;
+		opts->mss = TCP_DEFAULT_SMSS;
+
+		if (offer || conn->ws_ok) {
+			opts->present |= TCP_SOPT_WS;
+			opts->ws = conn->rcv_wscale;
+		}
+
+		if (offer || conn->sack_ok)
+			opts->present |= TCP_SOPT_SACK_PERM;
+	}
+
+	if (offer || conn->ts_ok) {
+		opts->present |= TCP_SOPT_TS;
+		opts->ts_val = tcp_cc_ts_now();
+		opts->ts_ecr = ack ? conn->ts_recent : 0;
+	}
+
+	if (!syn && ack && conn->sack_ok) {
+		/* With timestamps there is only room for three blocks */
+		sack_max = conn->ts_ok ? TCP_SACK_BLOCKS_MAX - 1 :
+		    TCP_SACK_BLOCKS_MAX;
+		opts->sack_cnt = tcp_iqueue_sack_blocks(&conn->incoming,
+		    opts->sack, sack_max);
+		if (opts->sack_cnt > 0)
+			opts->present |= TCP_SOPT_SACK;
+	}
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	/* Window in SYN segments is never scaled (RFC 7323 2.2) */
+	if ((seg->ctrl & CTL_SYN) != 0)
+		seg->wnd = min(conn->rcv_wnd, UINT16_MAX);
+	else
+		seg->wnd = min(conn->rcv_wnd >> conn->rcv_wscale, UINT16_MAX);
+
+	++conn->stats.segs_sent;
 
-	if ((seg->ctrl & CTL_ACK) != 0)
+	if ((seg->ctrl & CTL_ACK) != 0) {
 		seg->ack = conn->rcv_nxt;
-	else
+		conn->last_ack_sent = seg->ack;
+	} else {
 		seg->ack = 0;
+	}
 
+	tcp_tqueue_seg_opts(conn, seg);
 	tcp_tqueue_send_immed(conn, seg);
 }
 
@@ -320,8 +535,6 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
-	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -343,22 +556,24 @@ static void retransmit_timeout_func(void *arg)
 		return;
 	}
 
-	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	tcp_cc_rto_expired(conn);
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+	/*
+	 * The receiver may have discarded data it has selectively
+	 * acknowledged, forget SACK information (RFC 2018 section 8).
+	 */
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe)
+		tqe->sacked = false;
+
+	if (tcp_tqueue_retransmit(conn) == ENOMEM) {
 		tcp_conn_unlock(conn);
 		tcp_conn_delref(conn);
 		/* XXX Handle properly */
 		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
-
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->cc.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -377,7 +592,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->cc.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
@@ -290,6 +290,12 @@ void tcp_uc_status(tcp_conn_t *conn, tcp_conn_status_t *cstatus)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_status()");
 	cstatus->cstate = conn->cstate;
+	cstatus->cwnd = conn->cc.cwnd;
+	cstatus->ssthresh = conn->cc.ssthresh;
+	cstatus->srtt = conn->cc.srtt;
+	cstatus->rttvar = conn->cc.rttvar;
+	cstatus->rto = conn->cc.rto;
+	cstatus->stats = conn->stats;
 }
 
 /** Delete connection user call.
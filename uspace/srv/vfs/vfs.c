@@ -99,6 +99,14 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 
+	/*
+	 * Initialize the dentry cache.
+	 */
+	if (!vfs_dcache_init()) {
+		printf("%s: Failed to initialize dentry cache\n", NAME);
+		return ENOMEM;
+	}
+
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
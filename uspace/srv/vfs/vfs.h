@@ -118,6 +118,9 @@ typedef struct _vfs_node {
 
 	aoff64_t size;		/**< Cached size if the node is a file. */
 
+	/** The size changed since the node was looked up. */
+	bool size_changed;
+
 	/**
 	 * Holding this rwlock prevents modifications of the node's contents.
 	 */
@@ -182,6 +185,25 @@ extern errno_t vfs_get_fstypes(vfs_fstypes_t *);
 extern errno_t vfs_lookup_internal(vfs_node_t *, char *, int, vfs_lookup_res_t *);
 extern errno_t vfs_link_internal(vfs_node_t *, char *, vfs_triplet_t *);
 
+/** Result of a dentry cache lookup. */
+typedef enum {
+	VFS_DCACHE_MISS,
+	VFS_DCACHE_POSITIVE,
+	VFS_DCACHE_NEGATIVE
+} vfs_dcache_result_t;
+
+extern bool vfs_dcache_init(void);
+extern bool vfs_dcache_enabled(fs_handle_t);
+extern size_t vfs_dcache_generation(void);
+extern vfs_dcache_result_t vfs_dcache_lookup(vfs_triplet_t *, const char *,
+    vfs_lookup_res_t *);
+extern void vfs_dcache_insert(vfs_triplet_t *, const char *,
+    vfs_lookup_res_t *, size_t);
+extern void vfs_dcache_remove(vfs_triplet_t *, const char *);
+extern void vfs_dcache_purge_dir(vfs_triplet_t *);
+extern void vfs_dcache_purge_fs(fs_handle_t, service_id_t);
+extern void vfs_dcache_set_size(vfs_triplet_t *, aoff64_t);
+
 extern bool vfs_nodes_init(void);
 extern vfs_node_t *vfs_node_get(vfs_lookup_res_t *);
 extern vfs_node_t *vfs_node_peek(vfs_lookup_res_t *result);
@@ -207,6 +229,7 @@ extern void vfs_node_addref(vfs_node_t *);
 extern void vfs_node_delref(vfs_node_t *);
 extern errno_t vfs_open_node_remote(vfs_node_t *);
 
+extern errno_t vfs_op_cache_stats(int fd);
 extern errno_t vfs_op_clone(int oldfd, int newfd, bool desc, int *);
 extern errno_t vfs_op_fsprobe(const char *, service_id_t, vfs_fs_probe_info_t *);
 extern errno_t vfs_op_mount(int mpfd, unsigned servid, unsigned flags, unsigned instance, const char *opts, const char *fsname, int *outfd);
@@ -235,6 +258,7 @@ typedef struct {
 } rdwr_io_chunk_t;
 
 extern errno_t vfs_rdwr_internal(int, aoff64_t, bool, rdwr_io_chunk_t *);
+extern errno_t vfs_page_map_internal(int, aoff64_t, void **, void **);
 
 extern void vfs_connection(ipc_call_t *, void *);
 
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2026 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup vfs
+ * @{
+ */
+
+/**
+ * @file	vfs_dcache.c
+ * @brief	Cache of path name components resolved by file systems.
+ *
+ * Each entry maps a (parent directory triplet, component name) pair either
+ * to the node the component refers to, or records that the component does
+ * not exist (a negative entry). Only file systems which announce that all
+ * changes to their namespace go through VFS (vfs_info_t.dentry_cache) are
+ * cached.
+ *
+ * Invalidation happens on link, on lookups which create or unlink a name
+ * and on unmount. Since lookups run concurrently with name creation, any
+ * invalidation bumps a generation counter and entries resolved at the file
+ * system before the invalidation are not inserted.
+ */
+
+#include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <fibril_synch.h>
+#include <stdlib.h>
+#include <str.h>
+
+/** Maximum number of entries in the cache */
+#define DCACHE_MAX_ENTRIES	1024
+
+typedef struct {
+	ht_link_t link;		/**< Cache hash table link */
+	link_t lru_link;	/**< LRU list link */
+
+	/* Key */
+	vfs_triplet_t parent;
+	char *name;
+
+	/* Value */
+	bool negative;		/**< The name does not exist */
+	vfs_lookup_res_t res;	/**< Resolved node unless negative */
+} dcache_entry_t;
+
+typedef struct {
+	const vfs_triplet_t *parent;
+	const char *name;
+} dcache_key_t;
+
+static FIBRIL_MUTEX_INITIALIZE(dcache_mutex);
+static hash_table_t dcache;
+static LIST_INITIALIZE(dcache_lru);	/**< Least recently used first */
+static size_t dcache_count;
+static size_t dcache_generation;
+
+static size_t dcache_triplet_hash(const vfs_triplet_t *tri)
+{
+	size_t hash = hash_combine(tri->fs_handle, tri->index);
+	return hash_combine(hash, tri->service_id);
+}
+
+static size_t dcache_name_hash(const char *name)
+{
+	size_t hash = 0;
+
+	while (*name != '\0')
+		hash = hash * 31 + (uint8_t) *name++;
+
+	return hash_mix(hash);
+}
+
+static bool dcache_triplet_equal(const vfs_triplet_t *a,
+    const vfs_triplet_t *b)
+{
+	return a->fs_handle == b->fs_handle &&
+	    a->service_id == b->service_id && a->index == b->index;
+}
+
+static size_t dcache_key_hash(const void *key)
+{
+	const dcache_key_t *dkey = key;
+	return hash_combine(dcache_triplet_hash(dkey->parent),
+	    dcache_name_hash(dkey->name));
+}
+
+static size_t dcache_hash(const ht_link_t *item)
+{
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+	dcache_key_t key = {
+		.parent = &entry->parent,
+		.name = entry->name
+	};
+
+	return dcache_key_hash(&key);
+}
+
+static bool dcache_key_equal(const void *key, const ht_link_t *item)
+{
+	const dcache_key_t *dkey = key;
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+
+	return dcache_triplet_equal(dkey->parent, &entry->parent) &&
+	    str_cmp(dkey->name, entry->name) == 0;
+}
+
+static void dcache_remove_callback(ht_link_t *item)
+{
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+
+	list_remove(&entry->lru_link);
+	dcache_count--;
+
+	free(entry->name);
+	free(entry);
+}
+
+/** Dentry cache hash table operations. */
+static hash_table_ops_t dcache_ops = {
+	.hash = dcache_hash,
+	.key_hash = dcache_key_hash,
+	.key_equal = dcache_key_equal,
+	.equal = NULL,
+	.remove_callback = dcache_remove_callback
+};
+
+/** Initialize the dentry cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_dcache_init(void)
+{
+	return hash_table_create(&dcache, 0, 0, &dcache_ops);
+}
+
+/** Determine whether lookups in a file system can be cached.
+ *
+ * @param fs_handle	File system handle.
+ *
+ * @return		True if the file system opted in.
+ */
+bool vfs_dcache_enabled(fs_handle_t fs_handle)
+{
+	vfs_info_t *info = fs_handle_to_info(fs_handle);
+	return info != NULL && info->dentry_cache;
+}
+
+/** Get current dentry cache generation.
+ *
+ * The generation is to be obtained before asking the file system to resolve
+ * a name and passed to vfs_dcache_insert() afterwards.
+ *
+ * @return		Current generation.
+ */
+size_t vfs_dcache_generation(void)
+{
+	fibril_mutex_lock(&dcache_mutex);
+	size_t generation = dcache_generation;
+	fibril_mutex_unlock(&dcache_mutex);
+
+	return generation;
+}
+
+/** Look up a name in the dentry cache.
+ *
+ * @param parent	Directory containing the name.
+ * @param name		Name of the component.
+ * @param res		Place to store the resolved node on a positive hit.
+ *
+ * @return		VFS_DCACHE_MISS if there is no entry,
+ *			VFS_DCACHE_POSITIVE if the name was resolved to @a res,
+ *			VFS_DCACHE_NEGATIVE if the name is known not to exist.
+ */
+vfs_dcache_result_t vfs_dcache_lookup(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *res)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+	vfs_dcache_result_t result = VFS_DCACHE_MISS;
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	ht_link_t *item = hash_table_find(&dcache, &key);
+	if (item != NULL) {
+		dcache_entry_t *entry = hash_table_get_inst(item,
+		    dcache_entry_t, link);
+
+		/* Move to the most recently used end. */
+		list_remove(&entry->lru_link);
+		list_append(&entry->lru_link, &dcache_lru);
+
+		if (entry->negative) {
+			result = VFS_DCACHE_NEGATIVE;
+		} else {
+			*res = entry->res;
+			result = VFS_DCACHE_POSITIVE;
+		}
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+	return result;
+}
+
+/** Insert a name into the dentry cache.
+ *
+ * If the cache has been invalidated since @a generation was obtained, the
+ * entry might be stale already and it is not inserted. Failure to allocate
+ * the entry is not an error, the name simply stays uncached.
+ *
+ * @param parent	Directory containing the name.
+ * @param name		Name of the component.
+ * @param res		Resolved node or NULL for a negative entry.
+ * @param generation	Generation obtained before resolving the name.
+ */
+void vfs_dcache_insert(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *res, size_t generation)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	dcache_entry_t *entry = calloc(1, sizeof(dcache_entry_t));
+	if (entry == NULL)
+		return;
+
+	entry->name = str_dup(name);
+	if (entry->name == NULL) {
+		free(entry);
+		return;
+	}
+
+	entry->parent = *parent;
+	entry->negative = (res == NULL);
+	if (res != NULL)
+		entry->res = *res;
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	if ((generation != dcache_generation) ||
+	    (hash_table_find(&dcache, &key) != NULL)) {
+		fibril_mutex_unlock(&dcache_mutex);
+		free(entry->name);
+		free(entry);
+		return;
+	}
+
+	if (dcache_count == DCACHE_MAX_ENTRIES) {
+		dcache_entry_t *oldest = list_get_instance(
+		    list_first(&dcache_lru), dcache_entry_t, lru_link);
+		hash_table_remove_item(&dcache, &oldest->link);
+	}
+
+	hash_table_insert(&dcache, &entry->link);
+	list_append(&entry->lru_link, &dcache_lru);
+	dcache_count++;
+
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/** Remove a name from the dentry cache.
+ *
+ * @param parent	Directory containing the name.
+ * @param name		Name of the component.
+ */
+void vfs_dcache_remove(vfs_triplet_t *parent, const char *name)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_generation++;
+	hash_table_remove(&dcache, &key);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+typedef struct {
+	const vfs_triplet_t *tri;
+	fs_handle_t fs_handle;
+	service_id_t service_id;
+	aoff64_t size;
+} dcache_apply_arg_t;
+
+static bool dcache_purge_dir_visitor(ht_link_t *item, void *arg)
+{
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+	dcache_apply_arg_t *aarg = arg;
+
+	if (dcache_triplet_equal(&entry->parent, aarg->tri))
+		hash_table_remove_item(&dcache, item);
+
+	return true;
+}
+
+/** Remove all names contained in a directory from the dentry cache.
+ *
+ * @param dir		Directory which ceases to exist.
+ */
+void vfs_dcache_purge_dir(vfs_triplet_t *dir)
+{
+	dcache_apply_arg_t arg = {
+		.tri = dir
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_generation++;
+	hash_table_apply(&dcache, dcache_purge_dir_visitor, &arg);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+static bool dcache_purge_fs_visitor(ht_link_t *item, void *arg)
+{
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+	dcache_apply_arg_t *aarg = arg;
+
+	if ((entry->parent.fs_handle == aarg->fs_handle) &&
+	    (entry->parent.service_id == aarg->service_id))
+		hash_table_remove_item(&dcache, item);
+
+	return true;
+}
+
+/** Remove all names of a file system instance from the dentry cache.
+ *
+ * @param fs_handle	File system handle.
+ * @param service_id	Service ID of the file system instance.
+ */
+void vfs_dcache_purge_fs(fs_handle_t fs_handle, service_id_t service_id)
+{
+	dcache_apply_arg_t arg = {
+		.fs_handle = fs_handle,
+		.service_id = service_id
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_generation++;
+	hash_table_apply(&dcache, dcache_purge_fs_visitor, &arg);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+static bool dcache_set_size_visitor(ht_link_t *item, void *arg)
+{
+	dcache_entry_t *entry = hash_table_get_inst(item, dcache_entry_t, link);
+	dcache_apply_arg_t *aarg = arg;
+
+	if ((!entry->negative) &&
+	    (dcache_triplet_equal(&entry->res.triplet, aarg->tri)))
+		entry->res.size = aarg->size;
+
+	return true;
+}
+
+/** Update the size of a node recorded in the dentry cache.
+ *
+ * This is to be called when a VFS node whose size has changed is being
+ * released, so that a later lookup served from the cache does not bring
+ * the old size back to life.
+ *
+ * @param tri		Node whose size has changed.
+ * @param size		New size of the node.
+ */
+void vfs_dcache_set_size(vfs_triplet_t *tri, aoff64_t size)
+{
+	dcache_apply_arg_t arg = {
+		.tri = tri,
+		.size = size
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_generation++;
+	hash_table_apply(&dcache, dcache_set_size_visitor, &arg);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/**
+ * @}
+ */
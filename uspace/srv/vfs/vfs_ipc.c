@@ -34,6 +34,14 @@
 #include <str.h>
 #include <vfs/canonify.h>
 
+static void vfs_in_cache_stats(ipc_call_t *req)
+{
+	int fd = (int) ipc_get_arg1(req);
+
+	errno_t rc = vfs_op_cache_stats(fd);
+	async_answer_0(req, rc);
+}
+
 static void vfs_in_clone(ipc_call_t *req)
 {
 	int oldfd = ipc_get_arg1(req);
@@ -335,6 +343,9 @@ void vfs_connection(ipc_call_t *icall, void *arg)
 		}
 
 		switch (ipc_get_imethod(&call)) {
+		case VFS_IN_CACHE_STATS:
+			vfs_in_cache_stats(&call);
+			break;
 		case VFS_IN_CLONE:
 			vfs_in_clone(&call);
 			break;
@@ -202,6 +202,9 @@ errno_t vfs_link_internal(vfs_node_t *base, char *path, vfs_triplet_t *child)
 	if (orig_rc != EOK)
 		rc = orig_rc;
 
+	if ((rc == EOK) && vfs_dcache_enabled(triplet->fs_handle))
+		vfs_dcache_remove(triplet, component);
+
 out:
 	return rc;
 }
@@ -237,6 +240,97 @@ static errno_t out_lookup(vfs_triplet_t *base, size_t *pfirst, size_t *plen,
 	return EOK;
 }
 
+/** Extract a path component.
+ *
+ * @param path   Local copy of the path being resolved.
+ * @param first  PLB index at which @a path starts.
+ * @param next   PLB index of the slash preceding the component.
+ * @param nlen   Length of the rest of the path.
+ * @param name   Buffer of NAME_MAX + 1 bytes to store the component to.
+ * @param clen   Place to store the length of the component including
+ *               the preceding slash.
+ *
+ * @return True on success, false if the component is empty or too long.
+ */
+static bool path_component(char *path, size_t first, size_t next, size_t nlen,
+    char *name, size_t *clen)
+{
+	/* The PLB is a ring buffer, whose size is a power of two. */
+	char *comp = path + ((next - first) % PLB_SIZE);
+	size_t len = 1;
+
+	if (comp[0] != '/')
+		return false;
+
+	while ((len < nlen) && (comp[len] != '/'))
+		len++;
+
+	if ((len == 1) || (len - 1 > NAME_MAX))
+		return false;
+
+	memcpy(name, comp + 1, len - 1);
+	name[len - 1] = '\0';
+	*clen = len;
+	return true;
+}
+
+/** Resolve a single path component with the help of the dentry cache.
+ *
+ * @param base   Directory to resolve the component in.
+ * @param path   Local copy of the path being resolved.
+ * @param first  PLB index at which @a path starts.
+ * @param next   PLB index of the component, advanced past it on success.
+ * @param nlen   Length of the rest of the path, updated on success.
+ * @param result Place to store the resolved node.
+ *
+ * @return EOK on success, ENOENT if the component does not exist,
+ *         ENOTSUP if the component cannot be resolved this way or
+ *         an error code from errno.h.
+ */
+static errno_t lookup_component(vfs_triplet_t *base, char *path, size_t first,
+    size_t *next, size_t *nlen, vfs_lookup_res_t *result)
+{
+	char name[NAME_MAX + 1];
+	size_t clen;
+
+	if (!path_component(path, first, *next, *nlen, name, &clen))
+		return ENOTSUP;
+
+	switch (vfs_dcache_lookup(base, name, result)) {
+	case VFS_DCACHE_POSITIVE:
+		*next += clen;
+		*nlen -= clen;
+		return EOK;
+	case VFS_DCACHE_NEGATIVE:
+		return ENOENT;
+	case VFS_DCACHE_MISS:
+		break;
+	}
+
+	size_t generation = vfs_dcache_generation();
+	size_t cnext = *next;
+	size_t cnlen = clen;
+
+	errno_t rc = out_lookup(base, &cnext, &cnlen, L_NONE, result);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * If the component does not exist, the file system returns the
+	 * directory and points back at the component.
+	 */
+	if (cnext % PLB_SIZE == *next % PLB_SIZE) {
+		vfs_dcache_insert(base, name, NULL, generation);
+		return ENOENT;
+	}
+
+	vfs_dcache_insert(base, name, result, generation);
+
+	*next += clen;
+	*nlen -= clen;
+	return EOK;
+}
+
 static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
     vfs_lookup_res_t *result, size_t len)
 {
@@ -251,44 +345,106 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 	size_t next = first;
 	size_t nlen = len;
 
+	/*
+	 * Lookups which modify the namespace are never served from the
+	 * dentry cache.
+	 */
+	bool cacheable = !(lflag & (L_CREATE | L_UNLINK));
+
+	vfs_lookup_res_t cur = {
+		.triplet = *((vfs_triplet_t *) base),
+		.type = base->type,
+		.size = base->size
+	};
 	vfs_lookup_res_t res;
+	vfs_node_t *node;
 
 	/* Resolve path as long as there are mount points to cross. */
 	while (nlen > 0) {
-		while (base->mount) {
+		node = vfs_node_peek(&cur);
+		if (node != NULL && node->mount != NULL) {
 			if (lflag & L_DISABLE_MOUNTS) {
+				vfs_node_put(node);
 				rc = EXDEV;
 				goto out;
 			}
 
-			base = base->mount;
+			vfs_node_t *mnt = node->mount;
+			while (mnt->mount)
+				mnt = mnt->mount;
+
+			cur.triplet = *((vfs_triplet_t *) mnt);
+			cur.type = mnt->type;
+			cur.size = mnt->size;
 		}
+		if (node != NULL)
+			vfs_node_put(node);
+
+		bool dcache = vfs_dcache_enabled(cur.triplet.fs_handle);
 
-		rc = out_lookup((vfs_triplet_t *) base, &next, &nlen, lflag,
-		    &res);
+		if (cacheable && dcache) {
+			if (cur.type == VFS_NODE_FILE) {
+				rc = ENOTDIR;
+				goto out;
+			}
+
+			rc = lookup_component(&cur.triplet, path, first, &next,
+			    &nlen, &res);
+			if (rc == EOK) {
+				cur = res;
+				continue;
+			}
+
+			if (rc != ENOTSUP)
+				goto out;
+		}
+
+		/* Let the file system resolve as much as it can. */
+		char name[NAME_MAX + 1];
+		size_t clen;
+		bool named = path_component(path, first, next, nlen, name,
+		    &clen);
+
+		rc = out_lookup(&cur.triplet, &next, &nlen, lflag, &res);
 		if (rc != EOK)
 			goto out;
 
+		if (!cacheable && dcache && named) {
+			/* The name was created or unlinked. */
+			vfs_dcache_remove(&cur.triplet, name);
+			if ((lflag & L_UNLINK) && (res.type == VFS_NODE_DIRECTORY))
+				vfs_dcache_purge_dir(&res.triplet);
+		}
+
 		if (nlen > 0) {
-			base = vfs_node_peek(&res);
-			if (!base) {
+			node = vfs_node_peek(&res);
+			if (!node) {
 				rc = ENOENT;
 				goto out;
 			}
-			if (!base->mount) {
-				vfs_node_put(base);
+			if (!node->mount) {
+				vfs_node_put(node);
 				rc = ENOENT;
 				goto out;
 			}
-			vfs_node_put(base);
-			if (lflag & L_DISABLE_MOUNTS) {
-				rc = EXDEV;
-				goto out;
-			}
+			vfs_node_put(node);
 		}
+
+		cur = res;
 	}
 
 	assert(nlen == 0);
+
+	if ((lflag & L_FILE) && (res.type == VFS_NODE_DIRECTORY)) {
+		rc = EISDIR;
+		goto out;
+	}
+
+	if ((lflag & L_DIRECTORY) && (res.type == VFS_NODE_FILE)) {
+		rc = ENOTDIR;
+		goto out;
+	}
+
 	rc = EOK;
 
 	if (result != NULL) {
@@ -124,6 +124,11 @@ void vfs_node_delref(vfs_node_t *node)
 	fibril_mutex_unlock(&nodes_mutex);
 
 	if (free_node) {
+		if (node->size_changed) {
+			vfs_triplet_t tri = node_triplet(node);
+			vfs_dcache_set_size(&tri, node->size);
+		}
+
 		/*
 		 * VFS_OUT_DESTROY will free up the file's resources if there
 		 * are no more hard links.
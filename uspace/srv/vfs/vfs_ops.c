@@ -48,6 +48,7 @@
 #include <adt/list.h>
 #include <ctype.h>
 #include <assert.h>
+#include <as.h>
 #include <vfs/canonify.h>
 
 /* Forward declarations of static functions. */
@@ -85,6 +86,23 @@ static void out_destroy(vfs_triplet_t *file)
 	vfs_exchange_release(exch);
 }
 
+errno_t vfs_op_cache_stats(int fd)
+{
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+
+	vfs_node_t *node = file->node;
+
+	async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
+	errno_t rc = async_data_read_forward_3_0(exch, VFS_OUT_CACHE_STATS,
+	    node->service_id, node->index, false);
+	vfs_exchange_release(exch);
+
+	vfs_file_put(file);
+	return rc;
+}
+
 errno_t vfs_op_clone(int oldfd, int newfd, bool desc, int *out_fd)
 {
 	errno_t rc;
@@ -433,13 +451,18 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
 	assert(fs_info);
 
+	/*
+	 * Writes which append to the file depend on the cached size of the
+	 * node, so they always need the node for themselves.
+	 */
 	bool rlock = read ||
-	    (fs_info->concurrent_read_write && fs_info->write_retains_size);
+	    (fs_info->concurrent_read_write &&
+	    (fs_info->write_retains_size || !file->append));
 
 	/*
 	 * Lock the file's node so that no other client can read/write to it at
-	 * the same time unless the FS supports concurrent reads/writes and its
-	 * write implementation does not modify the file size.
+	 * the same time unless the FS supports concurrent reads/writes. Such a
+	 * FS serializes modifications of its nodes on its own.
 	 */
 	if (rlock)
 		fibril_rwlock_read_lock(&file->node->contents_rwlock);
@@ -485,12 +508,26 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 
 	/* Unlock the VFS node. */
 	if (rlock) {
+		if (!read && !fs_info->write_retains_size && rc == EOK) {
+			/*
+			 * Concurrent writes can only make the node grow and
+			 * their answers may arrive in any order. Nothing
+			 * blocks between the comparison and the update.
+			 */
+			aoff64_t size = MERGE_LOUP32(ipc_get_arg2(&answer),
+			    ipc_get_arg3(&answer));
+			if (size > file->node->size) {
+				file->node->size = size;
+				file->node->size_changed = true;
+			}
+		}
 		fibril_rwlock_read_unlock(&file->node->contents_rwlock);
 	} else {
 		/* Update the cached version of node's size. */
 		if (rc == EOK) {
 			file->node->size = MERGE_LOUP32(ipc_get_arg2(&answer),
 			    ipc_get_arg3(&answer));
+			file->node->size_changed = true;
 		}
 		fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	}
@@ -505,6 +542,91 @@ errno_t vfs_rdwr_internal(int fd, aoff64_t pos, bool read, rdwr_io_chunk_t *chun
 	return vfs_rdwr(fd, pos, read, rdwr_ipc_internal, chunk);
 }
 
+typedef struct {
+	void *area;
+	size_t offset;
+} page_map_data_t;
+
+static errno_t rdwr_ipc_page_map(async_exch_t *exch, vfs_file_t *file,
+    aoff64_t pos, ipc_call_t *answer, bool read, void *data)
+{
+	page_map_data_t *map = (page_map_data_t *) data;
+	vfs_page_map_t info;
+
+	if (exch == NULL)
+		return ENOENT;
+
+	aid_t msg = async_send_4(exch, VFS_OUT_PAGE_MAP,
+	    file->node->service_id, file->node->index, LOWER32(pos),
+	    UPPER32(pos), answer);
+	if (msg == 0)
+		return EINVAL;
+
+	/* The fs refuses holes and pages past EOF already here. */
+	errno_t rc = async_data_read_start(exch, &info, sizeof(info));
+	if (rc != EOK) {
+		async_forget(msg);
+		return rc;
+	}
+
+	void *area;
+	rc = async_share_in_start_0_0(exch, info.area_size, &area);
+	if (rc != EOK) {
+		async_forget(msg);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(msg, &retval);
+	if (retval != EOK || info.offset >= info.area_size) {
+		as_area_destroy(area);
+		return retval != EOK ? retval : EIO;
+	}
+
+	map->area = area;
+	map->offset = info.offset;
+	return EOK;
+}
+
+/** Map a file page of a file system which supports it into VFS.
+ *
+ * The page stays shared with the file system, i.e. it is not a copy.
+ *
+ * @param fd    File descriptor
+ * @param pos   Page aligned position in the file
+ * @param area  Place to store the address of the shared area which the
+ *              caller destroys once done with the page
+ * @param page  Place to store the address of the page within @a area
+ *
+ * @return EOK on success, ENOTSUP if the file system cannot map pages,
+ *         ENOENT if the page is a hole or past the end of the file or
+ *         another error code.
+ */
+errno_t vfs_page_map_internal(int fd, aoff64_t pos, void **area, void **page)
+{
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+
+	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
+	assert(fs_info);
+	bool page_map = fs_info->page_map &&
+	    file->node->type == VFS_NODE_FILE;
+	vfs_file_put(file);
+
+	if (!page_map)
+		return ENOTSUP;
+
+	page_map_data_t map;
+	errno_t rc = vfs_rdwr(fd, pos, true, rdwr_ipc_page_map, &map);
+	if (rc != EOK)
+		return rc;
+
+	*area = map.area;
+	*page = map.area + map.offset;
+	return EOK;
+}
+
 errno_t vfs_op_read(int fd, aoff64_t pos, size_t *out_bytes)
 {
 	return vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
@@ -626,8 +748,10 @@ errno_t vfs_op_resize(int fd, int64_t size)
 
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
-	if (rc == EOK)
+	if (rc == EOK) {
 		file->node->size = size;
+		file->node->size_changed = true;
+	}
 
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -822,6 +946,9 @@ errno_t vfs_op_unmount(int mpfd)
 		return rc;
 	}
 
+	vfs_dcache_purge_fs(mp->node->mount->fs_handle,
+	    mp->node->mount->service_id);
+
 	vfs_node_forget(mp->node->mount);
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
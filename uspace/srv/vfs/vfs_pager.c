@@ -44,11 +44,32 @@
 void vfs_page_in(ipc_call_t *req)
 {
 	aoff64_t offset = ipc_get_arg1(req);
-	size_t page_size = ipc_get_arg2(req);
+	size_t page_size = ipc_get_arg2(req) & ~(PAGE_SIZE - 1);
+	unsigned int flags = ipc_get_arg2(req) & (PAGE_SIZE - 1);
 	int fd = ipc_get_arg3(req);
+	void *area;
 	void *page;
 	errno_t rc;
 
+	/*
+	 * If the file system can share its own copy of the page with us,
+	 * pass that one on to read-only areas. The caller then maps the very
+	 * frame which backs the file instead of a private copy of it. The
+	 * mapping is not coherent with the file though, the frame stays mapped
+	 * even after the file is truncated.
+	 *
+	 * Writable areas always get a private copy, they must not modify the
+	 * file through the mapping.
+	 */
+	if (page_size == PAGE_SIZE && !(flags & AS_AREA_WRITE) &&
+	    vfs_page_map_internal(fd, offset, &area, &page) == EOK) {
+		/* Make sure the page is mapped in our address space. */
+		(void) *(volatile uint8_t *) page;
+		async_answer_1(req, EOK, (sysarg_t) page);
+		as_area_destroy(area);
+		return;
+	}
+
 	page = as_area_create(AS_AREA_ANY, page_size,
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);